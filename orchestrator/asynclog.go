@@ -0,0 +1,104 @@
+package main
+
+import (
+	"fmt"   // Dropped-lines notice
+	"io"    // Destination writer
+	"log"   // Fatal messages
+	"os"    // Exit
+	"sync"  // Buffer locks
+	"time"  // Flush interval
+)
+
+// Async log buffering (every log.Printf of the server goes through it)
+const (
+	LogFlushInterval = 100 * time.Millisecond
+	LogFlushSize     = 64 << 10  // Buffered bytes that wake the writer early
+	LogBufferMax     = 4 << 20   // Lines past this are dropped (and counted) until it catches up
+)
+
+// asyncLog is the log output set up by main() (nil: log writes directly)
+var asyncLog *AsyncLogWriter
+
+// AsyncLogWriter is a log output that never blocks a request on the log's
+// destination: Write appends the line to a buffer and returns, and a
+// goroutine writes the buffer out every LogFlushInterval (or once
+// LogFlushSize has piled up). With a slow terminal or disk the request path
+// only pays a mutex and a copy; if the writer falls LogBufferMax behind,
+// lines are dropped and a count of them is logged instead.
+type AsyncLogWriter struct {
+	out     io.Writer
+	mu      sync.Mutex  // buf, dropped
+	buf     []byte
+	dropped int
+	flushMu sync.Mutex  // One Flush at a time; owns spare
+	spare   []byte      // The other buffer, swapped in on every flush
+	wake    chan struct{}
+}
+
+// NewAsyncLogWriter starts the goroutine that writes to out
+func NewAsyncLogWriter(out io.Writer) *AsyncLogWriter {
+	w := &AsyncLogWriter{out: out, wake: make(chan struct{}, 1)}
+	go w.run()
+	return w
+}
+
+// Write buffers one log line (log.Logger calls it once per line)
+func (w *AsyncLogWriter) Write(p []byte) (int, error) {
+	w.mu.Lock()
+	if len(w.buf)+len(p) > LogBufferMax {
+		w.dropped++
+		w.mu.Unlock()
+		return len(p), nil
+	}
+	w.buf = append(w.buf, p...)
+	full := len(w.buf) >= LogFlushSize
+	w.mu.Unlock()
+
+	if full {
+		select {
+		case w.wake <- struct{}{}:
+		default:  // Already woken
+		}
+	}
+	return len(p), nil
+}
+
+func (w *AsyncLogWriter) run() {
+	ticker := time.NewTicker(LogFlushInterval)
+	for {
+		select {
+		case <-ticker.C:
+		case <-w.wake:
+		}
+		w.Flush()
+	}
+}
+
+// Flush writes out everything buffered so far
+func (w *AsyncLogWriter) Flush() {
+	w.flushMu.Lock()
+	defer w.flushMu.Unlock()
+
+	w.mu.Lock()
+	buf, dropped := w.buf, w.dropped
+	w.buf, w.dropped = w.spare[:0], 0
+	w.mu.Unlock()
+
+	if dropped > 0 {
+		buf = append(buf, fmt.Sprintf("%s %d log line(s) dropped, the log output is too slow\n",
+			time.Now().Format("2006/01/02 15:04:05"), dropped)...)
+	}
+	if len(buf) > 0 {
+		w.out.Write(buf)
+	}
+	w.spare = buf
+}
+
+// logFatalf is log.Fatalf that writes out the buffered log before exiting
+func logFatalf(format string, v ...interface{}) {
+	log.Printf(format, v...)
+	if asyncLog != nil {
+		asyncLog.Flush()
+	}
+	os.Exit(1)
+}
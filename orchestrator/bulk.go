@@ -0,0 +1,227 @@
+package main
+
+import (
+	"bufio"          // Request lines
+	"bytes"          // Captured single-operation responses
+	"encoding/json"  // NDJSON both ways
+	"fmt"            // Formatted I/O
+	"log"            // Logging
+	"net/http"       // Handler, full-duplex streaming
+	"time"           // Creation timestamps
+)
+
+// Bulk endpoint limits
+const (
+	BulkBatchSize   = 512      // Operations taken off the stream at once (creates share one transaction)
+	BulkMaxLineSize = 1 << 20  // Longest request line
+)
+
+// BulkOp is one line of a POST /bulk request body. Create takes the fields of
+// POST /containers, start a name and optional replicas.
+type BulkOp struct {
+	Op string `json:"op"`  // create/start
+	CreateRequest
+	Replicas int `json:"replicas,omitempty"`  // start only (default 1)
+
+	line int    // 1-based line number in the request
+	err  string // Parse error: the line is answered with a 400
+}
+
+// BulkResult is one line of the POST /bulk response, in request order
+type BulkResult struct {
+	Line    int             `json:"line"`
+	Op      string          `json:"op"`
+	Name    string          `json:"name,omitempty"`
+	Status  int             `json:"status"`              // What the single-container endpoint would have returned
+	Message string          `json:"message,omitempty"`
+	Error   string          `json:"error,omitempty"`
+	Data    json.RawMessage `json:"data,omitempty"`      // That endpoint's data (container, process)
+}
+
+// BulkHandler runs a stream of create/start operations (POST /bulk, NDJSON in and out).
+//
+// One connection carries any number of operations instead of one request (and
+// TLS handshake) each. The handler keeps reading while it answers: whatever
+// has arrived when it is ready is taken as one batch of up to BulkBatchSize,
+// consecutive creates in it are written in one database transaction (one
+// locked update of the state store), and the batch's results are flushed
+// before the next one. Over HTTP/1.1 that needs a full-duplex response;
+// HTTP/2 (TLS) always has one. Per-line errors are results, not failures of
+// the stream.
+func BulkHandler(w http.ResponseWriter, r *http.Request) {
+	rc := http.NewResponseController(w)
+	rc.EnableFullDuplex()  // Fails only where it isn't needed (HTTP/2)
+	w.Header().Set("Content-Type", "application/x-ndjson")
+	w.WriteHeader(http.StatusOK)
+
+	ops := make(chan BulkOp, BulkBatchSize)
+	go readBulkOps(r, ops)
+
+	enc := json.NewEncoder(w)
+	total := 0
+	for op := range ops {
+		batch := []BulkOp{op}
+	drain:
+		for len(batch) < BulkBatchSize {
+			select {
+			case next, ok := <-ops:
+				if !ok {
+					break drain
+				}
+				batch = append(batch, next)
+			default:
+				break drain
+			}
+		}
+
+		for _, result := range runBulkBatch(batch) {
+			if err := enc.Encode(result); err != nil {
+				return  // Client went away; the reader stops with the request context
+			}
+		}
+		if err := rc.Flush(); err != nil {
+			return
+		}
+		total += len(batch)
+	}
+	log.Printf("Bulk request: %d operation(s)", total)
+}
+
+// readBulkOps parses request lines into ops until the body ends (or the handler returns)
+func readBulkOps(r *http.Request, ops chan<- BulkOp) {
+	defer close(ops)
+	scanner := bufio.NewScanner(r.Body)
+	scanner.Buffer(make([]byte, 64*1024), BulkMaxLineSize)
+	line := 0
+	for scanner.Scan() {
+		line++
+		if len(bytes.TrimSpace(scanner.Bytes())) == 0 {
+			continue
+		}
+		op := BulkOp{line: line}
+		if err := json.Unmarshal(scanner.Bytes(), &op); err != nil {
+			op = BulkOp{line: line, err: "Invalid operation: " + err.Error()}
+		}
+		select {
+		case ops <- op:
+		case <-r.Context().Done():
+			return
+		}
+	}
+	// The rest of the stream can't be read (e.g. a line over BulkMaxLineSize)
+	if err := scanner.Err(); err != nil {
+		select {
+		case ops <- BulkOp{line: line + 1, err: "Invalid request body: " + err.Error()}:
+		case <-r.Context().Done():
+		}
+	}
+}
+
+// runBulkBatch answers a batch in order; each run of consecutive creates is one transaction
+func runBulkBatch(batch []BulkOp) []BulkResult {
+	results := make([]BulkResult, len(batch))
+	var creates []int  // Indexes of the pending run of creates
+	for i, op := range batch {
+		results[i] = BulkResult{Line: op.line, Op: op.Op, Name: op.Name}
+		switch {
+		case op.err != "":
+			results[i].Status, results[i].Error = http.StatusBadRequest, op.err
+		case op.Op == "create":
+			creates = append(creates, i)
+			continue
+		case op.Op == "start":
+			createBulk(batch, results, creates)
+			creates = nil
+			startBulk(op, &results[i])
+		default:
+			results[i].Status, results[i].Error = http.StatusBadRequest, fmt.Sprintf("Unknown op %q (create, start)", op.Op)
+		}
+	}
+	createBulk(batch, results, creates)
+	return results
+}
+
+// createBulk validates the creates at indexes and stores the valid ones in one transaction
+func createBulk(batch []BulkOp, results []BulkResult, indexes []int) {
+	var containers []*Container
+	var stored []int
+	now := time.Now()
+	for _, i := range indexes {
+		container, err := containerFromRequest(batch[i].CreateRequest)
+		if err != nil {
+			results[i].Status, results[i].Error = http.StatusBadRequest, err.Error()
+			continue
+		}
+		container.CreatedAt = now
+		containers = append(containers, &container)
+		stored = append(stored, i)
+	}
+	if len(containers) == 0 {
+		return
+	}
+
+	var errs []error
+	if useDatabase {
+		errs = db.CreateContainers(containers)
+	} else {
+		errs = store.CreateMany(containers)
+	}
+	for j, i := range stored {
+		switch errs[j] {
+		case nil:
+			results[i].Status, results[i].Message = http.StatusOK, "Container created successfully"
+			results[i].Data, _ = json.Marshal(containers[j])
+		case ErrContainerExists:
+			results[i].Status, results[i].Error = http.StatusConflict, "Container '"+results[i].Name+"' already exists"
+		default:
+			results[i].Status, results[i].Error = http.StatusInternalServerError, "Failed to create container: "+errs[j].Error()
+		}
+	}
+	log.Printf("Bulk: %d container(s) created in one transaction", len(containers))
+}
+
+// startBulk starts one container exactly like POST /containers/{name}/start would
+func startBulk(op BulkOp, result *BulkResult) {
+	replicas := op.Replicas
+	if replicas == 0 {
+		replicas = 1
+	}
+	if op.Name == "" || replicas < 1 || replicas > MaxReplicas {
+		result.Status = http.StatusBadRequest
+		result.Error = fmt.Sprintf("start needs a name and replicas between 1 and %d", MaxReplicas)
+		return
+	}
+	container, err := loadContainer(op.Name)
+	if err != nil {
+		if err.Error() == "container not found" {
+			result.Status, result.Error = http.StatusNotFound, "Container '"+op.Name+"' not found"
+		} else {
+			result.Status, result.Error = http.StatusInternalServerError, "Failed to get container: "+err.Error()
+		}
+		return
+	}
+
+	// Same path as the single start (fleet forwarding included), answered into a buffer
+	rec := &bulkRecorder{header: http.Header{}, status: http.StatusOK}
+	if coordinator == nil || !coordinator.Forward(rec, *container, replicas) {
+		submitStart(rec, *container, replicas)
+	}
+	var resp struct {
+		Message string          `json:"message"`
+		Error   string          `json:"error"`
+		Data    json.RawMessage `json:"data"`
+	}
+	json.Unmarshal(rec.body.Bytes(), &resp)  // APIResponse, with data kept as is
+	result.Status, result.Message, result.Error, result.Data = rec.status, resp.Message, resp.Error, resp.Data
+}
+
+// bulkRecorder is the http.ResponseWriter a bulk start answers into
+type bulkRecorder struct {
+	header http.Header
+	status int
+	body   bytes.Buffer
+}
+
+func (b *bulkRecorder) Header() http.Header         { return b.header }
+func (b *bulkRecorder) Write(p []byte) (int, error) { return b.body.Write(p) }
+func (b *bulkRecorder) WriteHeader(status int)      { b.status = status }
@@ -1,19 +1,59 @@
 package main
 
 import (
-	"database/sql"  // SQL database interface
-	"fmt"           // Formatted I/O
-	"time"          // Time and duration handling
+	"database/sql"   // SQL database interface
+	"encoding/json"  // Limits are stored as JSONB
+	"fmt"            // Formatted I/O
+	"log"            // Listener errors
+	"os"             // Pool settings from the environment
+	"strings"        // Notification payload parsing
+	"time"           // Time and duration handling
 
-	_ "github.com/lib/pq"  // PostgreSQL driver (imported for side effects)
+	"github.com/lib/pq"  // PostgreSQL driver and LISTEN/NOTIFY client
 )
 
-// Database handles PostgreSQL operations with connection pooling
+// ChangeChannel is the NOTIFY channel the containers trigger publishes "<OP> <name>" on
+const ChangeChannel = "container_changes"
+
+// Connection pool defaults (override with DB_MAX_OPEN_CONNS / DB_MAX_IDLE_CONNS /
+// DB_CONN_MAX_LIFETIME). Idle equals open so a burst doesn't close and reopen
+// connections, which with prepared statements also means re-preparing them.
+const (
+	DefaultMaxOpenConns    = 25
+	DefaultMaxIdleConns    = 25
+	DefaultConnMaxLifetime = 30 * time.Minute
+	DefaultConnMaxIdleTime = 5 * time.Minute  // Shrink back after a burst
+)
+
+// Column list shared by every SELECT (order matches scanContainer)
+const containerColumns = `name, rootfs, command, argv, init, status, limits, created_at`
+
+// Keyset pages are ordered newest first with name as the tie-breaker, served by
+// idx_containers_created_name, or idx_containers_status_created when filtering
+const pageOrder = ` ORDER BY created_at DESC, name DESC`
+
+// ErrContainerExists is returned by CreateContainer when the name is taken
+var ErrContainerExists = fmt.Errorf("container already exists")
+
+// statements are prepared once by InitializeSchema (hot paths only)
+type statements struct {
+	insert, get, updateStatus, updateLimits, remove *sql.Stmt
+	page, pageAfter                                 *sql.Stmt  // All statuses
+	statusPage, statusPageAfter                     *sql.Stmt  // WHERE status = $1
+}
+
+// Database handles PostgreSQL operations with connection pooling.
+// Reads are served from an in-memory Registry that every write goes
+// through and that LISTEN/NOTIFY keeps in step with other replicas.
 type Database struct {
-	conn *sql.DB
+	conn     *sql.DB
+	connStr  string
+	cache    *Registry
+	listener *pq.Listener  // nil until InitializeSchema
+	stmts    statements    // Prepared by InitializeSchema
 }
 
-// NewDatabase creates database connection with pooling (25 max, 5 idle, 5min lifetime)
+// NewDatabase creates database connection with pooling (25 max and idle, 30min lifetime by default)
 func NewDatabase(host, port, user, password, dbname string) (*Database, error) {
 	connStr := fmt.Sprintf("host=%s port=%s user=%s password=%s dbname=%s sslmode=disable",
 		host, port, user, password, dbname)
@@ -29,46 +69,189 @@ func NewDatabase(host, port, user, password, dbname string) (*Database, error) {
 	}
 	
 	// Configure connection pool for optimal performance
-	conn.SetMaxOpenConns(25)               // Max 25 concurrent connections
-	conn.SetMaxIdleConns(5)                // Keep 5 idle connections ready
-	conn.SetConnMaxLifetime(5 * time.Minute)  // Recycle connections after 5 minutes
+	conn.SetMaxOpenConns(envInt("DB_MAX_OPEN_CONNS", DefaultMaxOpenConns))  // Concurrent connections
+	conn.SetMaxIdleConns(envInt("DB_MAX_IDLE_CONNS", DefaultMaxIdleConns))  // Idle connections kept ready
+	conn.SetConnMaxLifetime(envDuration("DB_CONN_MAX_LIFETIME", DefaultConnMaxLifetime))  // Recycle connections
+	conn.SetConnMaxIdleTime(DefaultConnMaxIdleTime)
 	
-	return &Database{conn: conn}, nil
+	return &Database{conn: conn, connStr: connStr, cache: NewRegistry()}, nil
 }
 
-// Close shuts down database connection pool
+// Close stops the change listener and shuts down database connection pool
 func (db *Database) Close() error {
+	if db.listener != nil {
+		db.listener.Close()
+	}
 	if db.conn != nil {
 		return db.conn.Close()
 	}
 	return nil
 }
 
-// CreateContainer inserts new container with parameterized query (SQL injection safe)
+// envDuration returns a positive duration ("30m") from the environment, or def
+func envDuration(name string, def time.Duration) time.Duration {
+	if value := os.Getenv(name); value != "" {
+		if d, err := time.ParseDuration(value); err == nil && d > 0 {
+			return d
+		}
+		log.Printf("Warning: ignoring invalid %s=%q", name, value)
+	}
+	return def
+}
+
+// prepareStatements prepares the hot statements once (the table must exist)
+func (db *Database) prepareStatements() error {
+	queries := []struct {
+		stmt  **sql.Stmt
+		query string
+	}{
+		{&db.stmts.insert, `INSERT INTO containers (name, rootfs, command, argv, init, status, limits, created_at, updated_at)
+		                    VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9)
+		                    ON CONFLICT (name) DO NOTHING`},
+		{&db.stmts.get, `SELECT ` + containerColumns + ` FROM containers WHERE name = $1`},
+		{&db.stmts.updateStatus, `UPDATE containers SET status = $1, updated_at = $2 WHERE name = $3`},
+		{&db.stmts.updateLimits, `UPDATE containers SET limits = $1, updated_at = $2 WHERE name = $3`},
+		{&db.stmts.remove, `DELETE FROM containers WHERE name = $1`},
+		{&db.stmts.page, `SELECT ` + containerColumns + ` FROM containers` + pageOrder + ` LIMIT $1`},
+		{&db.stmts.pageAfter, `SELECT ` + containerColumns + ` FROM containers
+		                       WHERE (created_at, name) < ($1, $2)` + pageOrder + ` LIMIT $3`},
+		{&db.stmts.statusPage, `SELECT ` + containerColumns + ` FROM containers
+		                        WHERE status = $1` + pageOrder + ` LIMIT $2`},
+		{&db.stmts.statusPageAfter, `SELECT ` + containerColumns + ` FROM containers
+		                             WHERE status = $1 AND (created_at, name) < ($2, $3)` + pageOrder + ` LIMIT $4`},
+	}
+
+	for _, q := range queries {
+		stmt, err := db.conn.Prepare(q.query)
+		if err != nil {
+			return fmt.Errorf("failed to prepare statement: %w", err)
+		}
+		*q.stmt = stmt
+	}
+	return nil
+}
+
+// rowScanner is satisfied by *sql.Row and *sql.Rows
+type rowScanner interface {
+	Scan(dest ...interface{}) error
+}
+
+// scanContainer reads one row selected with containerColumns
+func scanContainer(row rowScanner) (*Container, error) {
+	var container Container
+	var limits, argv []byte
+	if err := row.Scan(&container.Name, &container.RootFS, &container.Command, &argv, &container.Init,
+		&container.Status, &limits, &container.CreatedAt); err != nil {
+		return nil, err
+	}
+	if argv != nil {
+		if err := json.Unmarshal(argv, &container.Argv); err != nil {
+			return nil, fmt.Errorf("failed to decode argv for %s: %w", container.Name, err)
+		}
+	}
+	if err := json.Unmarshal(limits, &container.Limits); err != nil {
+		return nil, fmt.Errorf("failed to decode limits for %s: %w", container.Name, err)
+	}
+	return &container, nil
+}
+
+// CreateContainer inserts new container with parameterized query (SQL injection safe).
+// The name check and the insert are one statement: ErrContainerExists if taken.
 func (db *Database) CreateContainer(c *Container) error {
-	query := `INSERT INTO containers (name, rootfs, command, status, created_at, updated_at)
-	          VALUES ($1, $2, $3, $4, $5, $6)`
-	
-	_, err := db.conn.Exec(query,
-		c.Name, c.RootFS, c.Command, c.Status, c.CreatedAt, time.Now())
+	if err := insertContainer(db.stmts.insert, c); err != nil {
+		return err
+	}
+	db.cache.Put(*c)
+	return nil
+}
+
+// CreateContainers inserts containers in one transaction (bulk creates): one
+// round trip to commit instead of one per container. The result has one error
+// per container, ErrContainerExists for a taken name; any other error rolls
+// the whole transaction back and is every container's error.
+func (db *Database) CreateContainers(cs []*Container) []error {
+	errs := make([]error, len(cs))
+	fail := func(err error) []error {
+		for i := range errs {
+			errs[i] = err
+		}
+		return errs
+	}
+
+	tx, err := db.conn.Begin()
+	if err != nil {
+		return fail(fmt.Errorf("failed to begin transaction: %w", err))
+	}
+	insert := tx.Stmt(db.stmts.insert)
+	for i, c := range cs {
+		if err := insertContainer(insert, c); err == ErrContainerExists {
+			errs[i] = err
+		} else if err != nil {
+			tx.Rollback()
+			return fail(err)
+		}
+	}
+	if err := tx.Commit(); err != nil {
+		return fail(fmt.Errorf("failed to commit containers: %w", err))
+	}
+
+	for i, c := range cs {
+		if errs[i] == nil {
+			db.cache.Put(*c)
+		}
+	}
+	return errs
+}
+
+// insertContainer runs the insert statement (or its transaction copy) for one container
+func insertContainer(insert *sql.Stmt, c *Container) error {
+	limits, err := json.Marshal(c.Limits)
+	if err != nil {
+		return fmt.Errorf("failed to encode limits: %w", err)
+	}
+	var argv []byte  // NULL: bash -c command
+	if len(c.Argv) > 0 {
+		if argv, err = json.Marshal(c.Argv); err != nil {
+			return fmt.Errorf("failed to encode argv: %w", err)
+		}
+	}
+
+	result, err := insert.Exec(
+		c.Name, c.RootFS, c.Command, argv, c.Init, c.Status, limits, c.CreatedAt, time.Now())
 	
 	if err != nil {
 		return fmt.Errorf("failed to create container: %w", err)
 	}
 	
+	rows, err := result.RowsAffected()
+	if err != nil {
+		return fmt.Errorf("failed to get rows affected: %w", err)
+	}
+
+	if rows == 0 {
+		return ErrContainerExists
+	}
 	return nil
 }
 
 // GetContainer retrieves container by name, returns error if not found
 func (db *Database) GetContainer(name string) (*Container, error) {
-	query := `SELECT name, rootfs, command, status, created_at
-	          FROM containers WHERE name = $1`
-	
-	var container Container
-	err := db.conn.QueryRow(query, name).Scan(
-		&container.Name, &container.RootFS, &container.Command,
-		&container.Status, &container.CreatedAt)
-	
+	if c, ok := db.cache.Get(name); ok {
+		return &c, nil
+	}
+
+	// Miss: possibly created by another replica whose NOTIFY hasn't arrived yet
+	container, err := db.fetchContainer(name)
+	if err != nil {
+		return nil, err
+	}
+	db.cache.Put(*container)
+	return container, nil
+}
+
+// fetchContainer reads one row, bypassing the registry
+func (db *Database) fetchContainer(name string) (*Container, error) {
+	container, err := scanContainer(db.stmts.get.QueryRow(name))
 	if err == sql.ErrNoRows {
 		return nil, fmt.Errorf("container not found")
 	}
@@ -76,29 +259,52 @@ func (db *Database) GetContainer(name string) (*Container, error) {
 		return nil, fmt.Errorf("failed to get container: %w", err)
 	}
 	
-	return &container, nil
+	return container, nil
 }
 
-// ListContainers retrieves all containers ordered by creation time (newest first)
-func (db *Database) ListContainers() ([]Container, error) {
-	query := `SELECT name, rootfs, command, status, created_at
-	          FROM containers ORDER BY created_at DESC`
-	
-	rows, err := db.conn.Query(query)
+// ListContainers retrieves one keyset page ordered by creation time (newest first).
+// Each page is an index range scan starting at the cursor, so its cost depends
+// on opts.Limit only, not on the table size or how deep the page is.
+func (db *Database) ListContainers(opts ListOptions) ([]Container, error) {
+	var rows *sql.Rows
+	var err error
+
+	switch {
+	case opts.Status == "" && opts.After == nil:
+		rows, err = db.stmts.page.Query(opts.Limit)
+	case opts.Status == "":
+		rows, err = db.stmts.pageAfter.Query(opts.After.CreatedAt, opts.After.Name, opts.Limit)
+	case opts.After == nil:
+		rows, err = db.stmts.statusPage.Query(opts.Status, opts.Limit)
+	default:
+		rows, err = db.stmts.statusPageAfter.Query(opts.Status, opts.After.CreatedAt, opts.After.Name, opts.Limit)
+	}
 	if err != nil {
 		return nil, fmt.Errorf("failed to list containers: %w", err)
 	}
+	return collectContainers(rows)
+}
+
+// fetchContainers reads the whole table, bypassing the registry (warm-up only)
+func (db *Database) fetchContainers() ([]Container, error) {
+	rows, err := db.conn.Query(`SELECT ` + containerColumns + ` FROM containers`)
+	if err != nil {
+		return nil, fmt.Errorf("failed to list containers: %w", err)
+	}
+	return collectContainers(rows)
+}
+
+// collectContainers scans and closes a result set
+func collectContainers(rows *sql.Rows) ([]Container, error) {
 	defer rows.Close()
 	
 	containers := []Container{}
 	for rows.Next() {
-		var container Container
-		err := rows.Scan(&container.Name, &container.RootFS, &container.Command,
-			&container.Status, &container.CreatedAt)
+		container, err := scanContainer(rows)
 		if err != nil {
 			return nil, fmt.Errorf("failed to scan container: %w", err)
 		}
-		containers = append(containers, container)
+		containers = append(containers, *container)
 	}
 	
 	if err := rows.Err(); err != nil {
@@ -110,9 +316,7 @@ func (db *Database) ListContainers() ([]Container, error) {
 
 // UpdateContainerStatus changes container status with automatic timestamp update
 func (db *Database) UpdateContainerStatus(name, status string) error {
-	query := `UPDATE containers SET status = $1, updated_at = $2 WHERE name = $3`
-	
-	result, err := db.conn.Exec(query, status, time.Now(), name)
+	result, err := db.stmts.updateStatus.Exec(status, time.Now(), name)
 	if err != nil {
 		return fmt.Errorf("failed to update container status: %w", err)
 	}
@@ -126,16 +330,20 @@ func (db *Database) UpdateContainerStatus(name, status string) error {
 		return fmt.Errorf("container not found")
 	}
 	
+	db.cache.SetStatus(name, status)
 	return nil
 }
 
-// DeleteContainer removes container from database, returns error if not found
-func (db *Database) DeleteContainer(name string) error {
-	query := `DELETE FROM containers WHERE name = $1`
-	
-	result, err := db.conn.Exec(query, name)
+// UpdateContainerLimits replaces the stored limits (PATCH /containers/{name})
+func (db *Database) UpdateContainerLimits(name string, limits ResourceLimits) error {
+	encoded, err := json.Marshal(limits)
 	if err != nil {
-		return fmt.Errorf("failed to delete container: %w", err)
+		return fmt.Errorf("failed to encode limits: %w", err)
+	}
+
+	result, err := db.stmts.updateLimits.Exec(encoded, time.Now(), name)
+	if err != nil {
+		return fmt.Errorf("failed to update container limits: %w", err)
 	}
 	
 	rows, err := result.RowsAffected()
@@ -147,23 +355,32 @@ func (db *Database) DeleteContainer(name string) error {
 		return fmt.Errorf("container not found")
 	}
 	
+	db.cache.SetLimits(name, limits)
 	return nil
 }
 
-// ContainerExists quickly checks if container name is already taken
-func (db *Database) ContainerExists(name string) (bool, error) {
-	query := `SELECT EXISTS(SELECT 1 FROM containers WHERE name = $1)`
+// DeleteContainer removes container from database, returns error if not found
+func (db *Database) DeleteContainer(name string) error {
+	result, err := db.stmts.remove.Exec(name)
+	if err != nil {
+		return fmt.Errorf("failed to delete container: %w", err)
+	}
 	
-	var exists bool
-	err := db.conn.QueryRow(query, name).Scan(&exists)
+	rows, err := result.RowsAffected()
 	if err != nil {
-		return false, fmt.Errorf("failed to check container existence: %w", err)
+		return fmt.Errorf("failed to get rows affected: %w", err)
+	}
+	
+	if rows == 0 {
+		return fmt.Errorf("container not found")
 	}
 	
-	return exists, nil
+	db.cache.Delete(name)
+	return nil
 }
 
-// InitializeSchema creates tables and indexes if they don't exist (idempotent)
+// InitializeSchema creates tables, indexes and the change trigger if they don't
+// exist (idempotent), then subscribes to changes and warms the registry
 func (db *Database) InitializeSchema() error {
 	schema := `
 		CREATE TABLE IF NOT EXISTS containers (
@@ -172,17 +389,104 @@ func (db *Database) InitializeSchema() error {
 			rootfs VARCHAR(512) NOT NULL,
 			command VARCHAR(255) NOT NULL,
 			status VARCHAR(50) NOT NULL,
+			limits JSONB NOT NULL DEFAULT '{}',
+			argv JSONB,
+			init BOOLEAN NOT NULL DEFAULT FALSE,
 			created_at TIMESTAMP NOT NULL,
 			updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
 		);
+		ALTER TABLE containers ADD COLUMN IF NOT EXISTS limits JSONB NOT NULL DEFAULT '{}';
+		ALTER TABLE containers ADD COLUMN IF NOT EXISTS argv JSONB;
+		ALTER TABLE containers ADD COLUMN IF NOT EXISTS init BOOLEAN NOT NULL DEFAULT FALSE;
 		CREATE INDEX IF NOT EXISTS idx_containers_status ON containers(status);
 		CREATE INDEX IF NOT EXISTS idx_containers_created ON containers(created_at);
+		CREATE INDEX IF NOT EXISTS idx_containers_created_name ON containers(created_at DESC, name DESC);
+		CREATE INDEX IF NOT EXISTS idx_containers_status_created ON containers(status, created_at DESC, name DESC);
+
+		CREATE OR REPLACE FUNCTION notify_container_change() RETURNS TRIGGER AS $$
+		BEGIN
+			IF TG_OP = 'DELETE' THEN
+				PERFORM pg_notify('` + ChangeChannel + `', TG_OP || ' ' || OLD.name);
+			ELSE
+				PERFORM pg_notify('` + ChangeChannel + `', TG_OP || ' ' || NEW.name);
+			END IF;
+			RETURN NULL;
+		END;
+		$$ LANGUAGE plpgsql;
+		DROP TRIGGER IF EXISTS notify_containers_change ON containers;
+		CREATE TRIGGER notify_containers_change
+			AFTER INSERT OR UPDATE OR DELETE ON containers
+			FOR EACH ROW EXECUTE FUNCTION notify_container_change();
 	`
 	
 	_, err := db.conn.Exec(schema)
 	if err != nil {
 		return fmt.Errorf("failed to initialize schema: %w", err)
 	}
+
+	if err := db.prepareStatements(); err != nil {
+		return err
+	}
 	
+	// Subscribe before the snapshot so no change falls between the two
+	db.listener = pq.NewListener(db.connStr, 10*time.Second, time.Minute,
+		func(event pq.ListenerEventType, err error) {
+			if err != nil {
+				log.Printf("Warning: change listener: %v", err)
+			}
+		})
+	if err := db.listener.Listen(ChangeChannel); err != nil {
+		return fmt.Errorf("failed to listen for changes: %w", err)
+	}
+
+	if err := db.warmCache(); err != nil {
+		return err
+	}
+	go db.applyChanges()
+
+	return nil
+}
+
+// warmCache loads the whole table into the registry
+func (db *Database) warmCache() error {
+	containers, err := db.fetchContainers()
+	if err != nil {
+		return err
+	}
+	db.cache.Replace(containers)
+	log.Printf("Container registry warmed with %d container(s)", len(containers))
 	return nil
+}
+
+// applyChanges keeps the registry in step with writes made by any replica
+func (db *Database) applyChanges() {
+	for n := range db.listener.Notify {
+		if n == nil {
+			// Reconnected: notifications may have been missed, reload everything
+			if err := db.warmCache(); err != nil {
+				log.Printf("Warning: registry resync failed: %v", err)
+			}
+			continue
+		}
+
+		op, name, ok := strings.Cut(n.Extra, " ")
+		if !ok {
+			continue
+		}
+		if op == "DELETE" {
+			db.cache.Delete(name)
+			continue
+		}
+
+		// INSERT/UPDATE: re-read the row (this replica's own writes come back too)
+		container, err := db.fetchContainer(name)
+		switch {
+		case err == nil:
+			db.cache.Put(*container)
+		case err.Error() == "container not found":
+			db.cache.Delete(name)  // Deleted again before we read it
+		default:
+			log.Printf("Warning: failed to refresh container '%s': %v", name, err)
+		}
+	}
 }
\ No newline at end of file
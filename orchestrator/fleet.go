@@ -0,0 +1,568 @@
+package main
+
+import (
+	"bufio"              // /proc/meminfo
+	"bytes"              // Forwarded request bodies
+	"encoding/json"      // Heartbeats and forwarded containers
+	"fmt"                // Formatted I/O
+	"io"                 // Response passthrough
+	"log"                // Logging
+	"net/http"           // Heartbeats, forwarding
+	"net/http/httputil"  // Process and log proxying
+	"net/url"            // Node addresses
+	"os"                 // /proc, cgroups and environment
+	"path/filepath"      // Cgroup directories
+	"runtime"            // Online CPU count
+	"sort"               // Node listing order
+	"strconv"            // Query parameters, cgroup values
+	"strings"            // /proc and cgroup parsing
+	"sync"               // Node table lock
+	"time"               // Heartbeat interval and expiry
+
+	"github.com/gorilla/mux"  // URL parameters
+)
+
+// Fleet defaults (override with HEARTBEAT_INTERVAL)
+const (
+	DefaultHeartbeatInterval = 2 * time.Second
+	NodeExpiryHeartbeats     = 3                      // Missed heartbeats before a node gets no more starts
+	FleetRequestTimeout      = 10 * time.Second       // Heartbeats and forwarded starts
+	CgroupRoot               = "/sys/fs/cgroup"       // CGROUP_ROOT in container_runtime.c
+	ForwardedHeader          = "X-Minirun-Forwarded"  // Set on proxied requests so a node never proxies them again
+)
+
+// Scheduling policies (FLEET_SCHEDULER)
+const (
+	ScheduleLeastLoaded = "least-loaded"  // Node with the lowest CPU/memory commitment
+	ScheduleBinpack     = "binpack"       // Fullest node that still has room, so others stay empty
+)
+
+// NodeCapacity is what a node agent reports in each heartbeat (POST /nodes/heartbeat)
+type NodeCapacity struct {
+	Name            string  `json:"name"`
+	Addr            string  `json:"addr"`              // Base URL starts are forwarded to
+	CPUs            int     `json:"cpus"`
+	CPUIdle         float64 `json:"cpu_idle"`          // Idle fraction since the previous heartbeat (/proc/stat)
+	MemoryTotal     int64   `json:"memory_total"`      // Bytes (/proc/meminfo)
+	MemoryAvailable int64   `json:"memory_available"`  // MemAvailable
+	CPUCommitted    int     `json:"cpu_committed"`     // Sum of running containers' cpu.max, % of one core
+	MemoryCommitted int64   `json:"memory_committed"`  // Sum of running containers' memory.max
+	Running         int     `json:"running"`           // Populated minirun-* cgroups
+	Queued          int     `json:"queued"`            // Starts waiting in its launch queue
+}
+
+// FleetNode is the coordinator's view of one node (GET /nodes)
+type FleetNode struct {
+	NodeCapacity
+	LastSeen time.Time `json:"last_seen"`
+	Alive    bool      `json:"alive"`    // Heard from within NodeExpiryHeartbeats intervals
+	Load     float64   `json:"load"`     // max(CPU, memory) commitment, 0..1+, pending starts included
+	Started  int64     `json:"started"`  // Starts forwarded to it since the coordinator came up
+
+	// Forwarded since its last heartbeat, so a burst of starts doesn't all pick the same node
+	pendingCPU     int
+	pendingMemory  int64
+	pendingRunning int
+}
+
+// Coordinator places starts on the nodes whose agents heartbeat to it.
+//
+// Every host runs its own orchestrator, store and launcher. A host started with
+// COORDINATOR_URL is a node agent: it reports its capacity every
+// HEARTBEAT_INTERVAL and accepts forwarded starts on POST /fleet/launch. The
+// host started with FLEET_SCHEDULER is the coordinator. Its
+// POST /containers/{name}/start picks a live node and forwards the container
+// config and the start there. The node creates the container in its own store
+// if needed and queues it on its own launcher, then returns the usual 202. Each
+// node's launch queue and kernel only see their own share, so the start rate
+// grows with the number of nodes. The coordinator remembers where each
+// container went and proxies requests about it to that node (proxiedHandler),
+// keeping its own copy in step (syncForwarded). With no live node it starts
+// containers itself.
+type Coordinator struct {
+	policy   string
+	interval time.Duration
+	token    string  // FLEET_TOKEN: required from agents, sent to them ("" = none)
+	client   *http.Client
+	mu       sync.Mutex
+	nodes    map[string]*FleetNode
+	assigned map[string]string  // Container -> node it was last started on
+}
+
+// Coordinator of this server (nil unless FLEET_SCHEDULER is set)
+var coordinator *Coordinator
+
+// NewCoordinatorFromEnv reads FLEET_SCHEDULER, HEARTBEAT_INTERVAL and FLEET_TOKEN; nil if not a coordinator
+func NewCoordinatorFromEnv() *Coordinator {
+	policy := os.Getenv("FLEET_SCHEDULER")
+	if policy == "" {
+		return nil
+	}
+	if policy != ScheduleLeastLoaded && policy != ScheduleBinpack {
+		log.Printf("Warning: ignoring invalid FLEET_SCHEDULER=%q (least-loaded or binpack)", policy)
+		return nil
+	}
+	log.Printf("Fleet coordinator: %s scheduling", policy)
+	return &Coordinator{
+		policy:   policy,
+		interval: envDuration("HEARTBEAT_INTERVAL", DefaultHeartbeatInterval),
+		token:    os.Getenv("FLEET_TOKEN"),
+		client:   &http.Client{Timeout: FleetRequestTimeout},
+		nodes:    make(map[string]*FleetNode),
+		assigned: make(map[string]string),
+	}
+}
+
+// fleetAuthorized checks the fleet token of an agent request
+func fleetAuthorized(r *http.Request, token string) bool {
+	return token == "" || r.Header.Get("Authorization") == "Bearer "+token
+}
+
+// demand is what one start of a container adds to a node (runtime defaults when unset)
+func demand(limits ResourceLimits, replicas int) (int, int64) {
+	cpu, memory := limits.CPU, limits.Memory
+	if cpu == 0 {
+		cpu = DefaultCPUPercent
+	}
+	if memory == 0 {
+		memory = DefaultMemoryLimit
+	}
+	return cpu * replicas, memory * int64(replicas)
+}
+
+// load is a node's commitment: the larger of its CPU and memory shares (lock held)
+func (n *FleetNode) load() float64 {
+	cpu := float64(n.CPUCommitted+n.pendingCPU) / float64(n.CPUs*100)
+	memory := 1 - float64(n.MemoryAvailable-n.pendingMemory)/float64(n.MemoryTotal)
+	if cpu > memory {
+		return cpu
+	}
+	return memory
+}
+
+// pick returns the node for a start by the policy, nil if no live node has the memory (lock held)
+func (co *Coordinator) pick(cpu int, memory int64) *FleetNode {
+	var best *FleetNode
+	bestRoom := false
+	for _, n := range co.nodes {
+		if time.Since(n.LastSeen) > NodeExpiryHeartbeats*co.interval || n.MemoryTotal <= 0 || n.CPUs <= 0 ||
+			n.MemoryAvailable-n.pendingMemory < memory {
+			continue
+		}
+		room := n.CPUCommitted+n.pendingCPU+cpu <= n.CPUs*100
+		if best == nil {
+			best, bestRoom = n, room
+			continue
+		}
+		load, bestLoad := n.load(), best.load()
+		switch {
+		case co.policy == ScheduleBinpack && room != bestRoom:
+			// Fullest node whose CPUs aren't overcommitted yet; least loaded if there is none
+			if room {
+				best, bestRoom = n, room
+			}
+		case co.policy == ScheduleBinpack && room:
+			if load > bestLoad {
+				best, bestRoom = n, room
+			}
+		case load < bestLoad || (load == bestLoad && n.Running+n.pendingRunning < best.Running+best.pendingRunning):
+			best, bestRoom = n, room
+		}
+	}
+	return best
+}
+
+// Forward starts a container on a node and relays the node's response; false if
+// there is no live node, so the caller starts it here
+func (co *Coordinator) Forward(w http.ResponseWriter, c Container, replicas int) bool {
+	cpu, memory := demand(c.Limits, replicas)
+
+	co.mu.Lock()
+	live := 0
+	for _, n := range co.nodes {
+		if time.Since(n.LastSeen) <= NodeExpiryHeartbeats*co.interval {
+			live++
+		}
+	}
+	if live == 0 {
+		co.mu.Unlock()
+		return false
+	}
+	node := co.pick(cpu, memory)
+	if node == nil {
+		co.mu.Unlock()
+		w.Header().Set("Retry-After", strconv.Itoa(int(co.interval.Seconds())+1))
+		ErrorResponse(w, "No node has room for this container, retry later", http.StatusServiceUnavailable)
+		return true
+	}
+	node.pendingCPU += cpu
+	node.pendingMemory += memory
+	node.pendingRunning += replicas
+	name, addr := node.Name, node.Addr
+	co.mu.Unlock()
+
+	body, err := json.Marshal(c)
+	if err == nil {
+		var req *http.Request
+		req, err = http.NewRequest("POST", addr+"/fleet/launch?replicas="+strconv.Itoa(replicas), bytes.NewReader(body))
+		if err == nil {
+			req.Header.Set("Content-Type", "application/json")
+			if co.token != "" {
+				req.Header.Set("Authorization", "Bearer "+co.token)
+			}
+			var resp *http.Response
+			if resp, err = co.client.Do(req); err == nil {
+				defer resp.Body.Close()
+				co.mu.Lock()
+				accepted := resp.StatusCode == http.StatusAccepted
+				if accepted {
+					co.assigned[c.Name] = name
+					node.Started++
+				} else {
+					node.pendingCPU -= cpu
+					node.pendingMemory -= memory
+					node.pendingRunning -= replicas
+				}
+				co.mu.Unlock()
+				if accepted {
+					setContainerStatus(c.Name, "running")  // Our copy; kept in step by syncForwarded
+				}
+
+				log.Printf("Container '%s' forwarded to node %s (%d)", c.Name, name, resp.StatusCode)
+				for _, header := range []string{"Content-Type", "Retry-After"} {
+					if value := resp.Header.Get(header); value != "" {
+						w.Header().Set(header, value)
+					}
+				}
+				w.Header().Set("X-Minirun-Node", name)
+				w.WriteHeader(resp.StatusCode)
+				io.Copy(w, resp.Body)
+				return true
+			}
+		}
+	}
+
+	// Unreachable: stop sending it starts until it heartbeats again
+	co.mu.Lock()
+	node.pendingCPU -= cpu
+	node.pendingMemory -= memory
+	node.pendingRunning -= replicas
+	node.LastSeen = time.Time{}
+	co.mu.Unlock()
+	log.Printf("Warning: failed to forward '%s' to node %s: %v", c.Name, name, err)
+	ErrorResponse(w, "Failed to forward start to node "+name+": "+err.Error(), http.StatusBadGateway)
+	return true
+}
+
+// Proxy relays a request about a forwarded container to its node; false if it wasn't forwarded
+func (co *Coordinator) Proxy(w http.ResponseWriter, r *http.Request, container string) bool {
+	co.mu.Lock()
+	node, ok := co.nodes[co.assigned[container]]
+	var addr string
+	if ok {
+		addr = node.Addr
+	}
+	co.mu.Unlock()
+	if !ok {
+		return false
+	}
+
+	target, err := url.Parse(addr)
+	if err != nil {
+		ErrorResponse(w, "Invalid address of node "+node.Name+": "+err.Error(), http.StatusBadGateway)
+		return true
+	}
+	proxy := httputil.NewSingleHostReverseProxy(target)
+	proxy.FlushInterval = -1  // logs?follow=1 streams
+	if !strings.HasSuffix(r.URL.Path, "/logs") {
+		proxy.ModifyResponse = func(resp *http.Response) error {
+			body, err := io.ReadAll(resp.Body)
+			resp.Body.Close()
+			resp.Body = io.NopCloser(bytes.NewReader(body))
+			if err == nil {
+				co.syncForwarded(container, r, resp.StatusCode, body)
+			}
+			return err
+		}
+	}
+	r.Header.Set(ForwardedHeader, "1")
+	proxy.ServeHTTP(w, r)
+	return true
+}
+
+// syncForwarded applies a node's answer about a forwarded container to the
+// coordinator's own copy, which lists and GETs still read: the status the
+// node's process reports, limits a PATCH changed, and a DELETE. A node that
+// no longer knows the container (404 on DELETE) gives it back, so deleting
+// again removes the copy here.
+func (co *Coordinator) syncForwarded(name string, r *http.Request, status int, body []byte) {
+	if r.Method == "DELETE" && (status == http.StatusOK || status == http.StatusNotFound) {
+		co.mu.Lock()
+		delete(co.assigned, name)
+		co.mu.Unlock()
+		if status == http.StatusOK {
+			if err := deleteContainer(name); err != nil && err.Error() != "container not found" {
+				log.Printf("Warning: failed to delete the copy of forwarded container '%s': %v", name, err)
+			}
+		}
+		return
+	}
+	if status != http.StatusOK {
+		return
+	}
+
+	var resp struct {
+		Data struct {
+			Status string          `json:"status"`
+			Limits *ResourceLimits `json:"limits"`  // PATCH: the node's merged limits
+		} `json:"data"`
+	}
+	if json.Unmarshal(body, &resp) != nil {
+		return
+	}
+	if r.Method == "PATCH" && resp.Data.Limits != nil {
+		var err error
+		if useDatabase {
+			err = db.UpdateContainerLimits(name, *resp.Data.Limits)
+		} else {
+			err = store.SetLimits(name, *resp.Data.Limits)
+		}
+		if err != nil {
+			log.Printf("Warning: failed to update the copy of forwarded container '%s': %v", name, err)
+		}
+	}
+	if r.Method == "GET" && strings.HasSuffix(r.URL.Path, "/process") {
+		current := resp.Data.Status
+		if current == "queued" {
+			current = "running"
+		}
+		if c, err := loadContainer(name); err == nil && current != "" && c.Status != current {
+			setContainerStatus(name, current)
+		}
+	}
+}
+
+// HeartbeatHandler records a node's capacity (POST /nodes/heartbeat, coordinator only)
+func HeartbeatHandler(w http.ResponseWriter, r *http.Request) {
+	if coordinator == nil {
+		ErrorResponse(w, "This server is not a fleet coordinator (set FLEET_SCHEDULER)", http.StatusNotFound)
+		return
+	}
+	if !fleetAuthorized(r, coordinator.token) {
+		ErrorResponse(w, "Invalid fleet token", http.StatusUnauthorized)
+		return
+	}
+	var capacity NodeCapacity
+	if err := json.NewDecoder(r.Body).Decode(&capacity); err != nil {
+		ErrorResponse(w, "Invalid request body: "+err.Error(), http.StatusBadRequest)
+		return
+	}
+	if capacity.Name == "" || capacity.Addr == "" {
+		ErrorResponse(w, "Node name and addr are required", http.StatusBadRequest)
+		return
+	}
+
+	coordinator.mu.Lock()
+	node, ok := coordinator.nodes[capacity.Name]
+	if !ok {
+		node = &FleetNode{}
+		coordinator.nodes[capacity.Name] = node
+		log.Printf("Fleet: node %s joined (%s, %d CPUs)", capacity.Name, capacity.Addr, capacity.CPUs)
+	}
+	node.NodeCapacity = capacity
+	node.LastSeen = time.Now()
+	node.pendingCPU, node.pendingMemory, node.pendingRunning = 0, 0, 0  // Counted by the node now
+	coordinator.mu.Unlock()
+
+	SuccessResponse(w, "Heartbeat recorded", nil)
+}
+
+// ListNodesHandler returns every node that has heartbeated (GET /nodes, coordinator only)
+func ListNodesHandler(w http.ResponseWriter, r *http.Request) {
+	if coordinator == nil {
+		ErrorResponse(w, "This server is not a fleet coordinator (set FLEET_SCHEDULER)", http.StatusNotFound)
+		return
+	}
+
+	coordinator.mu.Lock()
+	nodes := make([]FleetNode, 0, len(coordinator.nodes))
+	for _, n := range coordinator.nodes {
+		view := *n
+		view.Alive = time.Since(n.LastSeen) <= NodeExpiryHeartbeats*coordinator.interval
+		if n.CPUs > 0 && n.MemoryTotal > 0 {
+			view.Load = n.load()
+		}
+		nodes = append(nodes, view)
+	}
+	coordinator.mu.Unlock()
+	sort.Slice(nodes, func(i, j int) bool { return nodes[i].Name < nodes[j].Name })
+
+	SuccessResponse(w, fmt.Sprintf("Found %d nodes", len(nodes)), map[string]interface{}{
+		"scheduler": coordinator.policy,
+		"nodes":     nodes,
+	})
+}
+
+// FleetLaunchHandler starts a container forwarded by the coordinator (POST /fleet/launch[?replicas=N]).
+// The container is created in this node's store first if it doesn't exist here yet.
+func FleetLaunchHandler(w http.ResponseWriter, r *http.Request) {
+	if !fleetAuthorized(r, os.Getenv("FLEET_TOKEN")) {
+		ErrorResponse(w, "Invalid fleet token", http.StatusUnauthorized)
+		return
+	}
+	var c Container
+	if err := json.NewDecoder(r.Body).Decode(&c); err != nil {
+		ErrorResponse(w, "Invalid request body: "+err.Error(), http.StatusBadRequest)
+		return
+	}
+	if err := validateName(c.Name); err != nil {
+		ErrorResponse(w, err.Error(), http.StatusBadRequest)
+		return
+	}
+	if err := c.Limits.Validate(); err != nil {
+		ErrorResponse(w, "Invalid limits: "+err.Error(), http.StatusBadRequest)
+		return
+	}
+	replicas, err := strconv.Atoi(r.URL.Query().Get("replicas"))
+	if err != nil || replicas < 1 || replicas > MaxReplicas {
+		replicas = 1
+	}
+
+	local := c
+	local.Status = "created"
+	if useDatabase {
+		err = db.CreateContainer(&local)
+	} else {
+		err = store.Create(&local)
+	}
+	if err != nil && err != ErrContainerExists {
+		ErrorResponse(w, "Failed to create container: "+err.Error(), http.StatusInternalServerError)
+		return
+	}
+	submitStart(w, c, replicas)
+}
+
+// RunAgent heartbeats this node's capacity to COORDINATOR_URL forever (node agent mode)
+func RunAgent(coordinatorURL, name, addr string) {
+	interval := envDuration("HEARTBEAT_INTERVAL", DefaultHeartbeatInterval)
+	token := os.Getenv("FLEET_TOKEN")
+	client := &http.Client{Timeout: FleetRequestTimeout}
+	log.Printf("Fleet agent: node %s (%s) reporting to %s every %v", name, addr, coordinatorURL, interval)
+
+	var prevIdle, prevTotal uint64
+	for failures := 0; ; time.Sleep(interval) {
+		capacity := sampleCapacity()
+		capacity.Name, capacity.Addr = name, addr
+		idle, total := readCPUTimes()
+		if total > prevTotal && prevTotal != 0 {
+			capacity.CPUIdle = float64(idle-prevIdle) / float64(total-prevTotal)
+		}
+		prevIdle, prevTotal = idle, total
+
+		body, _ := json.Marshal(capacity)
+		req, err := http.NewRequest("POST", coordinatorURL+"/nodes/heartbeat", bytes.NewReader(body))
+		if err != nil {
+			log.Printf("Warning: invalid COORDINATOR_URL: %v", err)
+			return
+		}
+		req.Header.Set("Content-Type", "application/json")
+		if token != "" {
+			req.Header.Set("Authorization", "Bearer "+token)
+		}
+		resp, err := client.Do(req)
+		if err == nil {
+			resp.Body.Close()
+			if resp.StatusCode != http.StatusOK {
+				err = fmt.Errorf("coordinator answered %s", resp.Status)
+			}
+		}
+		// Log the first failure of a run and the recovery, not every interval
+		if err != nil {
+			if failures == 0 {
+				log.Printf("Warning: heartbeat to %s failed: %v", coordinatorURL, err)
+			}
+			failures++
+		} else if failures > 0 {
+			log.Printf("Fleet agent: coordinator reachable again after %d failed heartbeats", failures)
+			failures = 0
+		}
+	}
+}
+
+// sampleCapacity reads memory from /proc/meminfo and commitments from the minirun-* cgroups
+func sampleCapacity() NodeCapacity {
+	capacity := NodeCapacity{CPUs: runtime.NumCPU(), Queued: launcher.Stats()["queued"]}
+
+	if f, err := os.Open("/proc/meminfo"); err == nil {
+		scanner := bufio.NewScanner(f)
+		for scanner.Scan() {
+			fields := strings.Fields(scanner.Text())
+			if len(fields) < 2 {
+				continue
+			}
+			kb, _ := strconv.ParseInt(fields[1], 10, 64)
+			switch fields[0] {
+			case "MemTotal:":
+				capacity.MemoryTotal = kb * 1024
+			case "MemAvailable:":
+				capacity.MemoryAvailable = kb * 1024
+			}
+		}
+		f.Close()
+	}
+
+	// Containers of every runtime on the host, pooled or not, whoever started them
+	dirs, _ := filepath.Glob(filepath.Join(CgroupRoot, "minirun-*"))
+	for _, dir := range dirs {
+		events, err := os.ReadFile(filepath.Join(dir, "cgroup.events"))
+		if err != nil || !strings.Contains(string(events), "populated 1") {
+			continue
+		}
+		capacity.Running++
+		if data, err := os.ReadFile(filepath.Join(dir, "memory.max")); err == nil {
+			if limit, err := strconv.ParseInt(strings.TrimSpace(string(data)), 10, 64); err == nil {
+				capacity.MemoryCommitted += limit
+			}
+		}
+		if data, err := os.ReadFile(filepath.Join(dir, "cpu.max")); err == nil {
+			var quota, period int64
+			if n, _ := fmt.Sscanf(string(data), "%d %d", &quota, &period); n == 2 && period > 0 {
+				capacity.CPUCommitted += int(quota * 100 / period)
+			}
+		}
+	}
+	return capacity
+}
+
+// readCPUTimes returns idle (idle + iowait) and total jiffies of all CPUs from /proc/stat
+func readCPUTimes() (uint64, uint64) {
+	data, err := os.ReadFile("/proc/stat")
+	if err != nil {
+		return 0, 0
+	}
+	line, _, _ := strings.Cut(string(data), "\n")
+	fields := strings.Fields(line)
+	if len(fields) > 9 {
+		fields = fields[:9]  // guest and guest_nice are already counted in user and nice
+	}
+	var idle, total uint64
+	for i, field := range fields[1:] {
+		value, _ := strconv.ParseUint(field, 10, 64)
+		total += value
+		if i == 3 || i == 4 {
+			idle += value
+		}
+	}
+	return idle, total
+}
+
+// proxiedHandler sends requests about containers the coordinator forwarded to
+// their node (process, logs, PATCH, DELETE, pause and resume)
+func proxiedHandler(next http.HandlerFunc) http.HandlerFunc {
+	return func(w http.ResponseWriter, r *http.Request) {
+		if coordinator != nil && r.Header.Get(ForwardedHeader) == "" && coordinator.Proxy(w, r, mux.Vars(r)["name"]) {
+			return
+		}
+		next(w, r)
+	}
+}
@@ -0,0 +1,323 @@
+package main
+
+import (
+	"bufio"    // Line-by-line runtime output
+	"fmt"      // Formatted I/O
+	"io"       // Output tee to the log file
+	"log"      // Logging
+	"os"       // Log files and environment
+	"os/exec"  // Spawning container_runtime
+	"path/filepath"  // Log file paths
+	"strconv"  // Environment parsing
+	"strings"  // Readiness line matching
+	"sync"     // Process table lock, one-shot ready signal
+	"syscall"  // Process group for the runtime
+	"time"     // Start and exit timestamps
+)
+
+// Launch queue defaults (override with LAUNCH_WORKERS / LAUNCH_QUEUE)
+const (
+	DefaultLaunchWorkers = 4   // container_runtime setups in flight at once
+	DefaultLaunchQueue   = 64  // Accepted starts waiting for a worker before 429
+	LaunchReadyTimeout   = 30 * time.Second  // Max time a worker waits for the container PID
+)
+
+// Process is one container_runtime the orchestrator started
+type Process struct {
+	Name      string    `json:"name"`
+	PID       int       `json:"pid"`                 // container_runtime PID (0 while queued)
+	Replicas  int       `json:"replicas"`
+	Status    string    `json:"status"`              // queued/running/stopped/failed
+	ExitCode  int       `json:"exit_code"`           // Runtime exit code once stopped/failed
+	QueuedAt  time.Time `json:"queued_at"`
+	StartedAt time.Time `json:"started_at"`
+	ExitedAt  time.Time `json:"exited_at"`
+	LogPath   string    `json:"log"`                 // Runtime messages (container output: /logs)
+}
+
+type launchJob struct {
+	container Container
+	replicas  int
+	process   *Process
+}
+
+// Launcher runs container_runtime for start requests through a bounded queue.
+//
+// A fixed number of workers take jobs off the queue, spawn the runtime and
+// hold the slot until it reports the container PID on its --ready-fd pipe
+// (cgroup setup and clone done), so at most `workers` setups compete for
+// the kernel at once however many clients call start. A full queue is
+// rejected (429) instead of piling up goroutines. Each runtime is then reaped by its own goroutine,
+// which records the exit and moves the container to stopped or failed.
+type Launcher struct {
+	queue      chan launchJob
+	workers    int
+	cgroupPool int  // --cgroup-pool slots passed to every runtime (0 = off)
+	netPool    int  // --net-pool size passed with --net (0 = the runtime's default)
+	placer     *Placer  // Dedicated cpusets for single containers (nil = quota only, see placement.go)
+	mu         sync.Mutex
+	processes  map[string]*Process  // Latest process per container name
+}
+
+// ErrQueueFull is returned by Submit when the launch queue has no room
+var ErrQueueFull = fmt.Errorf("launch queue is full")
+
+// ErrAlreadyRunning is returned by Submit for containers that are queued or running
+var ErrAlreadyRunning = fmt.Errorf("container is already queued or running")
+
+// NewLauncher starts `workers` launch workers behind a queue of `depth` jobs
+func NewLauncher(workers, depth int) *Launcher {
+	l := &Launcher{
+		queue:     make(chan launchJob, depth),
+		workers:   workers,
+		processes: make(map[string]*Process),
+	}
+	for i := 0; i < workers; i++ {
+		go l.worker()
+	}
+	return l
+}
+
+// NewLauncherFromEnv reads LAUNCH_WORKERS, LAUNCH_QUEUE (defaults above), CGROUP_POOL, NET_POOL and PLACEMENT
+func NewLauncherFromEnv() *Launcher {
+	l := NewLauncher(envInt("LAUNCH_WORKERS", DefaultLaunchWorkers), envInt("LAUNCH_QUEUE", DefaultLaunchQueue))
+	l.cgroupPool = envInt("CGROUP_POOL", 0)  // Read by workers only after a job is queued
+	l.netPool = envInt("NET_POOL", 0)
+	l.placer = NewPlacerFromEnv()
+	return l
+}
+
+// envInt returns a positive integer from the environment, or def
+func envInt(name string, def int) int {
+	if value := os.Getenv(name); value != "" {
+		if n, err := strconv.Atoi(value); err == nil && n > 0 {
+			return n
+		}
+		log.Printf("Warning: ignoring invalid %s=%q", name, value)
+	}
+	return def
+}
+
+// Submit queues a start without blocking; the returned Process is a snapshot
+func (l *Launcher) Submit(c Container, replicas int) (Process, error) {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+
+	if p, ok := l.processes[c.Name]; ok && (p.Status == "queued" || p.Status == "running") {
+		return *p, ErrAlreadyRunning
+	}
+
+	p := &Process{
+		Name: c.Name, Replicas: replicas, Status: "queued", QueuedAt: time.Now(),
+		LogPath: filepath.Join(ContainersDir, c.Name+".log"),
+	}
+	select {
+	case l.queue <- launchJob{container: c, replicas: replicas, process: p}:
+		l.processes[c.Name] = p
+		return *p, nil
+	default:
+		return *p, ErrQueueFull
+	}
+}
+
+// Get returns a snapshot of the latest process for a container
+func (l *Launcher) Get(name string) (Process, bool) {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+
+	p, ok := l.processes[name]
+	if !ok {
+		return Process{}, false
+	}
+	return *p, true
+}
+
+// Stats reports queue and process counts for /health
+func (l *Launcher) Stats() map[string]int {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+
+	stats := map[string]int{"workers": l.workers, "queued": len(l.queue), "queue_capacity": cap(l.queue), "running": 0}
+	for _, p := range l.processes {
+		if p.Status == "running" {
+			stats["running"]++
+		}
+	}
+	return stats
+}
+
+func (l *Launcher) worker() {
+	for job := range l.queue {
+		l.launch(job)
+	}
+}
+
+// launch spawns one runtime and returns once it is running (or has failed)
+func (l *Launcher) launch(job launchJob) {
+	c, p := job.container, job.process
+
+	var args []string
+	if strings.HasPrefix(c.RootFS, "sha256:") {
+		// An image of the CLI's store (minirun create --image), resolved by the runtime
+		store := os.Getenv("MINIRUN_IMAGE_STORE")
+		if store == "" {
+			store = ImagesDir
+		}
+		args = append(args, "--image-store", store)
+	}
+	if job.replicas > 1 {
+		args = append(args, "--replicas", strconv.Itoa(job.replicas))
+	}
+	if l.cgroupPool > 0 {
+		args = append(args, "--cgroup-pool", strconv.Itoa(l.cgroupPool))
+	}
+	limits := c.Limits
+	if job.replicas <= 1 {
+		limits = l.placer.Place(c.Name, limits)  // Released by finish()
+	}
+	args = append(args, limits.RuntimeArgs()...)
+	args = append(args, "--log-dir", ContainersDir)  // Container output goes to <name>.ring (see logs.go)
+
+	// A single container runs with --json: no banners, one record in the log at exit,
+	// and the PID arrives on a pipe (the runtime's fd 3) once it is cloned
+	var readyRead, readyWrite *os.File
+	if job.replicas <= 1 {
+		if r, w, err := os.Pipe(); err == nil {
+			readyRead, readyWrite = r, w
+			args = append(args, "--json", "--ready-fd", "3")
+		}
+	}
+	if c.Init {
+		args = append(args, "--init")
+	}
+	if c.Network {
+		// Without a pool the container still gets its own namespace, with lo only
+		args = append(args, "--net")
+		if l.netPool > 0 {
+			args = append(args, "--net-pool", strconv.Itoa(l.netPool))
+		}
+	}
+	if c.Seccomp != "" {
+		args = append(args, "--seccomp", c.Seccomp)
+	}
+	if len(c.Argv) > 0 {
+		// No bash -c: the runtime execs the argv as is
+		args = append(args, "--exec", c.Name, c.RootFS)
+		args = append(args, c.Argv...)
+	} else {
+		args = append(args, c.Name, c.RootFS, c.Command)
+	}
+
+	logFile, err := os.OpenFile(p.LogPath, os.O_CREATE|os.O_WRONLY|os.O_APPEND, 0644)
+	if err != nil {
+		closeFiles(readyRead, readyWrite)
+		l.finish(p, -1, fmt.Errorf("failed to open log: %w", err))
+		return
+	}
+
+	cmd := exec.Command(RuntimeBinary, args...)
+	cmd.SysProcAttr = &syscall.SysProcAttr{Setpgid: true}  // Our signals (Ctrl-C) don't reach containers
+	cmd.Stderr = logFile
+	if readyWrite != nil {
+		cmd.ExtraFiles = []*os.File{readyWrite}
+	}
+	stdout, err := cmd.StdoutPipe()
+	if err == nil {
+		err = cmd.Start()
+	}
+	closeFiles(readyWrite)  // The runtime has its copy; EOF once it closes or exits
+	if err != nil {
+		closeFiles(readyRead)
+		logFile.Close()
+		l.finish(p, -1, fmt.Errorf("failed to start runtime: %w", err))
+		return
+	}
+
+	l.mu.Lock()
+	p.PID = cmd.Process.Pid
+	l.mu.Unlock()
+
+	// Ready once the PID is on the ready pipe, or (batch) the runtime prints "Started N/M replicas"
+	ready := make(chan struct{})
+	var readyOnce sync.Once
+	markReady := func() { readyOnce.Do(func() { close(ready) }) }
+	if readyRead != nil {
+		go func() {
+			defer readyRead.Close()
+			buf := make([]byte, 32)
+			readyRead.Read(buf)  // "<pid>\n", or EOF if the runtime failed first
+			markReady()
+		}()
+	}
+	drained := make(chan struct{})
+	go func() {
+		defer close(drained)
+		scanner := bufio.NewScanner(stdout)
+		for scanner.Scan() {
+			line := scanner.Text()
+			fmt.Fprintln(logFile, line)
+			if strings.HasPrefix(line, "Container PID:") || strings.HasPrefix(line, "Started ") {
+				markReady()
+			}
+		}
+		io.Copy(logFile, stdout)
+		markReady()
+	}()
+
+	select {
+	case <-ready:
+	case <-time.After(LaunchReadyTimeout):
+		log.Printf("Warning: container '%s' not ready after %v, releasing launch slot", c.Name, LaunchReadyTimeout)
+	}
+
+	l.mu.Lock()
+	p.Status = "running"
+	p.StartedAt = time.Now()
+	l.mu.Unlock()
+	setContainerStatus(c.Name, "running")
+	log.Printf("Container '%s' running (runtime PID %d)", c.Name, p.PID)
+
+	// Reap asynchronously; the worker moves on to the next job
+	go func() {
+		<-drained  // Wait closes stdout, so read it to EOF first
+		err := cmd.Wait()
+		logFile.Close()
+		code := 0
+		if exitErr, ok := err.(*exec.ExitError); ok {
+			code = exitErr.ExitCode()
+			err = nil
+		}
+		l.finish(p, code, err)
+	}()
+}
+
+// closeFiles closes whichever of the files are open
+func closeFiles(files ...*os.File) {
+	for _, f := range files {
+		if f != nil {
+			f.Close()
+		}
+	}
+}
+
+// finish records a runtime exit and persists the stopped/failed status
+func (l *Launcher) finish(p *Process, code int, err error) {
+	status := "stopped"
+	if err != nil || code != 0 {
+		status = "failed"
+	}
+
+	l.mu.Lock()
+	p.Status = status
+	p.ExitCode = code
+	p.ExitedAt = time.Now()
+	l.mu.Unlock()
+
+	if err != nil {
+		log.Printf("Container '%s' failed: %v", p.Name, err)
+	} else {
+		log.Printf("Container '%s' %s (exit code %d)", p.Name, status, code)
+	}
+	setContainerStatus(p.Name, status)
+	l.placer.Release(p.Name)
+}
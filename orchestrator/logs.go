@@ -0,0 +1,203 @@
+package main
+
+import (
+	"fmt"            // Formatted I/O
+	"net/http"       // Streaming responses
+	"os"             // Ring files
+	"path/filepath"  // Ring file paths
+	"strconv"        // Query parameter parsing
+	"sync/atomic"    // head / write_end loads from the shared mapping
+	"syscall"        // mmap
+	"time"           // Follow polling interval
+	"unsafe"         // uint64 views of the mapped header
+
+	"github.com/gorilla/mux"  // URL parameters
+)
+
+// Ring file layout written by container_runtime --log-dir (LOG_RING_* in container_runtime.c)
+const (
+	LogRingHeaderSize = 4096
+	LogRingMagic      = "MRLOG1\x00\x00"
+	LogReadChunk      = 64 * 1024               // Bytes copied out of the ring per write to the client
+	LogFollowInterval = 100 * time.Millisecond  // How often a caught-up follower checks for more
+)
+
+// LogRing is a read-only mapping of one container's output ring.
+//
+// The runtime reads the container's stdout/stderr pipe straight into the
+// shared mapping and only ever moves forward; readers never lock and never
+// slow it down. Byte pos of the stream sits at data[pos % capacity] until it
+// is overwritten, which Read detects from the header after copying.
+type LogRing struct {
+	mapping  []byte
+	data     []byte
+	capacity uint64
+}
+
+// OpenLogRing maps a ring file written by the runtime
+func OpenLogRing(path string) (*LogRing, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()  // The mapping stays valid after close
+
+	info, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+	if info.Size() <= LogRingHeaderSize {
+		return nil, fmt.Errorf("%s is not a log ring", path)
+	}
+
+	mapping, err := syscall.Mmap(int(f.Fd()), 0, int(info.Size()), syscall.PROT_READ, syscall.MAP_SHARED)
+	if err != nil {
+		return nil, fmt.Errorf("failed to map %s: %w", path, err)
+	}
+
+	ring := &LogRing{mapping: mapping, data: mapping[LogRingHeaderSize:]}
+	ring.capacity = *(*uint64)(unsafe.Pointer(&mapping[8]))
+	if string(mapping[:8]) != LogRingMagic || ring.capacity != uint64(len(ring.data)) {
+		syscall.Munmap(mapping)
+		return nil, fmt.Errorf("%s is not a log ring", path)
+	}
+	return ring, nil
+}
+
+// Close unmaps the ring
+func (r *LogRing) Close() {
+	syscall.Munmap(r.mapping)
+}
+
+// head is the total number of bytes the container has written
+func (r *LogRing) head() uint64 {
+	return atomic.LoadUint64((*uint64)(unsafe.Pointer(&r.mapping[16])))
+}
+
+// writeEnd is head plus the range the runtime is filling right now
+func (r *LogRing) writeEnd() uint64 {
+	return atomic.LoadUint64((*uint64)(unsafe.Pointer(&r.mapping[24])))
+}
+
+// Oldest returns the position of the oldest byte still in the ring
+func (r *LogRing) Oldest() uint64 {
+	if head := r.head(); head > r.capacity {
+		return head - r.capacity
+	}
+	return 0
+}
+
+// Read copies up to len(buf) bytes starting at stream position pos. If those
+// bytes were already overwritten it starts further on; the returned start is
+// the position of buf[0] and start+n is where the next Read should begin.
+func (r *LogRing) Read(pos uint64, buf []byte) (start uint64, n int) {
+	head := r.head()
+	start = pos
+	if head-start > r.capacity {
+		start = head - r.capacity
+	}
+	if start >= head {
+		return head, 0
+	}
+
+	n = len(buf)
+	if uint64(n) > head-start {
+		n = int(head - start)
+	}
+	offset := start % r.capacity
+	first := copy(buf[:n], r.data[offset:])
+	copy(buf[first:n], r.data)
+
+	// The runtime may have started overwriting the oldest part while we copied
+	if end := r.writeEnd(); end > r.capacity && end-r.capacity > start {
+		lost := end - r.capacity - start
+		if lost >= uint64(n) {
+			return start + uint64(n), 0
+		}
+		n = copy(buf, buf[lost:n])
+		start += lost
+	}
+	return start, n
+}
+
+// containerActive reports whether a runtime started by this server may still write output
+func containerActive(name string) bool {
+	process, ok := launcher.Get(name)
+	return ok && (process.Status == "queued" || process.Status == "running")
+}
+
+// LogsHandler streams captured stdout/stderr (GET /containers/{name}/logs[?follow=1&replica=N]).
+// Without follow it returns what the ring holds now; with follow it keeps the
+// chunked response open and flushes new output until the runtime exits.
+func LogsHandler(w http.ResponseWriter, r *http.Request) {
+	name := mux.Vars(r)["name"]
+	query := r.URL.Query()
+	follow := query.Get("follow") == "1" || query.Get("follow") == "true"
+
+	// Batch starts write one ring per replica, named <name>-<i>
+	ringName := name
+	if value := query.Get("replica"); value != "" {
+		replica, err := strconv.Atoi(value)
+		if err != nil || replica < 0 || replica >= MaxReplicas {
+			ErrorResponse(w, "Invalid replica: "+value, http.StatusBadRequest)
+			return
+		}
+		ringName = fmt.Sprintf("%s-%d", name, replica)
+	}
+
+	ring, err := OpenLogRing(filepath.Join(ContainersDir, ringName+".ring"))
+	if err != nil {
+		if os.IsNotExist(err) {
+			ErrorResponse(w, "No output captured for '"+ringName+"'", http.StatusNotFound)
+			return
+		}
+		ErrorResponse(w, "Failed to open logs: "+err.Error(), http.StatusInternalServerError)
+		return
+	}
+	defer ring.Close()
+
+	w.Header().Set("Content-Type", "text/plain; charset=utf-8")
+	w.Header().Set("X-Content-Type-Options", "nosniff")
+	w.WriteHeader(http.StatusOK)
+	flusher, _ := w.(http.Flusher)
+
+	buf := make([]byte, LogReadChunk)
+	pos := ring.Oldest()
+	until := ring.head()  // Without follow, stop at what was there when we started
+
+	for {
+		start, n := ring.Read(pos, buf)
+		if start > pos {
+			fmt.Fprintf(w, "\n[%d bytes overwritten before they could be sent]\n", start-pos)
+			pos = start
+		}
+		if n > 0 && (follow || start < until) {
+			if !follow && start+uint64(n) > until {
+				n = int(until - start)
+			}
+			if _, err := w.Write(buf[:n]); err != nil {
+				return  // Client went away
+			}
+			pos = start + uint64(n)
+			continue
+		}
+		if !follow {
+			return
+		}
+
+		if flusher != nil {
+			flusher.Flush()
+		}
+		active := containerActive(name)
+		select {
+		case <-r.Context().Done():
+			return
+		case <-time.After(LogFollowInterval):
+		}
+		// The runtime drains the pipe before it exits, so once it is gone
+		// and the ring has nothing new, the stream is complete
+		if !active && ring.head() == pos {
+			return
+		}
+	}
+}
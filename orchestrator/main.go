@@ -1,12 +1,18 @@
 package main
 
 import (
+	"encoding/base64"  // Opaque page cursors
 	"encoding/json"  // JSON encoding/decoding for API responses
 	"fmt"            // Formatted I/O
 	"log"            // Logging
 	"net/http"       // HTTP server and client
 	"os"             // Operating system functions
+	"os/exec"        // container_runtime --update/--pause/--resume
 	"path/filepath"  // File path manipulation
+	"regexp"         // Limit syntax validation
+	"sort"           // File storage listing order
+	"strconv"        // Query parameter parsing
+	"strings"        // Cursor parsing
 	"time"           // Time and duration handling
 
 	"github.com/gorilla/mux"  // HTTP router with URL parameters
@@ -14,35 +20,211 @@ import (
 
 // Global database instance (nil if using file storage)
 var db *Database
-var useDatabase bool  // true = PostgreSQL, false = JSON files
+var useDatabase bool  // true = PostgreSQL, false = the state store
+
+// File storage shared with ./minirun (see store.go)
+var store = NewStateStore(ContainersDir)
+
+// Global launcher that runs container_runtime for start requests (see launcher.go)
+var launcher *Launcher
+
+// Project checkout the runtime, rootfs and state live in ($MINIRUN_ROOT overrides the default)
+var (
+	ProjectRoot   = projectRoot()
+	ContainersDir = ProjectRoot + "/containers"  // State store, runtime logs and output rings
+	RuntimeBinary = ProjectRoot + "/bin/container_runtime"  // C runtime binary
+	DefaultRootFS = ProjectRoot + "/myroot"  // Default container root filesystem
+	ImagesDir     = ProjectRoot + "/images"  // Image store for sha256:<digest> rootfs values (or $MINIRUN_IMAGE_STORE)
+)
+
+// projectRoot returns $MINIRUN_ROOT without a trailing slash, or the default checkout
+func projectRoot() string {
+	if root := strings.TrimRight(os.Getenv("MINIRUN_ROOT"), "/"); root != "" {
+		return root
+	}
+	return "/home/raafayqureshi/container-project"
+}
 
 // Server configuration constants
 const (
-	ProjectRoot     = "/home/raafayqureshi/container-project"
-	ContainersDir   = ProjectRoot + "/containers"  // JSON storage directory
-	RuntimeBinary   = ProjectRoot + "/bin/container_runtime"  // C runtime binary
-	DefaultRootFS   = ProjectRoot + "/myroot"  // Default container root filesystem
 	ServerPort      = "8080"   // HTTP port
 	ServerPortTLS   = "8443"   // HTTPS port
 	ServerVersion   = "1.0.0"
 	DefaultCertPath = "/etc/minirun/cert.pem"  // TLS certificate location
 	DefaultKeyPath  = "/etc/minirun/key.pem"   // TLS private key location
+	MaxReplicas     = 1024  // Matches MAX_REPLICAS in container_runtime.c
+	DefaultPageSize = 100   // GET /containers without ?limit=
+	MaxPageSize     = 1000
+
+	// Runtime defaults and bounds (DEFAULT_* / CPU_PERIOD_* in container_runtime.c)
+	DefaultMemoryLimit = 512 * 1024 * 1024
+	DefaultCPUPercent  = 50
+	DefaultCPUPeriod   = 100000
+	MinCPUPeriod       = 1000
+	MaxCPUPeriod       = 1000000
+	MaxIOLimits        = 4  // CGROUP_MAX_IO
+)
+
+// Accepted forms of cpuset lists ("0-3,8") and io.max lines ("8:0 rbps=1048576 wiops=max"),
+// and of container names, which become file names under ContainersDir and cgroup names
+var (
+	cpusetPattern = regexp.MustCompile(`^[0-9]+(-[0-9]+)?(,[0-9]+(-[0-9]+)?)*$`)
+	ioMaxPattern  = regexp.MustCompile(`^[0-9]+:[0-9]+( (rbps|wbps|riops|wiops)=([0-9]+|max))+$`)
+	namePattern   = regexp.MustCompile(`^[A-Za-z0-9][A-Za-z0-9_.-]*$`)
 )
 
-// Container represents container configuration (stored in DB or JSON file)
+// Container represents container configuration (stored in DB or the state store)
 type Container struct {
-	Name      string    `json:"name"`       // Unique container name
-	RootFS    string    `json:"rootfs"`     // Path to root filesystem
-	Command   string    `json:"command"`    // Command to execute
-	Status    string    `json:"status"`     // created/running/stopped
-	CreatedAt time.Time `json:"created_at"` // Creation timestamp
+	Name      string         `json:"name"`       // Unique container name
+	RootFS    string         `json:"rootfs"`     // Path to root filesystem
+	Command   string         `json:"command"`    // Command to execute (bash -c), or Argv quoted for display
+	Argv      []string       `json:"argv,omitempty"` // Exec'd directly instead of bash -c Command (runtime --exec)
+	Init      bool           `json:"init,omitempty"` // Minimal init as PID 1 (runtime --init)
+	Seccomp   string         `json:"seccomp,omitempty"` // Syscall filter profile path (minirun create --seccomp)
+	Network   bool           `json:"network,omitempty"` // Own network namespace (minirun create --net, runtime --net)
+	Status    string         `json:"status"`     // created/running/stopped
+	CreatedAt time.Time      `json:"created_at"` // Creation timestamp
+	Limits    ResourceLimits `json:"limits"`     // Cgroup limits passed to the runtime
+}
+
+// ResourceLimits matches the "limits" object ./minirun writes to container configs.
+// Zero values keep the runtime defaults (512MB memory.max, 50% of one core per 100ms).
+type ResourceLimits struct {
+	Memory     int64    `json:"memory,omitempty"`      // memory.max in bytes
+	MemoryHigh int64    `json:"memory_high,omitempty"` // memory.high in bytes (below Memory)
+	CPU        int      `json:"cpu,omitempty"`         // % of one core, 200 = two cores
+	CPUPeriod  int      `json:"cpu_period,omitempty"`  // cpu.max period in microseconds
+	CpusetCPUs string   `json:"cpuset_cpus,omitempty"` // e.g. "0-3"
+	CpusetMems string   `json:"cpuset_mems,omitempty"` // e.g. "0"
+	IOMax      []string `json:"io_max,omitempty"`      // io.max lines, one per device
+	PidsMax    int64    `json:"pids_max,omitempty"`    // pids.max
+}
+
+// LimitsPatch is the body of PATCH /containers/{name}: limits to change, where an
+// empty cpuset_cpus or cpuset_mems unpins the container instead of being ignored
+type LimitsPatch struct {
+	ResourceLimits
+	CpusetCPUs *string `json:"cpuset_cpus"`
+	CpusetMems *string `json:"cpuset_mems"`
+}
+
+// Validate applies the same checks as container_runtime, so bad limits fail at create time
+func (l ResourceLimits) Validate() error {
+	memory, cpu, period := l.Memory, l.CPU, l.CPUPeriod
+	if memory == 0 {
+		memory = DefaultMemoryLimit
+	}
+	if cpu == 0 {
+		cpu = DefaultCPUPercent
+	}
+	if period == 0 {
+		period = DefaultCPUPeriod
+	}
+
+	switch {
+	case l.Memory < 0 || l.MemoryHigh < 0 || l.CPU < 0 || l.PidsMax < 0:
+		return fmt.Errorf("limits must not be negative")
+	case l.MemoryHigh >= memory:
+		return fmt.Errorf("memory_high must be below memory (%d bytes)", memory)
+	case period < MinCPUPeriod || period > MaxCPUPeriod:
+		return fmt.Errorf("cpu_period must be between %d and %d microseconds", MinCPUPeriod, MaxCPUPeriod)
+	case int64(cpu)*int64(period)/100 < MinCPUPeriod:
+		return fmt.Errorf("cpu quota (%d%% of %dus) is below the %dus minimum", cpu, period, MinCPUPeriod)
+	case l.CpusetCPUs != "" && !cpusetPattern.MatchString(l.CpusetCPUs):
+		return fmt.Errorf("invalid cpuset_cpus: %q", l.CpusetCPUs)
+	case l.CpusetMems != "" && !cpusetPattern.MatchString(l.CpusetMems):
+		return fmt.Errorf("invalid cpuset_mems: %q", l.CpusetMems)
+	case len(l.IOMax) > MaxIOLimits:
+		return fmt.Errorf("at most %d io_max lines", MaxIOLimits)
+	}
+	for _, line := range l.IOMax {
+		if !ioMaxPattern.MatchString(line) {
+			return fmt.Errorf("invalid io_max line: %q", line)
+		}
+	}
+	return nil
+}
+
+// RuntimeArgs returns the container_runtime flags for the limits that are set
+func (l ResourceLimits) RuntimeArgs() []string {
+	var args []string
+	if l.Memory > 0 {
+		args = append(args, "--memory", strconv.FormatInt(l.Memory, 10))
+	}
+	if l.MemoryHigh > 0 {
+		args = append(args, "--memory-high", strconv.FormatInt(l.MemoryHigh, 10))
+	}
+	if l.CPU > 0 {
+		args = append(args, "--cpu", strconv.Itoa(l.CPU))
+	}
+	if l.CPUPeriod > 0 {
+		args = append(args, "--cpu-period", strconv.Itoa(l.CPUPeriod))
+	}
+	if l.CpusetCPUs != "" {
+		args = append(args, "--cpuset-cpus", l.CpusetCPUs)
+	}
+	if l.CpusetMems != "" {
+		args = append(args, "--cpuset-mems", l.CpusetMems)
+	}
+	for _, line := range l.IOMax {
+		args = append(args, "--io-max", line)  // Passed as one argv entry, no shell involved
+	}
+	if l.PidsMax > 0 {
+		args = append(args, "--pids-max", strconv.FormatInt(l.PidsMax, 10))
+	}
+	return args
+}
+
+// Merge returns l with every limit that is set in changes replaced (PATCH /containers/{name})
+func (l ResourceLimits) Merge(changes ResourceLimits) ResourceLimits {
+	if changes.Memory > 0 {
+		l.Memory = changes.Memory
+	}
+	if changes.MemoryHigh > 0 {
+		l.MemoryHigh = changes.MemoryHigh
+	}
+	if changes.CPU > 0 {
+		l.CPU = changes.CPU
+	}
+	if changes.CPUPeriod > 0 {
+		l.CPUPeriod = changes.CPUPeriod
+	}
+	if changes.CpusetCPUs != "" {
+		l.CpusetCPUs = changes.CpusetCPUs
+	}
+	if changes.CpusetMems != "" {
+		l.CpusetMems = changes.CpusetMems
+	}
+	if len(changes.IOMax) > 0 {
+		l.IOMax = changes.IOMax
+	}
+	if changes.PidsMax > 0 {
+		l.PidsMax = changes.PidsMax
+	}
+	return l
+}
+
+// quoteArgv joins an argv the way ./minirun create --exec stores it as "command" (shlex.join)
+func quoteArgv(argv []string) string {
+	quoted := make([]string, len(argv))
+	for i, arg := range argv {
+		if arg != "" && strings.Trim(arg, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789@%+=:,./-_") == "" {
+			quoted[i] = arg
+		} else {
+			quoted[i] = "'" + strings.ReplaceAll(arg, "'", `'"'"'`) + "'"
+		}
+	}
+	return strings.Join(quoted, " ")
 }
 
 // CreateRequest is the JSON body for POST /containers
 type CreateRequest struct {
-	Name    string `json:"name"`                    // Required: container name
-	RootFS  string `json:"rootfs,omitempty"`        // Optional: defaults to DefaultRootFS
-	Command string `json:"command,omitempty"`       // Optional: defaults to /bin/bash
+	Name    string         `json:"name"`              // Required: container name
+	RootFS  string         `json:"rootfs,omitempty"`  // Optional: defaults to DefaultRootFS
+	Command string         `json:"command,omitempty"` // Optional: defaults to /bin/bash
+	Argv    []string       `json:"argv,omitempty"`    // Optional: program and arguments, instead of command
+	Init    bool           `json:"init,omitempty"`    // Optional: reap zombies/forward signals with an init
+	Limits  ResourceLimits `json:"limits,omitempty"`  // Optional: runtime defaults when omitted
 }
 
 // APIResponse is the standard JSON response format
@@ -51,6 +233,52 @@ type APIResponse struct {
 	Message string      `json:"message"`              // Human-readable message
 	Data    interface{} `json:"data,omitempty"`       // Response data (if any)
 	Error   string      `json:"error,omitempty"`      // Error message (if failed)
+	Next    string      `json:"next,omitempty"`       // Cursor for the next page (lists only)
+}
+
+// ListOptions selects one page of GET /containers (newest first)
+type ListOptions struct {
+	Status string      // Only this status ("" = all)
+	After  *PageCursor // Start after this container (nil = first page)
+	Limit  int
+}
+
+// PageCursor is the (created_at, name) position of the last container on a page
+type PageCursor struct {
+	CreatedAt time.Time
+	Name      string
+}
+
+// Before reports whether c sorts after the cursor in newest-first order
+func (p *PageCursor) Before(c Container) bool {
+	created := c.CreatedAt.Truncate(time.Microsecond)  // Cursor precision
+	if !created.Equal(p.CreatedAt) {
+		return created.Before(p.CreatedAt)
+	}
+	return c.Name < p.Name
+}
+
+// Encode returns the opaque ?after= value for this position
+func (p PageCursor) Encode() string {
+	raw := strconv.FormatInt(p.CreatedAt.UnixMicro(), 10) + ":" + p.Name  // Microseconds, PostgreSQL TIMESTAMP precision
+	return base64.RawURLEncoding.EncodeToString([]byte(raw))
+}
+
+// ParsePageCursor decodes an ?after= value produced by Encode
+func ParsePageCursor(value string) (*PageCursor, error) {
+	raw, err := base64.RawURLEncoding.DecodeString(value)
+	if err != nil {
+		return nil, fmt.Errorf("invalid cursor")
+	}
+	micros, name, ok := strings.Cut(string(raw), ":")
+	if !ok {
+		return nil, fmt.Errorf("invalid cursor")
+	}
+	usec, err := strconv.ParseInt(micros, 10, 64)
+	if err != nil {
+		return nil, fmt.Errorf("invalid cursor")
+	}
+	return &PageCursor{CreatedAt: time.UnixMicro(usec).UTC(), Name: name}, nil
 }
 
 // ErrorResponse sends JSON error with HTTP status code
@@ -67,16 +295,103 @@ func SuccessResponse(w http.ResponseWriter, message string, data interface{}) {
 	json.NewEncoder(w).Encode(APIResponse{Success: true, Message: message, Data: data})
 }
 
-// HealthCheckHandler returns service status and uptime (GET /health)
+// AcceptedResponse sends JSON success for work that continues in the background (202)
+func AcceptedResponse(w http.ResponseWriter, message string, data interface{}) {
+	w.Header().Set("Content-Type", "application/json")
+	w.WriteHeader(http.StatusAccepted)
+	json.NewEncoder(w).Encode(APIResponse{Success: true, Message: message, Data: data})
+}
+
+// loadContainer reads one container from PostgreSQL or the state store
+func loadContainer(name string) (*Container, error) {
+	if useDatabase {
+		return db.GetContainer(name)
+	}
+	return store.Get(name)
+}
+
+// setContainerStatus persists a status transition (created/running/stopped/failed)
+func setContainerStatus(name, status string) {
+	var err error
+	if useDatabase {
+		err = db.UpdateContainerStatus(name, status)
+	} else {
+		err = store.SetStatus(name, status)
+	}
+	if err != nil {
+		log.Printf("Warning: failed to mark container '%s' %s: %v", name, status, err)
+	}
+}
+
+// runRuntime runs a short container_runtime command (--update, --pause, --resume);
+// the error carries the runtime's own message
+func runRuntime(args ...string) error {
+	out, err := exec.Command(RuntimeBinary, append([]string{"--quiet"}, args...)...).CombinedOutput()
+	if err != nil {
+		if message := strings.TrimSpace(string(out)); message != "" {
+			return fmt.Errorf("%s", message)
+		}
+		return err
+	}
+	return nil
+}
+
+// HealthCheckHandler returns service status, uptime and launch queue state (GET /health)
 func HealthCheckHandler(w http.ResponseWriter, r *http.Request) {
 	health := map[string]interface{}{
-		"status":  "healthy",
-		"version": ServerVersion,
-		"uptime":  time.Since(startTime).String(),
+		"status":   "healthy",
+		"version":  ServerVersion,
+		"uptime":   time.Since(startTime).String(),
+		"launcher": launcher.Stats(),
+		"storage":  "file",
+	}
+	if useDatabase {
+		health["storage"] = "postgresql"
 	}
 	SuccessResponse(w, "Service is healthy", health)
 }
 
+// validateName rejects names that aren't safe as a path component ("../x", "a/b")
+func validateName(name string) error {
+	if name == "" {
+		return fmt.Errorf("Container name is required")
+	}
+	if !namePattern.MatchString(name) {
+		return fmt.Errorf("Invalid container name %q: letters, digits, '_', '.' and '-', starting with a letter or digit", name)
+	}
+	return nil
+}
+
+// containerFromRequest validates a create request (POST /containers, bulk
+// creates) and builds the container with the defaults and the current time.
+// An error is the client's (400).
+func containerFromRequest(req CreateRequest) (Container, error) {
+	if err := validateName(req.Name); err != nil {
+		return Container{}, err
+	}
+	if err := req.Limits.Validate(); err != nil {
+		return Container{}, fmt.Errorf("Invalid limits: %w", err)
+	}
+
+	// Apply defaults for optional fields
+	if req.RootFS == "" {
+		req.RootFS = DefaultRootFS
+	}
+	if len(req.Argv) > 0 {
+		if req.Command != "" || req.Argv[0] == "" {
+			return Container{}, fmt.Errorf("argv needs a program and replaces command")
+		}
+		req.Command = quoteArgv(req.Argv)
+	}
+	if req.Command == "" {
+		req.Command = "/bin/bash"
+	}
+	return Container{
+		Name: req.Name, RootFS: req.RootFS, Command: req.Command, Argv: req.Argv, Init: req.Init,
+		Status: "created", CreatedAt: time.Now(), Limits: req.Limits,
+	}, nil
+}
+
 // CreateContainerHandler creates new container config (POST /containers)
 func CreateContainerHandler(w http.ResponseWriter, r *http.Request) {
 	var req CreateRequest
@@ -87,121 +402,128 @@ func CreateContainerHandler(w http.ResponseWriter, r *http.Request) {
 		return
 	}
 	
-	if req.Name == "" {
-		ErrorResponse(w, "Container name is required", http.StatusBadRequest)
+	container, err := containerFromRequest(req)
+	if err != nil {
+		ErrorResponse(w, err.Error(), http.StatusBadRequest)
 		return
 	}
 	
-	// Apply defaults for optional fields
-	if req.RootFS == "" {
-		req.RootFS = DefaultRootFS
-	}
-	if req.Command == "" {
-		req.Command = "/bin/bash"
-	}
-	
-	// Build container config with current timestamp
-	container := Container{
-		Name: req.Name, RootFS: req.RootFS, Command: req.Command,
-		Status: "created", CreatedAt: time.Now(),
-	}
-	
-	// Save to PostgreSQL or JSON file (depends on useDatabase flag)
+	// Save to PostgreSQL or the state store (depends on useDatabase flag); both
+	// report a taken name from the same locked insert
 	if useDatabase {
-		// Database path: check existence then insert
-		exists, err := db.ContainerExists(req.Name)
-		if err != nil {
-			ErrorResponse(w, "Database error: "+err.Error(), http.StatusInternalServerError)
-			return
-		}
-		if exists {
-			ErrorResponse(w, "Container '"+req.Name+"' already exists", http.StatusConflict)
-			return
-		}
-		
-		if err := db.CreateContainer(&container); err != nil {
-			ErrorResponse(w, "Failed to create container: "+err.Error(), http.StatusInternalServerError)
-			return
-		}
+		err = db.CreateContainer(&container)
 	} else {
-		// File path: check existence then write JSON
-		configPath := filepath.Join(ContainersDir, req.Name+".json")
-		if _, err := os.Stat(configPath); err == nil {
+		err = store.Create(&container)
+	}
+	if err != nil {
+		if err == ErrContainerExists {
 			ErrorResponse(w, "Container '"+req.Name+"' already exists", http.StatusConflict)
 			return
 		}
-		
-		if err := os.MkdirAll(ContainersDir, 0755); err != nil {
-			ErrorResponse(w, "Failed to create containers directory: "+err.Error(), http.StatusInternalServerError)
-			return
+		ErrorResponse(w, "Failed to create container: "+err.Error(), http.StatusInternalServerError)
+		return
+	}
+	
+	log.Printf("Container '%s' created successfully", req.Name)
+	SuccessResponse(w, "Container created successfully", container)
+}
+
+// parseListOptions reads ?limit=&after=&status= for GET /containers
+func parseListOptions(r *http.Request) (ListOptions, error) {
+	query := r.URL.Query()
+	opts := ListOptions{Status: query.Get("status"), Limit: DefaultPageSize}
+
+	if value := query.Get("limit"); value != "" {
+		n, err := strconv.Atoi(value)
+		if err != nil || n < 1 || n > MaxPageSize {
+			return opts, fmt.Errorf("limit must be between 1 and %d", MaxPageSize)
 		}
-		
-		configData, err := json.MarshalIndent(container, "", "  ")
+		opts.Limit = n
+	}
+	if value := query.Get("after"); value != "" {
+		cursor, err := ParsePageCursor(value)
 		if err != nil {
-			ErrorResponse(w, "Failed to serialize container config: "+err.Error(), http.StatusInternalServerError)
-			return
+			return opts, err
 		}
-		
-		if err := os.WriteFile(configPath, configData, 0644); err != nil {
-			ErrorResponse(w, "Failed to save container config: "+err.Error(), http.StatusInternalServerError)
-			return
+		opts.After = cursor
+	}
+	switch opts.Status {
+	case "", "created", "running", "stopped", "failed":
+	default:
+		return opts, fmt.Errorf("status must be created, running, stopped or failed")
+	}
+	return opts, nil
+}
+
+// pageCollector applies ListOptions to containers streamed in any order (file
+// storage), holding at most opts.Limit of them, newest first
+type pageCollector struct {
+	opts ListOptions
+	page []Container
+}
+
+func (p *pageCollector) add(c Container) {
+	if (p.opts.Status != "" && c.Status != p.opts.Status) || (p.opts.After != nil && !p.opts.After.Before(c)) {
+		return
+	}
+	i := sort.Search(len(p.page), func(i int) bool {
+		if !c.CreatedAt.Equal(p.page[i].CreatedAt) {
+			return c.CreatedAt.After(p.page[i].CreatedAt)
 		}
+		return c.Name > p.page[i].Name
+	})
+	if i == p.opts.Limit {
+		return
 	}
-	
-	log.Printf("Container '%s' created successfully", req.Name)
-	SuccessResponse(w, "Container created successfully", container)
+	if len(p.page) == p.opts.Limit {
+		p.page = p.page[:len(p.page)-1]
+	}
+	p.page = append(p.page, Container{})
+	copy(p.page[i+1:], p.page[i:])
+	p.page[i] = c
 }
 
-// ListContainersHandler returns all containers (GET /containers)
+// ListContainersHandler returns one page of containers, newest first
+// (GET /containers[?limit=N&after=CURSOR&status=S]); "next" holds the cursor of the following page
 func ListContainersHandler(w http.ResponseWriter, r *http.Request) {
 	var containers []Container
-	var err error
+
+	opts, err := parseListOptions(r)
+	if err != nil {
+		ErrorResponse(w, err.Error(), http.StatusBadRequest)
+		return
+	}
+	want := opts.Limit
+	opts.Limit++  // One extra row tells us whether another page exists
 	
 	if useDatabase {
-		// Database path: query all rows
-		containers, err = db.ListContainers()
+		// Database path: one keyset query per page
+		containers, err = db.ListContainers(opts)
 		if err != nil {
 			ErrorResponse(w, "Failed to list containers: "+err.Error(), http.StatusInternalServerError)
 			return
 		}
 	} else {
-		// File path: read all JSON files from directory
-		entries, err := os.ReadDir(ContainersDir)
-		if err != nil {
-			if os.IsNotExist(err) {
-				SuccessResponse(w, "No containers found", []Container{})
-				return
-			}
-			ErrorResponse(w, "Failed to read containers directory: "+err.Error(), http.StatusInternalServerError)
+		// File path: stream the state store, keeping only this page
+		pages := pageCollector{opts: opts, page: []Container{}}
+		if err := store.List(pages.add); err != nil {
+			ErrorResponse(w, "Failed to list containers: "+err.Error(), http.StatusInternalServerError)
 			return
 		}
-		
-		containers = []Container{}
-		
-		// Load each container configuration
-		for _, entry := range entries {
-			if filepath.Ext(entry.Name()) != ".json" {
-				continue
-			}
-			
-			configPath := filepath.Join(ContainersDir, entry.Name())
-			data, err := os.ReadFile(configPath)
-			if err != nil {
-				log.Printf("Warning: Failed to read %s: %v", entry.Name(), err)
-				continue
-			}
-			
-			var container Container
-			if err := json.Unmarshal(data, &container); err != nil {
-				log.Printf("Warning: Failed to parse %s: %v", entry.Name(), err)
-				continue
-			}
-			
-			containers = append(containers, container)
-		}
+		containers = pages.page
 	}
 	
-	SuccessResponse(w, fmt.Sprintf("Found %d container(s)", len(containers)), containers)
+	var next string
+	if len(containers) > want {
+		containers = containers[:want]
+		last := containers[want-1]
+		next = PageCursor{CreatedAt: last.CreatedAt, Name: last.Name}.Encode()
+	}
+	response := APIResponse{Success: true, Message: fmt.Sprintf("Found %d container(s)", len(containers)), Data: containers, Next: next}
+
+	w.Header().Set("Content-Type", "application/json")
+	w.WriteHeader(http.StatusOK)
+	json.NewEncoder(w).Encode(response)
 }
 
 // GetContainerHandler returns container info (GET /containers/{name})
@@ -214,44 +536,33 @@ func GetContainerHandler(w http.ResponseWriter, r *http.Request) {
 		return
 	}
 	
-	var container *Container
-	var err error
-	
-	if useDatabase {
-		// Database path: SELECT by name
-		container, err = db.GetContainer(name)
-		if err != nil {
-			if err.Error() == "container not found" {
-				ErrorResponse(w, "Container '"+name+"' not found", http.StatusNotFound)
-				return
-			}
-			ErrorResponse(w, "Failed to get container: "+err.Error(), http.StatusInternalServerError)
-			return
-		}
-	} else {
-		// Load container configuration from file
-		configPath := filepath.Join(ContainersDir, name+".json")
-		data, err := os.ReadFile(configPath)
-		if err != nil {
-			if os.IsNotExist(err) {
-				ErrorResponse(w, "Container '"+name+"' not found", http.StatusNotFound)
-				return
-			}
-			ErrorResponse(w, "Failed to read container config: "+err.Error(), http.StatusInternalServerError)
-			return
-		}
-		
-		var c Container
-		if err := json.Unmarshal(data, &c); err != nil {
-			ErrorResponse(w, "Failed to parse container config: "+err.Error(), http.StatusInternalServerError)
+	// SELECT by name or read the JSON file
+	container, err := loadContainer(name)
+	if err != nil {
+		if err.Error() == "container not found" {
+			ErrorResponse(w, "Container '"+name+"' not found", http.StatusNotFound)
 			return
 		}
-		container = &c
+		ErrorResponse(w, "Failed to get container: "+err.Error(), http.StatusInternalServerError)
+		return
 	}
 	
 	SuccessResponse(w, "Container found", container)
 }
 
+// GetProcessHandler returns the runtime process of the latest start (GET /containers/{name}/process)
+func GetProcessHandler(w http.ResponseWriter, r *http.Request) {
+	name := mux.Vars(r)["name"]
+
+	process, ok := launcher.Get(name)
+	if !ok {
+		ErrorResponse(w, "Container '"+name+"' has not been started by this server", http.StatusNotFound)
+		return
+	}
+
+	SuccessResponse(w, "Container process", process)
+}
+
 // DeleteContainerHandler removes container (DELETE /containers/{name})
 func DeleteContainerHandler(w http.ResponseWriter, r *http.Request) {
 	vars := mux.Vars(r)
@@ -261,37 +572,61 @@ func DeleteContainerHandler(w http.ResponseWriter, r *http.Request) {
 		ErrorResponse(w, "Container name is required", http.StatusBadRequest)
 		return
 	}
+
+	if process, ok := launcher.Get(name); ok && (process.Status == "queued" || process.Status == "running") {
+		ErrorResponse(w, "Container '"+name+"' is "+process.Status, http.StatusConflict)
+		return
+	}
 	
-	if useDatabase {
-		// Database path: DELETE query
-		if err := db.DeleteContainer(name); err != nil {
-			if err.Error() == "container not found" {
-				ErrorResponse(w, "Container '"+name+"' not found", http.StatusNotFound)
-				return
-			}
-			ErrorResponse(w, "Failed to delete container: "+err.Error(), http.StatusInternalServerError)
-			return
-		}
-	} else {
-		// Check if container exists
-		configPath := filepath.Join(ContainersDir, name+".json")
-		if _, err := os.Stat(configPath); os.IsNotExist(err) {
+	if err := deleteContainer(name); err != nil {
+		if err.Error() == "container not found" {
 			ErrorResponse(w, "Container '"+name+"' not found", http.StatusNotFound)
 			return
 		}
-		
-		// Delete container configuration file
-		if err := os.Remove(configPath); err != nil {
-			ErrorResponse(w, "Failed to delete container: "+err.Error(), http.StatusInternalServerError)
-			return
-		}
+		ErrorResponse(w, "Failed to delete container: "+err.Error(), http.StatusInternalServerError)
+		return
 	}
-	
+
 	log.Printf("Container '%s' deleted successfully", name)
 	SuccessResponse(w, "Container deleted successfully", map[string]string{"name": name})
 }
 
-// StartContainerHandler provides container start instructions (POST /containers/{name}/start)
+// deleteContainer removes the config (DELETE query, or a delete record in the
+// state store) and the files that go with it
+func deleteContainer(name string) error {
+	var err error
+	if useDatabase {
+		err = db.DeleteContainer(name)
+	} else {
+		err = store.Delete(name)
+	}
+	if err != nil {
+		return err
+	}
+	
+	// Captured output and runtime messages go with the container
+	files := []string{name + ".ring", name + ".log"}
+	replicas, _ := filepath.Glob(filepath.Join(ContainersDir, name+"-*.ring"))
+	for _, path := range replicas {
+		// <name>-<i>.ring of a batch start, unless <name>-<i> is a container of its own
+		replica := strings.TrimSuffix(strings.TrimPrefix(filepath.Base(path), name+"-"), ".ring")
+		if i, err := strconv.Atoi(replica); err != nil || i < 0 || i >= MaxReplicas || strconv.Itoa(i) != replica {
+			continue
+		}
+		if _, err := loadContainer(name + "-" + replica); err == nil {
+			continue
+		}
+		files = append(files, filepath.Base(path))
+	}
+	for _, file := range files {
+		if err := os.Remove(filepath.Join(ContainersDir, file)); err != nil && !os.IsNotExist(err) {
+			log.Printf("Warning: failed to remove %s: %v", file, err)
+		}
+	}
+	return nil
+}
+
+// StartContainerHandler queues a container_runtime launch (POST /containers/{name}/start[?replicas=N])
 func StartContainerHandler(w http.ResponseWriter, r *http.Request) {
 	vars := mux.Vars(r)
 	name := vars["name"]
@@ -301,33 +636,174 @@ func StartContainerHandler(w http.ResponseWriter, r *http.Request) {
 		return
 	}
 	
+	// Optional batch launch: one runtime process starts <name>-0 .. <name>-(N-1)
+	replicas := 1
+	if value := r.URL.Query().Get("replicas"); value != "" {
+		n, err := strconv.Atoi(value)
+		if err != nil || n < 1 || n > MaxReplicas {
+			ErrorResponse(w, fmt.Sprintf("replicas must be between 1 and %d", MaxReplicas), http.StatusBadRequest)
+			return
+		}
+		replicas = n
+	}
+	
 	// Load container configuration
-	configPath := filepath.Join(ContainersDir, name+".json")
-	data, err := os.ReadFile(configPath)
+	container, err := loadContainer(name)
 	if err != nil {
-		if os.IsNotExist(err) {
+		if err.Error() == "container not found" {
 			ErrorResponse(w, "Container '"+name+"' not found", http.StatusNotFound)
 			return
 		}
-		ErrorResponse(w, "Failed to read container config: "+err.Error(), http.StatusInternalServerError)
+		ErrorResponse(w, "Failed to get container: "+err.Error(), http.StatusInternalServerError)
 		return
 	}
 	
-	var container Container
-	if err := json.Unmarshal(data, &container); err != nil {
-		ErrorResponse(w, "Failed to parse container config: "+err.Error(), http.StatusInternalServerError)
+	// A fleet coordinator hands the start to a node; it runs here only without live nodes
+	if coordinator != nil && coordinator.Forward(w, *container, replicas) {
 		return
 	}
-	
-	// Interactive container start requires terminal I/O (not suitable for REST API)
-	// Return CLI command instead for user to execute
-	startInfo := map[string]string{
-		"message": "Container start requires interactive terminal",
-		"command": fmt.Sprintf("sudo %s %s %s %s", RuntimeBinary, container.Name, container.RootFS, container.Command),
-		"cli":     fmt.Sprintf("./minirun start %s", container.Name),
+	submitStart(w, *container, replicas)
+}
+
+// submitStart queues the launch; a worker runs container_runtime and the reaper records the exit
+func submitStart(w http.ResponseWriter, container Container, replicas int) {
+	process, err := launcher.Submit(container, replicas)
+	switch err {
+	case nil:
+	case ErrQueueFull:
+		w.Header().Set("Retry-After", "1")
+		ErrorResponse(w, "Too many pending starts, retry later", http.StatusTooManyRequests)
+		return
+	case ErrAlreadyRunning:
+		ErrorResponse(w, "Container '"+container.Name+"' is already "+process.Status, http.StatusConflict)
+		return
+	default:
+		ErrorResponse(w, "Failed to queue start: "+err.Error(), http.StatusInternalServerError)
+		return
 	}
 	
-	SuccessResponse(w, "Container start information", startInfo)
+	log.Printf("Container '%s' queued for start (%d replica(s))", container.Name, replicas)
+	AcceptedResponse(w, "Container start queued", process)
+}
+
+// UpdateContainerHandler changes some limits (PATCH /containers/{name}, body: a limits object).
+// Limits left out keep their stored values, and "" for a cpuset clears it. A running
+// container gets the merged set at once, written to its cgroup by container_runtime
+// --update without a restart.
+func UpdateContainerHandler(w http.ResponseWriter, r *http.Request) {
+	name := mux.Vars(r)["name"]
+
+	var patch LimitsPatch
+	if err := json.NewDecoder(r.Body).Decode(&patch); err != nil {
+		ErrorResponse(w, "Invalid request body: "+err.Error(), http.StatusBadRequest)
+		return
+	}
+	changes := patch.ResourceLimits
+	unpinCPUs := patch.CpusetCPUs != nil && *patch.CpusetCPUs == ""
+	unpinMems := patch.CpusetMems != nil && *patch.CpusetMems == ""
+	if patch.CpusetCPUs != nil {
+		changes.CpusetCPUs = *patch.CpusetCPUs
+	}
+	if patch.CpusetMems != nil {
+		changes.CpusetMems = *patch.CpusetMems
+	}
+	if len(changes.RuntimeArgs()) == 0 && !unpinCPUs && !unpinMems {
+		ErrorResponse(w, "No limits to change", http.StatusBadRequest)
+		return
+	}
+
+	container, err := loadContainer(name)
+	if err != nil {
+		if err.Error() == "container not found" {
+			ErrorResponse(w, "Container '"+name+"' not found", http.StatusNotFound)
+			return
+		}
+		ErrorResponse(w, "Failed to get container: "+err.Error(), http.StatusInternalServerError)
+		return
+	}
+
+	limits := container.Limits.Merge(changes)
+	if unpinCPUs {
+		limits.CpusetCPUs = ""
+	}
+	if unpinMems {
+		limits.CpusetMems = ""
+	}
+	if err := limits.Validate(); err != nil {
+		ErrorResponse(w, "Invalid limits: "+err.Error(), http.StatusBadRequest)
+		return
+	}
+
+	// Live first, so the stored limits never claim what the cgroup refused. A placed
+	// container keeps a dedicated cpuset, resized to the new quota.
+	if container.Status == "running" {
+		live, commit := launcher.placer.Update(name, limits)
+		args := append([]string{"--update"}, live.RuntimeArgs()...)
+		if unpinCPUs && live.CpusetCPUs == "" {
+			args = append(args, "--cpuset-cpus", "")  // Back to the parent's CPUs
+		}
+		if unpinMems && live.CpusetMems == "" {
+			args = append(args, "--cpuset-mems", "")
+		}
+		err := runRuntime(append(args, name)...)
+		commit(err == nil)
+		if err != nil {
+			ErrorResponse(w, "Failed to update running container: "+err.Error(), http.StatusConflict)
+			return
+		}
+	}
+
+	if useDatabase {
+		err = db.UpdateContainerLimits(name, limits)
+	} else {
+		err = store.SetLimits(name, limits)
+	}
+	if err != nil {
+		if err.Error() == "container not found" {
+			ErrorResponse(w, "Container '"+name+"' not found", http.StatusNotFound)
+			return
+		}
+		ErrorResponse(w, "Failed to update container: "+err.Error(), http.StatusInternalServerError)
+		return
+	}
+	container.Limits = limits
+
+	log.Printf("Container '%s' limits updated (live: %v)", name, container.Status == "running")
+	SuccessResponse(w, "Container updated successfully", container)
+}
+
+// FreezeContainerHandler returns the handler of POST /containers/{name}/pause (frozen)
+// and /resume, which toggle cgroup.freeze of a running container
+func FreezeContainerHandler(frozen bool) http.HandlerFunc {
+	flag, done := "--resume", "resumed"
+	if frozen {
+		flag, done = "--pause", "paused"
+	}
+	return func(w http.ResponseWriter, r *http.Request) {
+		name := mux.Vars(r)["name"]
+
+		container, err := loadContainer(name)
+		if err != nil {
+			if err.Error() == "container not found" {
+				ErrorResponse(w, "Container '"+name+"' not found", http.StatusNotFound)
+				return
+			}
+			ErrorResponse(w, "Failed to get container: "+err.Error(), http.StatusInternalServerError)
+			return
+		}
+		if container.Status != "running" {
+			ErrorResponse(w, "Container '"+name+"' is "+container.Status, http.StatusConflict)
+			return
+		}
+
+		if err := runRuntime(flag, name); err != nil {
+			ErrorResponse(w, "Failed to "+flag[2:]+" container: "+err.Error(), http.StatusInternalServerError)
+			return
+		}
+
+		log.Printf("Container '%s' %s", name, done)
+		SuccessResponse(w, "Container "+done, map[string]string{"name": name})
+	}
 }
 
 // LoggingMiddleware logs HTTP method, URI, client IP, and duration
@@ -344,7 +820,7 @@ func LoggingMiddleware(next http.Handler) http.Handler {
 func CORSMiddleware(next http.Handler) http.Handler {
 	return http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
 		w.Header().Set("Access-Control-Allow-Origin", "*")  // Allow all origins (restrict in production)
-		w.Header().Set("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS")
+		w.Header().Set("Access-Control-Allow-Methods", "GET, POST, PUT, PATCH, DELETE, OPTIONS")
 		w.Header().Set("Access-Control-Allow-Headers", "Content-Type, Authorization")
 		
 		if r.Method == "OPTIONS" {  // Preflight request
@@ -360,8 +836,13 @@ var startTime time.Time
 
 func main() {
 	startTime = time.Now()
+	// Requests never wait for the log's destination (see AsyncLogWriter)
+	asyncLog = NewAsyncLogWriter(os.Stderr)
+	log.SetOutput(asyncLog)
+	launcher = NewLauncherFromEnv()
+	coordinator = NewCoordinatorFromEnv()
 	
-	// Try to initialize PostgreSQL (falls back to JSON files if unavailable)
+	// Try to initialize PostgreSQL (falls back to the state store if unavailable)
 	dbHost := os.Getenv("DB_HOST")
 	dbPort := os.Getenv("DB_PORT")
 	dbUser := os.Getenv("DB_USER")
@@ -399,11 +880,21 @@ func main() {
 	
 	// Register API endpoints
 	router.HandleFunc("/health", HealthCheckHandler).Methods("GET")
+	router.HandleFunc("/metrics", MetricsHandler).Methods("GET")
 	router.HandleFunc("/containers", CreateContainerHandler).Methods("POST")
 	router.HandleFunc("/containers", ListContainersHandler).Methods("GET")
+	router.HandleFunc("/bulk", BulkHandler).Methods("POST")
 	router.HandleFunc("/containers/{name}", GetContainerHandler).Methods("GET")
-	router.HandleFunc("/containers/{name}", DeleteContainerHandler).Methods("DELETE")
+	router.HandleFunc("/containers/{name}", proxiedHandler(UpdateContainerHandler)).Methods("PATCH")
+	router.HandleFunc("/containers/{name}", proxiedHandler(DeleteContainerHandler)).Methods("DELETE")
 	router.HandleFunc("/containers/{name}/start", StartContainerHandler).Methods("POST")
+	router.HandleFunc("/containers/{name}/pause", proxiedHandler(FreezeContainerHandler(true))).Methods("POST")
+	router.HandleFunc("/containers/{name}/resume", proxiedHandler(FreezeContainerHandler(false))).Methods("POST")
+	router.HandleFunc("/containers/{name}/process", proxiedHandler(GetProcessHandler)).Methods("GET")
+	router.HandleFunc("/containers/{name}/logs", proxiedHandler(LogsHandler)).Methods("GET")
+	router.HandleFunc("/nodes", ListNodesHandler).Methods("GET")
+	router.HandleFunc("/nodes/heartbeat", HeartbeatHandler).Methods("POST")
+	router.HandleFunc("/fleet/launch", FleetLaunchHandler).Methods("POST")
 	
 	// Root endpoint with API documentation
 	router.HandleFunc("/", func(w http.ResponseWriter, r *http.Request) {
@@ -411,9 +902,13 @@ func main() {
 			"service": "MiniRun Container Orchestrator",
 			"version": ServerVersion,
 			"endpoints": []string{
-				"GET    /health", "POST   /containers", "GET    /containers",
-				"GET    /containers/{name}", "DELETE /containers/{name}",
-				"POST   /containers/{name}/start",
+				"GET    /health", "GET    /metrics", "POST   /containers", "GET    /containers[?limit=N&after=CURSOR&status=S]",
+				"POST   /bulk (NDJSON create/start stream)",
+				"GET    /containers/{name}", "PATCH  /containers/{name}", "DELETE /containers/{name}",
+				"POST   /containers/{name}/start[?replicas=N]", "GET    /containers/{name}/process",
+				"POST   /containers/{name}/pause", "POST   /containers/{name}/resume",
+				"GET    /containers/{name}/logs[?follow=1&replica=N]",
+				"GET    /nodes", "POST   /nodes/heartbeat", "POST   /fleet/launch[?replicas=N]",
 			},
 		}
 		SuccessResponse(w, "MiniRun Orchestrator API", info)
@@ -429,6 +924,18 @@ func main() {
 		keyPath = DefaultKeyPath
 	}
 	
+	// Node agent: report capacity to the fleet coordinator, which forwards starts to /fleet/launch
+	if coordinatorURL := os.Getenv("COORDINATOR_URL"); coordinatorURL != "" {
+		nodeName, nodeAddr := os.Getenv("NODE_NAME"), os.Getenv("NODE_ADDR")
+		if nodeName == "" {
+			nodeName, _ = os.Hostname()
+		}
+		if nodeAddr == "" {
+			logFatalf("COORDINATOR_URL requires NODE_ADDR, the URL the coordinator reaches this server at")
+		}
+		go RunAgent(strings.TrimRight(coordinatorURL, "/"), nodeName, strings.TrimRight(nodeAddr, "/"))
+	}
+	
 	// Print startup banner
 	log.Printf("╔════════════════════════════════════════════════╗")
 	log.Printf("║   MiniRun Container Orchestrator              ║")
@@ -449,7 +956,7 @@ func main() {
 		log.Printf("")
 		
 		if err := http.ListenAndServeTLS(addr, certPath, keyPath, router); err != nil {
-			log.Fatalf("HTTPS server failed to start: %v", err)
+			logFatalf("HTTPS server failed to start: %v", err)
 		}
 	} else {
 		addr := ":" + ServerPort
@@ -464,7 +971,7 @@ func main() {
 		log.Printf("")
 		
 		if err := http.ListenAndServe(addr, router); err != nil {
-			log.Fatalf("HTTP server failed to start: %v", err)
+			logFatalf("HTTP server failed to start: %v", err)
 		}
 	}
 }
@@ -0,0 +1,595 @@
+package main
+
+import (
+	"fmt"            // Formatted I/O
+	"log"            // Logging
+	"net/http"       // Metrics endpoint
+	"os"             // Topology files and environment
+	"path/filepath"  // Node directories
+	"sort"           // Candidate ordering
+	"strconv"        // CPU list parsing
+	"strings"        // CPU list parsing
+	"sync"           // Allocation table lock
+)
+
+// Topology as the kernel exports it (node<N>/cpulist, cpu<N>/topology/core_id)
+const (
+	SysNodeDir = "/sys/devices/system/node"
+	SysCPUDir  = "/sys/devices/system/cpu"
+)
+
+// Placement modes (PLACEMENT=pack|spread, anything else leaves placement off)
+const (
+	PlacementPack   = "pack"    // Fill the fullest node that still fits, sibling threads together
+	PlacementSpread = "spread"  // Emptiest node, idle cores first
+)
+
+// placementCPU is one online logical CPU
+type placementCPU struct {
+	id    int
+	node  int
+	core  int     // Package and core_id: threads with the same value share a core
+	owner string  // Container it is dedicated to ("" = free)
+}
+
+// Placement is where one container runs
+type Placement struct {
+	CPUs   []int          // Dedicated logical CPUs
+	Nodes  []int          // NUMA nodes of those CPUs (cpuset.mems)
+	limits ResourceLimits // Stored limits, passed again when a rebalance moves it
+}
+
+// Placer gives containers dedicated cpuset.cpus/cpuset.mems.
+//
+// Without it every container only gets its cpu.max quota and the kernel runs
+// it on any CPU, so busy containers share cores and caches with each other and
+// with memory on the other socket. A container started by the launcher that has
+// no cpuset of its own gets ceil(cpu / 100) CPUs no other placed container uses,
+// all on one node where they fit, with its memory on that node. pack picks the
+// node with the fewest free CPUs that still fit and takes both threads of a
+// core first, which leaves whole nodes free for big containers. spread picks
+// the node with the most free CPUs and idle cores first, which keeps SMT
+// siblings and caches apart. A container that fits on no single node is split
+// over the nodes with the most free CPUs. One that doesn't fit at all runs
+// with its quota only, as without placement. When a placed container exits,
+// every split container that now fits on one node is moved there with
+// container_runtime --update, without a restart. Batch starts and containers
+// with their own cpuset_cpus are not placed, and their CPUs are not tracked.
+type Placer struct {
+	mode     string
+	apply    func(name string, limits ResourceLimits) error  // Rewrites a running container's cpuset
+	mu       sync.Mutex
+	cpus     []placementCPU  // Ordered by node, core, id
+	nodes    []int
+	placed   map[string]*Placement
+	counters map[string]int64  // Decisions by result, for /metrics
+}
+
+// NewPlacerFromEnv reads PLACEMENT and PLACEMENT_RESERVED_CPUS (kept for the host); nil if off
+func NewPlacerFromEnv() *Placer {
+	mode := os.Getenv("PLACEMENT")
+	if mode != PlacementPack && mode != PlacementSpread {
+		if mode != "" && mode != "off" {
+			log.Printf("Warning: ignoring invalid PLACEMENT=%q (pack, spread or off)", mode)
+		}
+		return nil
+	}
+	reserved, err := parseCPUList(os.Getenv("PLACEMENT_RESERVED_CPUS"))
+	if err != nil {
+		log.Printf("Warning: ignoring invalid PLACEMENT_RESERVED_CPUS: %v", err)
+		reserved = nil
+	}
+	p, err := NewPlacer(mode, SysNodeDir, SysCPUDir, reserved)
+	if err != nil {
+		log.Printf("Warning: CPU placement off: %v", err)
+		return nil
+	}
+	p.apply = func(name string, limits ResourceLimits) error {
+		return runRuntime(append(append([]string{"--update"}, limits.RuntimeArgs()...), name)...)
+	}
+	log.Printf("CPU placement: %s over %d CPUs on %d node(s)", mode, len(p.cpus), len(p.nodes))
+	return p
+}
+
+// NewPlacer reads the topology under nodeDir and cpuDir (no node directories = one node 0)
+func NewPlacer(mode, nodeDir, cpuDir string, reserved []int) (*Placer, error) {
+	online, err := readCPUList(filepath.Join(cpuDir, "online"))
+	if err != nil {
+		return nil, err
+	}
+	nodeOf := make(map[int]int)
+	for _, cpu := range online {
+		nodeOf[cpu] = 0
+	}
+	nodeDirs, _ := filepath.Glob(filepath.Join(nodeDir, "node[0-9]*"))
+	for _, dir := range nodeDirs {
+		node, err := strconv.Atoi(strings.TrimPrefix(filepath.Base(dir), "node"))
+		if err != nil {
+			continue
+		}
+		cpus, err := readCPUList(filepath.Join(dir, "cpulist"))
+		if err != nil {
+			return nil, err
+		}
+		for _, cpu := range cpus {
+			if _, ok := nodeOf[cpu]; ok {
+				nodeOf[cpu] = node
+			}
+		}
+	}
+	skip := make(map[int]bool)
+	for _, cpu := range reserved {
+		skip[cpu] = true
+	}
+
+	p := &Placer{mode: mode, placed: make(map[string]*Placement), counters: make(map[string]int64)}
+	seen := make(map[int]bool)
+	for cpu, node := range nodeOf {
+		if skip[cpu] {
+			continue
+		}
+		core := cpu
+		pkg, errPkg := readInt(filepath.Join(cpuDir, fmt.Sprintf("cpu%d/topology/physical_package_id", cpu)))
+		id, errCore := readInt(filepath.Join(cpuDir, fmt.Sprintf("cpu%d/topology/core_id", cpu)))
+		if errPkg == nil && errCore == nil {
+			core = pkg<<16 | id
+		}
+		p.cpus = append(p.cpus, placementCPU{id: cpu, node: node, core: core})
+		if !seen[node] {
+			seen[node] = true
+			p.nodes = append(p.nodes, node)
+		}
+	}
+	if len(p.cpus) == 0 {
+		return nil, fmt.Errorf("no CPUs left to place containers on")
+	}
+	sort.Ints(p.nodes)
+	sort.Slice(p.cpus, func(i, j int) bool {
+		a, b := p.cpus[i], p.cpus[j]
+		if a.node != b.node {
+			return a.node < b.node
+		}
+		if a.core != b.core {
+			return a.core < b.core
+		}
+		return a.id < b.id
+	})
+	return p, nil
+}
+
+// cpusWanted is the number of dedicated CPUs for a cpu.max quota (% of one core)
+func cpusWanted(limits ResourceLimits) int {
+	cpu := limits.CPU
+	if cpu == 0 {
+		cpu = DefaultCPUPercent
+	}
+	return (cpu + 99) / 100
+}
+
+// Place dedicates CPUs to a container about to start and returns its limits with
+// the cpuset filled in (unchanged if it has its own, or nothing is free)
+func (p *Placer) Place(name string, limits ResourceLimits) ResourceLimits {
+	if p == nil || limits.CpusetCPUs != "" {
+		return limits
+	}
+	p.mu.Lock()
+	defer p.mu.Unlock()
+
+	p.release(name)  // A previous run that never reported its exit
+	cpus, result := p.pick(cpusWanted(limits), -1)
+	p.counters[result]++
+	if cpus == nil {
+		log.Printf("Placement: no %d free CPU(s) for '%s', running it on its quota only", cpusWanted(limits), name)
+		return limits
+	}
+	placement := p.assign(name, cpus, limits)
+	log.Printf("Placement: '%s' on CPUs %s (node %s, %s)", name,
+		formatCPUList(placement.CPUs), formatCPUList(placement.Nodes), result)
+	return placement.withCpuset(limits)
+}
+
+// Update is Place for PATCH /containers/{name} of a running container: the new
+// limits with a cpuset of the new size, or as given if it isn't placed. The
+// placement only changes once commit reports that container_runtime --update
+// applied them; until then both CPU sets stay reserved, as in rebalance(), so a
+// refused update leaves the table matching the cgroup.
+func (p *Placer) Update(name string, limits ResourceLimits) (ResourceLimits, func(applied bool)) {
+	noop := func(bool) {}
+	if p == nil {
+		return limits, noop
+	}
+	p.mu.Lock()
+	defer p.mu.Unlock()
+
+	old, ok := p.placed[name]
+	if !ok {
+		return limits, noop
+	}
+	if limits.CpusetCPUs != "" {
+		// Pinned by hand from now on
+		return limits, func(applied bool) {
+			p.mu.Lock()
+			if applied && p.placed[name] == old {
+				p.release(name)
+			}
+			p.mu.Unlock()
+		}
+	}
+
+	want := cpusWanted(limits)
+	free := 0
+	if len(old.Nodes) == 1 {
+		for _, c := range p.cpus {
+			if c.node == old.Nodes[0] && c.owner == "" {
+				free++
+			}
+		}
+	}
+	var cpus []int
+	result := ""
+	switch {
+	case want <= len(old.CPUs):
+		cpus = old.CPUs[:want]  // Keep the CPUs it has (and their warm caches)
+	case len(old.Nodes) == 1 && free >= want-len(old.CPUs):
+		cpus = append(p.freeOn(old.Nodes[0], want-len(old.CPUs)), old.CPUs...)
+		sort.Ints(cpus)
+		result = "node"
+	default:
+		// Any CPUs, its own included
+		for _, id := range old.CPUs {
+			p.cpuByID(id).owner = ""
+		}
+		cpus, result = p.pick(want, -1)
+		for _, id := range old.CPUs {
+			p.cpuByID(id).owner = name
+		}
+		if cpus == nil {
+			cpus = old.CPUs  // Grows within its quota only
+		}
+	}
+	if result != "" {
+		p.counters[result]++
+	}
+	var added []int
+	for _, id := range cpus {
+		if c := p.cpuByID(id); c.owner == "" {
+			c.owner = name
+			added = append(added, id)
+		}
+	}
+	updated := &Placement{CPUs: cpus, Nodes: p.nodesOf(cpus), limits: limits}
+
+	return updated.withCpuset(limits), func(applied bool) {
+		p.mu.Lock()
+		defer p.mu.Unlock()
+		if applied && p.placed[name] == old {
+			kept := make(map[int]bool, len(cpus))
+			for _, id := range cpus {
+				kept[id] = true
+			}
+			for _, id := range old.CPUs {
+				if c := p.cpuByID(id); !kept[id] && c.owner == name {
+					c.owner = ""
+				}
+			}
+			p.placed[name] = updated
+			return
+		}
+		for _, id := range added {
+			if c := p.cpuByID(id); c.owner == name {
+				c.owner = ""
+			}
+		}
+	}
+}
+
+// Release frees the CPUs of a container that exited, then moves split containers
+// that now fit on one node there
+func (p *Placer) Release(name string) {
+	if p == nil {
+		return
+	}
+	p.mu.Lock()
+	_, ok := p.placed[name]
+	p.release(name)
+	p.mu.Unlock()
+	if ok {
+		p.rebalance()
+	}
+}
+
+// rebalance moves each split container onto a single node where it now fits
+func (p *Placer) rebalance() {
+	p.mu.Lock()
+	names := make([]string, 0, len(p.placed))
+	for name, placement := range p.placed {
+		if len(placement.Nodes) > 1 {
+			names = append(names, name)
+		}
+	}
+	p.mu.Unlock()
+	sort.Strings(names)
+
+	for _, name := range names {
+		p.mu.Lock()
+		old, ok := p.placed[name]
+		var cpus []int
+		if ok && len(old.Nodes) > 1 {
+			cpus, _ = p.pick(len(old.CPUs), 1)
+		}
+		if cpus == nil {
+			p.mu.Unlock()
+			continue
+		}
+		// Hold both sets while the runtime rewrites the cgroup, so no start takes either
+		for _, id := range cpus {
+			p.cpuByID(id).owner = name
+		}
+		moved := &Placement{CPUs: cpus, Nodes: p.nodesOf(cpus), limits: old.limits}
+		p.mu.Unlock()
+
+		err := p.apply(name, moved.withCpuset(old.limits))
+
+		p.mu.Lock()
+		current, still := p.placed[name]
+		if err == nil && still && current == old {
+			for _, id := range old.CPUs {
+				p.cpuByID(id).owner = ""
+			}
+			p.placed[name] = moved
+			p.counters["rebalanced"]++
+			log.Printf("Placement: moved '%s' to CPUs %s (node %s)", name,
+				formatCPUList(moved.CPUs), formatCPUList(moved.Nodes))
+		} else {
+			for _, id := range cpus {
+				if c := p.cpuByID(id); c.owner == name {
+					c.owner = ""
+				}
+			}
+			if err != nil {
+				log.Printf("Warning: failed to move '%s' to node %s: %v", name, formatCPUList(moved.Nodes), err)
+			}
+		}
+		p.mu.Unlock()
+	}
+}
+
+// pick chooses n free CPUs by the placement mode, as "node" (all on one node),
+// "split" (several nodes, only when maxNodes is -1) or "unplaced" (nil)
+func (p *Placer) pick(n, maxNodes int) ([]int, string) {
+	free := make(map[int]int)
+	for _, c := range p.cpus {
+		if c.owner == "" {
+			free[c.node]++
+		}
+	}
+
+	// Nodes in order of preference: pack = fullest first, spread = emptiest first
+	nodes := append([]int(nil), p.nodes...)
+	sort.SliceStable(nodes, func(i, j int) bool {
+		if p.mode == PlacementPack {
+			return free[nodes[i]] < free[nodes[j]]
+		}
+		return free[nodes[i]] > free[nodes[j]]
+	})
+	for _, node := range nodes {
+		if free[node] >= n {
+			return p.freeOn(node, n), "node"
+		}
+	}
+	if maxNodes != -1 {
+		return nil, "unplaced"
+	}
+
+	// Split: as few nodes as possible, the ones with the most free CPUs
+	sort.SliceStable(nodes, func(i, j int) bool { return free[nodes[i]] > free[nodes[j]] })
+	var cpus []int
+	for _, node := range nodes {
+		if len(cpus) == n {
+			break
+		}
+		take := free[node]
+		if take > n-len(cpus) {
+			take = n - len(cpus)
+		}
+		cpus = append(cpus, p.freeOn(node, take)...)
+	}
+	if len(cpus) < n {
+		return nil, "unplaced"
+	}
+	return cpus, "split"
+}
+
+// freeOn returns n free CPUs of a node: pack fills cores in order, spread takes idle cores first
+func (p *Placer) freeOn(node, n int) []int {
+	busy := make(map[int]int)  // Allocated threads per core
+	var candidates []placementCPU
+	for _, c := range p.cpus {
+		if c.node != node {
+			continue
+		}
+		if c.owner != "" {
+			busy[c.core]++
+		} else {
+			candidates = append(candidates, c)
+		}
+	}
+	if p.mode == PlacementSpread {
+		sort.SliceStable(candidates, func(i, j int) bool {
+			return busy[candidates[i].core] < busy[candidates[j].core]
+		})
+	}
+	cpus := make([]int, 0, n)
+	for _, c := range candidates[:n] {
+		cpus = append(cpus, c.id)
+	}
+	sort.Ints(cpus)
+	return cpus
+}
+
+// assign records a placement (lock held)
+func (p *Placer) assign(name string, cpus []int, limits ResourceLimits) *Placement {
+	for _, id := range cpus {
+		p.cpuByID(id).owner = name
+	}
+	placement := &Placement{CPUs: cpus, Nodes: p.nodesOf(cpus), limits: limits}
+	p.placed[name] = placement
+	return placement
+}
+
+// release frees a container's CPUs (lock held)
+func (p *Placer) release(name string) {
+	placement, ok := p.placed[name]
+	if !ok {
+		return
+	}
+	for _, id := range placement.CPUs {
+		if c := p.cpuByID(id); c.owner == name {
+			c.owner = ""
+		}
+	}
+	delete(p.placed, name)
+}
+
+func (p *Placer) cpuByID(id int) *placementCPU {
+	for i := range p.cpus {
+		if p.cpus[i].id == id {
+			return &p.cpus[i]
+		}
+	}
+	return &placementCPU{}  // Not placeable (reserved or offline since)
+}
+
+func (p *Placer) nodesOf(cpus []int) []int {
+	seen := make(map[int]bool)
+	var nodes []int
+	for _, id := range cpus {
+		node := p.cpuByID(id).node
+		if !seen[node] {
+			seen[node] = true
+			nodes = append(nodes, node)
+		}
+	}
+	sort.Ints(nodes)
+	return nodes
+}
+
+// withCpuset returns limits pinned to the placement
+func (pl *Placement) withCpuset(limits ResourceLimits) ResourceLimits {
+	limits.CpusetCPUs = formatCPUList(pl.CPUs)
+	limits.CpusetMems = formatCPUList(pl.Nodes)
+	return limits
+}
+
+// WriteMetrics writes the allocation table and decision counts in the Prometheus text format
+func (p *Placer) WriteMetrics(w http.ResponseWriter) {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+
+	fmt.Fprintf(w, "# HELP minirun_placement_mode Active placement mode.\n# TYPE minirun_placement_mode gauge\n")
+	fmt.Fprintf(w, "minirun_placement_mode{mode=%q} 1\n", p.mode)
+
+	total := make(map[int]int)
+	allocated := make(map[int]int)
+	for _, c := range p.cpus {
+		total[c.node]++
+		if c.owner != "" {
+			allocated[c.node]++
+		}
+	}
+	fmt.Fprintf(w, "# HELP minirun_placement_node_cpus Placeable CPUs per NUMA node.\n# TYPE minirun_placement_node_cpus gauge\n")
+	for _, node := range p.nodes {
+		fmt.Fprintf(w, "minirun_placement_node_cpus{node=\"%d\"} %d\n", node, total[node])
+	}
+	fmt.Fprintf(w, "# HELP minirun_placement_node_allocated_cpus CPUs dedicated to containers per NUMA node.\n# TYPE minirun_placement_node_allocated_cpus gauge\n")
+	for _, node := range p.nodes {
+		fmt.Fprintf(w, "minirun_placement_node_allocated_cpus{node=\"%d\"} %d\n", node, allocated[node])
+	}
+
+	names := make([]string, 0, len(p.placed))
+	for name := range p.placed {
+		names = append(names, name)
+	}
+	sort.Strings(names)
+	fmt.Fprintf(w, "# HELP minirun_placement_container_cpus CPUs dedicated to a container per NUMA node.\n# TYPE minirun_placement_container_cpus gauge\n")
+	for _, name := range names {
+		perNode := make(map[int]int)
+		for _, id := range p.placed[name].CPUs {
+			perNode[p.cpuByID(id).node]++
+		}
+		for _, node := range p.placed[name].Nodes {
+			fmt.Fprintf(w, "minirun_placement_container_cpus{container=%q,node=\"%d\"} %d\n", name, node, perNode[node])
+		}
+	}
+
+	fmt.Fprintf(w, "# HELP minirun_placement_decisions_total Starts and resizes by outcome (node, split, unplaced), and moves by rebalances.\n# TYPE minirun_placement_decisions_total counter\n")
+	for _, result := range []string{"node", "split", "unplaced", "rebalanced"} {
+		fmt.Fprintf(w, "minirun_placement_decisions_total{result=%q} %d\n", result, p.counters[result])
+	}
+}
+
+// MetricsHandler serves the placement metrics (GET /metrics; empty while placement is off)
+func MetricsHandler(w http.ResponseWriter, r *http.Request) {
+	w.Header().Set("Content-Type", "text/plain; version=0.0.4")
+	if launcher.placer != nil {
+		launcher.placer.WriteMetrics(w)
+	}
+}
+
+// parseCPUList parses a kernel CPU list ("0-3,8,10-11"); "" is an empty list
+func parseCPUList(list string) ([]int, error) {
+	var cpus []int
+	list = strings.TrimSpace(list)
+	if list == "" {
+		return nil, nil
+	}
+	for _, part := range strings.Split(list, ",") {
+		first, last, isRange := strings.Cut(part, "-")
+		lo, err := strconv.Atoi(first)
+		hi := lo
+		if err == nil && isRange {
+			hi, err = strconv.Atoi(last)
+		}
+		if err != nil || lo < 0 || hi < lo {
+			return nil, fmt.Errorf("invalid CPU list %q", list)
+		}
+		for cpu := lo; cpu <= hi; cpu++ {
+			cpus = append(cpus, cpu)
+		}
+	}
+	return cpus, nil
+}
+
+// formatCPUList is the inverse of parseCPUList for sorted lists (runs become ranges)
+func formatCPUList(cpus []int) string {
+	var parts []string
+	for i := 0; i < len(cpus); {
+		j := i
+		for j+1 < len(cpus) && cpus[j+1] == cpus[j]+1 {
+			j++
+		}
+		if j > i {
+			parts = append(parts, fmt.Sprintf("%d-%d", cpus[i], cpus[j]))
+		} else {
+			parts = append(parts, strconv.Itoa(cpus[i]))
+		}
+		i = j + 1
+	}
+	return strings.Join(parts, ",")
+}
+
+func readCPUList(path string) ([]int, error) {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return nil, err
+	}
+	return parseCPUList(string(data))
+}
+
+func readInt(path string) (int, error) {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return 0, err
+	}
+	return strconv.Atoi(strings.TrimSpace(string(data)))
+}
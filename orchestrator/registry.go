@@ -0,0 +1,110 @@
+package main
+
+import (
+	"hash/fnv"  // Shard selection
+	"sync"      // Per-shard locks
+)
+
+// RegistryShards is the number of independently locked maps in the registry
+const RegistryShards = 16
+
+// Registry is an in-memory copy of the containers table.
+//
+// Lookups by name are served from memory; Database writes through to it
+// after every successful statement and applies NOTIFY events from other
+// replicas. Names are spread over RegistryShards maps, each with its own
+// RWMutex, so concurrent readers never contend and a write only blocks
+// the names that hash to the same shard.
+type Registry struct {
+	shards [RegistryShards]registryShard
+}
+
+type registryShard struct {
+	mu         sync.RWMutex
+	containers map[string]Container
+}
+
+// NewRegistry returns an empty registry
+func NewRegistry() *Registry {
+	r := &Registry{}
+	for i := range r.shards {
+		r.shards[i].containers = make(map[string]Container)
+	}
+	return r
+}
+
+// shardIndex maps a name to its shard
+func shardIndex(name string) uint32 {
+	h := fnv.New32a()
+	h.Write([]byte(name))
+	return h.Sum32() % RegistryShards
+}
+
+func (r *Registry) shard(name string) *registryShard {
+	return &r.shards[shardIndex(name)]
+}
+
+// Get returns a copy of one container
+func (r *Registry) Get(name string) (Container, bool) {
+	s := r.shard(name)
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+
+	c, ok := s.containers[name]
+	return c, ok
+}
+
+// Put inserts or replaces a container
+func (r *Registry) Put(c Container) {
+	s := r.shard(c.Name)
+	s.mu.Lock()
+	s.containers[c.Name] = c
+	s.mu.Unlock()
+}
+
+// SetStatus updates the status of a cached container (no-op if absent)
+func (r *Registry) SetStatus(name, status string) {
+	s := r.shard(name)
+	s.mu.Lock()
+	if c, ok := s.containers[name]; ok {
+		c.Status = status
+		s.containers[name] = c
+	}
+	s.mu.Unlock()
+}
+
+// SetLimits replaces the limits of a cached container (no-op if absent)
+func (r *Registry) SetLimits(name string, limits ResourceLimits) {
+	s := r.shard(name)
+	s.mu.Lock()
+	if c, ok := s.containers[name]; ok {
+		c.Limits = limits
+		s.containers[name] = c
+	}
+	s.mu.Unlock()
+}
+
+// Delete removes a container
+func (r *Registry) Delete(name string) {
+	s := r.shard(name)
+	s.mu.Lock()
+	delete(s.containers, name)
+	s.mu.Unlock()
+}
+
+// Replace swaps the whole contents for a fresh snapshot (warm-up and resync)
+func (r *Registry) Replace(containers []Container) {
+	var fresh [RegistryShards]map[string]Container
+	for i := range fresh {
+		fresh[i] = make(map[string]Container)
+	}
+	for _, c := range containers {
+		fresh[shardIndex(c.Name)][c.Name] = c
+	}
+	for i := range r.shards {
+		s := &r.shards[i]
+		s.mu.Lock()
+		s.containers = fresh[i]
+		s.mu.Unlock()
+	}
+}
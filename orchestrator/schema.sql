@@ -9,6 +9,9 @@ CREATE TABLE containers (
     rootfs VARCHAR(512) NOT NULL,         -- Path to root filesystem
     command VARCHAR(255) NOT NULL,        -- Command to execute
     status VARCHAR(50) NOT NULL CHECK (status IN ('created', 'running', 'stopped', 'failed')),
+    limits JSONB NOT NULL DEFAULT '{}',   -- Cgroup limits (same keys as ./minirun configs)
+    argv JSONB,                           -- Program + arguments exec'd without bash (NULL = bash -c command)
+    init BOOLEAN NOT NULL DEFAULT FALSE,  -- Minimal init as PID 1 (runtime --init)
     created_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP,  -- Creation time
     updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP            -- Last modification time
 );
@@ -16,6 +19,8 @@ CREATE TABLE containers (
 CREATE INDEX idx_containers_status ON containers(status);      -- Fast status queries
 CREATE INDEX idx_containers_created ON containers(created_at); -- Fast time-based queries
 CREATE INDEX idx_containers_name ON containers(name);          -- Fast name lookups
+CREATE INDEX idx_containers_created_name ON containers(created_at DESC, name DESC);  -- Keyset pages of GET /containers
+CREATE INDEX idx_containers_status_created ON containers(status, created_at DESC, name DESC);  -- Same, with ?status=
 
 -- Auto-update updated_at timestamp on any row change
 CREATE OR REPLACE FUNCTION update_updated_at_column()
@@ -29,4 +34,22 @@ $$ language 'plpgsql';
 CREATE TRIGGER update_containers_updated_at
     BEFORE UPDATE ON containers
     FOR EACH ROW
-    EXECUTE FUNCTION update_updated_at_column();
\ No newline at end of file
+    EXECUTE FUNCTION update_updated_at_column();
+
+-- Publish every change as "<OP> <name>" so each API replica can update its in-memory registry
+CREATE OR REPLACE FUNCTION notify_container_change()
+RETURNS TRIGGER AS $$
+BEGIN
+    IF TG_OP = 'DELETE' THEN
+        PERFORM pg_notify('container_changes', TG_OP || ' ' || OLD.name);
+    ELSE
+        PERFORM pg_notify('container_changes', TG_OP || ' ' || NEW.name);
+    END IF;
+    RETURN NULL;  -- AFTER trigger, result ignored
+END;
+$$ language 'plpgsql';
+
+CREATE TRIGGER notify_containers_change
+    AFTER INSERT OR UPDATE OR DELETE ON containers
+    FOR EACH ROW
+    EXECUTE FUNCTION notify_container_change();
\ No newline at end of file
@@ -0,0 +1,677 @@
+package main
+
+import (
+	"bufio"            // Log scans
+	"bytes"            // Record line splitting
+	"encoding/binary"  // Index header and slots
+	"encoding/json"    // Log records
+	"fmt"              // Error wrapping
+	"log"              // Import warnings
+	"os"               // Log, index and lock files
+	"path/filepath"    // Store paths
+	"sort"             // Compaction order
+	"strings"          // Legacy file names
+	"syscall"          // flock and mmap
+	"time"             // Record timestamps
+)
+
+// State store layout, shared with ./minirun (StateStore there)
+const (
+	StateMagic      = 0x5849524d  // "MRIX"
+	StateVersion    = 1
+	StateHeaderSize = 64
+	StateSlotSize   = 16
+	StateDeleted    = 1 << 63  // Slot ref flag: the latest record is a delete
+	StateMinSlots   = 1024
+	StateCompactMin = 1024  // Superseded records tolerated regardless of the live count
+)
+
+// stateRecord is one line of state.log
+type stateRecord struct {
+	Op        string          `json:"op"`                   // put/delete
+	Name      string          `json:"name"`
+	At        string          `json:"at"`                   // RFC 3339, UTC
+	Container json.RawMessage `json:"container,omitempty"`  // Full config (put only)
+}
+
+// StateStore keeps container configs and statuses for file storage in one
+// indexed log instead of a JSON file per container, so the CLI and the API
+// see the same containers without reading a directory.
+//
+// state.log is append-only, one JSON record per create, status change and
+// delete. state.idx is an mmap'd open-addressing hash table over it: a 64-byte
+// header (magic, version, slots, used, live, log_end, log_ino, records) and
+// 16-byte slots holding FNV-1a 64 of a name and 1 + the offset of its latest
+// record (StateDeleted set when that is a delete). state.lock is flock()ed
+// shared by readers and exclusive by writers, across processes.
+//
+// A lookup is one probe and one pread() of the record; a listing streams the
+// log and keeps the records the index still points at. The index is rebuilt
+// from the log whenever it does not describe the log as it is (missing, or a
+// writer died between its append and the index update), and a last line
+// without its newline is a torn append and is cut off. A writer that leaves
+// more superseded records than live ones rewrites the log with only the latest
+// record of each container.
+type StateStore struct {
+	dir string
+}
+
+// stateTxn is one locked operation on the store
+type stateTxn struct {
+	store     *StateStore
+	lock      *os.File
+	log       *os.File
+	idx       []byte  // MAP_SHARED view of state.idx
+	exclusive bool
+}
+
+// NewStateStore returns the store under dir; <name>.json files of the
+// per-file layout are imported the first time it is used
+func NewStateStore(dir string) *StateStore {
+	return &StateStore{dir: dir}
+}
+
+func (s *StateStore) path(name string) string {
+	return filepath.Join(s.dir, name)
+}
+
+// stateNow is the record timestamp format (what ./minirun writes too)
+func stateNow() string {
+	return time.Now().UTC().Format(time.RFC3339Nano)
+}
+
+// stateHash is FNV-1a 64 of a name, never 0 (the empty slot)
+func stateHash(name string) uint64 {
+	h := uint64(0xcbf29ce484222325)
+	for i := 0; i < len(name); i++ {
+		h = (h ^ uint64(name[i])) * 0x100000001b3
+	}
+	if h == 0 {
+		h = 1
+	}
+	return h
+}
+
+// begin takes the store lock and maps an up-to-date index
+func (s *StateStore) begin(exclusive bool) (*stateTxn, error) {
+	if err := os.MkdirAll(s.dir, 0755); err != nil {
+		return nil, err
+	}
+	lock, err := os.OpenFile(s.path("state.lock"), os.O_RDONLY|os.O_CREATE, 0644)  // flock needs no write access
+	if err != nil {
+		return nil, err
+	}
+	t := &stateTxn{store: s, lock: lock, exclusive: exclusive}
+	if err := t.open(); err != nil {
+		t.close()
+		return nil, err
+	}
+	return t, nil
+}
+
+func (t *stateTxn) flock(exclusive bool) error {
+	how := syscall.LOCK_SH
+	if exclusive {
+		how = syscall.LOCK_EX
+	}
+	t.exclusive = exclusive
+	return syscall.Flock(int(t.lock.Fd()), how)
+}
+
+func (t *stateTxn) open() error {
+	s := t.store
+	if err := t.flock(t.exclusive); err != nil {
+		return err
+	}
+	if _, err := os.Stat(s.path("state.log")); os.IsNotExist(err) {
+		if err := t.flock(true); err != nil {
+			return err
+		}
+		if _, err := os.Stat(s.path("state.log")); os.IsNotExist(err) {
+			if err := s.importJSONFiles(); err != nil {
+				return fmt.Errorf("failed to import container configs: %w", err)
+			}
+		}
+	}
+	if err := t.openLog(); err != nil {
+		return err
+	}
+	if !t.mapIndex(t.exclusive) {
+		// Stale or missing: only an exclusive holder may rebuild it
+		if !t.exclusive {
+			if err := t.flock(true); err != nil {
+				return err
+			}
+		}
+		if !t.mapIndex(true) {
+			if err := t.rebuild(false); err != nil {
+				return err
+			}
+			if !t.mapIndex(true) {
+				return fmt.Errorf("state index unusable after rebuild")
+			}
+		}
+	}
+	return nil
+}
+
+func (t *stateTxn) openLog() error {
+	if t.log != nil {
+		t.log.Close()
+	}
+	var err error
+	t.log, err = os.OpenFile(t.store.path("state.log"), os.O_RDWR|os.O_APPEND, 0644)
+	return err
+}
+
+func (t *stateTxn) unmap() {
+	if t.idx != nil {
+		syscall.Munmap(t.idx)
+		t.idx = nil
+	}
+}
+
+// close releases the mapping, the files and (with the lock fd) the flock
+func (t *stateTxn) close() {
+	t.unmap()
+	if t.log != nil {
+		t.log.Close()
+	}
+	t.lock.Close()
+}
+
+// Index header fields after magic and version, 8 bytes each
+const (
+	hdrSlots = iota
+	hdrUsed
+	hdrLive
+	hdrLogEnd
+	hdrLogIno
+	hdrRecords
+)
+
+func (t *stateTxn) header(field int) uint64 {
+	return binary.LittleEndian.Uint64(t.idx[8+8*field:])
+}
+
+func (t *stateTxn) setHeader(field int, value uint64) {
+	binary.LittleEndian.PutUint64(t.idx[8+8*field:], value)
+}
+
+// mapIndex maps state.idx if it describes the log as it is now
+func (t *stateTxn) mapIndex(writable bool) bool {
+	t.unmap()
+	flags, prot := os.O_RDONLY, syscall.PROT_READ
+	if writable {
+		flags, prot = os.O_RDWR, syscall.PROT_READ|syscall.PROT_WRITE
+	}
+	f, err := os.OpenFile(t.store.path("state.idx"), flags, 0)
+	if err != nil {
+		return false
+	}
+	defer f.Close()
+	info, err := f.Stat()
+	if err != nil || info.Size() < StateHeaderSize {
+		return false
+	}
+	idx, err := syscall.Mmap(int(f.Fd()), 0, int(info.Size()), prot, syscall.MAP_SHARED)
+	if err != nil {
+		return false
+	}
+	t.idx = idx
+
+	logInfo, err := t.log.Stat()
+	if err != nil {
+		t.unmap()
+		return false
+	}
+	st := logInfo.Sys().(*syscall.Stat_t)
+	if binary.LittleEndian.Uint32(idx[0:]) != StateMagic || binary.LittleEndian.Uint32(idx[4:]) != StateVersion ||
+		uint64(info.Size()) != StateHeaderSize+t.header(hdrSlots)*StateSlotSize ||
+		t.header(hdrLogEnd) != uint64(logInfo.Size()) || t.header(hdrLogIno) != st.Ino {
+		t.unmap()
+		return false
+	}
+	return true
+}
+
+// importJSONFiles creates the log from the <name>.json files of the per-file layout
+func (s *StateStore) importJSONFiles() error {
+	files, err := filepath.Glob(s.path("*.json"))
+	if err != nil {
+		return err
+	}
+	var out bytes.Buffer
+	for _, file := range files {
+		data, err := os.ReadFile(file)
+		var config map[string]interface{}
+		if err == nil {
+			err = json.Unmarshal(data, &config)
+		}
+		if err != nil {
+			log.Printf("Warning: skipping unreadable %s: %v", filepath.Base(file), err)
+			continue
+		}
+		name, ok := config["name"].(string)
+		if !ok {
+			name = strings.TrimSuffix(filepath.Base(file), ".json")
+			config["name"] = name
+		}
+		if _, ok := config["created_at"]; !ok {
+			if info, err := os.Stat(file); err == nil {
+				config["created_at"] = info.ModTime().UTC().Format(time.RFC3339Nano)
+			}
+		}
+		container, _ := json.Marshal(config)
+		line, _ := json.Marshal(stateRecord{Op: "put", Name: name, At: stateNow(), Container: container})
+		out.Write(append(line, '\n'))
+	}
+	return writeFileSynced(s.path("state.log.tmp"), s.path("state.log"), out.Bytes())
+}
+
+// writeFileSynced writes data to tmp, fsyncs it and renames it over path
+func writeFileSynced(tmp, path string, data []byte) error {
+	f, err := os.OpenFile(tmp, os.O_WRONLY|os.O_CREATE|os.O_TRUNC, 0644)
+	if err != nil {
+		return err
+	}
+	_, err = f.Write(data)
+	if err == nil {
+		err = f.Sync()
+	}
+	if cerr := f.Close(); err == nil {
+		err = cerr
+	}
+	if err == nil {
+		err = os.Rename(tmp, path)
+	}
+	return err
+}
+
+// readLine returns the log line starting at offset, newline included
+func (t *stateTxn) readLine(offset int64) ([]byte, error) {
+	var line []byte
+	buf := make([]byte, 4096)
+	for {
+		n, err := t.log.ReadAt(buf, offset+int64(len(line)))
+		if i := bytes.IndexByte(buf[:n], '\n'); i >= 0 {
+			return append(line, buf[:i+1]...), nil
+		}
+		line = append(line, buf[:n]...)
+		if err != nil {
+			return nil, fmt.Errorf("truncated state record at %d: %w", offset, err)
+		}
+	}
+}
+
+// scan calls fn for every complete log line with its offset, cutting off a torn last line
+func (t *stateTxn) scan(fn func(offset int64, line []byte)) (int64, error) {
+	r := bufio.NewReaderSize(&offsetReader{f: t.log}, 1<<16)
+	var offset int64
+	for {
+		line, err := r.ReadBytes('\n')
+		if err != nil {
+			if len(line) > 0 && t.exclusive {
+				return offset, t.log.Truncate(offset)  // Torn append
+			}
+			return offset, nil
+		}
+		fn(offset, line)
+		offset += int64(len(line))
+	}
+}
+
+// offsetReader reads a file from the start with pread, leaving its offset alone
+type offsetReader struct {
+	f   *os.File
+	off int64
+}
+
+func (r *offsetReader) Read(p []byte) (int, error) {
+	n, err := r.f.ReadAt(p, r.off)
+	r.off += int64(n)
+	if n > 0 {
+		err = nil
+	}
+	return n, err
+}
+
+// rebuild re-creates state.idx from the log, rewriting the log first when compacting
+func (t *stateTxn) rebuild(compact bool) error {
+	type latest struct {
+		offset  int64
+		deleted bool
+	}
+	names := map[string]latest{}
+	var records uint64
+	if _, err := t.scan(func(offset int64, line []byte) {
+		var rec stateRecord
+		if json.Unmarshal(line, &rec) == nil && rec.Name != "" {
+			names[rec.Name] = latest{offset, rec.Op == "delete"}
+		}
+		records++  // Unparseable lines count as superseded, dropped by the next compaction
+	}); err != nil {
+		return err
+	}
+
+	if compact {
+		offsets := []int64{}
+		for _, l := range names {
+			if !l.deleted {
+				offsets = append(offsets, l.offset)
+			}
+		}
+		sort.Slice(offsets, func(i, j int) bool { return offsets[i] < offsets[j] })
+		var out bytes.Buffer
+		for _, offset := range offsets {
+			line, err := t.readLine(offset)
+			if err != nil {
+				return err
+			}
+			out.Write(line)
+		}
+		if err := writeFileSynced(t.store.path("state.log.tmp"), t.store.path("state.log"), out.Bytes()); err != nil {
+			return err
+		}
+		if err := t.openLog(); err != nil {
+			return err
+		}
+		return t.rebuild(false)
+	}
+
+	slots := uint64(StateMinSlots)
+	for slots < 4*uint64(len(names)) {
+		slots *= 2
+	}
+	idx := make([]byte, StateHeaderSize+slots*StateSlotSize)
+	var live uint64
+	for name, l := range names {
+		h := stateHash(name)
+		i := probe(idx, slots, h, nil)
+		ref := uint64(l.offset) + 1
+		if l.deleted {
+			ref |= StateDeleted
+		} else {
+			live++
+		}
+		binary.LittleEndian.PutUint64(idx[StateHeaderSize+i*StateSlotSize:], h)
+		binary.LittleEndian.PutUint64(idx[StateHeaderSize+i*StateSlotSize+8:], ref)
+	}
+	info, err := t.log.Stat()
+	if err != nil {
+		return err
+	}
+	binary.LittleEndian.PutUint32(idx[0:], StateMagic)
+	binary.LittleEndian.PutUint32(idx[4:], StateVersion)
+	for field, value := range []uint64{slots, uint64(len(names)), live, uint64(info.Size()),
+		info.Sys().(*syscall.Stat_t).Ino, records} {
+		binary.LittleEndian.PutUint64(idx[8+8*field:], value)
+	}
+	// Readers hold the shared lock while they use their mapping, so renaming over it is safe
+	tmp := t.store.path("state.idx.tmp")
+	if err := os.WriteFile(tmp, idx, 0644); err != nil {
+		return err
+	}
+	return os.Rename(tmp, t.store.path("state.idx"))
+}
+
+// probe returns the slot for hash h: the first where match(ref) holds, or the first empty one
+func probe(idx []byte, slots, h uint64, match func(ref uint64) bool) uint64 {
+	for i := h & (slots - 1); ; i = (i + 1) & (slots - 1) {
+		slot := idx[StateHeaderSize+i*StateSlotSize:]
+		slotHash := binary.LittleEndian.Uint64(slot)
+		if slotHash == 0 || (slotHash == h && match != nil && match(binary.LittleEndian.Uint64(slot[8:]))) {
+			return i
+		}
+	}
+}
+
+func (t *stateTxn) slotRef(i uint64) uint64 {
+	return binary.LittleEndian.Uint64(t.idx[StateHeaderSize+i*StateSlotSize+8:])
+}
+
+// find returns the slot, ref and latest record of a name (ref 0 and nil if never seen)
+func (t *stateTxn) find(name string) (uint64, uint64, *stateRecord, error) {
+	var found *stateRecord
+	var readErr error
+	i := probe(t.idx, t.header(hdrSlots), stateHash(name), func(ref uint64) bool {
+		line, err := t.readLine(int64(ref&^StateDeleted) - 1)
+		var rec stateRecord
+		if err == nil {
+			err = json.Unmarshal(line, &rec)
+		}
+		if err != nil {
+			readErr = err
+			return true
+		}
+		if rec.Name == name {
+			found = &rec
+			return true
+		}
+		return false
+	})
+	if readErr != nil {
+		return 0, 0, nil, readErr
+	}
+	return i, t.slotRef(i), found, nil
+}
+
+// isLive reports whether find saw a container that has not been deleted
+func isLive(ref uint64, rec *stateRecord) bool {
+	return rec != nil && ref&StateDeleted == 0
+}
+
+// append writes a record (exclusive lock held) and points the name's slot at it
+func (t *stateTxn) append(slot, ref uint64, rec stateRecord) error {
+	line, err := json.Marshal(rec)
+	if err != nil {
+		return err
+	}
+	line = append(line, '\n')
+	logEnd := t.header(hdrLogEnd)
+	if _, err := t.log.Write(line); err != nil {
+		return err
+	}
+
+	deleted := rec.Op == "delete"
+	newRef := logEnd + 1
+	if deleted {
+		newRef |= StateDeleted
+	}
+	binary.LittleEndian.PutUint64(t.idx[StateHeaderSize+slot*StateSlotSize:], stateHash(rec.Name))
+	binary.LittleEndian.PutUint64(t.idx[StateHeaderSize+slot*StateSlotSize+8:], newRef)
+	used, liveCount, records := t.header(hdrUsed), t.header(hdrLive), t.header(hdrRecords)+1
+	if ref == 0 {
+		used++
+	}
+	if ref != 0 && ref&StateDeleted == 0 {
+		liveCount--
+	}
+	if !deleted {
+		liveCount++
+	}
+	t.setHeader(hdrUsed, used)
+	t.setHeader(hdrLive, liveCount)
+	t.setHeader(hdrRecords, records)
+	t.setHeader(hdrLogEnd, logEnd+uint64(len(line)))
+
+	superseded := records - liveCount
+	compact := superseded > liveCount && superseded > StateCompactMin
+	if !compact && 2*used <= t.header(hdrSlots) {
+		return nil
+	}
+	if err := t.rebuild(compact); err != nil {
+		return err
+	}
+	// The rebuilt index replaced the mapped one; later appends (CreateMany) need the new one
+	if !t.mapIndex(true) {
+		return fmt.Errorf("state index unusable after rebuild")
+	}
+	return nil
+}
+
+// Get returns one container ("container not found" if there is none)
+func (s *StateStore) Get(name string) (*Container, error) {
+	t, err := s.begin(false)
+	if err != nil {
+		return nil, err
+	}
+	defer t.close()
+	_, ref, rec, err := t.find(name)
+	if err != nil {
+		return nil, err
+	}
+	if !isLive(ref, rec) {
+		return nil, fmt.Errorf("container not found")
+	}
+	var c Container
+	if err := json.Unmarshal(rec.Container, &c); err != nil {
+		return nil, fmt.Errorf("failed to parse container config: %w", err)
+	}
+	return &c, nil
+}
+
+// Create adds a container; ErrContainerExists if the name is taken
+func (s *StateStore) Create(c *Container) error {
+	t, err := s.begin(true)
+	if err != nil {
+		return err
+	}
+	defer t.close()
+	slot, ref, rec, err := t.find(c.Name)
+	if err != nil {
+		return err
+	}
+	if isLive(ref, rec) {
+		return ErrContainerExists
+	}
+	container, err := json.Marshal(c)
+	if err != nil {
+		return err
+	}
+	return t.append(slot, ref, stateRecord{Op: "put", Name: c.Name, At: stateNow(), Container: container})
+}
+
+// CreateMany adds containers under one lock (bulk creates), with one error per
+// container: ErrContainerExists for a taken name (earlier ones in cs count)
+func (s *StateStore) CreateMany(cs []*Container) []error {
+	errs := make([]error, len(cs))
+	t, err := s.begin(true)
+	if err != nil {
+		for i := range errs {
+			errs[i] = err
+		}
+		return errs
+	}
+	defer t.close()
+	for i, c := range cs {
+		slot, ref, rec, err := t.find(c.Name)
+		if err == nil && isLive(ref, rec) {
+			err = ErrContainerExists
+		}
+		var container []byte
+		if err == nil {
+			container, err = json.Marshal(c)
+		}
+		if err == nil {
+			err = t.append(slot, ref, stateRecord{Op: "put", Name: c.Name, At: stateNow(), Container: container})
+		}
+		errs[i] = err
+	}
+	return errs
+}
+
+// SetStatus records a status transition, keeping fields this version doesn't know about
+func (s *StateStore) SetStatus(name, status string) error {
+	t, err := s.begin(true)
+	if err != nil {
+		return err
+	}
+	defer t.close()
+	slot, ref, rec, err := t.find(name)
+	if err != nil {
+		return err
+	}
+	if !isLive(ref, rec) {
+		return fmt.Errorf("container not found")
+	}
+	var config map[string]interface{}
+	if err := json.Unmarshal(rec.Container, &config); err != nil {
+		return err
+	}
+	config["status"] = status
+	container, err := json.Marshal(config)
+	if err != nil {
+		return err
+	}
+	return t.append(slot, ref, stateRecord{Op: "put", Name: name, At: stateNow(), Container: container})
+}
+
+// SetLimits replaces a container's limits, keeping fields this version doesn't know about
+func (s *StateStore) SetLimits(name string, limits ResourceLimits) error {
+	t, err := s.begin(true)
+	if err != nil {
+		return err
+	}
+	defer t.close()
+	slot, ref, rec, err := t.find(name)
+	if err != nil {
+		return err
+	}
+	if !isLive(ref, rec) {
+		return fmt.Errorf("container not found")
+	}
+	var config map[string]interface{}
+	if err := json.Unmarshal(rec.Container, &config); err != nil {
+		return err
+	}
+	config["limits"] = limits
+	container, err := json.Marshal(config)
+	if err != nil {
+		return err
+	}
+	return t.append(slot, ref, stateRecord{Op: "put", Name: name, At: stateNow(), Container: container})
+}
+
+// Delete removes a container ("container not found" if there is none)
+func (s *StateStore) Delete(name string) error {
+	t, err := s.begin(true)
+	if err != nil {
+		return err
+	}
+	defer t.close()
+	slot, ref, rec, err := t.find(name)
+	if err != nil {
+		return err
+	}
+	if !isLive(ref, rec) {
+		return fmt.Errorf("container not found")
+	}
+	return t.append(slot, ref, stateRecord{Op: "delete", Name: name, At: stateNow()})
+}
+
+// List streams every container to fn, oldest record first, without loading them all
+func (s *StateStore) List(fn func(Container)) error {
+	t, err := s.begin(false)
+	if err != nil {
+		return err
+	}
+	defer t.close()
+	slots := t.header(hdrSlots)
+	_, err = t.scan(func(offset int64, line []byte) {
+		var rec stateRecord
+		if json.Unmarshal(line, &rec) != nil || rec.Op != "put" {
+			return
+		}
+		// Live if the name's slot still points here (refs are unique, so no name check)
+		ref := uint64(offset) + 1
+		if t.slotRef(probe(t.idx, slots, stateHash(rec.Name), func(r uint64) bool { return r == ref })) != ref {
+			return
+		}
+		var c Container
+		if json.Unmarshal(rec.Container, &c) == nil {
+			fn(c)
+		}
+	})
+	return err
+}
@@ -183,6 +183,16 @@ compile_runtime() {
     # Show binary size
     local size=$(du -h "$BIN_DIR/container_runtime" | cut -f1)
     print_message "$GREEN" "Binary size: $size"
+
+    # Compile metrics exporter
+    print_message "$YELLOW" "Compiling minirun_metricsd.c..."
+
+    if gcc -o "$BIN_DIR/minirun-metricsd" "$SRC_DIR/minirun_metricsd.c" -Wall -Wextra -O2 2>&1 | tee /tmp/minirun_compile.log; then
+        print_success "minirun-metricsd compiled successfully"
+    else
+        cat /tmp/minirun_compile.log
+        print_error "Compilation failed. See output above."
+    fi
 }
 
 # Run code quality checks
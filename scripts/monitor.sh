@@ -12,6 +12,7 @@
 #   --json          Output metrics in JSON format
 #   --prometheus    Output in Prometheus-compatible format
 #   --csv           Output in CSV format for analysis
+#   --trace         Show recent container start-up steps from the runtime's trace ring
 
 
 set -e  # Exit on error
@@ -31,7 +32,8 @@ METRICS_DIR="$PROJECT_ROOT/metrics"
 
 # Configuration
 CONTINUOUS_MODE=false
-OUTPUT_FORMAT="human"  # human, json, prometheus, csv
+OUTPUT_FORMAT="human"  # human, json, prometheus, csv, trace
+TRACE_EVENTS=40        # Start-up events shown by --trace
 REFRESH_INTERVAL=2
 
 
@@ -63,6 +65,10 @@ parse_args() {
                 OUTPUT_FORMAT="csv"
                 shift
                 ;;
+            --trace)
+                OUTPUT_FORMAT="trace"
+                shift
+                ;;
             --interval)
                 REFRESH_INTERVAL="$2"
                 shift 2
@@ -74,6 +80,7 @@ parse_args() {
                 echo "  --json              Output metrics in JSON format"
                 echo "  --prometheus        Output in Prometheus-compatible format"
                 echo "  --csv               Output in CSV format"
+                echo "  --trace             Show recent start-up steps (container_runtime --trace-dump)"
                 echo "  --interval N        Set refresh interval to N seconds (default: 2)"
                 echo "  -h, --help          Show this help message"
                 exit 0
@@ -108,6 +115,13 @@ get_system_metrics() {
 }
 
 
+# Names of all containers, one per line (from the state store, see minirun)
+
+container_names() {
+    "$PROJECT_ROOT/minirun" list --names 2>/dev/null
+}
+
+
 # Get container-specific metrics
 
 get_container_metrics() {
@@ -182,10 +196,9 @@ display_human() {
     local running_count=0
     
     if [ -d "$CONTAINERS_DIR" ]; then
-        for config_file in "$CONTAINERS_DIR"/*.json; do
-            if [ -f "$config_file" ]; then
+        while read -r container_name; do
+            if [ -n "$container_name" ]; then
                 container_count=$((container_count + 1))
-                local container_name=$(basename "$config_file" .json)
                 
                 # Get container metrics
                 local metrics=$(get_container_metrics "$container_name")
@@ -218,7 +231,7 @@ display_human() {
                     echo "     CPU (μs):     $cpu_usage"
                 fi
             fi
-        done
+        done < <(container_names)
     fi
     
     echo ""
@@ -254,9 +267,8 @@ display_json() {
     
     local first=true
     if [ -d "$CONTAINERS_DIR" ]; then
-        for config_file in "$CONTAINERS_DIR"/*.json; do
-            if [ -f "$config_file" ]; then
-                local container_name=$(basename "$config_file" .json)
+        while read -r container_name; do
+            if [ -n "$container_name" ]; then
                 local metrics=$(get_container_metrics "$container_name")
                 IFS='|' read -r proc_count mem_current mem_max cpu_usage status <<< "$metrics"
                 
@@ -276,7 +288,7 @@ display_json() {
                 echo "      \"cpu_usage_usec\": $cpu_usage"
                 echo -n "    }"
             fi
-        done
+        done < <(container_names)
     fi
     
     echo ""
@@ -316,9 +328,8 @@ display_prometheus() {
         echo "# HELP minirun_container_memory_bytes Container memory usage"
         echo "# TYPE minirun_container_memory_bytes gauge"
         
-        for config_file in "$CONTAINERS_DIR"/*.json; do
-            if [ -f "$config_file" ]; then
-                local container_name=$(basename "$config_file" .json)
+        while read -r container_name; do
+            if [ -n "$container_name" ]; then
                 local metrics=$(get_container_metrics "$container_name")
                 IFS='|' read -r proc_count mem_current mem_max cpu_usage status <<< "$metrics"
                 
@@ -332,7 +343,7 @@ display_prometheus() {
                 echo "minirun_container_memory_bytes{name=\"$container_name\",type=\"current\"} $mem_current $timestamp"
                 echo "minirun_container_memory_bytes{name=\"$container_name\",type=\"max\"} $mem_max $timestamp"
             fi
-        done
+        done < <(container_names)
     fi
 }
 
@@ -347,19 +358,39 @@ display_csv() {
     IFS='|' read -r timestamp _ _ _ _ _ _ <<< "$sys_metrics"
     
     if [ -d "$CONTAINERS_DIR" ]; then
-        for config_file in "$CONTAINERS_DIR"/*.json; do
-            if [ -f "$config_file" ]; then
-                local container_name=$(basename "$config_file" .json)
+        while read -r container_name; do
+            if [ -n "$container_name" ]; then
                 local metrics=$(get_container_metrics "$container_name")
                 IFS='|' read -r proc_count mem_current mem_max cpu_usage status <<< "$metrics"
                 
                 echo "$timestamp,$container_name,$status,$proc_count,$mem_current,$mem_max,$cpu_usage"
             fi
-        done
+        done < <(container_names)
     fi
 }
 
 
+# Display recent start-up steps from the runtime's trace ring
+
+display_trace() {
+    local runtime="$PROJECT_ROOT/bin/container_runtime"
+
+    # Lines: seq ns pid source container phase errno; offsets are per runtime pid
+    "$runtime" --trace-dump | tail -n "$TRACE_EVENTS" | awk '
+        BEGIN { printf "%-8s %-10s %11s  %-24s %-13s %s\n", "PID", "SOURCE", "OFFSET", "CONTAINER", "STEP", "ERRNO" }
+        {
+            if (!($3 in first) || $2 < first[$3]) first[$3] = $2
+            line[NR] = $0
+        }
+        END {
+            for (i = 1; i <= NR; i++) {
+                split(line[i], f, " ")
+                printf "%-8s %-10s %9.3fms  %-24s %-13s %s\n", f[3], f[4], (f[2] - first[f[3]]) / 1e6, f[5], f[6], f[7]
+            }
+        }'
+}
+
+
 # Save metrics to file
 
 save_metrics() {
@@ -408,6 +439,9 @@ main() {
                 csv)
                     display_csv
                     ;;
+                trace)
+                    display_trace
+                    ;;
             esac
             
             sleep "$REFRESH_INTERVAL"
@@ -427,6 +461,9 @@ main() {
             csv)
                 display_csv
                 ;;
+            trace)
+                display_trace
+                ;;
         esac
     fi
 }
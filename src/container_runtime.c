@@ -8,281 +8,5763 @@
 #include <sys/stat.h>   // File status (mkdir)
 #include <errno.h>      // Error numbers (errno)
 #include <string.h>     // String operations (strerror)
+#include <getopt.h>     // Long option parsing (getopt_long)
+#include <signal.h>     // Signal numbers and masks (sigset_t)
+#include <poll.h>       // I/O multiplexing (poll)
+#include <sys/socket.h> // Unix sockets and fd passing (SCM_RIGHTS)
+#include <sys/un.h>     // Unix socket addresses (sockaddr_un)
+#include <sys/signalfd.h> // Signals as file descriptors (signalfd)
+#include <sys/prctl.h>  // Process control (PR_SET_PDEATHSIG)
+#include <fcntl.h>      // File control (open, O_DIRECTORY)
+#include <stdint.h>     // Fixed-width integers (uint64_t)
+#include <sys/syscall.h> // Raw system calls (SYS_clone3)
+#include <stdarg.h>     // Variadic arguments (cgroup_limits_add)
+#include <limits.h>     // PATH_MAX
+#include <sys/inotify.h> // File change notification (memory.events)
+#include <sys/resource.h> // File descriptor limit (RLIMIT_NOFILE)
+#include <time.h>       // Event timestamps (clock_gettime)
+#include <sys/mman.h>   // Shared mapping of log rings (mmap)
+#include <sys/epoll.h>  // Event-driven supervision (epoll)
+#include <sys/file.h>   // Cgroup pool slot locks (flock)
+#include <sys/ioctl.h>  // Interface index lookup (SIOCGIFINDEX)
+#include <dirent.h>     // Cgroup pool run-state directory listing (opendir)
+#include <net/if.h>     // Interface requests and flags (ifreq, IFF_UP)
+#include <arpa/inet.h>  // Byte order (htonl)
+#include <linux/netlink.h>   // Netlink sockets (sockaddr_nl, nlmsghdr)
+#include <linux/rtnetlink.h> // Link, address and route messages (RTM_*)
+#include <linux/if_link.h>   // Link attributes (IFLA_*)
+#include <linux/veth.h>      // veth peer attribute (VETH_INFO_PEER)
+#include <linux/filter.h>    // BPF instructions (sock_filter, BPF_STMT)
+#include <linux/seccomp.h>   // Syscall filters (SECCOMP_SET_MODE_FILTER, seccomp_data)
+#include <linux/audit.h>     // Architecture tokens (AUDIT_ARCH_*)
+#include <sys/uio.h>         // Gathered writes (writev)
+#include <stddef.h>          // offsetof
+#include <ctype.h>           // Container name check (isalnum)
+
+// Runtime state directory (zygote socket lives here)
+#define MINIRUN_RUN_DIR     "/run/minirun"
+#define ZYGOTE_SOCKET_PATH  MINIRUN_RUN_DIR "/zygote.sock"
+#define OVERLAY_SCRATCH_DIR MINIRUN_RUN_DIR "/overlay"  // tmpfs mountpoint, per mount namespace
+#define CGROUP_POOL_DIR     MINIRUN_RUN_DIR "/cgroups"  // Run-state files of the warm cgroup pool
+#define TRACE_RING_PATH     MINIRUN_RUN_DIR "/trace.ring"  // Start-up events of every runtime on the host
+#define NET_POOL_DIR        MINIRUN_RUN_DIR "/net"      // Run-state files of the veth pool
+#define RESTORE_WORK_DIR    MINIRUN_RUN_DIR "/criu"     // CRIU work dirs of --restore, one per container
+#define SECCOMP_CACHE_DIR   MINIRUN_RUN_DIR "/seccomp"  // Compiled --seccomp profiles, <hash>.bpf
+
+// Image references handled by resolve_rootfs() (store layout is managed by ./minirun image)
+#define IMAGE_REF_PREFIX    "sha256:"
+#define IMAGE_DIGEST_LEN    64        // Hex characters in a sha256 digest
+
+// What a single-container run prints (--quiet, --json)
+#define OUTPUT_TEXT         0         // Banners on stdout, warnings on stderr
+#define OUTPUT_QUIET        1         // Errors only
+#define OUTPUT_JSON         2         // Errors, plus one record on stdout when the container is gone
+
+// How enter_rootfs() builds and enters the container root
+#define ROOTFS_OVERLAY      (1 << 0)  // Copy-on-write overlay over rootfs_path
+#define ROOTFS_CHROOT       (1 << 1)  // chroot() instead of pivot_root() (host mounts stay visible)
+
+// Zygote pool sizing
+#define ZYGOTE_DEFAULT_POOL 4     // Pre-cloned children kept ready
+#define ZYGOTE_MAX_POOL     64    // Upper bound for --pool-size
+#define ZYGOTE_MAX_SLOTS    256   // Ready + running children tracked at once
+#define ZYGOTE_MAX_ARGS     256   // argv strings of one direct-exec request
+
+#define CHILD_STACK_SIZE    (256 * 1024)   // Default clone() stack (--stack-size), backed only where touched
+#define CHILD_STACK_MIN     (64 * 1024)    // The overlay setup alone needs ~28K before exec
+#define CHILD_STACK_MAX     (64L << 20)
+#define STACK_POOL_MAX_FREE 16             // Free stacks kept mapped for reuse
+#define CGROUP_ROOT         "/sys/fs/cgroup"
+#define CGROUP_MAX_LIMITS   16             // Knobs in one CgroupLimitSet
+#define CGROUP_MAX_IO       4              // io.max lines (devices) per container
+#define MAX_REPLICAS        1024           // Upper bound for --replicas
+#define MAX_SUPERVISED      4096           // Upper bound for containers in one --supervise spec
+#define CONTAINER_NAME_RULE "letters, digits, '_', '.' and '-', starting with a letter or digit"
+#define CGROUP_POOL_MAX     4096           // Upper bound for --cgroup-pool
+#define CGROUP_DRAIN_MS     1000           // How long the pool reaper waits for a cgroup to empty
+#define CGROUP_FREEZE_MS    1000           // How long cgroup_freeze() waits for every task to stop
+#define CRIU_BIN            "criu"         // Looked up in PATH by --checkpoint and --restore
+
+// Container networking (--net, --net-pool): pairs mrh<n> (host, on the bridge) / mrc<n> (moved in as eth0)
+#define NET_BRIDGE          "minirun0"
+#define NET_HOST_PREFIX     "mrh"
+#define NET_PEER_PREFIX     "mrc"
+#define NET_CONTAINER_IFNAME "eth0"
+#define NET_SUBNET          0x0ac80000U    // 10.200.0.0; slot n gets NET_SUBNET + 2 + n
+#define NET_GATEWAY         (NET_SUBNET + 1)  // The bridge's address
+#define NET_PREFIX_LEN      16
+#define NET_POOL_MAX        4096           // Upper bound for --net-pool
+#define NETLINK_BATCH_SIZE  8192           // Messages sent in one sendmsg()
+#define NETLINK_PAIR_SPACE  256            // Batch room one veth pair creation needs
+
+// Captured stdout/stderr (--log-dir): one fixed-size ring file per container
+#define LOG_RING_MAGIC          "MRLOG1"
+#define LOG_RING_HEADER         4096           // Header page; data starts page-aligned after it
+#define LOG_RING_DEFAULT_SIZE   (1L << 20)     // 1 MB of output kept per container
+#define LOG_RING_MIN_SIZE       4096
+#define LOG_RING_MAX_SIZE       (1L << 30)
+#define LOG_RING_CHUNK          65536          // Largest read() straight into the ring
+#define LOG_RING_BURST          16             // Chunks moved per wakeup before serving other fds
+
+// Trace ring: events kept per process until flushed, and records in TRACE_RING_PATH
+#define TRACE_RING_MAGIC        0x3152544dU    // "MTR1"
+#define TRACE_RING_EVENTS       256
+#define TRACE_SHM_EVENTS        16384          // 1 MB shared ring
+#define TRACE_RING_MAP_LEN      (sizeof(TraceRingHeader) + TRACE_SHM_EVENTS * sizeof(TraceRecord))
+
+// Syscall filters (--seccomp)
+#define SECCOMP_CACHE_MAGIC     "MRSECC1"      // First bytes of a cache file; bump when the program layout changes
+#define SECCOMP_MAX_PROFILES    16             // Distinct profiles one runtime keeps loaded
+#define SECCOMP_MAX_SYSCALL     1024           // Numbers a profile can name; higher ones get its default
+#define SECCOMP_PROFILE_MAX     (64 * 1024)    // Largest profile file
+#define SECCOMP_X32_SYSCALL_BIT 0x40000000U    // __X32_SYSCALL_BIT
+
+#if defined(__x86_64__)
+#define SECCOMP_AUDIT_ARCH      AUDIT_ARCH_X86_64
+#elif defined(__aarch64__)
+#define SECCOMP_AUDIT_ARCH      AUDIT_ARCH_AARCH64
+#else
+#error "--seccomp: add this architecture's AUDIT_ARCH_* token"
+#endif
+
+// Resource limits used when no flag overrides them
+#define DEFAULT_MEMORY_LIMIT (512L * 1024 * 1024)  // 512 MB
+#define DEFAULT_CPU_PERCENT  50                    // Half of one core
+#define DEFAULT_CPU_PERIOD   100000                // cpu.max period in µs (100ms)
+#define CPU_PERIOD_MIN       1000                  // Kernel bounds for the period and quota
+#define CPU_PERIOD_MAX       1000000
+
+// PSI triggers armed by watch_open(): "<some|full> <stall us> <window us>"
+// 2s windows also work without CAP_SYS_RESOURCE (unprivileged windows must be multiples of 2s)
+#define PSI_MEMORY_TRIGGER  "some 300000 2000000"  // 300ms memory stall within 2s
+#define PSI_CPU_TRIGGER     "some 1000000 2000000" // 1s CPU stall within 2s
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open      434
+#endif
+
+// clone3() ABI (Linux 5.7+ for CLONE_INTO_CGROUP); defined here so older headers still build
+#ifndef SYS_clone3
+#define SYS_clone3          435
+#endif
+#ifndef CLONE_INTO_CGROUP
+#define CLONE_INTO_CGROUP   0x200000000ULL
+#endif
+
+struct minirun_clone_args {
+    uint64_t flags;
+    uint64_t pidfd;
+    uint64_t child_tid;
+    uint64_t parent_tid;
+    uint64_t exit_signal;
+    uint64_t stack;
+    uint64_t stack_size;
+    uint64_t tls;
+    uint64_t set_tid;
+    uint64_t set_tid_size;
+    uint64_t cgroup;
+};
+
+// Open cgroup directory; knobs are written relative to dir_fd
+typedef struct {
+    int dir_fd;         // O_DIRECTORY fd (-1 = not open)
+    char path[256];     // Full path, for messages
+} CgroupHandle;
+
+// Limits formatted once, then applied to any number of cgroups
+typedef struct {
+    const char* knob[CGROUP_MAX_LIMITS];
+    char value[CGROUP_MAX_LIMITS][64];
+    int count;
+} CgroupLimitSet;
 
 // Container structure configuration
 typedef struct {
     char* name;
     char* rootfs_path;
-    char* command;
+    char* command;      // bash -c string, or argv[0] with direct_exec
+    char** argv;        // NULL-terminated command argv when direct_exec (strings outlive the config)
+    int direct_exec;    // 1 = execvp() argv instead of bash -c command (--exec)
+    int init;           // 1 = a minimal init is PID 1 and runs the command as its child (--init)
     long memory_limit;  // in bytes
-    int cpu_limit;      // percentage (0-100)
+    long memory_high;   // memory.high throttling threshold in bytes (0 = unset)
+    int cpu_limit;      // percentage of one core (200 = two full cores)
+    long cpu_period;    // cpu.max period in microseconds
+    const char* cpuset_cpus;  // cpuset.cpus list, e.g. "0-3" (NULL = inherit)
+    const char* cpuset_mems;  // cpuset.mems list, e.g. "0" (NULL = inherit)
+    const char* io_max[CGROUP_MAX_IO];  // io.max lines, "MAJ:MIN rbps=.. wbps=.. riops=.. wiops=.."
+    int io_max_count;
+    long pids_max;      // pids.max (0 = unlimited)
+    const char* log_dir; // Capture stdout/stderr into <log_dir>/<name>.ring (NULL = inherit ours)
+    long log_size;      // Ring capacity in bytes
+    int log_fd;         // Pipe write end the child puts on stdout/stderr (-1 = none)
+    int replica;        // index in batch mode (-1 = single container)
+    const CgroupHandle* cgroup;  // open cgroup to start in (NULL = no limits)
+    int in_cgroup;      // 1 if clone3() already placed the child in its cgroup
+    int rootfs_flags;   // ROOTFS_* bits for enter_rootfs()
+    const char* upper_dir;  // Persistent overlay upper/work location (NULL = tmpfs)
+    int net;            // 1 = own network namespace (--net)
+    int net_slot;       // Claimed veth pool slot (-1 = loopback only), set by net_prepare()
+    int net_ifindex;    // Host ifindex of the slot's mrc<n>
+    int net_fd;         // Host netlink socket the child moves mrc<n> with (-1 = none)
+    const char* seccomp_profile;       // Syscall filter profile (--seccomp, NULL = none)
+    const struct sock_fprog* seccomp;  // Its compiled program, loaded by spawn_container()
 } ContainerConfig;
 
-// Helper function to write to cgroup files with error handling
-int write_cgroup_file(const char* path, const char* value);
+// A profile compiled by seccomp_load() (path == NULL = free slot)
+typedef struct {
+    char* path;         // As given to --seccomp
+    struct sock_fprog prog;
+} SeccompProfile;
+
+// First bytes of a SECCOMP_CACHE_DIR file; the program, then the profile text it was compiled from, follow
+typedef struct {
+    char magic[8];      // SECCOMP_CACHE_MAGIC
+    uint64_t hash;      // seccomp_hash() of the profile, also the file name
+    uint32_t count;     // Instructions in the program
+    uint32_t text_len;  // Bytes of profile text
+} SeccompCacheHeader;
+
+// One pre-cloned zygote child and the client it is currently serving
+typedef struct {
+    pid_t pid;          // Host PID of the child (0 = free slot)
+    int control_fd;     // Our end of the socketpair the child waits on
+    int client_fd;      // Client connection awaiting exit status (-1 = child still in pool)
+    char name[128];     // Container name once a command has been handed over
+} ZygoteSlot;
+
+// First bytes of a ring file. Readers map the file read-only and never lock:
+// byte pos of the output stream lives at data[pos % capacity] while
+// pos >= head - capacity, and bytes older than write_end - capacity may be
+// overwritten at any moment.
+typedef struct {
+    char magic[8];          // LOG_RING_MAGIC
+    uint64_t capacity;      // Data bytes after the LOG_RING_HEADER page
+    uint64_t head;          // Total bytes written so far (never wraps)
+    uint64_t write_end;     // head + size of the read() in progress
+} LogRingHeader;
+
+// A mapped ring file (hdr == NULL = not open)
+typedef struct {
+    LogRingHeader* hdr;
+    char* data;
+    size_t map_len;
+} LogRing;
+
+// Start-up steps recorded in the trace ring (see trace_event)
+enum {
+    TRACE_MAIN = 1,
+    TRACE_CGROUP_PROBE,
+    TRACE_CGROUP_MKDIR,
+    TRACE_CGROUP_WRITE,
+    TRACE_CLONE,
+    TRACE_CHILD,
+    TRACE_CGROUP_JOIN,
+    TRACE_ROOTFS,
+    TRACE_PROC_MOUNT,
+    TRACE_EXEC,
+    TRACE_EXIT,
+    TRACE_NET,          // After the others so older runtimes' records in the shared ring keep their names
+    TRACE_RESTORE,
+    TRACE_SECCOMP,
+    TRACE_PHASE_COUNT
+};
+
+#define TRACE_SOURCE_RUNTIME    0
+#define TRACE_SOURCE_CONTAINER  1   // Recorded by the child before exec
+
+// One event in a process's own ring
+typedef struct {
+    uint64_t ns;            // CLOCK_MONOTONIC
+    const char* container;  // NULL = the ring's default container
+    int32_t err;            // errno if the step failed, else 0
+    uint16_t phase;         // TRACE_*
+    uint16_t source;        // TRACE_SOURCE_*
+} TraceEvent;
+
+// Per-process trace ring; events [flushed, head) are not in TRACE_RING_PATH yet
+typedef struct {
+    TraceEvent events[TRACE_RING_EVENTS];
+    unsigned int head;      // Events ever recorded (slot = head % TRACE_RING_EVENTS)
+    unsigned int flushed;
+    uint32_t pid;           // Host PID of the runtime, also in its container's events
+    uint16_t source;
+    const char* container;  // Container of events recorded without one (the child's)
+    struct TraceRingHeader* shm;  // TRACE_RING_PATH mapped by trace_install(), NULL until then
+} TraceRing;
+
+// First bytes of TRACE_RING_PATH; TRACE_SHM_EVENTS records follow
+typedef struct TraceRingHeader {
+    uint32_t magic;         // TRACE_RING_MAGIC once initialized
+    uint32_t capacity;      // Records in the file
+    uint64_t head;          // Records ever reserved (slot = seq % capacity)
+    char reserved[48];
+} TraceRingHeader;
+
+// One event in TRACE_RING_PATH, a cache line each
+typedef struct {
+    uint64_t seq;           // Position + 1, stored last (anything else = incomplete)
+    uint64_t ns;
+    uint32_t pid;
+    int32_t err;
+    uint16_t phase;
+    uint16_t source;
+    char container[36];     // Name, NUL-padded (truncated past 35 bytes)
+} TraceRecord;
+
+_Static_assert(sizeof(TraceRecord) == 64, "TraceRecord must stay one cache line");
+
+// This process's claim on one warm cgroup pool slot (minirun-pool-<n>)
+typedef struct {
+    int lock_fd;        // flock()ed run-state file, -1 = not claimed by us
+    char* name;         // Container using the slot
+} CgroupPoolSlot;
+
+// This process's claim on one veth pool slot (mrh<n> / mrc<n>)
+typedef struct {
+    int lock_fd;        // flock()ed run-state file, -1 = not claimed by us
+    char* name;         // Container using the slot
+} NetPoolSlot;
+
+// Netlink messages built back to back and sent with one sendmsg()
+typedef struct {
+    char buf[NETLINK_BATCH_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+    size_t len;
+    uint32_t seq;       // Sequence number of the first message
+    int count;          // Messages in buf, each with NLM_F_ACK
+} NetlinkBatch;
+
+// A free clone stack; the link is stored in the stack itself
+typedef struct StackFree {
+    struct StackFree* next;
+} StackFree;
+
+// Clone stacks handed out by stack_acquire() and recycled by stack_release()
+typedef struct {
+    size_t size;        // Usable bytes per stack, a page multiple (guard page not included)
+    StackFree* free;    // Released stacks, ready for reuse
+    int free_count;
+    int mapped;         // Stacks currently mapped, in use or free
+} StackPool;
+
+// One supervised container: its pidfd plus the cgroup notification fds (-1 = not watched)
+typedef struct {
+    const char* name;
+    pid_t pid;
+    int pidfd;          // pidfd_open() handle, readable once the container exits
+    int memory_psi_fd;  // memory.pressure with PSI_MEMORY_TRIGGER armed
+    int cpu_psi_fd;     // cpu.pressure with PSI_CPU_TRIGGER armed
+    int events_fd;      // memory.events, re-read on inotify IN_MODIFY
+    int events_wd;      // inotify watch descriptor for memory.events
+    uint64_t events[4]; // Last high/max/oom/oom_kill counters
+    int log_fd;         // Read end of the container's stdout/stderr pipe (O_NONBLOCK)
+    LogRing log;        // Where log_fd is drained to
+    int status;         // waitpid() status once exited
+    int exited;
+} ContainerWatch;
+
+// Root of the cgroup v2 hierarchy (overridable by benchmarks)
+const char* cgroup_root = CGROUP_ROOT;
+
+// Where supervise_containers() writes events (NULL = stderr, set by --events)
+static FILE* event_stream = NULL;
+
+// OUTPUT_* mode, inherited by the container until exec
+static int output_mode = OUTPUT_TEXT;
+
+// Trace ring of this process, and the text copy of it requested with --trace (-1 = none)
+static TraceRing trace_ring;
+static int trace_fd = -1;
+
+// Stacks for clone() (size set by --stack-size)
+static StackPool stack_pool = { .size = CHILD_STACK_SIZE };
+
+// Warm cgroup pool (--cgroup-pool); the run-state directory is overridable by benchmarks
+const char* cgroup_pool_dir = CGROUP_POOL_DIR;
+static CgroupPoolSlot* cgroup_pool = NULL;
+static int cgroup_pool_size = 0;
+
+// Veth pool (--net-pool); the run-state directory is overridable by benchmarks
+const char* net_pool_dir = NET_POOL_DIR;
+static NetPoolSlot* net_pool = NULL;
+static int net_pool_size = 0;
+
+// Compiled --seccomp profiles; the cache directory is overridable by benchmarks
+const char* seccomp_cache_dir = SECCOMP_CACHE_DIR;
+static SeccompProfile seccomp_profiles[SECCOMP_MAX_PROFILES];
+
+// Cgroup handle API: one directory fd, knobs written with openat() + write()
+int cgroup_open(CgroupHandle* cg, const char* container_name);
+int cgroup_open_root(CgroupHandle* cg);
+int cgroup_write(const CgroupHandle* cg, const char* knob, const char* value);
+int cgroup_add_process(const CgroupHandle* cg, pid_t pid);
+void cgroup_close(CgroupHandle* cg);
+int cgroup_freeze(const CgroupHandle* cg, int frozen);
+void cgroup_limits_init(CgroupLimitSet* set, long memory_limit_bytes, int cpu_percent, long cpu_period_us);
+int cgroup_limits_add(CgroupLimitSet* set, const char* knob, const char* fmt, ...);
+int cgroup_apply_limits(const CgroupHandle* cg, const CgroupLimitSet* set);
 
 // Setup and cleanup cgroups
-int setup_cgroups(const char* container_name, long memory_limit_bytes, int cpu_percent);
+int cgroups_v2_available(void);
+void enable_cgroup_controllers(void);
+int setup_cgroups(CgroupHandle* cg, const ContainerConfig* config);
 void cleanup_cgroups(const char* container_name);
+void container_limits(CgroupLimitSet* set, const ContainerConfig* config);
+void container_optional_limits(CgroupLimitSet* set, const ContainerConfig* config);
+
+// Warm cgroup pool: minirun-pool-<n> cgroups reused instead of mkdir/rmdir per container
+int cgroup_pool_init(int size);
+int cgroup_pool_lookup(const char* container_name);
+int cgroup_open_existing(CgroupHandle* cg, const char* container_name);
+int cgroup_pool_claim(const char* container_name);
+int cgroup_pool_reset(int slot, int kill_leftovers);
+void cgroup_pool_release(int slot);
+
+// Container networking: pre-created veth pairs moved into each --net container
+int net_pool_init(int size);
+int net_pool_provision(void);
+int net_pool_lookup(const char* container_name);
+int net_pool_claim(const char* container_name, int fd, int* ifindex);
+void net_pool_release(int slot);
+void net_prepare(ContainerConfig* config);
+int net_configure(const ContainerConfig* config);
+void cleanup_network(const char* container_name);
+int validate_limits(const ContainerConfig* config);
+int valid_container_name(const char* name);
+
+// Syscall filtering: profiles compiled to seccomp-BPF once, cached by hash, installed before exec
+int seccomp_compile(const char* text, const char* source, struct sock_filter** filter);
+const struct sock_fprog* seccomp_load(const char* profile_path);
+int seccomp_install(const struct sock_fprog* prog);
+
+int parse_container_option(int opt, const char* arg, ContainerConfig* config);
+long parse_size(const char* str);
+
+// Trace ring
+void trace_event(int phase, int err, const char* container, const struct timespec* at);
+void trace_flush(void);
+void trace_child_begin(const char* container);
+void trace_install(void);
+int trace_dump(FILE* out);
 
-// Child process function
+// Output modes
+void report(FILE* stream, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void print_run_record(const char* name, pid_t pid, const char* cgroup_path, const ContainerWatch* w,
+                      const char* error);
+const char* json_escape(const char* s, char* out, size_t size);
+
+// Child process functions
+int stack_pool_set_size(StackPool* pool, long size);
+void* stack_acquire(StackPool* pool);
+void stack_release(StackPool* pool, void* top);
+void stack_pool_drain(StackPool* pool);
+pid_t spawn_container(ContainerConfig* config);
 int child_function(void* arg);
+static int exec_container(const ContainerConfig* config);
+static int run_init(const ContainerConfig* config);
+char* resolve_rootfs(char* ref, const char* image_store, int rootfs_flags, char* buf, size_t len);
+int mount_overlay_root(const char* rootfs_path, const char* layer_dir, const char* upper_dir,
+                       char* merged, size_t merged_len);
+int pivot_into_root(const char* new_root);
+int enter_rootfs(const char* rootfs_path, int flags, const char* upper_dir);
+int zygote_child_function(void* arg);
+
+// Batch launch and supervisor mode
+int run_replicas(const ContainerConfig* base, int replicas);
+int run_supervisor(const char* spec_path, const ContainerConfig* defaults, const char* image_store);
+
+// Live updates: limits rewritten and cgroup.freeze toggled in a running container's cgroup
+#define UPDATE_MEMORY      0x1  // --update flags given: the limits container_limits() always sets
+#define UPDATE_CPU         0x2
+#define UPDATE_CPU_PERIOD  0x4
+int update_container(const char* container_name, const ContainerConfig* config, int given);
+int pause_container(const char* container_name, int paused);
+
+// Checkpoint/restore: CRIU images of a frozen container, restored into a new overlay and cgroup
+int checkpoint_container(const char* container_name, const char* dir);
+pid_t restore_container(ContainerConfig* config, const char* dir, int lazy_pages);
+
+// Container output: stdout/stderr pipe drained into an mmap'd ring file
+int log_ring_open(LogRing* ring, const char* path, size_t capacity);
+int log_ring_pump(LogRing* ring, int fd);
+void log_ring_close(LogRing* ring);
+int container_log_open(ContainerConfig* config, LogRing* ring);
+void container_log_attach(ContainerConfig* config, ContainerWatch* w, LogRing* ring, int read_fd, pid_t pid);
+
+// Supervision: exits, PSI triggers, memory.events and log pipes from one epoll loop
+int watch_open(ContainerWatch* w, const char* name, pid_t pid, const CgroupHandle* cg, int inotify_fd);
+void watch_close(ContainerWatch* w);
+int supervise_containers(ContainerWatch* watches, int count, int inotify_fd);
+
+// Zygote daemon
+int run_zygote(const char* rootfs_path, const char* socket_path, int pool_size, int rootfs_flags,
+               const CgroupLimitSet* limits);
+
+// Command-line options; the per-container ones are also accepted in --supervise specs
+static const struct option long_options[] = {
+    {"replicas",  required_argument, 0, 'r'},
+    {"zygote",    no_argument,       0, 'z'},
+    {"pool-size", required_argument, 0, 'P'},
+    {"socket",    required_argument, 0, 'S'},
+    {"upper-dir", required_argument, 0, 'u'},
+    {"no-overlay", no_argument,      0, 'O'},
+    {"chroot",    no_argument,       0, 'C'},
+    {"image-store", required_argument, 0, 'I'},
+    {"memory",    required_argument, 0, 'm'},
+    {"memory-high", required_argument, 0, 'H'},
+    {"cpu",       required_argument, 0, 'c'},
+    {"cpu-period", required_argument, 0, 'p'},
+    {"cpuset-cpus", required_argument, 0, 'U'},
+    {"cpuset-mems", required_argument, 0, 'N'},
+    {"io-max",    required_argument, 0, 'i'},
+    {"pids-max",  required_argument, 0, 'x'},
+    {"events",    required_argument, 0, 'E'},
+    {"log-dir",   required_argument, 0, 'L'},
+    {"log-size",  required_argument, 0, 'Z'},
+    {"supervise", required_argument, 0, 'V'},
+    {"stack-size", required_argument, 0, 'k'},
+    {"trace",     required_argument, 0, 'T'},
+    {"trace-dump", no_argument,      0, 'D'},
+    {"quiet",     no_argument,       0, 'q'},
+    {"json",      no_argument,       0, 'J'},
+    {"ready-fd",  required_argument, 0, 'R'},
+    {"cgroup-pool", required_argument, 0, 'G'},
+    {"net",       no_argument,       0, 'n'},
+    {"net-pool",  required_argument, 0, 'W'},
+    {"net-provision", no_argument,   0, 'X'},
+    {"seccomp",   required_argument, 0, 's'},
+    {"exec",      no_argument,       0, 'e'},
+    {"init",      no_argument,       0, 'j'},
+    {"checkpoint", required_argument, 0, 'K'},
+    {"restore",   required_argument, 0, 'Y'},
+    {"lazy-pages", no_argument,      0, 'l'},
+    {"update",    no_argument,       0, 'A'},
+    {"pause",     no_argument,       0, 'F'},
+    {"resume",    no_argument,       0, 'B'},
+    {"help",      no_argument,       0, 'h'},
+    {0, 0, 0, 0}
+};
+
+#ifndef MINIRUN_NO_MAIN  // Defined by tests/bench to reuse the helpers below
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--replicas N] [limits] <name> <rootfs_path> <command>\n", prog);
+    fprintf(stderr, "       %s --exec [--replicas N] [limits] <name> <rootfs_path> <program> [args...]\n", prog);
+    fprintf(stderr, "       %s --zygote [--pool-size N] [--socket PATH] [limits] <rootfs_path>\n", prog);
+    fprintf(stderr, "       %s --supervise SPEC [limits]\n", prog);
+    fprintf(stderr, "       %s --checkpoint DIR <name>\n", prog);
+    fprintf(stderr, "       %s --restore DIR [--lazy-pages] [limits] <name> <rootfs_path>\n", prog);
+    fprintf(stderr, "       %s --update [limits] <name>\n", prog);
+    fprintf(stderr, "       %s --pause|--resume <name>\n", prog);
+    fprintf(stderr, "Example: %s myapp /path/to/myroot /bin/bash\n", prog);
+    fprintf(stderr, "\nOptions:\n");
+    fprintf(stderr, "  --replicas N      Start N identical containers named <name>-0 .. <name>-(N-1)\n");
+    fprintf(stderr, "  --zygote          Run as a daemon that keeps pre-cloned containers ready\n");
+    fprintf(stderr, "  --pool-size N     Number of ready children in zygote mode (default: %d)\n", ZYGOTE_DEFAULT_POOL);
+    fprintf(stderr, "  --socket PATH     Zygote control socket (default: %s)\n", ZYGOTE_SOCKET_PATH);
+    fprintf(stderr, "  --supervise SPEC  Start every container in SPEC (one per line, - = stdin) and supervise them\n");
+    fprintf(stderr, "  --upper-dir DIR   Keep the container's writes in DIR/upper instead of a tmpfs\n");
+    fprintf(stderr, "  --no-overlay      Use <rootfs_path> directly (writes are shared with other containers)\n");
+    fprintf(stderr, "  --chroot          chroot() into the root instead of pivot_root()\n");
+    fprintf(stderr, "  --image-store DIR Where sha256:<digest> rootfs references live (or $MINIRUN_IMAGE_STORE)\n");
+    fprintf(stderr, "  --events PATH     Append pressure/OOM/exit events as JSON lines to PATH (default: stderr)\n");
+    fprintf(stderr, "  --log-dir DIR     Capture each container's stdout/stderr in DIR/<name>.ring\n");
+    fprintf(stderr, "  --log-size SIZE   Output kept per container, oldest overwritten first (default: 1M)\n");
+    fprintf(stderr, "  --quiet           Print nothing but errors (single container)\n");
+    fprintf(stderr, "  --json            Like --quiet, then one JSON record (pid, cgroup, timings, exit) at the end\n");
+    fprintf(stderr, "  --ready-fd FD     Write the container PID to FD once it is cloned, then close FD\n");
+    fprintf(stderr, "  --trace FILE      Also append this run's start-up events to FILE as text\n");
+    fprintf(stderr, "  --trace-dump      Print the start-up events of recent runs (%s) and exit\n", TRACE_RING_PATH);
+    fprintf(stderr, "\nCommand (per container):\n");
+    fprintf(stderr, "  --exec            Exec <program> with the remaining arguments as its argv, without\n");
+    fprintf(stderr, "                    bash -c (looked up in PATH inside the root; no bash needed)\n");
+    fprintf(stderr, "  --init            Run a minimal init as PID 1 that reaps zombies, forwards signals\n");
+    fprintf(stderr, "                    and exits with the command's status\n");
+    fprintf(stderr, "\nLimits (per container, zygote children all get the zygote's):\n");
+    fprintf(stderr, "  --memory SIZE     memory.max, e.g. 1G (default: 512M)\n");
+    fprintf(stderr, "  --memory-high SIZE Throttle above SIZE (e.g. 384M) before memory.max kills\n");
+    fprintf(stderr, "  --cpu PERCENT     CPU quota in %% of one core, 200 = two cores (default: %d)\n", DEFAULT_CPU_PERCENT);
+    fprintf(stderr, "  --cpu-period US   cpu.max period in microseconds (default: %d)\n", DEFAULT_CPU_PERIOD);
+    fprintf(stderr, "  --cpuset-cpus LIST Pin to CPUs, e.g. 0-3,8\n");
+    fprintf(stderr, "  --cpuset-mems LIST Allocate memory from NUMA nodes, e.g. 0\n");
+    fprintf(stderr, "  --io-max LINE     io.max line, e.g. \"8:0 rbps=10485760 wiops=100\" (repeatable)\n");
+    fprintf(stderr, "  --pids-max N      Maximum number of processes\n");
+    fprintf(stderr, "  --stack-size SIZE Stack for each clone() (default: %dK)\n", CHILD_STACK_SIZE / 1024);
+    fprintf(stderr, "  --cgroup-pool N   Reuse up to N warm minirun-pool-<n> cgroups shared by all runtimes\n");
+    fprintf(stderr, "\nNetworking:\n");
+    fprintf(stderr, "  --net             Own network namespace (per container; eth0 from the veth pool, else lo only)\n");
+    fprintf(stderr, "  --net-pool N      Use the veth pairs %s<n>/%s<n>, n < N, on bridge %s\n",
+            NET_HOST_PREFIX, NET_PEER_PREFIX, NET_BRIDGE);
+    fprintf(stderr, "  --net-provision   Create the bridge and missing pairs of --net-pool N, then exit\n");
+    fprintf(stderr, "\nSyscall filtering (per container):\n");
+    fprintf(stderr, "  --seccomp PROFILE Run the command under PROFILE's seccomp filter (compiled once,\n");
+    fprintf(stderr, "                    cached in %s)\n", SECCOMP_CACHE_DIR);
+    fprintf(stderr, "\nCheckpoint/restore (needs %s):\n", CRIU_BIN);
+    fprintf(stderr, "  --checkpoint DIR  Freeze running container <name>, save it in DIR and let it run on\n");
+    fprintf(stderr, "  --restore DIR     Start <name> from the checkpoint in DIR instead of running a command\n");
+    fprintf(stderr, "  --lazy-pages      With --restore: load memory pages on first touch, not up front\n");
+    fprintf(stderr, "\nLive updates (running container <name>, started by any runtime):\n");
+    fprintf(stderr, "  --update          Rewrite the limits given; the others keep their values (an empty\n");
+    fprintf(stderr, "                    --cpuset-cpus/--cpuset-mems unpins it)\n");
+    fprintf(stderr, "  --pause           Freeze all of its tasks (cgroup.freeze); memory is kept, no CPU is used\n");
+    fprintf(stderr, "  --resume          Thaw a paused container\n");
+}
 
 int main(int argc, char* argv[]) {
-    // ERROR: Less than 4 arguments, provide user correct instructions
-    if (argc < 4) {
-        fprintf(stderr, "Usage: %s <name> <rootfs_path> <command>\n", argv[0]);
-        fprintf(stderr, "Example: %s myapp /path/to/myroot /bin/bash\n", argv[0]);
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);  // Recorded as TRACE_MAIN once options are parsed
+    trace_install();
+
+    int replicas = 1;
+    int zygote_mode = 0;
+    int pool_size = ZYGOTE_DEFAULT_POOL;
+    const char* socket_path = ZYGOTE_SOCKET_PATH;
+    const char* upper_dir = NULL;
+    int rootfs_flags = ROOTFS_OVERLAY;
+    const char* image_store = getenv("MINIRUN_IMAGE_STORE");
+    const char* spec_path = NULL;
+    int pool_slots = 0;
+    int net_slots = 0;
+    int net_provision = 0;
+    const char* checkpoint_dir = NULL;
+    const char* restore_dir = NULL;
+    int lazy_pages = 0;
+    int update_limits = 0;
+    int update_given = 0;  // UPDATE_* of the options seen
+    int pause_state = -1;  // --pause 1, --resume 0
+    int dump_trace = 0;
+    int ready_fd = -1;
+    ContainerConfig config = {
+        .memory_limit = DEFAULT_MEMORY_LIMIT,
+        .cpu_limit = DEFAULT_CPU_PERCENT,
+        .cpu_period = DEFAULT_CPU_PERIOD,
+        .log_size = LOG_RING_DEFAULT_SIZE,
+        .log_fd = -1,
+        .replica = -1
+    };
+    char rootfs_buf[PATH_MAX];
+    char* rootfs;
+    int opt;
+
+    // '+' stops at the first positional argument so container commands are never parsed as options
+    while ((opt = getopt_long(argc, argv, "+h", long_options, NULL)) != -1) {
+        int applied = parse_container_option(opt, optarg, &config);
+        if (applied < 0) {
+            return 1;
+        } else if (applied == 0) {
+            update_given |= opt == 'm' ? UPDATE_MEMORY : opt == 'c' ? UPDATE_CPU : opt == 'p' ? UPDATE_CPU_PERIOD : 0;
+            continue;
+        }
+
+        switch (opt) {
+            case 'r':
+                replicas = atoi(optarg);
+                if (replicas < 1 || replicas > MAX_REPLICAS) {
+                    fprintf(stderr, "Replicas must be between 1 and %d\n", MAX_REPLICAS);
+                    return 1;
+                }
+                break;
+            case 'z':
+                zygote_mode = 1;
+                break;
+            case 'P':
+                pool_size = atoi(optarg);
+                if (pool_size < 1 || pool_size > ZYGOTE_MAX_POOL) {
+                    fprintf(stderr, "Pool size must be between 1 and %d\n", ZYGOTE_MAX_POOL);
+                    return 1;
+                }
+                break;
+            case 'S':
+                socket_path = optarg;
+                break;
+            case 'u':
+                upper_dir = optarg;
+                break;
+            case 'O':
+                rootfs_flags &= ~ROOTFS_OVERLAY;
+                break;
+            case 'C':
+                rootfs_flags |= ROOTFS_CHROOT;
+                break;
+            case 'I':
+                image_store = optarg;
+                break;
+            case 'E':
+                if (strcmp(optarg, "-") == 0) {
+                    event_stream = stdout;
+                } else if ((event_stream = fopen(optarg, "ae")) == NULL) {
+                    fprintf(stderr, "Cannot open event log %s: %s\n", optarg, strerror(errno));
+                    return 1;
+                }
+                break;
+            case 'V':
+                spec_path = optarg;
+                break;
+            case 'G':
+                pool_slots = atoi(optarg);
+                if (pool_slots < 1 || pool_slots > CGROUP_POOL_MAX) {
+                    fprintf(stderr, "Cgroup pool size must be between 1 and %d\n", CGROUP_POOL_MAX);
+                    return 1;
+                }
+                break;
+            case 'W':
+                net_slots = atoi(optarg);
+                if (net_slots < 1 || net_slots > NET_POOL_MAX) {
+                    fprintf(stderr, "Veth pool size must be between 1 and %d\n", NET_POOL_MAX);
+                    return 1;
+                }
+                break;
+            case 'X':
+                net_provision = 1;
+                break;
+            case 'K':
+                checkpoint_dir = optarg;
+                break;
+            case 'Y':
+                restore_dir = optarg;
+                break;
+            case 'l':
+                lazy_pages = 1;
+                break;
+            case 'A':
+                update_limits = 1;
+                break;
+            case 'F':
+                pause_state = 1;
+                break;
+            case 'B':
+                pause_state = 0;
+                break;
+            case 'T':
+                trace_fd = open(optarg, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+                if (trace_fd == -1) {
+                    fprintf(stderr, "Cannot open trace file %s: %s\n", optarg, strerror(errno));
+                    return 1;
+                }
+                break;
+            case 'D':
+                dump_trace = 1;
+                break;
+            case 'q':
+                output_mode = OUTPUT_QUIET;
+                break;
+            case 'J':
+                output_mode = OUTPUT_JSON;
+                break;
+            case 'R':
+                ready_fd = atoi(optarg);
+                if (ready_fd < 0 || fcntl(ready_fd, F_SETFD, FD_CLOEXEC) != 0) {
+                    fprintf(stderr, "--ready-fd %s is not an open file descriptor\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'k':
+                if (stack_pool_set_size(&stack_pool, parse_size(optarg)) != 0) {
+                    fprintf(stderr, "--stack-size must be between 64K and 64M: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (dump_trace) {
+        return trace_dump(stdout);
+    }
+    if (net_provision) {
+        if (net_slots == 0) {
+            fprintf(stderr, "--net-provision needs --net-pool N\n");
+            return 1;
+        }
+        return net_pool_init(net_slots) == 0 && net_pool_provision() == 0 ? 0 : 1;
+    }
+    // The first positional argument is the container name, except for the zygote and supervisor
+    if (spec_path == NULL && !zygote_mode && argc > optind && !valid_container_name(argv[optind])) {
+        fprintf(stderr, "Invalid container name: %s (%s)\n", argv[optind], CONTAINER_NAME_RULE);
+        return 1;
+    }
+    if (checkpoint_dir != NULL) {
+        if (argc - optind < 1) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (checkpoint_container(argv[optind], checkpoint_dir) != 0) {
+            return 1;
+        }
+        report(stdout, "✓ Checkpoint of %s saved in %s\n", argv[optind], checkpoint_dir);
+        return 0;
+    }
+    if (update_limits || pause_state != -1) {
+        if (argc - optind < 1 || (update_limits && pause_state != -1)) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (update_limits) {
+            // The kernel keeps memory.max; only check --memory-high against a --memory given with it
+            ContainerConfig checked = config;
+            if (!(update_given & UPDATE_MEMORY)) {
+                checked.memory_limit = LONG_MAX;
+            }
+            // Likewise cpu.max: with only one of --cpu/--cpu-period given, update_container()
+            // checks the quota against the other half read back from the cgroup
+            if ((update_given & (UPDATE_CPU | UPDATE_CPU_PERIOD)) != (UPDATE_CPU | UPDATE_CPU_PERIOD)) {
+                checked.cpu_limit = 100;
+            }
+            if (validate_limits(&checked) != 0 || update_container(argv[optind], &config, update_given) != 0) {
+                return 1;
+            }
+            report(stdout, "✓ Limits of %s updated\n", argv[optind]);
+            return 0;
+        }
+        if (pause_container(argv[optind], pause_state) != 0) {
+            return 1;
+        }
+        report(stdout, "✓ %s %s\n", argv[optind], pause_state ? "paused" : "resumed");
+        return 0;
+    }
+    trace_event(TRACE_MAIN, 0, NULL, &started);
+
+    // Zygote children get their stdio from each client instead
+    if (config.log_dir != NULL && zygote_mode) {
+        fprintf(stderr, "--log-dir cannot be combined with --zygote\n");
+        return 1;
+    }
+
+    // Zygote children are cloned before anyone asks for a network
+    if (config.net && zygote_mode) {
+        fprintf(stderr, "--net cannot be combined with --zygote\n");
+        return 1;
+    }
+
+    // The zygote execs its children's commands without the per-container steps
+    // (clients choose between bash -c and argv per request, see zygote_child_function)
+    if ((config.seccomp_profile != NULL || config.direct_exec || config.init) && zygote_mode) {
+        fprintf(stderr, "--seccomp, --exec and --init cannot be combined with --zygote\n");
+        return 1;
+    }
+
+    // A checkpoint is one process tree, restored into a fresh namespace set of its own
+    // (with the seccomp filter it had when it was saved)
+    if (restore_dir != NULL && (zygote_mode || replicas > 1 || spec_path != NULL || config.net ||
+                                config.seccomp_profile != NULL)) {
+        fprintf(stderr, "--restore starts a single container without --net or --seccomp\n");
+        return 1;
+    }
+    if (lazy_pages && restore_dir == NULL) {
+        fprintf(stderr, "--lazy-pages needs --restore\n");
+        return 1;
+    }
+
+    if (spec_path != NULL && (zygote_mode || replicas > 1)) {
+        fprintf(stderr, "--supervise cannot be combined with --zygote or --replicas\n");
+        return 1;
+    }
+
+    // The record and the ready PID describe exactly one container
+    if ((output_mode != OUTPUT_TEXT || ready_fd != -1) && (zygote_mode || replicas > 1 || spec_path != NULL)) {
+        fprintf(stderr, "--quiet, --json and --ready-fd need a single container\n");
+        return 1;
+    }
+
+    // Replicas and pooled children would all write into the same upper directory
+    if (upper_dir != NULL && (!(rootfs_flags & ROOTFS_OVERLAY) || replicas > 1 || zygote_mode || spec_path != NULL)) {
+        fprintf(stderr, "--upper-dir needs the overlay and a single container\n");
+        return 1;
+    }
+
+    if (validate_limits(&config) != 0) {
+        return 1;
+    }
+
+    // Load the filter before any cgroup or veth is set up for it (replicas share it)
+    if (config.seccomp_profile != NULL && (config.seccomp = seccomp_load(config.seccomp_profile)) == NULL) {
+        return 1;
+    }
+
+    if (pool_slots > 0 && cgroup_pool_init(pool_slots) != 0) {
+        report(stderr, "⚠️  Cgroup pool unavailable (%s: %s), creating cgroups per container\n",
+                cgroup_pool_dir, strerror(errno));
+    }
+    if (net_slots > 0 && net_pool_init(net_slots) != 0) {
+        report(stderr, "⚠️  Veth pool unavailable (%s: %s), --net containers get loopback only\n",
+                net_pool_dir, strerror(errno));
+    }
+
+    if (zygote_mode) {
+        if (argc - optind < 1) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        rootfs = resolve_rootfs(argv[optind], image_store, rootfs_flags, rootfs_buf, sizeof(rootfs_buf));
+        if (rootfs == NULL) {
+            return 1;
+        }
+        CgroupLimitSet limits;
+        container_limits(&limits, &config);
+        return run_zygote(rootfs, socket_path, pool_size, rootfs_flags, &limits);
+    }
+
+    // Command-line limits are the defaults for every line of the spec
+    if (spec_path != NULL) {
+        config.rootfs_flags = rootfs_flags;
+        return run_supervisor(spec_path, &config, image_store);
+    }
+
+    // ERROR: Less than 3 positional arguments (2 to restore), provide user correct instructions
+    if (argc - optind < (restore_dir != NULL ? 2 : 3)) {
+        print_usage(argv[0]);
         return 1;
     }
     
-    // Build config using argument values
-    // Default limits: 512MB RAM, 50% CPU
-    ContainerConfig config = {
-        .name = argv[1],
-        .rootfs_path = argv[2],
-        .command = argv[3],
-        .memory_limit = 512 * 1024 * 1024,   // 512 MB
-        .cpu_limit = 50                      // 50%
-    };
+    rootfs = resolve_rootfs(argv[optind + 1], image_store, rootfs_flags, rootfs_buf, sizeof(rootfs_buf));
+    if (rootfs == NULL) {
+        return 1;
+    }
+    
+    // Complete the config (limits were filled in while parsing options)
+    config.name = argv[optind];
+    config.rootfs_path = rootfs;
+    config.command = argc - optind > 2 ? argv[optind + 2] : "";
+    if (config.direct_exec && restore_dir == NULL) {
+        config.argv = &argv[optind + 2];  // Up to argv[argc], which is NULL
+    }
+    config.rootfs_flags = rootfs_flags;
+    config.upper_dir = upper_dir;
+    
+    if (replicas > 1) {
+        return run_replicas(&config, replicas);
+    }
     
     // Print necessary information
-    printf("=== MiniRun Container Runtime ===\n");
-    printf("Starting container: %s\n", config.name);
-    printf("Root filesystem: %s\n", config.rootfs_path);
-    printf("Command: %s\n\n", config.command);
-    printf("Limits: %ldMB RAM, %d%% CPU\n\n", 
+    report(stdout, "=== MiniRun Container Runtime ===\n");
+    report(stdout, "Starting container: %s\n", config.name);
+    report(stdout, "Root filesystem: %s\n", config.rootfs_path);
+    if (restore_dir != NULL) {
+        report(stdout, "Checkpoint: %s%s\n\n", restore_dir, lazy_pages ? " (pages loaded on demand)" : "");
+    } else {
+        report(stdout, "Command: %s\n\n", config.command);
+    }
+    report(stdout, "Limits: %ldMB RAM, %d%% CPU\n\n",
            config.memory_limit / (1024*1024), config.cpu_limit);
     
     // Setup cgroups before creating container (optional - will warn if fails)
-    int cgroups_enabled = setup_cgroups(config.name, config.memory_limit, config.cpu_limit);
+    // The open handle lets clone3() create the child directly inside the cgroup
+    CgroupHandle cgroup;
+    int cgroups_enabled = setup_cgroups(&cgroup, &config);
+    config.cgroup = cgroup.dir_fd >= 0 ? &cgroup : NULL;
     if (!cgroups_enabled) {
-        printf("⚠️  WARNING: Running without resource limits\n\n");
+        report(stdout, "⚠️  WARNING: Running without resource limits\n\n");
     }
+    const char* cgroup_path = config.cgroup != NULL ? cgroup.path : NULL;  // Outlives cgroup_close()
 
-    // Allocate stack for child process
-    // Note: clone() requires stack pointer to point at TOP of allocated memory
-    void* stack = malloc(1024 * 1024);  // 1MB stack
-    if (stack == NULL) {
-        perror("malloc failed");
-        cleanup_cgroups(config.name);
-        return 1;
-    }
+    // Output pipe and ring, if --log-dir was given
+    LogRing ring;
+    int log_read_fd = container_log_open(&config, &ring);
 
-    // Create child with namespaces
-    // CLONE_NEWPID: New PID namespace (process will be PID 1)
-    // CLONE_NEWNS: New mount namespace (separate filesystem view)
-    // SIGCHLD: Send SIGCHLD to parent when child terminates
-    pid_t child_pid = clone(
-        child_function,
-        stack + (1024 * 1024),  // Stack grows downward, point to top
-        CLONE_NEWPID | CLONE_NEWNS | SIGCHLD,
-        &config
-    );
+    // Create child with namespaces (see spawn_container for the flags), or have CRIU recreate a checkpointed one
+    pid_t child_pid = restore_dir != NULL ? restore_container(&config, restore_dir, lazy_pages)
+                                          : spawn_container(&config);
+    trace_event(restore_dir != NULL ? TRACE_RESTORE : TRACE_CLONE, child_pid == -1 ? errno : 0, config.name, NULL);
     
     // ERROR: Child clone failed
     if (child_pid == -1) {
-        perror("clone failed");
-        free(stack);
+        perror(restore_dir != NULL ? "restore failed" : "clone failed");
+        print_run_record(config.name, -1, cgroup_path, NULL, strerror(errno));
+        container_log_attach(&config, NULL, &ring, log_read_fd, child_pid);
+        cgroup_close(&cgroup);
         cleanup_cgroups(config.name);
+        cleanup_network(config.name);
         return 1;
     }
     
     // Print Container PID of child
-    printf("Container PID: %d\n", child_pid);
+    report(stdout, "Container PID: %d\n", child_pid);
+    fflush(stdout);  // Supervisors reading a pipe (the orchestrator) wait for this line
+    if (ready_fd != -1) {
+        // The same signal without stdio, for --quiet/--json callers
+        dprintf(ready_fd, "%d\n", child_pid);
+        close(ready_fd);
+    }
     
-    // Wait for container to finish
-    int status;
-    waitpid(child_pid, &status, 0);
+    // Wait for container to finish, reporting pressure and OOM events as they happen
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    ContainerWatch watch;
+    watch_open(&watch, config.name, child_pid, config.cgroup, inotify_fd);
+    container_log_attach(&config, &watch, &ring, log_read_fd, child_pid);
+    cgroup_close(&cgroup);
+    supervise_containers(&watch, 1, inotify_fd);
+    trace_event(TRACE_EXIT, 0, config.name, NULL);
+    watch_close(&watch);
+    if (inotify_fd != -1) {
+        close(inotify_fd);
+    }
     
-    // Container has stopped
-    printf("\n=== Container [%s] stopped ===\n", config.name);
+    // Container has stopped; its exit code becomes ours (128 + N when killed by signal N)
+    int exit_code = !watch.exited ? 1 : WIFEXITED(watch.status) ? WEXITSTATUS(watch.status) :
+                    WIFSIGNALED(watch.status) ? 128 + WTERMSIG(watch.status) : 1;
+    report(stdout, "\n=== Container [%s] stopped (exit code %d) ===\n", config.name, exit_code);
 
-    // Free the allocated stack memory
-    free(stack);
     cleanup_cgroups(config.name);
+    cleanup_network(config.name);
+    print_run_record(config.name, child_pid, cgroup_path, &watch, NULL);
     
-    return 0;
+    return exit_code;
 }
+#endif /* MINIRUN_NO_MAIN */
+
+/*
+ * Trace ring
+ *
+ * Every start-up step of main(), setup_cgroups() and child_function() records
+ * a fixed-size event (CLOCK_MONOTONIC timestamp, phase, errno, container) into
+ * trace_ring, a per-process array: one vDSO clock read and a few stores, no
+ * syscall (tests/bench/bench_trace_ring.c: tens of ns per event, most of it
+ * the clock). The newest TRACE_RING_EVENTS are kept.
+ *
+ * Events reach the host-wide TRACE_RING_PATH only when trace_flush() runs: at
+ * exit (atexit), on SIGTERM/SIGINT/SIGHUP, and in the container just before
+ * exec, which would otherwise discard its copy of the ring. The runtime maps
+ * the file once at start-up and the container inherits the shared mapping, as
+ * the path is gone after pivot_root(). That file is a
+ * fixed ring of TraceRecords shared by every runtime on the host. A flush
+ * reserves its slots with one atomic add on the header's head and stores each
+ * record's seq last, so concurrent runtimes never lock and readers
+ * (--trace-dump, scripts/monitor.sh --trace) skip slots still being written.
+ * Once full, the oldest records are overwritten.
+ *
+ * With --trace FILE the flushed events are also appended to FILE as
+ * "<phase> <ns> <errno>" lines (tests/bench/startup_phases.py).
+ *
+ * Phases, each recorded when the step ends:
+ *
+ *   main          runtime entered main()
+ *   cgroup_probe  cgroup v2 found, controllers enabled
+ *   cgroup_mkdir  container cgroup opened (created or claimed from the pool)
+ *   cgroup_write  limits written
+ *   clone         spawn_container() returned in the runtime
+ *   restore       criu restore returned (--restore, instead of clone and the child's steps)
+ *   child         first instruction of child_function()
+ *   cgroup_join   child is in its cgroup
+ *   net           eth0 and lo configured (--net only)
+ *   rootfs        pivot_root()/chroot() done
+ *   proc_mount    /proc mounted
+ *   seccomp       syscall filter installed (--seccomp only)
+ *   exec          about to execl() the command (again with errno if it failed)
+ *   exit          container reaped
+ */
+
+static const char* trace_phase_names[TRACE_PHASE_COUNT] = {
+    [TRACE_MAIN] = "main",
+    [TRACE_CGROUP_PROBE] = "cgroup_probe",
+    [TRACE_CGROUP_MKDIR] = "cgroup_mkdir",
+    [TRACE_CGROUP_WRITE] = "cgroup_write",
+    [TRACE_CLONE] = "clone",
+    [TRACE_CHILD] = "child",
+    [TRACE_CGROUP_JOIN] = "cgroup_join",
+    [TRACE_ROOTFS] = "rootfs",
+    [TRACE_PROC_MOUNT] = "proc_mount",
+    [TRACE_EXEC] = "exec",
+    [TRACE_EXIT] = "exit",
+    [TRACE_NET] = "net",
+    [TRACE_RESTORE] = "restore",
+    [TRACE_SECCOMP] = "seccomp",
+};
 
 /**
- * Helper function: Write to a cgroup file with proper error handling
+ * Record one step in this process's trace ring
  *
- * @param path  Full path to cgroup file
- * @param value String value to write
- * @return 0 on success, -1 on failure
+ * @param phase     TRACE_* step that just ended
+ * @param err       errno if the step failed, else 0
+ * @param container Container name (NULL = the child's, or none); must outlive the next flush
+ * @param at        When the step ended, or NULL for now
  */
-int write_cgroup_file(const char* path, const char* value) {
-    FILE* f = fopen(path, "w");
-    if (f == NULL) {
-        // Don't print error here - let caller decide
-        return -1;
-    }
-    
-    int ret = fprintf(f, "%s", value);
-    fclose(f);
-    
-    if (ret < 0) {
-        return -1;
+void trace_event(int phase, int err, const char* container, const struct timespec* at) {
+    struct timespec now;
+
+    if (at == NULL) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        at = &now;
     }
-    
-    return 0;
+    // Atomic so a flushing signal handler never shares a slot with the code it interrupted
+    unsigned int i = __atomic_fetch_add(&trace_ring.head, 1, __ATOMIC_RELAXED);
+    TraceEvent* e = &trace_ring.events[i % TRACE_RING_EVENTS];
+    e->ns = (uint64_t)at->tv_sec * 1000000000ULL + at->tv_nsec;
+    e->container = container;
+    e->err = err;
+    e->phase = phase;
+    e->source = trace_ring.source;
 }
 
 /**
- * Setup cgroups for resource limits (memory and CPU)
- *
- * Cgroups v2 structure:
- *   /sys/fs/cgroup/minirun-<name>/
- *     ├── memory.max        (memory limit in bytes)
- *     ├── cpu.max           (CPU quota: "max period" in microseconds)
- *     └── cgroup.procs      (PIDs in this cgroup)
+ * Map the host-wide trace ring
  *
- * @param container_name     Name of container (used for cgroup directory)
- * @param memory_limit_bytes Memory limit in bytes (e.g., 512*1024*1024 for 512MB)
- * @param cpu_percent        CPU percentage (e.g., 50 for 50% of one core)
- * @return 1 if cgroups set up successfully, 0 if failed (container can still run)
+ * @param writable 1 to flush into it (creating it on first use), 0 to read it
+ * @return Header of the mapping (records follow it), or NULL with errno set
  */
-int setup_cgroups(const char* container_name, long memory_limit_bytes, int cpu_percent) {
-    char cgroup_path[256];
-    char file_path[300];  // Slightly larger to fit cgroup_path + filename
-    char value[128];
-    int success = 1;  // Track if cgroups are working
-    
-    // Build cgroup directory path: /sys/fs/cgroup/minirun-<name>
-    snprintf(cgroup_path, sizeof(cgroup_path), "/sys/fs/cgroup/minirun-%s", container_name);
-    
-    // Check if cgroups v2 is available
-    if (access("/sys/fs/cgroup/cgroup.controllers", F_OK) != 0) {
-        fprintf(stderr, "⚠️  Cgroups v2 not available on this system\n");
-        fprintf(stderr, "   Container will run without resource limits\n");
-        return 0;
+static TraceRingHeader* trace_ring_map(int writable) {
+    size_t len = TRACE_RING_MAP_LEN;
+    int fd;
+
+    if (writable) {
+        mkdir(MINIRUN_RUN_DIR, 0755);
+        fd = open(TRACE_RING_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    } else {
+        fd = open(TRACE_RING_PATH, O_RDONLY | O_CLOEXEC);
     }
-    
-    // Create cgroup directory
-    if (mkdir(cgroup_path, 0755) != 0 && errno != EEXIST) {
-        fprintf(stderr, "⚠️  Failed to create cgroup directory: %s\n", strerror(errno));
-        fprintf(stderr, "   Try running with sudo or check permissions\n");
-        return 0;
+    if (fd == -1) {
+        return NULL;
     }
-    
-    // Enable controllers in parent cgroup (may already be enabled, that's fine)
-    // This is needed before child cgroups can use these controllers
-    if (write_cgroup_file("/sys/fs/cgroup/cgroup.subtree_control", "+cpu +memory") != 0) {
-        // This might fail if already enabled or if we lack permissions - not critical
-        // We'll try to set limits anyway
+    // Every creator extends it to the same size, so racing creators are harmless
+    struct stat st;
+    int ok = fstat(fd, &st) == 0;
+    if (ok && st.st_size < (off_t)len) {
+        ok = writable && ftruncate(fd, len) == 0;
+        if (!writable) {
+            errno = EINVAL;  // Created by another version, or still being created
+        }
     }
-    
-    // Set memory limit
-    snprintf(file_path, sizeof(file_path), "%s/memory.max", cgroup_path);
-    snprintf(value, sizeof(value), "%ld", memory_limit_bytes);
-    
-    if (write_cgroup_file(file_path, value) != 0) {
-        fprintf(stderr, "⚠️  Failed to set memory limit: %s\n", strerror(errno));
-        fprintf(stderr, "   Check if memory controller is enabled\n");
-        success = 0;
+    if (!ok) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return NULL;
     }
-    
-    // Set CPU limit
-    // Format: "$MAX $PERIOD" (both in microseconds)
-    // Example: 50% CPU = "50000 100000" (50ms out of every 100ms)
-    long cpu_max = (cpu_percent * 1000);     // Convert percentage to microseconds
-    long cpu_period = 100000;                 // 100ms period (standard)
-    
-    snprintf(file_path, sizeof(file_path), "%s/cpu.max", cgroup_path);
-    snprintf(value, sizeof(value), "%ld %ld", cpu_max, cpu_period);
-    
-    if (write_cgroup_file(file_path, value) != 0) {
-        fprintf(stderr, "⚠️  Failed to set CPU limit: %s\n", strerror(errno));
-        fprintf(stderr, "   Check if CPU controller is enabled\n");
-        success = 0;
+    TraceRingHeader* hdr = mmap(NULL, len, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (hdr == MAP_FAILED) {
+        return NULL;
     }
-    
-    // If we successfully set limits, print confirmation
-    if (success) {
-        printf("✓ Resource limits configured:\n");
-        printf("  - Memory: %ldMB\n", memory_limit_bytes / (1024*1024));
-        printf("  - CPU: %d%% of one core\n", cpu_percent);
-        printf("  - Cgroup: %s\n\n", cgroup_path);
+
+    uint32_t expected = 0;
+    if (writable && __atomic_compare_exchange_n(&hdr->magic, &expected, TRACE_RING_MAGIC, 0,
+                                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        hdr->capacity = TRACE_SHM_EVENTS;
     }
-    
-    return success;
+    if (hdr->magic != TRACE_RING_MAGIC) {
+        munmap(hdr, len);
+        errno = EINVAL;
+        return NULL;
+    }
+    return hdr;
 }
 
 /**
- * Cleanup cgroups after container stops
- *
- * Removes the cgroup directory. This will fail if processes are still in the cgroup,
- * which is fine - kernel will clean up when all processes exit.
+ * Copy the events recorded since the last flush to TRACE_RING_PATH (and --trace)
  *
- * @param container_name Name of container
+ * Takes no locks and allocates nothing, so the signal handler can call it too.
+ * errno is preserved.
  */
-void cleanup_cgroups(const char* container_name) {
-    char cgroup_path[512];
-    
-    snprintf(cgroup_path, sizeof(cgroup_path), "/sys/fs/cgroup/minirun-%s", container_name);
-    
-    // Try to remove cgroup directory
-    // This may fail if processes still exist in the cgroup, which is okay
-    if (rmdir(cgroup_path) != 0 && errno != ENOENT) {
-        // ENOENT means directory doesn't exist (already cleaned up or never created)
-        // Other errors we can ignore - kernel will clean up eventually
-    }
-}
+void trace_flush(void) {
+    int saved_errno = errno;
+    unsigned int head = __atomic_load_n(&trace_ring.head, __ATOMIC_ACQUIRE);
+    unsigned int first = trace_ring.flushed;
 
-// This function is executed only by the child
-// Clone() requires 'void *arg' signature
-int child_function(void* arg) {
-    ContainerConfig* config = (ContainerConfig*)arg;
-    
-    // Print Container Name and PID (1 from child's perspective)
-    printf("Container [%s] starting...\n", config->name);
-    printf("PID: %d\n", getpid());
+    if (head - first > TRACE_RING_EVENTS) {
+        first = head - TRACE_RING_EVENTS;  // The oldest were overwritten before anyone saw them
+    }
+    trace_ring.flushed = head;
+    if (head == first) {
+        errno = saved_errno;
+        return;
+    }
 
-    // Join the cgroup to apply resource limits
-    // We write our PID to cgroup.procs, which moves this process into the cgroup
-    char cgroup_procs_path[300];
-    char pid_str[32];
-    
-    snprintf(cgroup_procs_path, sizeof(cgroup_procs_path),
-             "/sys/fs/cgroup/minirun-%s/cgroup.procs", config->name);
-    snprintf(pid_str, sizeof(pid_str), "%d", getpid());
-    
-    // Try to join the cgroup
-    FILE* cgroup_file = fopen(cgroup_procs_path, "w");
-    if (cgroup_file) {
-        if (fprintf(cgroup_file, "%s", pid_str) > 0) {
-            printf("✓ Resource limits applied to this container\n");
-        } else {
-            fprintf(stderr, "⚠️  Warning: Could not write PID to cgroup\n");
-        }
-        fclose(cgroup_file);
-    } else {
-        // Cgroup doesn't exist or we lack permissions - container continues without limits
-        fprintf(stderr, "⚠️  Warning: Running without resource limits\n");
+    if (trace_ring.shm == NULL) {
+        trace_ring.shm = trace_ring_map(1);
     }
-    
-    // Change root to our rootfs_path so child can't see outside of it
-    if (chroot(config->rootfs_path) != 0) {
-        // ERROR: Changing root execution failed
-        perror("chroot failed");
-        return 1;
+    TraceRingHeader* hdr = trace_ring.shm;
+    if (hdr != NULL) {
+        TraceRecord* records = (TraceRecord*)(hdr + 1);
+        uint64_t seq = __atomic_fetch_add(&hdr->head, head - first, __ATOMIC_RELAXED);
+        for (unsigned int i = first; i != head; i++, seq++) {
+            const TraceEvent* e = &trace_ring.events[i % TRACE_RING_EVENTS];
+            TraceRecord* r = &records[seq % hdr->capacity];
+            __atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);  // Readers skip it until complete
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            r->ns = e->ns;
+            r->pid = trace_ring.pid;
+            r->err = e->err;
+            r->phase = e->phase;
+            r->source = e->source;
+            const char* container = e->container != NULL ? e->container : trace_ring.container;
+            memset(r->container, 0, sizeof(r->container));
+            if (container != NULL) {
+                strncpy(r->container, container, sizeof(r->container) - 1);
+            }
+            __atomic_store_n(&r->seq, seq + 1, __ATOMIC_RELEASE);
+        }
     }
-    // Changes directory to myroot as we already set it as the new root
-    chdir("/");
-    
-    // Mount /proc so we can use utilities like 'ps' in the container
-    if (mount("proc", "/proc", "proc", 0, NULL) != 0) {
-        perror("Warning: mount /proc failed (ps command may not work)");
+
+    if (trace_fd != -1) {
+        // One write() for all lines, so lines from runtime and container never interleave
+        char buf[TRACE_RING_EVENTS * 48];
+        size_t len = 0;
+        for (unsigned int i = first; i != head; i++) {
+            const TraceEvent* e = &trace_ring.events[i % TRACE_RING_EVENTS];
+            int n = snprintf(buf + len, sizeof(buf) - len, "%s %llu %d\n",
+                             trace_phase_names[e->phase], (unsigned long long)e->ns, e->err);
+            if (n < 0 || (size_t)n >= sizeof(buf) - len) {
+                break;
+            }
+            len += n;
+        }
+        if (write(trace_fd, buf, len) != (ssize_t)len) {
+            // Benchmark output only; the shared ring above has the events
+        }
+    }
+    errno = saved_errno;
+}
+
+/**
+ * Forget events inherited from the parent (first thing in a cloned child)
+ *
+ * @param container Name recorded with the child's events
+ */
+void trace_child_begin(const char* container) {
+    trace_ring.flushed = trace_ring.head;
+    trace_ring.source = TRACE_SOURCE_CONTAINER;
+    trace_ring.container = container;
+}
+
+// Flush, then die of the signal as if we had never caught it
+static void trace_signal_handler(int sig) {
+    trace_flush();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/**
+ * Map the shared ring and make sure this process's events are flushed however it ends
+ */
+void trace_install(void) {
+    struct sigaction sa;
+
+    trace_ring.pid = getpid();
+    trace_ring.shm = trace_ring_map(1);  // NULL (not root, no /run): flushes retry, events stay local
+    atexit(trace_flush);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = trace_signal_handler;
+    sigemptyset(&sa.sa_mask);
+    const int signals[] = { SIGTERM, SIGINT, SIGHUP };
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+        sigaction(signals[i], &sa, NULL);
+    }
+}
+
+/**
+ * Print the host-wide trace ring (--trace-dump), oldest first
+ *
+ * One line per event: "<seq> <ns> <pid> <runtime|container> <name|-> <phase> <errno>"
+ *
+ * @param out Where to print
+ * @return 0 on success, 1 if there is no ring yet
+ */
+int trace_dump(FILE* out) {
+    TraceRingHeader* hdr = trace_ring_map(0);
+    if (hdr == NULL) {
+        fprintf(stderr, "No trace ring at %s: %s\n", TRACE_RING_PATH, strerror(errno));
+        return 1;
+    }
+
+    const TraceRecord* records = (const TraceRecord*)(hdr + 1);
+    uint64_t head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+    uint64_t count = head < hdr->capacity ? head : hdr->capacity;
+    for (uint64_t seq = head - count; seq < head; seq++) {
+        const TraceRecord* r = &records[seq % hdr->capacity];
+        if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != seq + 1) {
+            continue;  // Being written, or already overwritten by a newer flush
+        }
+        TraceRecord copy = *r;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&r->seq, __ATOMIC_RELAXED) != seq + 1 || copy.phase >= TRACE_PHASE_COUNT ||
+            trace_phase_names[copy.phase] == NULL) {
+            continue;
+        }
+        copy.container[sizeof(copy.container) - 1] = '\0';
+        fprintf(out, "%llu %llu %u %s %s %s %d\n", (unsigned long long)seq, (unsigned long long)copy.ns,
+                copy.pid, copy.source == TRACE_SOURCE_CONTAINER ? "container" : "runtime",
+                copy.container[0] ? copy.container : "-", trace_phase_names[copy.phase], copy.err);
+    }
+    munmap(hdr, TRACE_RING_MAP_LEN);
+    return 0;
+}
+
+/*
+ * Output modes
+ *
+ * By default a run prints banners on stdout and soft warnings (no cgroup, no
+ * overlay, ...) on stderr, from both sides of the clone. With --quiet they all
+ * go through report() and are dropped, leaving only errors, so a successful
+ * launch does no stdio at all. --json then prints one record when the
+ * container is gone:
+ *
+ *   {"container":"web","pid":4242,"cgroup":"/sys/fs/cgroup/minirun-web","exit_code":0,
+ *    "signal":null,"timings_us":{"cgroup_probe":41.2,"cgroup_mkdir":60.8,...,"exit":3120.5}}
+ *
+ * timings_us holds the offset from main() of every trace ring step of the run;
+ * the container's own steps are read back from the shared ring it flushed to
+ * before exec. A start that fails has "pid":null and an "error".
+ */
+
+/**
+ * Print a banner line or soft warning, unless --quiet/--json
+ */
+void report(FILE* stream, const char* fmt, ...) {
+    va_list ap;
+
+    if (output_mode != OUTPUT_TEXT) {
+        return;
+    }
+    va_start(ap, fmt);
+    vfprintf(stream, fmt, ap);
+    va_end(ap);
+}
+
+/**
+ * When each step of this run first happened (0 = not recorded)
+ *
+ * @param first_ns TRACE_PHASE_COUNT timestamps to fill in
+ */
+static void trace_run_steps(uint64_t* first_ns) {
+    unsigned int head = trace_ring.head;
+    unsigned int begin = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+
+    memset(first_ns, 0, TRACE_PHASE_COUNT * sizeof(uint64_t));
+    for (unsigned int i = begin; i != head; i++) {
+        const TraceEvent* e = &trace_ring.events[i % TRACE_RING_EVENTS];
+        if (e->phase < TRACE_PHASE_COUNT && first_ns[e->phase] == 0) {
+            first_ns[e->phase] = e->ns;
+        }
+    }
+
+    // Newest first, back to the container's first step; older runs with a recycled pid predate main()
+    TraceRingHeader* hdr = trace_ring.shm;
+    if (hdr == NULL) {
+        return;
+    }
+    const TraceRecord* records = (const TraceRecord*)(hdr + 1);
+    uint64_t shm_head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+    for (uint64_t n = 0; n < shm_head && n < hdr->capacity; n++) {
+        uint64_t seq = shm_head - 1 - n;
+        const TraceRecord* r = &records[seq % hdr->capacity];
+        if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != seq + 1 || r->pid != trace_ring.pid ||
+            r->source != TRACE_SOURCE_CONTAINER || r->phase >= TRACE_PHASE_COUNT || r->ns < first_ns[TRACE_MAIN]) {
+            continue;
+        }
+        first_ns[r->phase] = r->ns;  // Going backwards, so a repeated step ends at its first time
+        if (r->phase == TRACE_CHILD) {
+            break;
+        }
+    }
+}
+
+/**
+ * Escape a string for use between the quotes of a JSON string
+ *
+ * Container names, cgroup paths and error messages are not restricted to
+ * characters that are safe in JSON. Output is truncated to fit, never in the
+ * middle of an escape sequence.
+ *
+ * @return out
+ */
+const char* json_escape(const char* s, char* out, size_t size) {
+    size_t len = 0;
+
+    for (; *s != '\0'; s++) {
+        unsigned char ch = (unsigned char)*s;
+        char seq[7];
+        int n;
+        if (ch == '"' || ch == '\\') {
+            n = snprintf(seq, sizeof(seq), "\\%c", ch);
+        } else if (ch < 0x20) {
+            n = snprintf(seq, sizeof(seq), "\\u%04x", ch);
+        } else {
+            seq[0] = ch;
+            n = 1;
+        }
+        if (len + n >= size) {
+            break;
+        }
+        memcpy(out + len, seq, n);
+        len += n;
+    }
+    out[len] = '\0';
+    return out;
+}
+
+/**
+ * Print the --json record of a single-container run (nothing in other modes)
+ *
+ * @param name        Container name
+ * @param pid         Container PID, or -1 if it never started
+ * @param cgroup_path Its cgroup, or NULL
+ * @param w           Its watch once reaped, or NULL
+ * @param error       Why the start failed, or NULL
+ */
+void print_run_record(const char* name, pid_t pid, const char* cgroup_path, const ContainerWatch* w,
+                      const char* error) {
+    uint64_t first_ns[TRACE_PHASE_COUNT];
+    char buf[2048];
+    char esc[512];
+    size_t len = 0;
+
+    if (output_mode != OUTPUT_JSON) {
+        return;
+    }
+
+#define RECORD(...) \
+    (len += snprintf(buf + len, len < sizeof(buf) ? sizeof(buf) - len : 0, __VA_ARGS__))
+
+    RECORD("{\"container\":\"%s\",", json_escape(name, esc, sizeof(esc)));
+    RECORD(pid > 0 ? "\"pid\":%d," : "\"pid\":null,", pid);
+    if (cgroup_path != NULL) {
+        RECORD("\"cgroup\":\"%s\",", json_escape(cgroup_path, esc, sizeof(esc)));
+    } else {
+        RECORD("\"cgroup\":null,");
+    }
+    if (error != NULL) {
+        RECORD("\"error\":\"%s\",", json_escape(error, esc, sizeof(esc)));
+    }
+    if (w != NULL && w->exited && WIFSIGNALED(w->status)) {
+        RECORD("\"exit_code\":%d,\"signal\":%d,", 128 + WTERMSIG(w->status), WTERMSIG(w->status));
+    } else {
+        RECORD("\"exit_code\":%d,\"signal\":null,",
+               w != NULL && w->exited && WIFEXITED(w->status) ? WEXITSTATUS(w->status) : 1);
+    }
+
+    trace_run_steps(first_ns);
+    const char* sep = "";
+    RECORD("\"timings_us\":{");
+    for (int phase = TRACE_MAIN + 1; phase < TRACE_PHASE_COUNT; phase++) {
+        if (first_ns[phase] != 0 && first_ns[TRACE_MAIN] != 0) {
+            RECORD("%s\"%s\":%.1f", sep, trace_phase_names[phase], (first_ns[phase] - first_ns[TRACE_MAIN]) / 1000.0);
+            sep = ",";
+        }
+    }
+    RECORD("}}\n");
+#undef RECORD
+
+    // One write(), so the record never interleaves with a supervisor's own output
+    if (len < sizeof(buf)) {
+        fwrite(buf, 1, len, stdout);
+        fflush(stdout);
+    }
+}
+
+/*
+ * Cgroup handle API
+ *
+ * A CgroupHandle keeps an O_DIRECTORY fd on the container's cgroup. Knobs are
+ * opened relative to it with openat() and written with one write() each, so a
+ * limit costs openat + write + close with no path walk from / and no stdio
+ * buffering. Limits are formatted once into a CgroupLimitSet and that same set
+ * is applied to every cgroup that needs it (batch mode, zygote).
+ *
+ * On failure these return -1 with errno from the call that failed.
+ */
+
+/**
+ * Open (creating if needed) /sys/fs/cgroup/minirun-<name>
+ *
+ * With the warm pool enabled the container gets its claimed minirun-pool-<n>
+ * instead (claiming a slot on first use), and mkdir() only runs the first time
+ * a slot is ever used.
+ *
+ * @param cg             Handle to fill in
+ * @param container_name Name of container
+ * @return 0 on success, -1 on failure (cg->dir_fd is -1)
+ */
+int cgroup_open(CgroupHandle* cg, const char* container_name) {
+    int slot = cgroup_pool_size > 0 ? cgroup_pool_lookup(container_name) : -1;
+    if (cgroup_pool_size > 0 && slot == -1) {
+        slot = cgroup_pool_claim(container_name);
+    }
+    if (slot >= 0) {
+        snprintf(cg->path, sizeof(cg->path), "%s/minirun-pool-%d", cgroup_root, slot);
+    } else {
+        snprintf(cg->path, sizeof(cg->path), "%s/minirun-%s", cgroup_root, container_name);
+    }
+    
+    if (mkdir(cg->path, 0755) != 0 && errno != EEXIST) {
+        cg->dir_fd = -1;
+        return -1;
+    }
+    
+    cg->dir_fd = open(cg->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return cg->dir_fd >= 0 ? 0 : -1;
+}
+    
+/**
+ * Open the root of the cgroup hierarchy (for cgroup.subtree_control)
+ */
+int cgroup_open_root(CgroupHandle* cg) {
+    snprintf(cg->path, sizeof(cg->path), "%s", cgroup_root);
+    cg->dir_fd = open(cg->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return cg->dir_fd >= 0 ? 0 : -1;
+}
+
+/**
+ * Write one value to a knob in the cgroup with a single write()
+ *
+ * @param cg    Open cgroup handle
+ * @param knob  File name inside the cgroup (e.g. "memory.max")
+ * @param value String value to write
+ * @return 0 on success, -1 on failure (errno preserved)
+ */
+int cgroup_write(const CgroupHandle* cg, const char* knob, const char* value) {
+    int fd = openat(cg->dir_fd, knob, O_WRONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    
+    size_t len = strlen(value);
+    ssize_t ret = write(fd, value, len);
+    int saved_errno = errno;  // close() must not clobber the write error
+    close(fd);
+    
+    if (ret != (ssize_t)len) {
+        errno = ret < 0 ? saved_errno : EIO;
+        return -1;
+    }
+    
+    return 0;
+}
+
+/**
+ * Move a process into the cgroup
+ *
+ * The PID is interpreted in the caller's PID namespace, so the container itself
+ * can pass its own getpid() (1) while the zygote passes the host PID.
+ */
+int cgroup_add_process(const CgroupHandle* cg, pid_t pid) {
+    char pid_str[32];
+    
+    snprintf(pid_str, sizeof(pid_str), "%d", pid);
+    return cgroup_write(cg, "cgroup.procs", pid_str);
+}
+
+void cgroup_close(CgroupHandle* cg) {
+    if (cg->dir_fd >= 0) {
+        close(cg->dir_fd);
+        cg->dir_fd = -1;
+    }
+}
+
+/**
+ * Freeze or thaw every task in the cgroup (cgroup.freeze, Linux 5.2+)
+ *
+ * Freezing is asynchronous: the write returns at once and cgroup.events
+ * reports "frozen 1" (raising POLLPRI) once the last task has stopped, which
+ * we wait for up to CGROUP_FREEZE_MS. Thawing takes effect immediately.
+ *
+ * @param cg     Open cgroup handle
+ * @param frozen 1 to freeze, 0 to thaw
+ * @return 0 on success, -1 on failure (errno set, ETIMEDOUT if tasks kept running)
+ */
+int cgroup_freeze(const CgroupHandle* cg, int frozen) {
+    if (cgroup_write(cg, "cgroup.freeze", frozen ? "1" : "0") != 0) {
+        return -1;
+    }
+    if (!frozen) {
+        return 0;
+    }
+
+    int events_fd = openat(cg->dir_fd, "cgroup.events", O_RDONLY | O_CLOEXEC);
+    if (events_fd == -1) {
+        return -1;
+    }
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        char buf[256];
+        ssize_t n = pread(events_fd, buf, sizeof(buf) - 1, 0);
+        if (n < 0) {
+            break;
+        }
+        buf[n] = '\0';
+        if (strstr(buf, "frozen 1") != NULL) {
+            close(events_fd);
+            return 0;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long waited_ms = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+        if (waited_ms >= CGROUP_FREEZE_MS) {
+            errno = ETIMEDOUT;
+            break;
+        }
+        struct pollfd pfd = { .fd = events_fd, .events = POLLPRI };
+        poll(&pfd, 1, CGROUP_FREEZE_MS - waited_ms);
+    }
+    int saved_errno = errno;
+    close(events_fd);
+    errno = saved_errno;
+    return -1;
+}
+
+/**
+ * Format the limits for a container once
+ *
+ * CPU limit format: "$MAX $PERIOD" (both in microseconds)
+ * Example: 50% CPU = "50000 100000" (50ms out of every 100ms)
+ *          250% CPU over a 10ms period = "25000 10000" (2.5 cores, finer-grained throttling)
+ *
+ * @param set                Limit set to fill in
+ * @param memory_limit_bytes Memory limit in bytes
+ * @param cpu_percent        CPU percentage of one core (above 100 = several cores)
+ * @param cpu_period_us      Period the quota is enforced over (DEFAULT_CPU_PERIOD = 100ms)
+ */
+void cgroup_limits_init(CgroupLimitSet* set, long memory_limit_bytes, int cpu_percent, long cpu_period_us) {
+    long cpu_max = (long)cpu_percent * cpu_period_us / 100;  // Quota per period
+    
+    set->count = 0;
+    cgroup_limits_add(set, "memory.max", "%ld", memory_limit_bytes);
+    cgroup_limits_add(set, "cpu.max", "%ld %ld", cpu_max, cpu_period_us);
+}
+
+/**
+ * Append one knob/value pair to a limit set
+ *
+ * @return 0 on success, -1 if the set is full
+ */
+int cgroup_limits_add(CgroupLimitSet* set, const char* knob, const char* fmt, ...) {
+    va_list ap;
+    
+    if (set->count >= CGROUP_MAX_LIMITS) {
+        return -1;
+    }
+    
+    set->knob[set->count] = knob;
+    va_start(ap, fmt);
+    vsnprintf(set->value[set->count], sizeof(set->value[0]), fmt, ap);
+    va_end(ap);
+    set->count++;
+    
+    return 0;
+}
+
+/**
+ * Write every limit in the set to an open cgroup
+ *
+ * @return 1 if all limits were applied, 0 if any failed (each failure is reported)
+ */
+int cgroup_apply_limits(const CgroupHandle* cg, const CgroupLimitSet* set) {
+    int success = 1;
+    
+    for (int i = 0; i < set->count; i++) {
+        if (cgroup_write(cg, set->knob[i], set->value[i]) != 0) {
+            const char* knob = set->knob[i];
+            int controller_len = strcspn(knob, ".");
+            
+            report(stderr, "⚠️  Failed to set %s: %s\n", knob, strerror(errno));
+            report(stderr, "   Check if the %.*s controller is enabled\n", controller_len, knob);
+            success = 0;
+        }
+    }
+    
+    return success;
+}
+
+/**
+ * Check whether the unified (v2) cgroup hierarchy is mounted
+ *
+ * @return 1 if available, 0 otherwise
+ */
+int cgroups_v2_available(void) {
+    char path[300];
+    
+    snprintf(path, sizeof(path), "%s/cgroup.controllers", cgroup_root);
+    return access(path, F_OK) == 0;
+}
+
+/**
+ * Enable the controllers we use for children of the root cgroup
+ *
+ * Only needs to happen once per runtime invocation, however many containers it starts.
+ */
+void enable_cgroup_controllers(void) {
+    CgroupHandle root;
+    
+    if (cgroup_open_root(&root) != 0) {
+        return;
+    }
+    
+    // Enable controllers in parent cgroup (may already be enabled, that's fine)
+    // This is needed before child cgroups can use these controllers. One write per
+    // controller, so a missing one (e.g. no io controller) doesn't block the rest
+    const char* controllers[] = { "+cpu", "+memory", "+cpuset", "+io", "+pids" };
+    for (size_t i = 0; i < sizeof(controllers) / sizeof(controllers[0]); i++) {
+        if (cgroup_write(&root, "cgroup.subtree_control", controllers[i]) != 0) {
+            // This might fail if already enabled or if we lack permissions - not critical
+            // We'll try to set limits anyway
+        }
+    }
+    cgroup_close(&root);
+}
+
+/**
+ * Setup cgroups for resource limits (memory and CPU)
+ *
+ * Cgroups v2 structure:
+ *   /sys/fs/cgroup/minirun-<name>/
+ *     ├── memory.max        (memory limit in bytes)
+ *     ├── cpu.max           (CPU quota: "max period" in microseconds)
+ *     └── cgroup.procs      (PIDs in this cgroup)
+ *
+ * The handle stays open so the child can be cloned straight into the cgroup;
+ * the caller closes it with cgroup_close().
+ *
+ * @param cg     Handle to fill in (dir_fd is -1 if the cgroup can't be used)
+ * @param config Container name (used for cgroup directory) and limits
+ * @return 1 if cgroups set up successfully, 0 if failed (container can still run)
+ */
+int setup_cgroups(CgroupHandle* cg, const ContainerConfig* config) {
+    CgroupLimitSet limits;
+    
+    cg->dir_fd = -1;
+    
+    // Check if cgroups v2 is available
+    if (!cgroups_v2_available()) {
+        trace_event(TRACE_CGROUP_PROBE, ENOENT, config->name, NULL);
+        report(stderr, "⚠️  Cgroups v2 not available on this system\n");
+        report(stderr, "   Container will run without resource limits\n");
+        return 0;
+    }
+    
+    enable_cgroup_controllers();
+    trace_event(TRACE_CGROUP_PROBE, 0, config->name, NULL);
+    
+    // Create cgroup directory
+    if (cgroup_open(cg, config->name) != 0) {
+        trace_event(TRACE_CGROUP_MKDIR, errno, config->name, NULL);
+        report(stderr, "⚠️  Failed to create cgroup directory: %s\n", strerror(errno));
+        report(stderr, "   Try running with sudo or check permissions\n");
+        return 0;
+    }
+    trace_event(TRACE_CGROUP_MKDIR, 0, config->name, NULL);
+    
+    container_limits(&limits, config);
+    int success = cgroup_apply_limits(cg, &limits);
+    trace_event(TRACE_CGROUP_WRITE, success ? 0 : errno, config->name, NULL);
+    
+    // If we successfully set limits, print confirmation
+    if (success) {
+        report(stdout, "✓ Resource limits configured:\n");
+        report(stdout, "  - Memory: %ldMB\n", config->memory_limit / (1024*1024));
+        if (config->memory_high > 0) {
+            report(stdout, "  - Memory throttle: %ldMB\n", config->memory_high / (1024*1024));
+        }
+        report(stdout, "  - CPU: %d%% of one core per %ldus\n", config->cpu_limit, config->cpu_period);
+        if (config->cpuset_cpus != NULL || config->cpuset_mems != NULL) {
+            report(stdout, "  - CPUs: %s, memory nodes: %s\n",
+                   config->cpuset_cpus ? config->cpuset_cpus : "all",
+                   config->cpuset_mems ? config->cpuset_mems : "all");
+        }
+        for (int i = 0; i < config->io_max_count; i++) {
+            report(stdout, "  - IO: %s\n", config->io_max[i]);
+        }
+        if (config->pids_max > 0) {
+            report(stdout, "  - Processes: %ld\n", config->pids_max);
+        }
+        report(stdout, "  - Cgroup: %s\n\n", cg->path);
+    }
+    
+    return success;
+}
+
+/**
+ * Cleanup cgroups after container stops
+ *
+ * Removes the cgroup directory. This will fail if processes are still in the cgroup,
+ * which is fine - kernel will clean up when all processes exit. A pooled cgroup
+ * is drained and reset by the pool reaper and stays for the next container.
+ *
+ * @param container_name Name of container
+ */
+void cleanup_cgroups(const char* container_name) {
+    char cgroup_path[512];
+
+    int slot = cgroup_pool_size > 0 ? cgroup_pool_lookup(container_name) : -1;
+    if (slot >= 0) {
+        cgroup_pool_release(slot);
+        return;
     }
     
-    // Validate that container is ready to user
-    printf("Container ready! You can now run commands inside.\n\n");
-    
-    // Run bash by replacing current program
-    execl("/bin/bash", "bash", "-c", config->command, NULL);
-    
+    snprintf(cgroup_path, sizeof(cgroup_path), "%s/minirun-%s", cgroup_root, container_name);
+    
+    // Try to remove cgroup directory
+    // This may fail if processes still exist in the cgroup, which is okay
+    if (rmdir(cgroup_path) != 0 && errno != ENOENT) {
+        // ENOENT means directory doesn't exist (already cleaned up or never created)
+        // Other errors we can ignore - kernel will clean up eventually
+    }
+}
+
+/*
+ * Warm cgroup pool
+ *
+ * mkdir() and rmdir() under /sys/fs/cgroup run under the kernel's global cgroup
+ * mutex, so a host churning through short-lived containers serializes on it.
+ * With --cgroup-pool N, cgroup_open() hands out minirun-pool-0 .. minirun-pool-
+ * (N-1) instead. Each is created once, reconfigured for every container that
+ * uses it, and cleanup_cgroups() resets it rather than removing it.
+ *
+ * Slots are shared by every runtime on the host through run-state files:
+ * CGROUP_POOL_DIR/pool-<n> is claimed with an exclusive flock() and holds
+ * "<container> <runtime pid>" while in use, so tools can map the cgroup back
+ * to its container. The lock dies with its process, so a crashed runtime never
+ * leaks a slot; a non-empty file that nobody holds marks a slot whose owner
+ * died before resetting it. The next claimer resets it once it is empty, and
+ * skips it while the orphaned container is still running. When every slot is
+ * busy a container falls back to its own minirun-<name> cgroup.
+ */
+
+/**
+ * Enable the pool for this process
+ *
+ * @param size Number of slots (minirun-pool-0 .. size-1) shared by all runtimes
+ * @return 0 on success, -1 if the run-state directory can't be created
+ */
+int cgroup_pool_init(int size) {
+    mkdir(MINIRUN_RUN_DIR, 0755);  // Parent of the default CGROUP_POOL_DIR
+    if (mkdir(cgroup_pool_dir, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+
+    cgroup_pool = calloc(size, sizeof(CgroupPoolSlot));
+    if (cgroup_pool == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < size; i++) {
+        cgroup_pool[i].lock_fd = -1;
+    }
+    cgroup_pool_size = size;
+    return 0;
+}
+
+/**
+ * Find the slot this process claimed for a container
+ *
+ * @return Slot number, or -1 if the container has none
+ */
+int cgroup_pool_lookup(const char* container_name) {
+    for (int i = 0; i < cgroup_pool_size; i++) {
+        if (cgroup_pool[i].lock_fd != -1 && strcmp(cgroup_pool[i].name, container_name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Open the cgroup of a container that another runtime started
+ *
+ * That is its own minirun-<name> or, failing that, the pool slot whose
+ * run-state file names it and whose runtime is still alive. Works whether or
+ * not this process has the pool enabled, and any pool size.
+ *
+ * @param cg             Handle to fill in
+ * @param container_name Name of container
+ * @return 0 on success, -1 if no cgroup was found (errno ENOENT) or can't be opened
+ */
+int cgroup_open_existing(CgroupHandle* cg, const char* container_name) {
+    snprintf(cg->path, sizeof(cg->path), "%s/minirun-%s", cgroup_root, container_name);
+    cg->dir_fd = open(cg->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (cg->dir_fd >= 0 || errno != ENOENT) {
+        return cg->dir_fd >= 0 ? 0 : -1;
+    }
+
+    DIR* dir = opendir(cgroup_pool_dir);
+    struct dirent* entry;
+    int slot = -1;
+    while (dir != NULL && slot == -1 && (entry = readdir(dir)) != NULL) {
+        char path[PATH_MAX];
+        char line[512];
+        int n;
+        if (sscanf(entry->d_name, "pool-%d", &n) != 1) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", cgroup_pool_dir, entry->d_name);
+        FILE* f = fopen(path, "re");
+        if (f == NULL) {
+            continue;
+        }
+        // "<container> <runtime pid>"; the name may itself contain spaces
+        if (fgets(line, sizeof(line), f) != NULL) {
+            char* sep = strrchr(line, ' ');
+            if (sep != NULL) {
+                *sep = '\0';
+                pid_t owner = atoi(sep + 1);
+                if (strcmp(line, container_name) == 0 && owner > 0 && (kill(owner, 0) == 0 || errno == EPERM)) {
+                    slot = n;
+                }
+            }
+        }
+        fclose(f);
+    }
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    if (slot == -1) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    snprintf(cg->path, sizeof(cg->path), "%s/minirun-pool-%d", cgroup_root, slot);
+    cg->dir_fd = open(cg->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return cg->dir_fd >= 0 ? 0 : -1;
+}
+
+/**
+ * Kill everything left in a cgroup (cgroup.kill, or SIGKILL per PID before 5.14)
+ */
+static void cgroup_kill_all(const CgroupHandle* cg) {
+    if (cgroup_write(cg, "cgroup.kill", "1") == 0) {
+        return;
+    }
+
+    int fd = openat(cg->dir_fd, "cgroup.procs", O_RDONLY | O_CLOEXEC);
+    FILE* procs = fd == -1 ? NULL : fdopen(fd, "r");
+    if (procs == NULL) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+    int pid;
+    while (fscanf(procs, "%d", &pid) == 1) {
+        kill(pid, SIGKILL);
+    }
+    fclose(procs);
+}
+
+/**
+ * Reaper: empty a pooled cgroup and put its limits back to the defaults
+ *
+ * Kills whatever is still in cgroup.procs, waits up to CGROUP_DRAIN_MS for
+ * cgroup.events to report "populated 0", then resets every knob that
+ * container_limits() may have set, so the next container only gets its own.
+ *
+ * @param slot           Slot number
+ * @param kill_leftovers 1 after our container exited, 0 for a slot another
+ *                       runtime left behind (its container may still be running)
+ * @return 0 once the cgroup is empty and reset, -1 if it is still populated
+ */
+int cgroup_pool_reset(int slot, int kill_leftovers) {
+    CgroupHandle cg;
+
+    snprintf(cg.path, sizeof(cg.path), "%s/minirun-pool-%d", cgroup_root, slot);
+    cg.dir_fd = open(cg.path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (cg.dir_fd == -1) {
+        return errno == ENOENT ? 0 : -1;  // Never created: nothing to reset
+    }
+
+    // cgroup.events raises POLLPRI whenever "populated" changes
+    int events_fd = openat(cg.dir_fd, "cgroup.events", O_RDONLY | O_CLOEXEC);
+    int drained = events_fd == -1;
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int killed = 0; !drained; killed = 1) {
+        char buf[256];
+        ssize_t n = pread(events_fd, buf, sizeof(buf) - 1, 0);
+        if (n < 0) {
+            break;
+        }
+        buf[n] = '\0';
+        if (strstr(buf, "populated 0") != NULL) {
+            drained = 1;
+            break;
+        }
+        if (!kill_leftovers) {
+            break;  // Another runtime's container is still running in it
+        }
+        if (!killed) {
+            cgroup_kill_all(&cg);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long waited_ms = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+        if (waited_ms >= CGROUP_DRAIN_MS) {
+            break;
+        }
+        struct pollfd pfd = { .fd = events_fd, .events = POLLPRI };
+        poll(&pfd, 1, CGROUP_DRAIN_MS - waited_ms);
+    }
+    if (events_fd != -1) {
+        close(events_fd);
+    }
+
+    if (drained) {
+        // Knobs missing because a controller is off are simply skipped
+        static const char* defaults[][2] = {
+            { "memory.high", "max" }, { "memory.max", "max" }, { "cpu.max", "max" },
+            { "pids.max", "max" }, { "cpuset.mems", "\n" }, { "cpuset.cpus", "\n" },
+        };
+        for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+            cgroup_write(&cg, defaults[i][0], defaults[i][1]);
+        }
+
+        // io.max lists only devices with a limit, one "MAJ:MIN key=value ..." line each
+        int fd = openat(cg.dir_fd, "io.max", O_RDONLY | O_CLOEXEC);
+        FILE* io = fd == -1 ? NULL : fdopen(fd, "r");
+        if (io != NULL) {
+            unsigned int major, minor;
+            char line[256];
+            while (fgets(line, sizeof(line), io) != NULL) {
+                if (sscanf(line, "%u:%u", &major, &minor) == 2) {
+                    snprintf(line, sizeof(line), "%u:%u rbps=max wbps=max riops=max wiops=max", major, minor);
+                    cgroup_write(&cg, "io.max", line);
+                }
+            }
+            fclose(io);
+        } else if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    cgroup_close(&cg);
+    return drained ? 0 : -1;
+}
+
+/**
+ * Claim a free slot for a container
+ *
+ * @return Slot number, or -1 if every slot is in use (or the pool is off)
+ */
+int cgroup_pool_claim(const char* container_name) {
+    char path[PATH_MAX];
+
+    // Start somewhere different in every process so concurrent runtimes rarely collide
+    int first = cgroup_pool_size > 0 ? getpid() % cgroup_pool_size : 0;
+    for (int k = 0; k < cgroup_pool_size; k++) {
+        int slot = (first + k) % cgroup_pool_size;
+        if (cgroup_pool[slot].lock_fd != -1) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/pool-%d", cgroup_pool_dir, slot);
+        int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd == -1) {
+            return -1;
+        }
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            close(fd);
+            continue;  // Another runtime's
+        }
+
+        // Left behind by a runtime that died before resetting it
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0 && cgroup_pool_reset(slot, 0) != 0) {
+            close(fd);
+            continue;
+        }
+
+        char* name = strdup(container_name);
+        if (name == NULL || ftruncate(fd, 0) != 0 || dprintf(fd, "%s %d\n", container_name, getpid()) < 0) {
+            free(name);
+            close(fd);
+            return -1;
+        }
+        cgroup_pool[slot].lock_fd = fd;
+        cgroup_pool[slot].name = name;
+        return slot;
+    }
+    return -1;
+}
+
+/**
+ * Reset a container's slot and hand it back to the pool
+ *
+ * A cgroup that could not be drained keeps its owner line, so no other runtime
+ * reuses it until it is empty.
+ */
+void cgroup_pool_release(int slot) {
+    CgroupPoolSlot* s = &cgroup_pool[slot];
+
+    if (cgroup_pool_reset(slot, 1) == 0 && ftruncate(s->lock_fd, 0) != 0) {
+        perror("Failed to release cgroup pool slot");  // The next claimer resets it again
+    }
+    close(s->lock_fd);  // Drops the flock
+    s->lock_fd = -1;
+    free(s->name);
+    s->name = NULL;
+}
+
+/*
+ * Container networking
+ *
+ * --net runs a container in its own network namespace (CLONE_NEWNET). Creating
+ * a veth pair, attaching it to a bridge, moving one end into the namespace and
+ * addressing it is several netlink round trips and device registrations, so
+ * with --net-pool N the pairs exist before any container asks for one:
+ * --net-provision creates the bridge NET_BRIDGE (NET_GATEWAY/NET_PREFIX_LEN)
+ * and mrh<n> / mrc<n> for n < N, mrh<n> attached to the bridge and up.
+ *
+ * Slots are claimed like warm cgroup pool slots: NET_POOL_DIR/veth-<n> is
+ * flock()ed and holds "<container> <runtime pid>" while in use. Before clone()
+ * the runtime claims a slot, looks up mrc<n>'s ifindex and opens a netlink
+ * socket in the host namespace, which the child inherits. The child then does
+ * all of its setup from two sendmsg() calls: one on the host socket moves
+ * mrc<n> into its namespace as eth0 and brings it up, one on a socket of its
+ * own namespace brings lo up and adds NET_SUBNET + 2 + n and the default route
+ * via NET_GATEWAY. Addresses and routes can only be changed from inside the
+ * namespace, hence the second socket. No `ip`, no fork, and no round trip
+ * with the parent.
+ *
+ * The namespace dies with the container and takes mrc<n> (and so mrh<n>)
+ * with it. The runtime that reaped the container re-creates the pair before it
+ * hands the slot back, off any container's start path. A claimer that finds
+ * both ends gone (a runtime died first) re-creates them itself; a slot whose
+ * mrh<n> is still there without mrc<n> belongs to a container that is still
+ * running and is skipped. Without --net-pool, or when every slot is busy, the
+ * container's namespace only has lo.
+ */
+
+/**
+ * Start a new message in a batch (NLM_F_REQUEST | NLM_F_ACK are added)
+ *
+ * @return The message, to add attributes to, or NULL if the batch is full
+ */
+static struct nlmsghdr* nl_msg(NetlinkBatch* b, uint16_t type, uint16_t flags, const void* body, size_t len) {
+    if (b->len + NLMSG_SPACE(len) > sizeof(b->buf)) {
+        return NULL;
+    }
+    struct nlmsghdr* msg = (struct nlmsghdr*)(b->buf + b->len);
+    memset(msg, 0, NLMSG_SPACE(len));
+    msg->nlmsg_len = NLMSG_LENGTH(len);
+    msg->nlmsg_type = type;
+    msg->nlmsg_flags = flags | NLM_F_REQUEST | NLM_F_ACK;
+    msg->nlmsg_seq = b->seq + b->count;
+    memcpy(NLMSG_DATA(msg), body, len);
+    b->len += NLMSG_SPACE(len);
+    b->count++;
+    return msg;
+}
+
+/**
+ * Append an attribute to msg, which must be the last message in the batch
+ *
+ * @return The attribute (for nesting), or NULL if the batch is full
+ */
+static struct rtattr* nl_attr(NetlinkBatch* b, struct nlmsghdr* msg, uint16_t type, const void* data, size_t len) {
+    if (msg == NULL || b->len + RTA_SPACE(len) > sizeof(b->buf)) {
+        return NULL;
+    }
+    struct rtattr* rta = (struct rtattr*)(b->buf + b->len);
+    memset(rta, 0, RTA_SPACE(len));
+    rta->rta_type = type;
+    rta->rta_len = RTA_LENGTH(len);
+    if (len > 0) {
+        memcpy(RTA_DATA(rta), data, len);
+    }
+    b->len += RTA_SPACE(len);
+    msg->nlmsg_len = b->buf + b->len - (char*)msg;
+    return rta;
+}
+
+/**
+ * Close a nested attribute opened with nl_attr(b, msg, type, NULL, 0)
+ */
+static void nl_nest_end(NetlinkBatch* b, struct rtattr* nest) {
+    if (nest != NULL) {
+        nest->rta_len = b->buf + b->len - (char*)nest;
+    }
+}
+
+/**
+ * Send every message of a batch in one sendmsg()
+ */
+static int nl_send(int fd, const NetlinkBatch* b) {
+    if (b->count == 0) {
+        return 0;
+    }
+    return send(fd, b->buf, b->len, 0) == (ssize_t)b->len ? 0 : -1;
+}
+
+/**
+ * Read the ACK of every message nl_send() sent, then empty the batch
+ *
+ * @return 0 if all succeeded, -1 with errno from the first that failed
+ */
+static int nl_wait(int fd, NetlinkBatch* b) {
+    char reply[8192] __attribute__((aligned(NLMSG_ALIGNTO)));
+    int acked = 0;
+    int err = 0;
+
+    while (acked < b->count) {
+        ssize_t n = recv(fd, reply, sizeof(reply), 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            err = errno;
+            break;
+        }
+        for (struct nlmsghdr* msg = (struct nlmsghdr*)reply; NLMSG_OK(msg, n); msg = NLMSG_NEXT(msg, n)) {
+            if (msg->nlmsg_type != NLMSG_ERROR || msg->nlmsg_seq - b->seq >= (uint32_t)b->count) {
+                continue;  // Not one of ours
+            }
+            const struct nlmsgerr* ack = NLMSG_DATA(msg);
+            if (ack->error != 0 && err == 0) {
+                err = -ack->error;
+            }
+            acked++;
+        }
+    }
+
+    b->seq += b->count;
+    b->count = 0;
+    b->len = 0;
+    errno = err;
+    return err == 0 ? 0 : -1;
+}
+
+/**
+ * nl_send() + nl_wait()
+ */
+static int nl_exchange(int fd, NetlinkBatch* b) {
+    if (nl_send(fd, b) != 0) {
+        int saved_errno = errno;
+        b->seq += b->count;
+        b->count = 0;
+        b->len = 0;
+        errno = saved_errno;
+        return -1;
+    }
+    return nl_wait(fd, b);
+}
+
+/**
+ * Batch an RTM_*LINK message for ifindex (0 = a new link, named by IFLA_IFNAME)
+ */
+static struct nlmsghdr* nl_link(NetlinkBatch* b, uint16_t type, uint16_t flags, int ifindex,
+                                unsigned int ifi_flags, unsigned int ifi_change) {
+    struct ifinfomsg ifi = {
+        .ifi_family = AF_UNSPEC, .ifi_index = ifindex, .ifi_flags = ifi_flags, .ifi_change = ifi_change
+    };
+    return nl_msg(b, type, flags, &ifi, sizeof(ifi));
+}
+
+/**
+ * Batch an IPv4 address: addr/prefix_len on ifindex
+ */
+static void nl_add_address(NetlinkBatch* b, int ifindex, uint32_t addr, int prefix_len) {
+    struct ifaddrmsg ifa = {
+        .ifa_family = AF_INET, .ifa_prefixlen = prefix_len, .ifa_scope = RT_SCOPE_UNIVERSE, .ifa_index = ifindex
+    };
+    uint32_t be_addr = htonl(addr);
+    struct nlmsghdr* msg = nl_msg(b, RTM_NEWADDR, NLM_F_CREATE | NLM_F_REPLACE, &ifa, sizeof(ifa));
+    nl_attr(b, msg, IFA_LOCAL, &be_addr, sizeof(be_addr));
+    nl_attr(b, msg, IFA_ADDRESS, &be_addr, sizeof(be_addr));
+}
+
+/**
+ * Batch the creation of slot's pair, mrh<n> attached to the bridge and up
+ *
+ * @return 0, or -1 if the batch has no room left for it
+ */
+static int nl_add_pair(NetlinkBatch* b, int slot, int bridge_index) {
+    char host[IFNAMSIZ], peer[IFNAMSIZ];
+    snprintf(host, sizeof(host), NET_HOST_PREFIX "%d", slot);
+    snprintf(peer, sizeof(peer), NET_PEER_PREFIX "%d", slot);
+    uint32_t master = bridge_index;
+    if (sizeof(b->buf) - b->len < NETLINK_PAIR_SPACE) {
+        return -1;
+    }
+
+    struct nlmsghdr* msg = nl_link(b, RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL, 0, IFF_UP, IFF_UP);
+    nl_attr(b, msg, IFLA_IFNAME, host, strlen(host) + 1);
+    nl_attr(b, msg, IFLA_MASTER, &master, sizeof(master));
+    struct rtattr* linkinfo = nl_attr(b, msg, IFLA_LINKINFO, NULL, 0);
+    nl_attr(b, msg, IFLA_INFO_KIND, "veth", strlen("veth"));
+    struct rtattr* data = nl_attr(b, msg, IFLA_INFO_DATA, NULL, 0);
+    struct rtattr* peer_info = nl_attr(b, msg, VETH_INFO_PEER, NULL, 0);
+    struct ifinfomsg peer_ifi = { .ifi_family = AF_UNSPEC };
+    memcpy(b->buf + b->len, &peer_ifi, sizeof(peer_ifi));  // The peer's own ifinfomsg
+    b->len += NLMSG_ALIGN(sizeof(peer_ifi));
+    nl_attr(b, msg, IFLA_IFNAME, peer, strlen(peer) + 1);
+    nl_nest_end(b, peer_info);
+    nl_nest_end(b, data);
+    nl_nest_end(b, linkinfo);
+    return 0;
+}
+
+/**
+ * Open a NETLINK_ROUTE socket in the current network namespace
+ */
+static int nl_open(void) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd == -1) {
+        return -1;
+    }
+    struct sockaddr_nl local = { .nl_family = AF_NETLINK };
+    if (bind(fd, (struct sockaddr*)&local, sizeof(local)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Interface index of name, looked up with an ioctl on any socket fd (0 = no such link)
+ */
+static int net_ifindex(int fd, const char* name) {
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", name);
+    return ioctl(fd, SIOCGIFINDEX, &ifr) == 0 ? ifr.ifr_ifindex : 0;
+}
+
+/**
+ * Enable the veth pool for this process
+ *
+ * @param size Number of slots (mrh<n>/mrc<n>, n < size) shared by all runtimes
+ * @return 0 on success, -1 if the run-state directory can't be created
+ */
+int net_pool_init(int size) {
+    mkdir(MINIRUN_RUN_DIR, 0755);  // Parent of the default NET_POOL_DIR
+    if (mkdir(net_pool_dir, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+
+    net_pool = calloc(size, sizeof(NetPoolSlot));
+    if (net_pool == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < size; i++) {
+        net_pool[i].lock_fd = -1;
+    }
+    net_pool_size = size;
+    return 0;
+}
+
+/**
+ * Create the bridge and every missing pair of the pool (--net-provision)
+ *
+ * Slots in use are left alone. Everything after the bridge goes out in as few
+ * sendmsg() calls as the batch buffer allows.
+ *
+ * @return 0 on success, -1 on failure (message printed)
+ */
+int net_pool_provision(void) {
+    NetlinkBatch b = { .seq = 1 };
+    int fd = nl_open();
+    if (fd == -1) {
+        perror("netlink socket failed");
+        return -1;
+    }
+
+    int bridge = net_ifindex(fd, NET_BRIDGE);
+    if (bridge == 0) {
+        struct nlmsghdr* msg = nl_link(&b, RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL, 0, IFF_UP, IFF_UP);
+        nl_attr(&b, msg, IFLA_IFNAME, NET_BRIDGE, strlen(NET_BRIDGE) + 1);
+        struct rtattr* linkinfo = nl_attr(&b, msg, IFLA_LINKINFO, NULL, 0);
+        nl_attr(&b, msg, IFLA_INFO_KIND, "bridge", strlen("bridge"));
+        nl_nest_end(&b, linkinfo);
+        if (nl_exchange(fd, &b) != 0 || (bridge = net_ifindex(fd, NET_BRIDGE)) == 0) {
+            fprintf(stderr, "Cannot create bridge %s: %s\n", NET_BRIDGE, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+    nl_add_address(&b, bridge, NET_GATEWAY, NET_PREFIX_LEN);
+
+    int created = 0;
+    for (int slot = 0; slot < net_pool_size; slot++) {
+        char host[IFNAMSIZ], peer[IFNAMSIZ];
+        snprintf(host, sizeof(host), NET_HOST_PREFIX "%d", slot);
+        snprintf(peer, sizeof(peer), NET_PEER_PREFIX "%d", slot);
+        if (net_ifindex(fd, host) != 0) {
+            continue;  // Ready, or its container is running
+        }
+
+        // A full batch goes out before the next pair is added
+        if (nl_add_pair(&b, slot, bridge) != 0 && (nl_exchange(fd, &b) != 0 || nl_add_pair(&b, slot, bridge) != 0)) {
+            break;
+        }
+        created++;
+    }
+    int ok = nl_exchange(fd, &b) == 0;
+    if (!ok) {
+        fprintf(stderr, "Cannot provision the veth pool: %s\n", strerror(errno));
+    }
+    close(fd);
+    if (ok) {
+        printf("✓ %s up, %d/%d veth pairs created\n", NET_BRIDGE, created, net_pool_size);
+    }
+    return ok ? 0 : -1;
+}
+
+/**
+ * Delete (if still there) and re-create slot's pair
+ *
+ * @return 0 on success, -1 on failure (the next claimer of the slot retries)
+ */
+static int net_pool_refill(int fd, int slot) {
+    NetlinkBatch b = { .seq = 1 };
+    char host[IFNAMSIZ];
+    snprintf(host, sizeof(host), NET_HOST_PREFIX "%d", slot);
+
+    int bridge = net_ifindex(fd, NET_BRIDGE);
+    if (bridge == 0) {
+        errno = ENODEV;
+        return -1;
+    }
+    // The old pair goes away with the container's namespace, but maybe not yet
+    int stale = net_ifindex(fd, host);
+    if (stale != 0) {
+        nl_link(&b, RTM_DELLINK, 0, stale, 0, 0);
+        if (nl_exchange(fd, &b) != 0 && errno != ENODEV) {
+            return -1;
+        }
+    }
+    nl_add_pair(&b, slot, bridge);
+    return nl_exchange(fd, &b);
+}
+
+/**
+ * Find the slot this process claimed for a container
+ *
+ * @return Slot number, or -1 if the container has none
+ */
+int net_pool_lookup(const char* container_name) {
+    for (int i = 0; i < net_pool_size; i++) {
+        if (net_pool[i].lock_fd != -1 && strcmp(net_pool[i].name, container_name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Claim a free slot whose mrc<n> is on the host, ready to be moved
+ *
+ * @param fd      Host netlink socket (for the ifindex lookup and re-creating pairs)
+ * @param ifindex Set to mrc<n>'s index
+ * @return Slot number, or -1 if every slot is in use (or the pool is off)
+ */
+int net_pool_claim(const char* container_name, int fd, int* ifindex) {
+    char path[PATH_MAX];
+
+    int first = net_pool_size > 0 ? getpid() % net_pool_size : 0;
+    for (int k = 0; k < net_pool_size; k++) {
+        int slot = (first + k) % net_pool_size;
+        if (net_pool[slot].lock_fd != -1) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/veth-%d", net_pool_dir, slot);
+        int lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lock_fd == -1) {
+            return -1;
+        }
+        if (flock(lock_fd, LOCK_EX | LOCK_NB) != 0) {
+            close(lock_fd);
+            continue;  // Another runtime's
+        }
+
+        char host[IFNAMSIZ], peer[IFNAMSIZ];
+        snprintf(host, sizeof(host), NET_HOST_PREFIX "%d", slot);
+        snprintf(peer, sizeof(peer), NET_PEER_PREFIX "%d", slot);
+        *ifindex = net_ifindex(fd, peer);
+        if (*ifindex == 0) {
+            // mrh<n> without mrc<n>: an orphaned container of a dead runtime still has it
+            if (net_ifindex(fd, host) != 0 || net_pool_refill(fd, slot) != 0 ||
+                (*ifindex = net_ifindex(fd, peer)) == 0) {
+                close(lock_fd);
+                continue;
+            }
+        }
+
+        char* name = strdup(container_name);
+        if (name == NULL || ftruncate(lock_fd, 0) != 0 || dprintf(lock_fd, "%s %d\n", container_name, getpid()) < 0) {
+            free(name);
+            close(lock_fd);
+            return -1;
+        }
+        net_pool[slot].lock_fd = lock_fd;
+        net_pool[slot].name = name;
+        return slot;
+    }
+    return -1;
+}
+
+/**
+ * Re-create a reaped container's pair and hand the slot back to the pool
+ */
+void net_pool_release(int slot) {
+    NetPoolSlot* s = &net_pool[slot];
+
+    int fd = nl_open();
+    if (fd == -1 || net_pool_refill(fd, slot) != 0) {
+        perror("Failed to re-create veth pair");  // The next claimer does it
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+    if (ftruncate(s->lock_fd, 0) != 0) {
+        perror("Failed to release veth pool slot");
+    }
+    close(s->lock_fd);  // Drops the flock
+    s->lock_fd = -1;
+    free(s->name);
+    s->name = NULL;
+}
+
+/**
+ * Parent side of --net, right before clone(): claim a slot and open the host
+ * netlink socket the child moves mrc<n> with
+ *
+ * Sets config->net_slot, net_ifindex and net_fd (-1 / 0 / -1 without a slot,
+ * in which case the container only gets lo).
+ */
+void net_prepare(ContainerConfig* config) {
+    config->net_slot = -1;
+    config->net_ifindex = 0;
+    config->net_fd = -1;
+    if (net_pool_size == 0) {
+        return;
+    }
+
+    int fd = nl_open();
+    int slot = fd == -1 ? -1 : net_pool_claim(config->name, fd, &config->net_ifindex);
+    if (slot == -1) {
+        report(stderr, "⚠️  No veth pool slot for %s, running with loopback only\n", config->name);
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+    config->net_slot = slot;
+    config->net_fd = fd;
+}
+
+/**
+ * Child side of --net, in the new namespace: eth0 from the claimed slot, lo up
+ *
+ * @return 0 on success, -1 with errno from the first step that failed
+ */
+int net_configure(const ContainerConfig* config) {
+    NetlinkBatch host = { .seq = 1 };
+    NetlinkBatch own = { .seq = 1 };
+    int err = 0;
+
+    if (config->net_fd != -1) {
+        // Move, rename and bring up in one message; the ifindex is kept in an empty namespace
+        uint32_t pid = getpid();  // Looked up in the sender's PID namespace, where we are 1
+        struct nlmsghdr* msg = nl_link(&host, RTM_NEWLINK, 0, config->net_ifindex, IFF_UP, IFF_UP);
+        nl_attr(&host, msg, IFLA_NET_NS_PID, &pid, sizeof(pid));
+        nl_attr(&host, msg, IFLA_IFNAME, NET_CONTAINER_IFNAME, strlen(NET_CONTAINER_IFNAME) + 1);
+        if (nl_send(config->net_fd, &host) != 0) {
+            return -1;
+        }
+    }
+
+    // rtnetlink handles a message before sendmsg() returns, so eth0 is here now
+    int fd = nl_open();
+    if (fd == -1) {
+        return -1;
+    }
+    nl_link(&own, RTM_NEWLINK, 0, 1, IFF_UP, IFF_UP);  // lo is always ifindex 1
+    if (config->net_fd != -1) {
+        uint32_t addr = NET_SUBNET + 2 + config->net_slot;
+        uint32_t gateway = htonl(NET_GATEWAY);
+        uint32_t oif = config->net_ifindex;
+        nl_add_address(&own, config->net_ifindex, addr, NET_PREFIX_LEN);
+
+        struct rtmsg rtm = {
+            .rtm_family = AF_INET, .rtm_table = RT_TABLE_MAIN, .rtm_protocol = RTPROT_BOOT,
+            .rtm_scope = RT_SCOPE_UNIVERSE, .rtm_type = RTN_UNICAST
+        };
+        struct nlmsghdr* msg = nl_msg(&own, RTM_NEWROUTE, NLM_F_CREATE | NLM_F_REPLACE, &rtm, sizeof(rtm));
+        nl_attr(&own, msg, RTA_GATEWAY, &gateway, sizeof(gateway));
+        nl_attr(&own, msg, RTA_OIF, &oif, sizeof(oif));
+    }
+    if (nl_send(fd, &own) != 0) {
+        err = errno;
+        own.count = 0;  // Nothing to wait for
+    }
+
+    if (config->net_fd != -1 && nl_wait(config->net_fd, &host) != 0 && err == 0) {
+        err = errno;
+    }
+    if (own.count > 0 && nl_wait(fd, &own) != 0 && err == 0) {
+        err = errno;
+    }
+    close(fd);
+    errno = err;
+    return err == 0 ? 0 : -1;
+}
+
+/**
+ * Give a container's veth slot back after it stopped
+ *
+ * @param container_name Name of container
+ */
+void cleanup_network(const char* container_name) {
+    int slot = net_pool_size > 0 ? net_pool_lookup(container_name) : -1;
+    if (slot >= 0) {
+        net_pool_release(slot);
+    }
+}
+
+/*
+ * Syscall filtering
+ *
+ * --seccomp PROFILE runs the container's command under a seccomp-BPF filter.
+ * A profile is a text file of "<action> <syscall>..." lines:
+ *
+ *   # Refuse what a container never needs, allow the rest
+ *   default allow
+ *   errno mount umount2 pivot_root ptrace bpf
+ *   kill kexec_load reboot
+ *
+ * The actions are allow, log (allowed, and logged by the kernel), errno (the
+ * call fails with EPERM), errno=N (fails with errno N) and kill (the container
+ * process is killed). "default <action>" covers every syscall the profile
+ * doesn't list, allow without such a line. A syscall listed twice gets its
+ * last action. Syscalls are named as on x86_64; numbers work everywhere.
+ * Comments start with '#'.
+ *
+ * Compiling is paid once per profile, not per start. The program is stored in
+ * SECCOMP_CACHE_DIR/<hash>.bpf, where hash is FNV-1a of the filter format,
+ * the architecture and the profile text, which the file also holds. A start
+ * reads the profile, hashes it and loads the program from that file, so only a
+ * new or edited profile is compiled. The runtime does this before clone(),
+ * once per distinct profile (all replicas of a batch share it). The child's
+ * part is a single seccomp(SECCOMP_SET_MODE_FILTER) call, just before
+ * execl(). The cache directory and files are root-only, as the kernel runs
+ * whatever program is in them.
+ *
+ * The program first kills any syscall of a foreign architecture (and refuses
+ * x32 ones on x86_64, which would bypass the numbers). It then finds the
+ * action by binary search over the ranges of syscall numbers that share one:
+ * a few compares per syscall however long the profile is, not one per listed
+ * syscall (tests/bench/bench_seccomp.c). The filter applies from the exec on,
+ * so the profile must allow execve and whatever the command needs.
+ */
+
+#if defined(__x86_64__)
+// Index = x86_64 syscall number (arch/x86/entry/syscalls/syscall_64.tbl)
+static const char* const syscall_names[] = {
+    "read", "write", "open", "close", "stat", "fstat", "lstat", "poll", "lseek", "mmap", "mprotect",
+    "munmap", "brk", "rt_sigaction", "rt_sigprocmask", "rt_sigreturn", "ioctl", "pread64",
+    "pwrite64", "readv", "writev", "access", "pipe", "select", "sched_yield", "mremap", "msync",
+    "mincore", "madvise", "shmget", "shmat", "shmctl", "dup", "dup2", "pause", "nanosleep",
+    "getitimer", "alarm", "setitimer", "getpid", "sendfile", "socket", "connect", "accept",
+    "sendto", "recvfrom", "sendmsg", "recvmsg", "shutdown", "bind", "listen", "getsockname",
+    "getpeername", "socketpair", "setsockopt", "getsockopt", "clone", "fork", "vfork", "execve",
+    "exit", "wait4", "kill", "uname", "semget", "semop", "semctl", "shmdt", "msgget", "msgsnd",
+    "msgrcv", "msgctl", "fcntl", "flock", "fsync", "fdatasync", "truncate", "ftruncate", "getdents",
+    "getcwd", "chdir", "fchdir", "rename", "mkdir", "rmdir", "creat", "link", "unlink", "symlink",
+    "readlink", "chmod", "fchmod", "chown", "fchown", "lchown", "umask", "gettimeofday",
+    "getrlimit", "getrusage", "sysinfo", "times", "ptrace", "getuid", "syslog", "getgid", "setuid",
+    "setgid", "geteuid", "getegid", "setpgid", "getppid", "getpgrp", "setsid", "setreuid",
+    "setregid", "getgroups", "setgroups", "setresuid", "getresuid", "setresgid", "getresgid",
+    "getpgid", "setfsuid", "setfsgid", "getsid", "capget", "capset", "rt_sigpending",
+    "rt_sigtimedwait", "rt_sigqueueinfo", "rt_sigsuspend", "sigaltstack", "utime", "mknod",
+    "uselib", "personality", "ustat", "statfs", "fstatfs", "sysfs", "getpriority", "setpriority",
+    "sched_setparam", "sched_getparam", "sched_setscheduler", "sched_getscheduler",
+    "sched_get_priority_max", "sched_get_priority_min", "sched_rr_get_interval", "mlock", "munlock",
+    "mlockall", "munlockall", "vhangup", "modify_ldt", "pivot_root", "_sysctl", "prctl",
+    "arch_prctl", "adjtimex", "setrlimit", "chroot", "sync", "acct", "settimeofday", "mount",
+    "umount2", "swapon", "swapoff", "reboot", "sethostname", "setdomainname", "iopl", "ioperm",
+    "create_module", "init_module", "delete_module", "get_kernel_syms", "query_module", "quotactl",
+    "nfsservctl", "getpmsg", "putpmsg", "afs_syscall", "tuxcall", "security", "gettid", "readahead",
+    "setxattr", "lsetxattr", "fsetxattr", "getxattr", "lgetxattr", "fgetxattr", "listxattr",
+    "llistxattr", "flistxattr", "removexattr", "lremovexattr", "fremovexattr", "tkill", "time",
+    "futex", "sched_setaffinity", "sched_getaffinity", "set_thread_area", "io_setup", "io_destroy",
+    "io_getevents", "io_submit", "io_cancel", "get_thread_area", "lookup_dcookie", "epoll_create",
+    "epoll_ctl_old", "epoll_wait_old", "remap_file_pages", "getdents64", "set_tid_address",
+    "restart_syscall", "semtimedop", "fadvise64", "timer_create", "timer_settime", "timer_gettime",
+    "timer_getoverrun", "timer_delete", "clock_settime", "clock_gettime", "clock_getres",
+    "clock_nanosleep", "exit_group", "epoll_wait", "epoll_ctl", "tgkill", "utimes", "vserver",
+    "mbind", "set_mempolicy", "get_mempolicy", "mq_open", "mq_unlink", "mq_timedsend",
+    "mq_timedreceive", "mq_notify", "mq_getsetattr", "kexec_load", "waitid", "add_key",
+    "request_key", "keyctl", "ioprio_set", "ioprio_get", "inotify_init", "inotify_add_watch",
+    "inotify_rm_watch", "migrate_pages", "openat", "mkdirat", "mknodat", "fchownat", "futimesat",
+    "newfstatat", "unlinkat", "renameat", "linkat", "symlinkat", "readlinkat", "fchmodat",
+    "faccessat", "pselect6", "ppoll", "unshare", "set_robust_list", "get_robust_list", "splice",
+    "tee", "sync_file_range", "vmsplice", "move_pages", "utimensat", "epoll_pwait", "signalfd",
+    "timerfd_create", "eventfd", "fallocate", "timerfd_settime", "timerfd_gettime", "accept4",
+    "signalfd4", "eventfd2", "epoll_create1", "dup3", "pipe2", "inotify_init1", "preadv", "pwritev",
+    "rt_tgsigqueueinfo", "perf_event_open", "recvmmsg", "fanotify_init", "fanotify_mark",
+    "prlimit64", "name_to_handle_at", "open_by_handle_at", "clock_adjtime", "syncfs", "sendmmsg",
+    "setns", "getcpu", "process_vm_readv", "process_vm_writev", "kcmp", "finit_module",
+    "sched_setattr", "sched_getattr", "renameat2", "seccomp", "getrandom", "memfd_create",
+    "kexec_file_load", "bpf", "execveat", "userfaultfd", "membarrier", "mlock2", "copy_file_range",
+    "preadv2", "pwritev2", "pkey_mprotect", "pkey_alloc", "pkey_free", "statx", "io_pgetevents",
+    "rseq",
+    [424] = "pidfd_send_signal", "io_uring_setup", "io_uring_enter", "io_uring_register",
+    "open_tree", "move_mount", "fsopen", "fsconfig", "fsmount", "fspick", "pidfd_open", "clone3",
+    "close_range", "openat2", "pidfd_getfd", "faccessat2", "process_madvise", "epoll_pwait2",
+    "mount_setattr", "quotactl_fd", "landlock_create_ruleset", "landlock_add_rule",
+    "landlock_restrict_self", "memfd_secret", "process_mrelease", "futex_waitv",
+    "set_mempolicy_home_node", "cachestat", "fchmodat2", "map_shadow_stack", "futex_wake",
+    "futex_wait", "futex_requeue", "statmount", "listmount", "lsm_get_self_attr", "lsm_set_self_attr",
+    "lsm_list_modules", "mseal",
+};
+#else
+static const char* const syscall_names[] = { NULL };  // Profiles give numbers
+#endif
+
+/**
+ * Look up a syscall by name, or parse its number
+ *
+ * @return The syscall number, or -1 if unknown or out of range
+ */
+static long seccomp_syscall_number(const char* name) {
+    char* end;
+    long nr = strtol(name, &end, 10);
+
+    if (end != name && *end == '\0') {
+        return nr >= 0 && nr < SECCOMP_MAX_SYSCALL ? nr : -1;
+    }
+    for (size_t i = 0; i < sizeof(syscall_names) / sizeof(syscall_names[0]); i++) {
+        if (syscall_names[i] != NULL && strcmp(syscall_names[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Parse a profile action (allow, log, errno, errno=N, kill)
+ *
+ * @return 0 with *action set to its SECCOMP_RET_* value, -1 if word is no action
+ */
+static int seccomp_parse_action(const char* word, uint32_t* action) {
+    char* end;
+
+    if (strcmp(word, "allow") == 0) {
+        *action = SECCOMP_RET_ALLOW;
+    } else if (strcmp(word, "log") == 0) {
+        *action = SECCOMP_RET_LOG;
+    } else if (strcmp(word, "kill") == 0) {
+        *action = SECCOMP_RET_KILL_PROCESS;
+    } else if (strcmp(word, "errno") == 0) {
+        *action = SECCOMP_RET_ERRNO | EPERM;
+    } else if (strncmp(word, "errno=", 6) == 0) {
+        long err = strtol(word + 6, &end, 10);
+        if (end == word + 6 || *end != '\0' || err < 1 || err > 4095) {
+            return -1;
+        }
+        *action = SECCOMP_RET_ERRNO | (uint32_t)err;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Emit the search over ranges [lo, hi): a compare and a jump per level, a
+ * return per range. JA takes a 32-bit offset, so no program is too long to
+ * reach its upper half (JGE/JEQ offsets are 8-bit).
+ */
+static void seccomp_emit_search(struct sock_filter* prog, int* len, const uint32_t* start,
+                                const uint32_t* action, int lo, int hi) {
+    if (hi - lo == 1) {
+        prog[(*len)++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, action[lo]);
+        return;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    // nr >= start[mid]: fall through to the jump to the upper half, else skip it
+    prog[(*len)++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, start[mid], 0, 1);
+    int jump = (*len)++;
+    seccomp_emit_search(prog, len, start, action, lo, mid);
+    prog[jump] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JA, *len - jump - 1, 0, 0);
+    seccomp_emit_search(prog, len, start, action, mid, hi);
+}
+
+/**
+ * Compile a profile into a seccomp-BPF program
+ *
+ * @param text    Profile text, NUL-terminated
+ * @param source  Where it came from, for messages
+ * @param filter  Set to the malloc()ed program
+ * @return Number of instructions, or -1 on a malformed profile (message printed)
+ */
+int seccomp_compile(const char* text, const char* source, struct sock_filter** filter) {
+    uint32_t actions[SECCOMP_MAX_SYSCALL];
+    unsigned char listed[SECCOMP_MAX_SYSCALL] = { 0 };
+    uint32_t fallback = SECCOMP_RET_ALLOW;
+    char* copy = strdup(text);
+    int line_no = 0;
+
+    if (copy == NULL) {
+        perror("strdup failed");
+        return -1;
+    }
+    for (char* line = copy; line != NULL; ) {
+        char* next = strchr(line, '\n');
+        if (next != NULL) {
+            *next++ = '\0';
+        }
+        line_no++;
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        char* save;
+        char* word = strtok_r(line, " \t\r", &save);
+        uint32_t action;
+        if (word == NULL) {
+            line = next;
+            continue;
+        }
+        if (strcmp(word, "default") == 0) {
+            word = strtok_r(NULL, " \t\r", &save);
+            if (word == NULL || seccomp_parse_action(word, &fallback) != 0 ||
+                strtok_r(NULL, " \t\r", &save) != NULL) {
+                fprintf(stderr, "%s:%d: expected \"default <action>\"\n", source, line_no);
+                free(copy);
+                return -1;
+            }
+        } else if (seccomp_parse_action(word, &action) != 0) {
+            fprintf(stderr, "%s:%d: unknown action '%s' (allow, log, errno, errno=N, kill)\n",
+                    source, line_no, word);
+            free(copy);
+            return -1;
+        } else {
+            while ((word = strtok_r(NULL, " \t\r", &save)) != NULL) {
+                long nr = seccomp_syscall_number(word);
+                if (nr < 0) {
+                    fprintf(stderr, "%s:%d: unknown syscall '%s'\n", source, line_no, word);
+                    free(copy);
+                    return -1;
+                }
+                actions[nr] = action;
+                listed[nr] = 1;
+            }
+        }
+        line = next;
+    }
+    free(copy);
+
+    // Ranges of consecutive numbers with one action; numbers past the table get the default
+    uint32_t start[SECCOMP_MAX_SYSCALL + 1];
+    uint32_t action[SECCOMP_MAX_SYSCALL + 1];
+    int ranges = 0;
+    for (int nr = 0; nr <= SECCOMP_MAX_SYSCALL; nr++) {
+        uint32_t a = nr < SECCOMP_MAX_SYSCALL && listed[nr] ? actions[nr] : fallback;
+        if (ranges == 0 || action[ranges - 1] != a) {
+            start[ranges] = nr;
+            action[ranges++] = a;
+        }
+    }
+
+    struct sock_filter* prog = malloc((8 + 3 * ranges) * sizeof(struct sock_filter));
+    int len = 0;
+    if (prog == NULL) {
+        perror("malloc failed");
+        return -1;
+    }
+    prog[len++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch));
+    prog[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_AUDIT_ARCH, 1, 0);
+    prog[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS);
+    prog[len++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr));
+#if defined(__x86_64__)
+    prog[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, SECCOMP_X32_SYSCALL_BIT, 0, 1);
+    prog[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | ENOSYS);
+#endif
+    seccomp_emit_search(prog, &len, start, action, 0, ranges);
+
+    *filter = prog;
+    return len;
+}
+
+// FNV-1a of the filter format, the architecture and the profile: the name of its cache file
+static uint64_t seccomp_hash(const char* text, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint32_t arch = SECCOMP_AUDIT_ARCH;
+    const unsigned char* parts[3] = { (const unsigned char*)SECCOMP_CACHE_MAGIC,
+                                      (const unsigned char*)&arch, (const unsigned char*)text };
+    size_t lens[3] = { sizeof(SECCOMP_CACHE_MAGIC), sizeof(arch), len };
+
+    for (int p = 0; p < 3; p++) {
+        for (size_t i = 0; i < lens[p]; i++) {
+            hash = (hash ^ parts[p][i]) * 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+/**
+ * Load a cached program compiled from exactly this profile text
+ *
+ * @return Number of instructions (*filter malloc()ed), or -1 if there is none
+ */
+static int seccomp_cache_read(const char* path, uint64_t hash, const char* text, size_t text_len,
+                              struct sock_filter** filter) {
+    SeccompCacheHeader hdr;
+    struct stat st;
+    int count = -1;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1) {
+        return -1;
+    }
+    // Only trust files nobody else could have written
+    if (fstat(fd, &st) == 0 && st.st_uid == geteuid() && (st.st_mode & 022) == 0 &&
+        read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+        memcmp(hdr.magic, SECCOMP_CACHE_MAGIC, sizeof(hdr.magic)) == 0 && hdr.hash == hash &&
+        hdr.count > 0 && hdr.count <= BPF_MAXINSNS && hdr.text_len == text_len &&
+        (size_t)st.st_size == sizeof(hdr) + hdr.count * sizeof(struct sock_filter) + text_len) {
+        size_t body = st.st_size - sizeof(hdr);
+        char* buf = malloc(body);
+        if (buf != NULL && read(fd, buf, body) == (ssize_t)body &&
+            memcmp(buf + hdr.count * sizeof(struct sock_filter), text, text_len) == 0) {
+            *filter = (struct sock_filter*)buf;  // The profile copy after the program goes with it
+            count = hdr.count;
+        } else {
+            free(buf);
+        }
+    }
+    close(fd);
+    return count;
+}
+
+// Store a compiled program (best effort: without it the next start compiles again)
+static void seccomp_cache_write(const char* path, uint64_t hash, const struct sock_filter* filter, int count,
+                                const char* text, size_t text_len) {
+    SeccompCacheHeader hdr = { .hash = hash, .count = count, .text_len = text_len };
+    char tmp[PATH_MAX];
+
+    memcpy(hdr.magic, SECCOMP_CACHE_MAGIC, sizeof(hdr.magic));
+    mkdir(MINIRUN_RUN_DIR, 0755);  // Parent of the default SECCOMP_CACHE_DIR
+    mkdir(seccomp_cache_dir, 0700);
+    if (snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid()) >= (int)sizeof(tmp)) {
+        return;
+    }
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        return;
+    }
+
+    struct iovec iov[3] = {
+        { .iov_base = &hdr, .iov_len = sizeof(hdr) },
+        { .iov_base = (void*)filter, .iov_len = count * sizeof(struct sock_filter) },
+        { .iov_base = (void*)text, .iov_len = text_len },
+    };
+    ssize_t total = iov[0].iov_len + iov[1].iov_len + iov[2].iov_len;
+    int written = writev(fd, iov, 3) == total;
+    // Renamed into place complete, so concurrent runtimes never read half a program
+    if (close(fd) != 0 || !written || rename(tmp, path) != 0) {
+        unlink(tmp);
+    }
+}
+
+/**
+ * Get the compiled filter of a profile: already loaded, from the cache, or compiled now
+ *
+ * @param profile_path Profile file (--seccomp)
+ * @return The program, valid for the life of the process, or NULL on error (message printed)
+ */
+const struct sock_fprog* seccomp_load(const char* profile_path) {
+    SeccompProfile* slot = NULL;
+
+    for (int i = 0; i < SECCOMP_MAX_PROFILES; i++) {
+        if (seccomp_profiles[i].path == NULL) {
+            slot = slot != NULL ? slot : &seccomp_profiles[i];
+        } else if (strcmp(seccomp_profiles[i].path, profile_path) == 0) {
+            return &seccomp_profiles[i].prog;
+        }
+    }
+    if (slot == NULL) {
+        fprintf(stderr, "At most %d different --seccomp profiles per runtime\n", SECCOMP_MAX_PROFILES);
+        errno = E2BIG;
+        return NULL;
+    }
+
+    // The hash needs the whole text; profiles are small, one read()
+    char* text = malloc(SECCOMP_PROFILE_MAX + 1);
+    int fd = open(profile_path, O_RDONLY | O_CLOEXEC);
+    ssize_t len = fd == -1 || text == NULL ? -1 : read(fd, text, SECCOMP_PROFILE_MAX + 1);
+    int saved_errno = errno;
+    if (fd != -1) {
+        close(fd);
+    }
+    if (len < 0 || len > SECCOMP_PROFILE_MAX) {
+        fprintf(stderr, "Cannot read seccomp profile %s: %s\n", profile_path,
+                len < 0 ? strerror(saved_errno) : "larger than 64K");
+        free(text);
+        errno = len < 0 ? saved_errno : EFBIG;
+        return NULL;
+    }
+    text[len] = '\0';
+
+    uint64_t hash = seccomp_hash(text, len);
+    char cache_path[PATH_MAX];
+    snprintf(cache_path, sizeof(cache_path), "%s/%016llx.bpf", seccomp_cache_dir, (unsigned long long)hash);
+    struct sock_filter* filter = NULL;
+    int count = seccomp_cache_read(cache_path, hash, text, len, &filter);
+    if (count < 0) {
+        count = seccomp_compile(text, profile_path, &filter);
+        if (count < 0) {
+            free(text);
+            errno = EINVAL;
+            return NULL;
+        }
+        seccomp_cache_write(cache_path, hash, filter, count, text, len);
+    }
+    free(text);
+
+    slot->path = strdup(profile_path);
+    slot->prog.len = count;
+    slot->prog.filter = filter;
+    return &slot->prog;
+}
+
+/**
+ * Apply a filter to this process (in the child, right before exec)
+ *
+ * @return 0 on success, -1 with errno set
+ */
+int seccomp_install(const struct sock_fprog* prog) {
+    if (syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER, 0, prog) == 0) {
+        return 0;
+    }
+    if (errno != EACCES) {
+        return -1;
+    }
+    // Without CAP_SYS_ADMIN the kernel only takes a filter once setuid can't undo it
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) {
+        return -1;
+    }
+    return syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER, 0, prog) == 0 ? 0 : -1;
+}
+
+/**
+ * Format the cgroup limits a container config asks for
+ *
+ * memory.high sits below memory.max: above it the kernel throttles and reclaims
+ * the cgroup instead of OOM-killing it, and memory.events counts each breach.
+ * cpuset.mems is written after cpuset.cpus so both end up in the same cpuset.
+ * Unset optional limits are left at the kernel default (inherit / "max").
+ */
+void container_limits(CgroupLimitSet* set, const ContainerConfig* config) {
+    cgroup_limits_init(set, config->memory_limit, config->cpu_limit, config->cpu_period);
+    container_optional_limits(set, config);
+}
+
+/**
+ * Add the limits a container only gets when they are given (memory.high,
+ * cpuset, io.max, pids.max)
+ *
+ * An empty cpuset list is written as a blank line, which makes the cgroup use
+ * its parent's CPUs or nodes again.
+ */
+void container_optional_limits(CgroupLimitSet* set, const ContainerConfig* config) {
+    if (config->memory_high > 0) {
+        cgroup_limits_add(set, "memory.high", "%ld", config->memory_high);
+    }
+    if (config->cpuset_cpus != NULL) {
+        cgroup_limits_add(set, "cpuset.cpus", "%s\n", config->cpuset_cpus);
+    }
+    if (config->cpuset_mems != NULL) {
+        cgroup_limits_add(set, "cpuset.mems", "%s\n", config->cpuset_mems);
+    }
+    // io.max takes one device per write
+    for (int i = 0; i < config->io_max_count; i++) {
+        cgroup_limits_add(set, "io.max", "%s", config->io_max[i]);
+    }
+    if (config->pids_max > 0) {
+        cgroup_limits_add(set, "pids.max", "%ld", config->pids_max);
+    }
+}
+
+/**
+ * Check that a container name is safe as a path component
+ *
+ * Names become the cgroup minirun-<name>, <log-dir>/<name>.ring, run-state and
+ * restore work directories, so "../x" or "a/b" would reach outside them. The
+ * rule is the one ./minirun and the orchestrator apply: a letter or digit, then
+ * letters, digits, '_', '.' and '-'.
+ *
+ * @return 1 if valid, 0 otherwise
+ */
+int valid_container_name(const char* name) {
+    if (!isalnum((unsigned char)name[0])) {
+        return 0;
+    }
+    for (const char* c = name; *c != '\0'; c++) {
+        if (!isalnum((unsigned char)*c) && *c != '_' && *c != '.' && *c != '-') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Check that a config's limits are ones the kernel will accept
+ *
+ * @return 0 if valid, -1 otherwise (error printed)
+ */
+int validate_limits(const ContainerConfig* config) {
+    long quota = (long)config->cpu_limit * config->cpu_period / 100;
+    size_t max_value = sizeof(((CgroupLimitSet*)0)->value[0]);
+
+    if (config->memory_high >= config->memory_limit) {
+        fprintf(stderr, "--memory-high must be below the %ldMB memory limit\n",
+                config->memory_limit / (1024*1024));
+        return -1;
+    }
+    if (config->cpu_period < CPU_PERIOD_MIN || config->cpu_period > CPU_PERIOD_MAX) {
+        fprintf(stderr, "--cpu-period must be between %d and %d microseconds\n",
+                CPU_PERIOD_MIN, CPU_PERIOD_MAX);
+        return -1;
+    }
+    if (quota < CPU_PERIOD_MIN) {
+        fprintf(stderr, "--cpu %d%% of a %ldus period is below the %dus minimum quota\n",
+                config->cpu_limit, config->cpu_period, CPU_PERIOD_MIN);
+        return -1;
+    }
+
+    // Values are stored in a CgroupLimitSet; reject what would be truncated
+    const char* lists[] = { config->cpuset_cpus, config->cpuset_mems };
+    for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+        if (lists[i] != NULL && strlen(lists[i]) >= max_value) {
+            fprintf(stderr, "cpuset list too long: %s\n", lists[i]);
+            return -1;
+        }
+    }
+    for (int i = 0; i < config->io_max_count; i++) {
+        unsigned int major, minor;
+        if (sscanf(config->io_max[i], "%u:%u ", &major, &minor) != 2 ||
+            strchr(config->io_max[i], '=') == NULL || strlen(config->io_max[i]) >= max_value) {
+            fprintf(stderr, "Invalid --io-max line (want \"MAJ:MIN key=value ...\"): %s\n", config->io_max[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Apply one per-container command-line option (limits, --log-dir, --log-size, --net,
+ * --seccomp, --exec, --init)
+ *
+ * Shared by main() and --supervise spec lines, which use the same option names.
+ *
+ * @param opt    Option character from long_options
+ * @param arg    Option argument (must outlive config)
+ * @param config Config to update
+ * @return 0 if applied, -1 if the value is invalid (error printed), 1 if opt
+ *         is not a per-container option
+ */
+int parse_container_option(int opt, const char* arg, ContainerConfig* config) {
+    char* end;
+
+    switch (opt) {
+        case 'm':
+            config->memory_limit = parse_size(arg);
+            if (config->memory_limit <= 0) {
+                fprintf(stderr, "Invalid --memory size: %s\n", arg);
+                return -1;
+            }
+            break;
+        case 'H':
+            config->memory_high = parse_size(arg);
+            if (config->memory_high <= 0) {
+                fprintf(stderr, "Invalid --memory-high size: %s\n", arg);
+                return -1;
+            }
+            break;
+        case 'c':
+            config->cpu_limit = strtol(arg, &end, 10);
+            if (*end != '\0' || config->cpu_limit < 1) {
+                fprintf(stderr, "Invalid --cpu percentage: %s\n", arg);
+                return -1;
+            }
+            break;
+        case 'p':
+            config->cpu_period = strtol(arg, &end, 10);
+            if (*end != '\0') {
+                fprintf(stderr, "Invalid --cpu-period: %s\n", arg);
+                return -1;
+            }
+            break;
+        case 'U':
+            config->cpuset_cpus = arg;
+            break;
+        case 'N':
+            config->cpuset_mems = arg;
+            break;
+        case 'i':
+            if (config->io_max_count == CGROUP_MAX_IO) {
+                fprintf(stderr, "At most %d --io-max lines\n", CGROUP_MAX_IO);
+                return -1;
+            }
+            config->io_max[config->io_max_count++] = arg;
+            break;
+        case 'x':
+            config->pids_max = strtol(arg, &end, 10);
+            if (*end != '\0' || config->pids_max < 1) {
+                fprintf(stderr, "Invalid --pids-max: %s\n", arg);
+                return -1;
+            }
+            break;
+        case 'L':
+            config->log_dir = arg;
+            break;
+        case 'n':
+            config->net = 1;
+            break;
+        case 's':
+            config->seccomp_profile = arg;
+            break;
+        case 'e':
+            config->direct_exec = 1;
+            break;
+        case 'j':
+            config->init = 1;
+            break;
+        case 'Z':
+            config->log_size = parse_size(arg);
+            if (config->log_size < LOG_RING_MIN_SIZE || config->log_size > LOG_RING_MAX_SIZE) {
+                fprintf(stderr, "--log-size must be between 4K and 1G: %s\n", arg);
+                return -1;
+            }
+            break;
+        default:
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * Parse a byte count with an optional K/M/G suffix (powers of 1024)
+ *
+ * @return The size in bytes, or -1 if str is not a valid size
+ */
+long parse_size(const char* str) {
+    char* end;
+    errno = 0;
+    long value = strtol(str, &end, 10);
+    if (errno != 0 || end == str || value < 0) {
+        return -1;
+    }
+
+    int shift = 0;
+    switch (*end) {
+        case 'k': case 'K': shift = 10; end++; break;
+        case 'm': case 'M': shift = 20; end++; break;
+        case 'g': case 'G': shift = 30; end++; break;
+    }
+    if (*end != '\0' || value > (LONG_MAX >> shift)) {
+        return -1;
+    }
+    return value << shift;
+}
+
+/**
+ * Resolve a rootfs argument to a directory
+ *
+ * "sha256:<hex>" refers to an image built by ./minirun image and is looked up
+ * as <image_store>/rootfs/<hex>. Image trees are hardlinks into the shared blob
+ * store, so they are only ever used as a read-only overlay lower layer.
+ * Anything else is a plain directory path and is returned unchanged.
+ *
+ * @param ref          Rootfs argument from the command line
+ * @param image_store  Image store directory (NULL if not configured)
+ * @param rootfs_flags ROOTFS_* bits the container will run with
+ * @param buf          Storage for the resolved path
+ * @param len          Size of buf
+ * @return Directory to use as rootfs, or NULL (error printed)
+ */
+char* resolve_rootfs(char* ref, const char* image_store, int rootfs_flags, char* buf, size_t len) {
+    struct stat st;
+    
+    if (strncmp(ref, IMAGE_REF_PREFIX, strlen(IMAGE_REF_PREFIX)) != 0) {
+        return ref;
+    }
+    
+    const char* digest = ref + strlen(IMAGE_REF_PREFIX);
+    if (strlen(digest) != IMAGE_DIGEST_LEN || strspn(digest, "0123456789abcdef") != IMAGE_DIGEST_LEN) {
+        fprintf(stderr, "Invalid image reference: %s\n", ref);
+        return NULL;
+    }
+    if (image_store == NULL) {
+        fprintf(stderr, "Image reference %s needs --image-store or MINIRUN_IMAGE_STORE\n", ref);
+        return NULL;
+    }
+    if (!(rootfs_flags & ROOTFS_OVERLAY)) {
+        fprintf(stderr, "--no-overlay would let the container modify image %s\n", ref);
+        return NULL;
+    }
+    
+    snprintf(buf, len, "%s/rootfs/%s", image_store, digest);
+    if (stat(buf, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "Image %s not found in %s\n", ref, image_store);
+        return NULL;
+    }
+    
+    return buf;
+}
+
+/**
+ * Mount a copy-on-write view of rootfs_path inside our mount namespace
+ *
+ * Overlay layout:
+ *   lowerdir = rootfs_path        (read-only, shared by every container)
+ *              with layer_dir on top of it, if given (a checkpoint's saved upper)
+ *   upperdir = tmpfs or DIR/upper (this container's writes)
+ *   workdir  = next to upperdir   (overlayfs needs it on the same filesystem)
+ *   merged   = OVERLAY_SCRATCH_DIR/merged
+ *
+ * The tmpfs is mounted over OVERLAY_SCRATCH_DIR in this namespace only, so the
+ * host never sees it and it disappears with the last process in the container.
+ * Because the lower layer is one directory, libc/bash pages stay shared in the
+ * page cache and a fresh root costs two mounts rather than a copy.
+ *
+ * The caller must already have made / private (see enter_rootfs()).
+ *
+ * @param rootfs_path Shared lower layer
+ * @param layer_dir   Read-only layer between rootfs_path and the upper, or NULL
+ * @param upper_dir   Directory to keep writes in, or NULL for a throwaway tmpfs
+ * @param merged      Receives the path to switch into
+ * @param merged_len  Size of merged
+ * @return 0 on success, -1 on failure (errno set)
+ */
+int mount_overlay_root(const char* rootfs_path, const char* layer_dir, const char* upper_dir,
+                       char* merged, size_t merged_len) {
+    char lower[PATH_MAX];
+    char layer[PATH_MAX];
+    char upper[PATH_MAX];
+    char work[PATH_MAX];
+    char options[4 * PATH_MAX + 64];
+    
+    if (realpath(rootfs_path, lower) == NULL || (layer_dir != NULL && realpath(layer_dir, layer) == NULL)) {
+        return -1;
+    }
+    
+    if ((mkdir(MINIRUN_RUN_DIR, 0755) != 0 && errno != EEXIST)
+        || (mkdir(OVERLAY_SCRATCH_DIR, 0755) != 0 && errno != EEXIST)) {
+        return -1;
+    }
+    if (mount("tmpfs", OVERLAY_SCRATCH_DIR, "tmpfs", 0, "mode=0755") != 0) {
+        return -1;
+    }
+    
+    if (upper_dir != NULL) {
+        char base[PATH_MAX];
+        if ((mkdir(upper_dir, 0755) != 0 && errno != EEXIST) || realpath(upper_dir, base) == NULL) {
+            return -1;
+        }
+        if (snprintf(upper, sizeof(upper), "%s/upper", base) >= (int)sizeof(upper)
+            || snprintf(work, sizeof(work), "%s/work", base) >= (int)sizeof(work)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+    } else {
+        snprintf(upper, sizeof(upper), "%s/upper", OVERLAY_SCRATCH_DIR);
+        snprintf(work, sizeof(work), "%s/work", OVERLAY_SCRATCH_DIR);
+    }
+    snprintf(merged, merged_len, "%s/merged", OVERLAY_SCRATCH_DIR);
+    
+    if ((mkdir(upper, 0755) != 0 && errno != EEXIST)
+        || (mkdir(work, 0755) != 0 && errno != EEXIST)
+        || mkdir(merged, 0755) != 0) {
+        return -1;
+    }
+    
+    // ',' and ':' are separators in the option string
+    if (strpbrk(lower, ",:") || strpbrk(upper, ",:") || (layer_dir != NULL && strpbrk(layer, ",:"))) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    // Lower layers are listed top first
+    if (layer_dir != NULL) {
+        snprintf(options, sizeof(options), "lowerdir=%s:%s,upperdir=%s,workdir=%s", layer, lower, upper, work);
+    } else {
+        snprintf(options, sizeof(options), "lowerdir=%s,upperdir=%s,workdir=%s", lower, upper, work);
+    }
+    return mount("overlay", merged, "overlay", 0, options);
+}
+
+/**
+ * Make new_root the root of this mount namespace and drop the host tree
+ *
+ * Unlike chroot(), which leaves every host mount in the namespace (and keeps
+ * receiving the host's mount events), this leaves only the container root:
+ *   1. bind new_root onto itself      (pivot_root needs a mount point)
+ *   2. pivot_root(".", ".")           (old root is stacked under the new one)
+ *   3. umount2(".", MNT_DETACH)       (lazily detach the old root and its mounts)
+ *
+ * @param new_root Directory that becomes /
+ * @return 0 on success, -1 if the pivot could not be done (errno set, namespace
+ *         untouched, chroot() still possible), -2 if the old root could not be
+ *         detached after pivoting (the host tree is still reachable: fatal)
+ */
+int pivot_into_root(const char* new_root) {
+    if (mount(new_root, new_root, NULL, MS_BIND | MS_REC, NULL) != 0) {
+        return -1;
+    }
+    if (chdir(new_root) != 0) {
+        return -1;
+    }
+    if (syscall(SYS_pivot_root, ".", ".") != 0) {
+        return -1;
+    }
+    
+    // From here on a failure can't be rolled back
+    if (umount2(".", MNT_DETACH) != 0 || chdir("/") != 0) {
+        return -2;
+    }
+    
+    return 0;
+}
+
+/**
+ * Switch into the container root filesystem and mount /proc
+ *
+ * Shared by the regular child and the pre-cloned zygote children. With
+ * ROOTFS_OVERLAY the container gets its own writable layer on top of rootfs_path;
+ * if the kernel can't do that (no overlayfs, unsupported backing fs) we fall back
+ * to rootfs_path itself, unless writes were meant to persist in upper_dir.
+ * The root is entered with pivot_root() (chroot() with ROOTFS_CHROOT, or when
+ * the pivot isn't possible, e.g. a rootfs on initramfs).
+ *
+ * @param rootfs_path Directory that becomes the container's / (or its lower layer)
+ * @param flags       ROOTFS_* bits
+ * @param upper_dir   Persistent upper directory, or NULL for tmpfs
+ * @return 0 on success, -1 if the root could not be entered
+ */
+int enter_rootfs(const char* rootfs_path, int flags, const char* upper_dir) {
+    char merged[PATH_MAX];
+    const char* root = rootfs_path;
+    int pivoted = 0;
+    
+    // Our mounts must not propagate back into the host's namespace (and host
+    // mount events must not propagate into ours)
+    if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) {
+        perror("Warning: making mounts private failed");
+        flags = (flags & ~ROOTFS_OVERLAY) | ROOTFS_CHROOT;
+    }
+    
+    if (flags & ROOTFS_OVERLAY) {
+        if (mount_overlay_root(rootfs_path, NULL, upper_dir, merged, sizeof(merged)) == 0) {
+            root = merged;
+        } else if (upper_dir != NULL) {
+            fprintf(stderr, "overlay mount failed: %s\n", strerror(errno));
+            return -1;
+        } else {
+            report(stderr, "⚠️  Overlay unavailable (%s), writes go to %s\n", strerror(errno), rootfs_path);
+        }
+    }
+    
+    if (!(flags & ROOTFS_CHROOT)) {
+        int ret = pivot_into_root(root);
+        if (ret == 0) {
+            pivoted = 1;
+        } else if (ret == -2) {
+            perror("detaching old root failed");
+            return -1;
+        } else {
+            report(stderr, "⚠️  pivot_root failed (%s), falling back to chroot\n", strerror(errno));
+        }
+    }
+    
+    // Change root to our rootfs_path so child can't see outside of it
+    if (!pivoted && chroot(root) != 0) {
+        // ERROR: Changing root execution failed
+        perror("chroot failed");
+        return -1;
+    }
+    // Changes directory to myroot as we already set it as the new root
+    if (chdir("/") != 0) {
+        perror("chdir failed");
+        return -1;
+    }
+    trace_event(TRACE_ROOTFS, 0, NULL, NULL);
+
+    // Mount /proc so we can use utilities like 'ps' in the container
+    int proc_err = 0;
+    if (mount("proc", "/proc", "proc", 0, NULL) != 0) {
+        proc_err = errno;
+        perror("Warning: mount /proc failed (ps command may not work)");
+    }
+    trace_event(TRACE_PROC_MOUNT, proc_err, NULL, NULL);
+
+    return 0;
+}
+
+/*
+ * Clone stacks
+ *
+ * The clone() fallback and the zygote need a stack for the child. Stacks are
+ * mmap'd with MAP_STACK | MAP_NORESERVE and a PROT_NONE guard page below them,
+ * so an overflow faults instead of scribbling over the heap, and only the
+ * pages the child actually touches are ever backed by memory. Without CLONE_VM
+ * the child runs on its own copy-on-write copy, so a stack goes back to the
+ * pool's free list as soon as clone() returns and the next spawn reuses the
+ * same mapping: a supervisor starting thousands of containers maps a single
+ * stack instead of allocating (and fragmenting the heap with) one per clone.
+ */
+
+/**
+ * Set the usable size of the pool's stacks (before the first stack_acquire())
+ *
+ * @param pool Pool to configure
+ * @param size Requested bytes, rounded up to whole pages
+ * @return 0 on success, -1 if size is out of range
+ */
+int stack_pool_set_size(StackPool* pool, long size) {
+    long page = sysconf(_SC_PAGESIZE);
+
+    if (size < CHILD_STACK_MIN || size > CHILD_STACK_MAX || pool->mapped > 0) {
+        return -1;
+    }
+    pool->size = (size + page - 1) / page * page;
+    return 0;
+}
+
+/**
+ * Take a stack from the pool, mapping a new one if none is free
+ *
+ * @return Top of the stack (what clone() expects), or NULL with errno set
+ */
+void* stack_acquire(StackPool* pool) {
+    size_t guard = sysconf(_SC_PAGESIZE);
+
+    if (pool->free != NULL) {
+        StackFree* stack = pool->free;
+        pool->free = stack->next;
+        pool->free_count--;
+        return (char*)stack + pool->size;
+    }
+
+    char* map = mmap(NULL, guard + pool->size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | MAP_NORESERVE, -1, 0);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    // Stacks grow down: the lowest page catches an overflow
+    if (mprotect(map, guard, PROT_NONE) != 0) {
+        int saved = errno;
+        munmap(map, guard + pool->size);
+        errno = saved;
+        return NULL;
+    }
+    pool->mapped++;
+    return map + guard + pool->size;
+}
+
+/**
+ * Return a stack to the pool once no child runs on it any more
+ *
+ * Without CLONE_VM that is right after clone() returns; with CLONE_VM it would
+ * be after waitpid(). Beyond STACK_POOL_MAX_FREE free stacks the mapping is released.
+ *
+ * @param pool Pool the stack came from
+ * @param top  Value returned by stack_acquire()
+ */
+void stack_release(StackPool* pool, void* top) {
+    size_t guard = sysconf(_SC_PAGESIZE);
+    StackFree* stack = (StackFree*)((char*)top - pool->size);
+
+    if (pool->free_count >= STACK_POOL_MAX_FREE) {
+        munmap((char*)stack - guard, guard + pool->size);
+        pool->mapped--;
+        return;
+    }
+    // The link lives in the lowest usable word, the last one a child would reach
+    stack->next = pool->free;
+    pool->free = stack;
+    pool->free_count++;
+}
+
+/**
+ * Unmap every free stack (stacks still in use are left alone)
+ */
+void stack_pool_drain(StackPool* pool) {
+    size_t guard = sysconf(_SC_PAGESIZE);
+
+    while (pool->free != NULL) {
+        StackFree* stack = pool->free;
+        pool->free = stack->next;
+        munmap((char*)stack - guard, guard + pool->size);
+        pool->mapped--;
+    }
+    pool->free_count = 0;
+}
+
+/**
+ * Create the container process in new PID and mount namespaces
+ *
+ * Preferred path: clone3() with CLONE_INTO_CGROUP, so the child starts life inside
+ * its cgroup. Limits and accounting then apply from its first instruction and there
+ * is no cgroup.procs write or live-task migration. clone3() is called without a
+ * stack (fork-like, the child continues on a copy of ours) and the child runs
+ * child_function() directly.
+ *
+ * Fallback (kernel < 5.7, no cgroup, or clone3 rejected): classic clone() on a
+ * stack from stack_pool, and the child joins its cgroup through cgroup.procs.
+ *
+ * CLONE_NEWPID: New PID namespace (process will be PID 1)
+ * CLONE_NEWNS: New mount namespace (separate filesystem view)
+ * CLONE_NEWNET: New network namespace (--net only, see net_prepare)
+ * SIGCHLD: Send SIGCHLD to parent when child terminates
+ *
+ * @param config    Container configuration passed to child_function(); config->cgroup
+ *                  (if set) is the cgroup the child is created in
+ * @return Child PID in our namespace, or -1 on failure
+ */
+pid_t spawn_container(ContainerConfig* config) {
+    config->in_cgroup = 0;
+    // Compiled (or read from the cache) once per profile, not once per start
+    if (config->seccomp_profile != NULL && config->seccomp == NULL &&
+        (config->seccomp = seccomp_load(config->seccomp_profile)) == NULL) {
+        return -1;
+    }
+    unsigned long namespaces = CLONE_NEWPID | CLONE_NEWNS;
+    if (config->net) {
+        namespaces |= CLONE_NEWNET;
+        net_prepare(config);
+    }
+    
+    // The child shares our stdio buffers until it execs, flush them first
+    fflush(stdout);
+
+    if (config->cgroup != NULL) {
+        struct minirun_clone_args args;
+        memset(&args, 0, sizeof(args));
+        args.flags = namespaces | CLONE_INTO_CGROUP;
+        args.exit_signal = SIGCHLD;
+        args.cgroup = config->cgroup->dir_fd;
+        
+        pid_t pid = syscall(SYS_clone3, &args, sizeof(args));
+        if (pid == 0) {
+            // Child: already in its cgroup
+            config->in_cgroup = 1;
+            _exit(child_function(config));
+        }
+        if (pid > 0) {
+            if (config->net && config->net_fd != -1) {
+                close(config->net_fd);  // The child's copy is the one that gets used
+            }
+            return pid;
+        }
+        // ENOSYS (< 5.3), E2BIG (< 5.7), EINVAL/EBUSY etc: take the classic path
+    }
+    
+    // The child runs on its own copy of the stack, so it is free again once clone() returns
+    void* stack = stack_acquire(&stack_pool);
+    pid_t pid = stack == NULL ? -1 : clone(
+        child_function,
+        stack,
+        namespaces | SIGCHLD,
+        config
+    );
+    int saved_errno = errno;
+    if (stack != NULL) {
+        stack_release(&stack_pool, stack);
+    }
+    if (config->net && config->net_fd != -1) {
+        close(config->net_fd);
+    }
+    errno = saved_errno;
+    return pid;
+}
+
+// This function is executed only by the child
+// Clone() requires 'void *arg' signature
+int child_function(void* arg) {
+    ContainerConfig* config = (ContainerConfig*)arg;
+    
+    // Steps are recorded in the trace ring instead of printed: stdout may be a
+    // pipe whose buffered banners would be lost or duplicated around exec
+    trace_child_begin(config->name);
+    trace_event(TRACE_CHILD, 0, NULL, NULL);
+
+    // Join the cgroup to apply resource limits
+    // With clone3(CLONE_INTO_CGROUP) we were born inside it; otherwise we write our
+    // PID to cgroup.procs, which moves this process into the cgroup
+    int join_err = 0;
+    if (!config->in_cgroup && (config->cgroup == NULL || cgroup_add_process(config->cgroup, getpid()) != 0)) {
+        join_err = config->cgroup == NULL ? ENOENT : errno;
+        // Cgroup doesn't exist or we lack permissions - container continues without limits
+        report(stderr, "⚠️  Warning: Running without resource limits\n");
+    }
+    trace_event(TRACE_CGROUP_JOIN, join_err, NULL, NULL);
+
+    // Still on the host's /proc and without the parent: the netlink socket does it all
+    if (config->net) {
+        int net_err = net_configure(config) == 0 ? 0 : errno;
+        if (net_err != 0) {
+            report(stderr, "⚠️  Warning: Network setup failed (%s), continuing\n", strerror(net_err));
+        }
+        trace_event(TRACE_NET, net_err, NULL, NULL);
+    }
+    
+    if (enter_rootfs(config->rootfs_path, config->rootfs_flags, config->upper_dir) != 0) {
+        trace_event(TRACE_ROOTFS, errno, NULL, NULL);
+        trace_flush();
+        return 1;
+    }
+    
+    // Let batch workers know which replica they are (e.g. for sharding work)
+    if (config->replica >= 0) {
+        char replica_str[16];
+        snprintf(replica_str, sizeof(replica_str), "%d", config->replica);
+        setenv("MINIRUN_REPLICA", replica_str, 1);
+    }
+    
+    // From here on the command's output goes to the ring pipe, not the runtime's stdio
+    if (config->log_fd != -1) {
+        fflush(stdout);
+        dup2(config->log_fd, STDOUT_FILENO);
+        dup2(config->log_fd, STDERR_FILENO);
+        close(config->log_fd);
+    }
+
+    // With --init we stay PID 1 and the command runs in a child of ours
+    if (config->init) {
+        return run_init(config);
+    }
+    return exec_container(config);
+}
+
+/**
+ * Last steps of a container: install its syscall filter, then exec the command
+ *
+ * With --exec the argv is exec'd as is (execvp(), so a bare program name is
+ * looked up in PATH inside the root). Otherwise bash -c parses the command,
+ * which costs loading bash and its libraries, reading its startup files and
+ * parsing the string, and needs bash in the rootfs at all.
+ *
+ * @return 1 (only returns on failure, message printed)
+ */
+static int exec_container(const ContainerConfig* config) {
+    // From here on every syscall goes through the filter
+    if (config->seccomp != NULL) {
+        int seccomp_err = seccomp_install(config->seccomp) == 0 ? 0 : errno;
+        trace_event(TRACE_SECCOMP, seccomp_err, NULL, NULL);
+        if (seccomp_err != 0) {
+            trace_flush();
+            fprintf(stderr, "seccomp filter failed: %s\n", strerror(seccomp_err));
+            return 1;
+        }
+    }
+
+    // Replace the current program (our copy of the trace ring goes with it)
+    trace_event(TRACE_EXEC, 0, NULL, NULL);
+    trace_flush();
+    if (config->direct_exec) {
+        execvp(config->argv[0], config->argv);
+    } else {
+        execl("/bin/bash", "bash", "-c", config->command, NULL);
+    }
+    
+    // ERROR: execution failed
+    trace_event(TRACE_EXEC, errno, NULL, NULL);
+    trace_flush();
+    perror("exec failed");
+    return 1;
+}
+
+/**
+ * Minimal init (--init): stay PID 1 of the container and run the command as our child
+ *
+ * Without a shell in between, the command itself would be PID 1: nothing
+ * would reap the orphans it leaves behind, and the kernel drops every signal
+ * it has no handler for, so SIGTERM does nothing. The init waits for signals
+ * with all of them blocked, forwards each one to the command and reaps every
+ * child that exits. Once the command has exited, so does the init, with the
+ * command's exit code (128 + signal if it was killed); the kernel then kills
+ * whatever is left in the namespace. The seccomp filter only applies to the
+ * command.
+ *
+ * @return Exit code for the container
+ */
+static int run_init(const ContainerConfig* config) {
+    sigset_t all, old;
+
+    // Events so far go out now, so the command's flush at exec doesn't repeat them
+    trace_flush();
+    sigfillset(&all);
+    sigprocmask(SIG_BLOCK, &all, &old);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        sigprocmask(SIG_SETMASK, &old, NULL);
+        _exit(exec_container(config));
+    }
+    if (pid == -1) {
+        perror("init: fork failed");
+        return 1;
+    }
+    prctl(PR_SET_NAME, "init");  // What ps inside the container shows as PID 1
+
+    for (;;) {
+        int sig = sigwaitinfo(&all, NULL);
+        if (sig == -1) {
+            continue;  // EINTR
+        }
+        if (sig != SIGCHLD) {
+            kill(pid, sig);
+            continue;
+        }
+        int status;
+        pid_t reaped;
+        while ((reaped = waitpid(-1, &status, WNOHANG)) > 0) {
+            if (reaped == pid) {
+                return WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status);
+            }
+        }
+    }
+}
+
+/**
+ * Start configs[0..count) from this process and supervise them until all exit
+ *
+ * Compared to one runtime process per container this probes the cgroup
+ * hierarchy and writes cgroup.subtree_control once, creates every cgroup up
+ * front, recycles one pooled clone stack and supervises all children (exits,
+ * memory pressure, OOM events and log pipes) from one epoll loop.
+ *
+ * @param configs Complete configs (name, rootfs, command, limits)
+ * @param count   Number of containers
+ * @param shared  Limits for every container, formatted once (NULL = each config's own)
+ * @param noun    "replicas" or "containers", for messages
+ * @return Number of containers that failed to start or exited non-zero
+ */
+static int run_containers(ContainerConfig* configs, int count, const CgroupLimitSet* shared, const char* noun) {
+    ContainerWatch* watches = calloc(count, sizeof(ContainerWatch));
+    int started = 0;
+    int failed = 0;
+    
+    if (watches == NULL) {
+        perror("calloc failed");
+        return count;
+    }
+
+    // Each watched container holds a pidfd, up to three cgroup fds and its log pipe
+    struct rlimit nofile;
+    if (getrlimit(RLIMIT_NOFILE, &nofile) == 0 && nofile.rlim_cur < nofile.rlim_max) {
+        nofile.rlim_cur = nofile.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &nofile);
+    }
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    
+    // Probe the hierarchy and enable controllers once for everyone
+    int cgroups_enabled = cgroups_v2_available();
+    if (cgroups_enabled) {
+        enable_cgroup_controllers();
+    } else {
+        fprintf(stderr, "⚠️  Cgroups v2 not available on this system\n");
+        fprintf(stderr, "   %d %s will run without resource limits\n", count, noun);
+    }
+    
+    // Create all cgroups before any child runs
+    int limited = 0;
+    for (int i = 0; i < count && cgroups_enabled; i++) {
+        CgroupLimitSet own;
+        const CgroupLimitSet* limits = shared;
+        if (limits == NULL) {
+            container_limits(&own, &configs[i]);
+            limits = &own;
+        }
+        
+        CgroupHandle cg;
+        configs[i].cgroup = NULL;
+        if (cgroup_open(&cg, configs[i].name) == 0) {
+            if (cgroup_apply_limits(&cg, limits)) {
+                limited++;
+            }
+            cgroup_close(&cg);
+        }
+    }
+    if (cgroups_enabled) {
+        printf("✓ Resource limits configured for %d/%d %s\n\n", limited, count, noun);
+    }
+    
+    // Handles are reopened one at a time; only the watch fds stay open per container
+    for (int i = 0; i < count; i++) {
+        CgroupHandle cg;
+        configs[i].cgroup = NULL;
+        if (cgroups_enabled && cgroup_open(&cg, configs[i].name) == 0) {
+            configs[i].cgroup = &cg;
+        }
+        LogRing ring;
+        int log_read_fd = container_log_open(&configs[i], &ring);
+        pid_t pid = spawn_container(&configs[i]);
+        if (pid != -1) {
+            watch_open(&watches[started], configs[i].name, pid, configs[i].cgroup, inotify_fd);
+        }
+        container_log_attach(&configs[i], pid != -1 ? &watches[started] : NULL, &ring, log_read_fd, pid);
+        if (configs[i].cgroup != NULL) {
+            cgroup_close(&cg);
+            configs[i].cgroup = NULL;  // Points at this loop's stack frame
+        }
+        
+        if (pid == -1) {
+            fprintf(stderr, "clone failed for %s: %s\n", configs[i].name, strerror(errno));
+            cleanup_cgroups(configs[i].name);
+            cleanup_network(configs[i].name);
+            failed++;
+            continue;
+        }
+        started++;
+    }
+    printf("Started %d/%d %s\n", started, count, noun);
+    fflush(stdout);
+    
+    // Reap containers in whatever order they finish, cleaning up each cgroup as we go
+    supervise_containers(watches, started, inotify_fd);
+    for (int i = 0; i < started; i++) {
+        if (!WIFEXITED(watches[i].status) || WEXITSTATUS(watches[i].status) != 0) {
+            failed++;
+        }
+        watch_close(&watches[i]);
+    }
+    if (inotify_fd != -1) {
+        close(inotify_fd);
+    }
+    
+    stack_pool_drain(&stack_pool);
+    free(watches);
+    return failed;
+}
+
+/**
+ * Batch mode: start N identical containers from one runtime invocation
+ *
+ * @param base     Config shared by all replicas (name is used as a prefix)
+ * @param replicas Number of containers to start
+ * @return 0 if every replica started and exited cleanly, 1 otherwise
+ */
+int run_replicas(const ContainerConfig* base, int replicas) {
+    ContainerConfig* configs = calloc(replicas, sizeof(ContainerConfig));
+    char (*names)[128] = calloc(replicas, sizeof(*names));
+
+    if (configs == NULL || names == NULL) {
+        perror("calloc failed");
+        free(configs);
+        free(names);
+        return 1;
+    }
+
+    printf("=== MiniRun Container Runtime (batch) ===\n");
+    printf("Starting %d replicas of: %s\n", replicas, base->name);
+    printf("Root filesystem: %s\n", base->rootfs_path);
+    printf("Command: %s\n\n", base->command);
+    printf("Limits per replica: %ldMB RAM, %d%% CPU\n\n",
+           base->memory_limit / (1024*1024), base->cpu_limit);
+
+    for (int i = 0; i < replicas; i++) {
+        snprintf(names[i], sizeof(names[i]), "%s-%d", base->name, i);
+        configs[i] = *base;
+        configs[i].name = names[i];
+        configs[i].replica = i;
+    }
+
+    // Every replica gets the same limits, so format them once
+    CgroupLimitSet limits;
+    container_limits(&limits, base);
+    int failed = run_containers(configs, replicas, &limits, "replicas");
+
+    printf("\n=== %d/%d replicas of [%s] exited cleanly ===\n",
+           replicas - failed, replicas, base->name);
+    
+    free(configs);
+    free(names);
+    
+    return failed == 0 ? 0 : 1;
+}
+
+/**
+ * Parse one supervisor spec line into a config
+ *
+ * Fields are separated by tabs: any number of "--option=value" (or "--net")
+ * fields (the per-container options of the command line: limits, --log-dir,
+ * --log-size, --net, --seccomp, --exec, --init), then name, rootfs and the
+ * command, which is the rest of the line. With --exec the rest of the line is
+ * the argv, one tab-separated field per argument.
+ *
+ * @param line    Line without its newline; strings in config point into it
+ * @param config  Starts as a copy of the command-line defaults
+ * @return 0 on success, -1 on a malformed line (message printed)
+ */
+static int parse_spec_line(char* line, ContainerConfig* config) {
+    char* field = line;
+    char* fields[2];
+    int nfields = 0;
+
+    while (nfields < 2) {
+        char* tab = strchr(field, '\t');
+        if (tab == NULL) {
+            fprintf(stderr, "Expected [--option=value<TAB>...]name<TAB>rootfs<TAB>command\n");
+            return -1;
+        }
+        *tab = '\0';
+
+        if (strncmp(field, "--", 2) == 0 && nfields == 0) {
+            char* value = strchr(field, '=');
+            const struct option* o = long_options;
+            if (value != NULL) {
+                *value++ = '\0';
+            }
+            while (o->name != NULL && strcmp(o->name, field + 2) != 0) {
+                o++;
+            }
+            // "--flag" for options without an argument, "--option=value" for the rest
+            if (o->name == NULL || (value == NULL) != (o->has_arg == no_argument) ||
+                parse_container_option(o->val, value, config) != 0) {
+                fprintf(stderr, "Unsupported or invalid spec option: %s\n", field);
+                return -1;
+            }
+        } else {
+            fields[nfields++] = field;
+        }
+        field = tab + 1;
+    }
+
+    config->name = fields[0];
+    config->rootfs_path = fields[1];
+    config->command = field;
+    if (*config->name == '\0' || *config->command == '\0') {
+        fprintf(stderr, "Empty name or command\n");
+        return -1;
+    }
+    if (!valid_container_name(config->name)) {
+        fprintf(stderr, "Invalid container name: %s (%s)\n", config->name, CONTAINER_NAME_RULE);
+        return -1;
+    }
+    if (config->direct_exec) {
+        size_t argc = 1;
+        for (char* c = field; (c = strchr(c, '\t')) != NULL; c++) {
+            argc++;
+        }
+        // Freed by run_supervisor() with the line
+        if ((config->argv = calloc(argc + 1, sizeof(char*))) == NULL) {
+            perror("calloc failed");
+            return -1;
+        }
+        for (size_t i = 0; i < argc; i++) {
+            config->argv[i] = strsep(&field, "\t");
+        }
+    }
+    return validate_limits(config);
+}
+
+/**
+ * Supervisor mode: start every container listed in a spec file from one process
+ *
+ * One runtime replaces the N runtime (and sudo) processes that N separate
+ * starts would leave behind. Per container it keeps a ContainerWatch and a few
+ * fds; the epoll loop in supervise_containers() only does work for containers
+ * that have something to report, so supervisor memory and CPU stay nearly
+ * flat as the count grows.
+ *
+ * @param spec_path    Spec file, one container per line (see parse_spec_line), "-" = stdin
+ * @param defaults     Options from the command line, applied before each line's own
+ * @param image_store  For sha256:<digest> rootfs references
+ * @return 0 if every container started and exited cleanly, 1 otherwise
+ */
+int run_supervisor(const char* spec_path, const ContainerConfig* defaults, const char* image_store) {
+    FILE* spec = strcmp(spec_path, "-") == 0 ? stdin : fopen(spec_path, "re");
+    if (spec == NULL) {
+        fprintf(stderr, "Cannot open spec %s: %s\n", spec_path, strerror(errno));
+        return 1;
+    }
+
+    ContainerConfig* configs = NULL;
+    char** lines = NULL;
+    int count = 0;
+    int capacity = 0;
+    int lineno = 0;
+    int ok = 1;
+    char* line = NULL;
+    size_t line_len = 0;
+    ssize_t n;
+
+    while ((n = getline(&line, &line_len, spec)) != -1) {
+        lineno++;
+        if (n > 0 && line[n - 1] == '\n') {
+            line[--n] = '\0';
+        }
+        if (n == 0 || line[0] == '#') {
+            continue;
+        }
+        if (count == MAX_SUPERVISED) {
+            fprintf(stderr, "%s: at most %d containers\n", spec_path, MAX_SUPERVISED);
+            ok = 0;
+            break;
+        }
+        if (count == capacity) {
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            configs = realloc(configs, capacity * sizeof(ContainerConfig));
+            lines = realloc(lines, capacity * sizeof(char*));
+            if (configs == NULL || lines == NULL) {
+                perror("realloc failed");
+                exit(1);
+            }
+        }
+
+        // The config points into the line, which stays allocated until we return
+        lines[count] = line;
+        line = NULL;
+        line_len = 0;
+        configs[count] = *defaults;
+        if (parse_spec_line(lines[count], &configs[count]) != 0) {
+            fprintf(stderr, "%s:%d: invalid container spec\n", spec_path, lineno);
+            free(configs[count].argv);
+            free(lines[count]);
+            ok = 0;
+            break;
+        }
+
+        char rootfs_buf[PATH_MAX];
+        char* rootfs = resolve_rootfs(configs[count].rootfs_path, image_store,
+                                      configs[count].rootfs_flags, rootfs_buf, sizeof(rootfs_buf));
+        if (rootfs == NULL || (rootfs = strdup(rootfs)) == NULL) {
+            fprintf(stderr, "%s:%d: cannot use rootfs %s\n", spec_path, lineno, configs[count].rootfs_path);
+            free(configs[count].argv);
+            free(lines[count]);
+            ok = 0;
+            break;
+        }
+        configs[count].rootfs_path = rootfs;
+        count++;
+    }
+    free(line);
+    if (spec != stdin) {
+        fclose(spec);
+    }
+
+    int failed = 0;
+    if (ok && count == 0) {
+        fprintf(stderr, "%s: no containers\n", spec_path);
+        ok = 0;
+    }
+    if (ok) {
+        printf("=== MiniRun Container Runtime (supervisor) ===\n");
+        printf("Starting %d containers from %s\n\n", count, spec_path);
+        failed = run_containers(configs, count, NULL, "containers");
+        printf("\n=== %d/%d containers exited cleanly ===\n", count - failed, count);
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(configs[i].rootfs_path);
+        free(configs[i].argv);
+        free(lines[i]);
+    }
+    free(configs);
+    free(lines);
+
+    return ok && failed == 0 ? 0 : 1;
+}
+
+/*
+ * Container output
+ *
+ * With --log-dir the child's stdout and stderr are one pipe whose read end the
+ * supervisor drains into <log_dir>/<name>.ring: a LOG_RING_HEADER page followed
+ * by a fixed number of data bytes, mapped MAP_SHARED. read() copies from the
+ * pipe straight into the mapping, so output is never buffered a second time,
+ * and once the ring is full the oldest bytes are overwritten. Memory per
+ * container is capped at the ring size however much the workload prints.
+ *
+ * Readers (the orchestrator's log endpoint) map the file read-only and copy
+ * out [pos, head) without any lock or syscall. The writer never waits for them:
+ * it announces the range it is about to fill in write_end first, and a reader
+ * drops whatever it copied from below write_end - capacity. A container is only
+ * slowed down if the supervisor itself falls behind and the pipe fills up.
+ */
+
+/**
+ * Create a ring file of `capacity` data bytes and map it
+ *
+ * The file is built under a temporary name and renamed into place, so a reader
+ * still mapping the previous run's ring keeps a valid (old) inode instead of
+ * faulting on a truncated file.
+ *
+ * @return 0 on success, -1 on failure (ring->hdr is NULL)
+ */
+int log_ring_open(LogRing* ring, const char* path, size_t capacity) {
+    char tmp[PATH_MAX];
+    memset(ring, 0, sizeof(*ring));
+
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd == -1) {
+        return -1;
+    }
+
+    size_t map_len = LOG_RING_HEADER + capacity;
+    void* map = MAP_FAILED;
+    if (ftruncate(fd, map_len) == 0) {
+        map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        unlink(tmp);
+        return -1;
+    }
+
+    // ftruncate() zero-filled the header, so head and write_end start at 0
+    ring->hdr = map;
+    ring->data = (char*)map + LOG_RING_HEADER;
+    ring->map_len = map_len;
+    ring->hdr->capacity = capacity;
+    memcpy(ring->hdr->magic, LOG_RING_MAGIC, sizeof(LOG_RING_MAGIC));
+
+    if (rename(tmp, path) != 0) {
+        int saved = errno;
+        unlink(tmp);
+        log_ring_close(ring);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Move what the container has written so far from its pipe into the ring
+ *
+ * @param ring Open ring
+ * @param fd   O_NONBLOCK read end of the container's stdout/stderr pipe
+ * @return 1 if the pipe was drained for now, 0 at EOF, -1 on error
+ */
+int log_ring_pump(LogRing* ring, int fd) {
+    LogRingHeader* hdr = ring->hdr;
+
+    for (int i = 0; i < LOG_RING_BURST; i++) {
+        uint64_t head = hdr->head;  // We are the only writer
+        uint64_t offset = head % hdr->capacity;
+        size_t chunk = hdr->capacity - offset;
+        if (chunk > LOG_RING_CHUNK) {
+            chunk = LOG_RING_CHUNK;
+        }
+
+        // Publish the range being overwritten before the kernel starts copying into it
+        __atomic_store_n(&hdr->write_end, head + chunk, __ATOMIC_RELEASE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        ssize_t n = read(fd, ring->data + offset, chunk);
+        if (n > 0) {
+            __atomic_store_n(&hdr->head, head + n, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&hdr->write_end, hdr->head, __ATOMIC_RELEASE);
+
+        if (n == 0) {
+            return 0;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN ? 1 : -1;
+        }
+    }
+    return 1;  // Still more: epoll reports the pipe readable again
+}
+
+/**
+ * Unmap a ring (the file stays for readers)
+ */
+void log_ring_close(LogRing* ring) {
+    if (ring->hdr != NULL) {
+        munmap(ring->hdr, ring->map_len);
+        ring->hdr = NULL;
+    }
+}
+
+/**
+ * Before spawning: create the container's ring and the pipe it will write to
+ *
+ * On success config->log_fd is the write end for child_function() to dup2().
+ * Without --log-dir, or if the ring can't be created (with a warning), the
+ * container keeps our stdout/stderr.
+ *
+ * @return The pipe's read end, or -1 if output is not captured
+ */
+int container_log_open(ContainerConfig* config, LogRing* ring) {
+    char path[PATH_MAX];
+    int fds[2];
+
+    config->log_fd = -1;
+    memset(ring, 0, sizeof(*ring));
+    if (config->log_dir == NULL) {
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s.ring", config->log_dir, config->name);
+    if (log_ring_open(ring, path, config->log_size) != 0) {
+        fprintf(stderr, "⚠️  Cannot create log ring %s: %s (output not captured)\n", path, strerror(errno));
+        return -1;
+    }
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        fprintf(stderr, "⚠️  Cannot create output pipe: %s (output not captured)\n", strerror(errno));
+        log_ring_close(ring);
+        return -1;
+    }
+
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    config->log_fd = fds[1];
+    return fds[0];
+}
+
+/**
+ * After spawning: close our copy of the write end and hand the read end to the watch
+ *
+ * @param w   Watch to drain into, or NULL if the spawn failed (everything is closed)
+ * @param pid spawn_container() result
+ */
+void container_log_attach(ContainerConfig* config, ContainerWatch* w, LogRing* ring, int read_fd, pid_t pid) {
+    if (config->log_fd != -1) {
+        close(config->log_fd);  // Only the child may hold it, or EOF never comes
+        config->log_fd = -1;
+    }
+    if (read_fd == -1) {
+        return;
+    }
+    if (w == NULL || pid == -1) {
+        close(read_fd);
+        log_ring_close(ring);
+        return;
+    }
+    w->log_fd = read_fd;
+    w->log = *ring;
+}
+
+/*
+ * Container supervision
+ *
+ * Instead of blocking in waitpid(), the parent waits in epoll on one pidfd per
+ * container together with the container's cgroup notification sources and
+ * its output pipe:
+ *
+ *   memory.pressure / cpu.pressure  PSI triggers, POLLPRI once the stall
+ *                                   threshold is crossed within the window
+ *   memory.events                   inotify IN_MODIFY whenever the high/max/
+ *                                   oom/oom_kill counters change
+ *
+ * Each notification becomes one JSON line on the event stream (stderr unless
+ * --events is given), usually within milliseconds of the kernel noticing.
+ * There is no sampling interval: the parent sleeps until something happens.
+ * Missing sources (no PSI, no cgroup, old kernel) are skipped, and without a
+ * pidfd the loop degrades to waitpid() with no events.
+ *
+ * Each fd is added to the epoll set once, when supervision starts, and is
+ * dropped by the kernel when it is closed, so one supervisor can hold
+ * thousands of containers without rebuilding a poll array on every wakeup.
+ */
+
+#define MEMORY_EVENT_COUNT  4
+
+// memory.events counters we report, in ContainerWatch.events[] order
+static const char* memory_event_keys[MEMORY_EVENT_COUNT] = { "high", "max", "oom", "oom_kill" };
+
+/**
+ * Write one event as a JSON line: {"time_ms":..,"container":..,"event":..,<detail>}
+ */
+static void emit_event(const char* name, const char* event, const char* fmt, ...) {
+    FILE* out = event_stream != NULL ? event_stream : stderr;
+    struct timespec now;
+    char detail[256];
+    char esc[512];
+    va_list ap;
+
+    // --quiet/--json keep stderr for errors; --events still gets everything
+    if (event_stream == NULL && output_mode != OUTPUT_TEXT) {
+        return;
+    }
+
+    va_start(ap, fmt);
+    vsnprintf(detail, sizeof(detail), fmt, ap);
+    va_end(ap);
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    fprintf(out, "{\"time_ms\":%lld,\"container\":\"%s\",\"event\":\"%s\",%s}\n",
+            (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000, json_escape(name, esc, sizeof(esc)), event, detail);
+    fflush(out);
+}
+
+/**
+ * Open a pressure file and arm a PSI trigger on it (fd polls POLLPRI on breach)
+ */
+static int open_psi_trigger(const CgroupHandle* cg, const char* file, const char* trigger) {
+    int fd = openat(cg->dir_fd, file, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    // The kernel expects the terminating NUL as part of the trigger
+    if (write(fd, trigger, strlen(trigger) + 1) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Read the memory.events counters we report into counts[]
+ */
+static int read_memory_events(int fd, uint64_t* counts) {
+    char buf[512];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+
+    for (char* line = buf; line != NULL && *line != '\0'; ) {
+        char* next = strchr(line, '\n');
+        if (next != NULL) {
+            *next++ = '\0';
+        }
+        char* value = strchr(line, ' ');
+        if (value != NULL) {
+            *value++ = '\0';
+            for (int i = 0; i < MEMORY_EVENT_COUNT; i++) {
+                if (strcmp(line, memory_event_keys[i]) == 0) {
+                    counts[i] = strtoull(value, NULL, 10);
+                }
+            }
+        }
+        line = next;
+    }
+    return 0;
+}
+
+/**
+ * Start watching a container that has just been spawned
+ *
+ * Works with cg == NULL or inotify_fd == -1; the container is then only reaped.
+ *
+ * @param w          Watch to fill in (name must outlive it)
+ * @param name       Container name used in events
+ * @param pid        Container PID from spawn_container()
+ * @param cg         The container's open cgroup, or NULL
+ * @param inotify_fd Shared inotify instance for memory.events, or -1
+ * @return 0 if the exit can be polled, -1 if only waitpid() is possible
+ */
+int watch_open(ContainerWatch* w, const char* name, pid_t pid, const CgroupHandle* cg, int inotify_fd) {
+    memset(w, 0, sizeof(*w));
+    w->name = name;
+    w->pid = pid;
+    w->memory_psi_fd = -1;
+    w->cpu_psi_fd = -1;
+    w->events_fd = -1;
+    w->events_wd = -1;
+    w->log_fd = -1;  // Set afterwards by container_log_attach()
+
+    // pidfd_open() (5.3+) makes the exit pollable alongside the cgroup fds
+    w->pidfd = syscall(SYS_pidfd_open, pid, 0);
+
+    if (cg == NULL) {
+        return w->pidfd == -1 ? -1 : 0;
+    }
+
+    w->memory_psi_fd = open_psi_trigger(cg, "memory.pressure", PSI_MEMORY_TRIGGER);
+    w->cpu_psi_fd = open_psi_trigger(cg, "cpu.pressure", PSI_CPU_TRIGGER);
+
+    w->events_fd = openat(cg->dir_fd, "memory.events", O_RDONLY | O_CLOEXEC);
+    if (w->events_fd != -1 && inotify_fd != -1) {
+        char path[300];
+        snprintf(path, sizeof(path), "%s/memory.events", cg->path);
+        w->events_wd = inotify_add_watch(inotify_fd, path, IN_MODIFY);
+        read_memory_events(w->events_fd, w->events);
+    }
+
+    return w->pidfd == -1 ? -1 : 0;
+}
+
+/**
+ * Close every fd held by a watch (the inotify watch goes away with the cgroup)
+ */
+void watch_close(ContainerWatch* w) {
+    int* fds[] = { &w->pidfd, &w->memory_psi_fd, &w->cpu_psi_fd, &w->events_fd, &w->log_fd };
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (*fds[i] != -1) {
+            close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+    log_ring_close(&w->log);
+}
+
+/**
+ * Drain the container's output pipe into its ring, closing it at EOF
+ */
+static void pump_log(ContainerWatch* w) {
+    if (w->log_fd != -1 && log_ring_pump(&w->log, w->log_fd) <= 0) {
+        close(w->log_fd);
+        w->log_fd = -1;
+    }
+}
+
+/**
+ * Report a PSI trigger firing, with the current avg10 and total stall time
+ */
+static void report_pressure(ContainerWatch* w, int fd, const char* event) {
+    char buf[256];
+    double avg10 = 0;
+    unsigned long long total = 0;
+
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n > 0) {
+        buf[n] = '\0';
+        sscanf(buf, "some avg10=%lf %*s %*s total=%llu", &avg10, &total);
+    }
+    emit_event(w->name, event, "\"avg10\":%.2f,\"total_us\":%llu", avg10, total);
+}
+
+/**
+ * Compare memory.events with the last read and report each counter that moved
+ */
+static void report_memory_events(ContainerWatch* w) {
+    uint64_t counts[MEMORY_EVENT_COUNT];
+    memcpy(counts, w->events, sizeof(counts));
+    if (w->events_fd == -1 || read_memory_events(w->events_fd, counts) != 0) {
+        return;
+    }
+
+    for (int i = 0; i < MEMORY_EVENT_COUNT; i++) {
+        if (counts[i] > w->events[i]) {
+            emit_event(w->name, memory_event_keys[i], "\"count\":%llu,\"delta\":%llu",
+                       (unsigned long long)counts[i], (unsigned long long)(counts[i] - w->events[i]));
+        }
+        w->events[i] = counts[i];
+    }
+}
+
+/**
+ * Reap a container, report its exit and remove its cgroup
+ */
+static void finish_watch(ContainerWatch* w, int status) {
+    // Catch counters that moved after the last inotify event (e.g. the final oom_kill),
+    // and output still in the pipe
+    report_memory_events(w);
+    pump_log(w);
+
+    w->status = status;
+    w->exited = 1;
+    if (WIFEXITED(status)) {
+        emit_event(w->name, "exit", "\"code\":%d", WEXITSTATUS(status));
+    } else {
+        emit_event(w->name, "exit", "\"signal\":%d", WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+    }
+
+    watch_close(w);
+    cleanup_cgroups(w->name);
+    cleanup_network(w->name);
+}
+
+// What an epoll event refers to: (watch index << 2) | source, or the inotify instance
+#define WATCH_PIDFD        0
+#define WATCH_MEMORY_PSI   1
+#define WATCH_CPU_PSI      2
+#define WATCH_LOG          3
+#define WATCH_TAG(i, src)  (((uint64_t)(i) << 2) | (src))
+#define WATCH_INOTIFY      UINT64_MAX
+
+/**
+ * Register one watch fd with the epoll instance (skipped if the fd is -1)
+ */
+static void watch_epoll_add(int epfd, int fd, uint32_t events, uint64_t tag) {
+    if (fd != -1) {
+        struct epoll_event ev = { .events = events, .data.u64 = tag };
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+/**
+ * Reap a container by PID (waitpid fallback for watches without a pidfd)
+ */
+static int finish_by_pid(ContainerWatch* watches, int count, pid_t pid, int status) {
+    for (int i = 0; i < count; i++) {
+        if (!watches[i].exited && watches[i].pid == pid) {
+            finish_watch(&watches[i], status);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Wait for every watched container, reporting events until the last one exits
+ *
+ * Every fd is registered once with epoll, tagged with its watch and source,
+ * and each wakeup only touches the containers whose fds fired, so the cost of
+ * an event does not grow with the number of containers.
+ *
+ * @param watches    Watches from watch_open(); status/exited are filled in
+ * @param count      Number of watches
+ * @param inotify_fd The inotify instance passed to watch_open(), or -1
+ * @return 0 once all containers were reaped, -1 on error
+ */
+int supervise_containers(ContainerWatch* watches, int count, int inotify_fd) {
+    int remaining = 0;
+    int pollable = 1;
+    int capturing = 0;
+    int max_wd = -1;
+
+    for (int i = 0; i < count; i++) {
+        if (!watches[i].exited) {
+            remaining++;
+            pollable &= watches[i].pidfd != -1;
+            capturing |= watches[i].log_fd != -1;
+            if (watches[i].events_wd > max_wd) {
+                max_wd = watches[i].events_wd;
+            }
+        }
+    }
+
+    // Without pidfds an exit can't wake epoll: fall back to plain reaping,
+    // unless output pipes need draining (then epoll with a timeout below)
+    while (!pollable && !capturing && remaining > 0) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("waitpid failed");
+            return -1;
+        }
+        remaining -= finish_by_pid(watches, count, pid, status);
+    }
+    if (remaining == 0) {
+        return 0;
+    }
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    // inotify watch descriptor -> watch index, so memory.events changes are found in O(1)
+    int* wd_owner = malloc((max_wd + 2) * sizeof(int));
+    if (epfd == -1 || wd_owner == NULL) {
+        perror("epoll setup failed");
+        if (epfd != -1) {
+            close(epfd);
+        }
+        free(wd_owner);
+        return -1;
+    }
+    for (int wd = 0; wd <= max_wd; wd++) {
+        wd_owner[wd] = -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        ContainerWatch* w = &watches[i];
+        if (w->exited) {
+            continue;
+        }
+        watch_epoll_add(epfd, w->pidfd, EPOLLIN, WATCH_TAG(i, WATCH_PIDFD));
+        watch_epoll_add(epfd, w->memory_psi_fd, EPOLLPRI, WATCH_TAG(i, WATCH_MEMORY_PSI));
+        watch_epoll_add(epfd, w->cpu_psi_fd, EPOLLPRI, WATCH_TAG(i, WATCH_CPU_PSI));
+        watch_epoll_add(epfd, w->log_fd, EPOLLIN, WATCH_TAG(i, WATCH_LOG));
+        if (w->events_wd >= 0) {
+            wd_owner[w->events_wd] = i;
+        }
+    }
+    watch_epoll_add(epfd, inotify_fd, EPOLLIN, WATCH_INOTIFY);
+
+    struct epoll_event events[64];
+    while (remaining > 0) {
+        // Exits without a pidfd are picked up with WNOHANG on this tick
+        int n = epoll_wait(epfd, events, sizeof(events) / sizeof(events[0]), pollable ? -1 : 100);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait failed");
+            break;  // Leaves remaining > 0
+        }
+
+        for (int e = 0; e < n; e++) {
+            uint64_t tag = events[e].data.u64;
+            uint32_t revents = events[e].events;
+
+            // memory.events changed somewhere: drain the queue, then diff the counters
+            if (tag == WATCH_INOTIFY) {
+                char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+                ssize_t len;
+                while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+                    for (char* p = buf; p < buf + len; ) {
+                        struct inotify_event* ev = (struct inotify_event*)p;
+                        if (ev->wd >= 0 && ev->wd <= max_wd && wd_owner[ev->wd] != -1 &&
+                            !watches[wd_owner[ev->wd]].exited) {
+                            report_memory_events(&watches[wd_owner[ev->wd]]);
+                        }
+                        p += sizeof(struct inotify_event) + ev->len;
+                    }
+                }
+                continue;
+            }
+
+            ContainerWatch* w = &watches[tag >> 2];
+            if (w->exited) {
+                continue;  // Reaped earlier in this batch of events
+            }
+
+            switch (tag & 3) {
+                case WATCH_MEMORY_PSI:
+                case WATCH_CPU_PSI: {
+                    int* fd = (tag & 3) == WATCH_MEMORY_PSI ? &w->memory_psi_fd : &w->cpu_psi_fd;
+                    if (revents & EPOLLPRI) {
+                        report_pressure(w, *fd, (tag & 3) == WATCH_MEMORY_PSI ? "memory_pressure" : "cpu_pressure");
+                    }
+                    // EPOLLERR: the trigger's cgroup is gone, stop watching it
+                    if (revents & EPOLLERR) {
+                        close(*fd);  // Also removes it from the epoll set
+                        *fd = -1;
+                    }
+                    break;
+                }
+                case WATCH_LOG:
+                    // EPOLLHUP: every writer is gone, pump_log() reads the rest and sees EOF
+                    pump_log(w);
+                    break;
+                case WATCH_PIDFD: {
+                    int status;
+                    if (waitpid(w->pid, &status, 0) == w->pid) {
+                        finish_watch(w, status);
+                        remaining--;
+                    }
+                    break;
+                }
+            }
+        }
+
+        if (!pollable) {
+            int status;
+            pid_t pid;
+            while (remaining > 0 && (pid = waitpid(-1, &status, WNOHANG)) > 0) {
+                remaining -= finish_by_pid(watches, count, pid, status);
+            }
+        }
+    }
+
+    free(wd_owner);
+    close(epfd);
+    return remaining == 0 ? 0 : -1;
+}
+
+/*
+ * Live updates
+ *
+ * setup_cgroups() writes a container's limits once as it starts, but every
+ * knob can be rewritten while its tasks run. --update [limits] <name> finds the
+ * cgroup of a running container, whichever runtime started it and whether or
+ * not it is a pool slot (cgroup_open_existing()), and writes only the limits
+ * given, so the others keep their current values. --cpu alone keeps the
+ * current cpu.max period, and --cpu-period alone keeps the current share of a
+ * core. An empty --cpuset-cpus or --cpuset-mems unpins the container.
+ * ./minirun update and PATCH /containers/{name} send the stored limits merged
+ * with the new ones. A memory.max below the current usage makes the kernel
+ * reclaim down to it, and OOM-kill if it can't.
+ *
+ * --pause <name> freezes every task in the cgroup through cgroup.freeze and
+ * --resume <name> thaws it. A paused container keeps its memory, files and
+ * sockets and uses no CPU, and resuming it is a single write instead of a new
+ * start. SIGKILL still ends frozen tasks, other signals wait for the resume.
+ */
+
+/**
+ * Rewrite the limits of a running container
+ *
+ * @param container_name Name of container
+ * @param config         Limits to write (see container_limits())
+ * @param given          UPDATE_* flags: which of memory.max and cpu.max to write
+ * @return 0 on success, -1 if there is no such cgroup or a limit was rejected (error printed)
+ */
+int update_container(const char* container_name, const ContainerConfig* config, int given) {
+    CgroupHandle cg;
+    CgroupLimitSet limits = { .count = 0 };
+
+    if (cgroup_open_existing(&cg, container_name) != 0) {
+        fprintf(stderr, "No cgroup for container %s (is it running?): %s\n", container_name, strerror(errno));
+        return -1;
+    }
+    if (given & UPDATE_MEMORY) {
+        cgroup_limits_add(&limits, "memory.max", "%ld", config->memory_limit);
+    }
+    if (given & (UPDATE_CPU | UPDATE_CPU_PERIOD)) {
+        // The part of cpu.max ("$MAX $PERIOD") that wasn't given is read back
+        char current[64] = "";
+        long quota = -1, period = DEFAULT_CPU_PERIOD;
+        int fd = openat(cg.dir_fd, "cpu.max", O_RDONLY | O_CLOEXEC);
+        if (fd != -1) {
+            ssize_t n = read(fd, current, sizeof(current) - 1);
+            current[n > 0 ? n : 0] = '\0';
+            close(fd);
+        }
+        if (strncmp(current, "max", 3) == 0) {
+            sscanf(current, "max %ld", &period);
+        } else {
+            sscanf(current, "%ld %ld", &quota, &period);
+        }
+
+        long new_period = given & UPDATE_CPU_PERIOD ? config->cpu_period : period;
+        long new_quota = -1;  // Unlimited stays unlimited
+        if (given & UPDATE_CPU) {
+            new_quota = (long)config->cpu_limit * new_period / 100;
+        } else if (quota >= 0) {
+            new_quota = quota * new_period / period;  // Same share of the CPU
+        }
+        if (new_quota >= 0 && new_quota < CPU_PERIOD_MIN) {
+            fprintf(stderr, "cpu.max quota %ldus of a %ldus period is below the %dus minimum\n",
+                    new_quota, new_period, CPU_PERIOD_MIN);
+            cgroup_close(&cg);
+            return -1;
+        }
+        if (new_quota < 0) {
+            cgroup_limits_add(&limits, "cpu.max", "max %ld", new_period);
+        } else {
+            cgroup_limits_add(&limits, "cpu.max", "%ld %ld", new_quota, new_period);
+        }
+    }
+    container_optional_limits(&limits, config);
+    int applied = cgroup_apply_limits(&cg, &limits);
+    cgroup_close(&cg);
+    return applied ? 0 : -1;
+}
+
+/**
+ * Freeze or thaw a running container
+ *
+ * @param container_name Name of container
+ * @param paused         1 to pause, 0 to resume
+ * @return 0 on success, -1 on failure (error printed; a pause that didn't complete is undone)
+ */
+int pause_container(const char* container_name, int paused) {
+    CgroupHandle cg;
+
+    if (cgroup_open_existing(&cg, container_name) != 0) {
+        fprintf(stderr, "No cgroup for container %s (is it running?): %s\n", container_name, strerror(errno));
+        return -1;
+    }
+    int ret = cgroup_freeze(&cg, paused);
+    if (ret != 0) {
+        fprintf(stderr, "Cannot %s %s: %s\n", paused ? "freeze" : "thaw", cg.path, strerror(errno));
+        if (paused) {
+            cgroup_freeze(&cg, 0);
+        }
+    }
+    cgroup_close(&cg);
+    return ret;
+}
+
+/*
+ * Checkpoint and restore
+ *
+ * Most of a typical container's start-up is spent warming up after exec
+ * (caches, JIT, connection pools), not in the runtime. --checkpoint DIR <name>
+ * saves a warmed container once so that copies of it can be started in that
+ * state. It freezes the container's cgroup through cgroup.freeze, so every
+ * task stops at once and nothing changes while it is saved. It then copies
+ * the files the container wrote into DIR/upper, has CRIU dump the process tree
+ * into DIR/images and thaws the cgroup, so the container keeps running.
+ * DIR/stdio records what fds 0-2 of its init were. Only an upper given with
+ * --upper-dir can be copied. The default tmpfs upper went away with the host
+ * tree at pivot_root(), and then only the processes are saved.
+ *
+ * --restore DIR <name> <rootfs> goes through the same path as a normal run:
+ * setup_cgroups() (a warm pool slot with --cgroup-pool), the log ring,
+ * --ready-fd, supervision and cleanup. Only spawn_container() is replaced. A
+ * helper process gets a mount namespace of its own. It mounts the overlay
+ * with DIR/upper as a read-only layer between <rootfs> and a fresh tmpfs
+ * upper, joins the cgroup and execs `criu restore` with that overlay as
+ * --root. All restores of a checkpoint share the rootfs and the saved layer
+ * in the page cache, and only their own writes are private. CRIU detaches from
+ * the restored tree once it runs. The runtime is a child subreaper, so the
+ * tree is reparented to it and supervised like its own child. Pipes and
+ * sockets at fds 0-2 are replaced by the new run's (--inherit-fd). A terminal
+ * makes both sides use --shell-job.
+ *
+ * With --lazy-pages the restored tasks run before their memory is copied back.
+ * A `criu lazy-pages` daemon serves each page from DIR/images the first time
+ * it is touched (userfaultfd) and streams the rest in the background, so the
+ * restore no longer grows with the size of the checkpointed working set.
+ *
+ * Containers with their own network namespace (--net) are refused, because
+ * their eth0 is a veth pool slot that a copy would need a new one of. CRIU_BIN
+ * must be in PATH. Its logs are DIR/images/dump.log and
+ * RESTORE_WORK_DIR/<name>/restore.log (and lazy-pages.log).
+ */
+
+/**
+ * Run a helper program to completion with our stdio
+ *
+ * @param argv Program (looked up in PATH) and its arguments, NULL-terminated
+ * @return Its exit code, or -1 if it could not be started or was killed
+ */
+static int run_tool(char* const argv[]) {
+    int status;
+
+    fflush(stdout);  // The child would flush our buffered banners a second time
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp(argv[0], argv);
+        fprintf(stderr, "Cannot run %s: %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+    if (pid == -1) {
+        return -1;
+    }
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * Whether an fd's /proc link target is a terminal (CRIU's --shell-job case)
+ */
+static int is_terminal_path(const char* target) {
+    return strncmp(target, "/dev/pts/", 9) == 0 || strncmp(target, "/dev/tty", 8) == 0
+           || strcmp(target, "/dev/console") == 0;
+}
+
+/**
+ * Host PID of a container's init: the task in its cgroup that is PID 1 of its own PID namespace
+ *
+ * @return PID, or -1 if there is none (errno ESRCH) or cgroup.procs can't be read
+ */
+static pid_t container_init_pid(const CgroupHandle* cg) {
+    int fd = openat(cg->dir_fd, "cgroup.procs", O_RDONLY | O_CLOEXEC);
+    FILE* procs = fd == -1 ? NULL : fdopen(fd, "r");
+    pid_t init = -1;
+    int pid;
+
+    if (procs == NULL) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+    while (init == -1 && fscanf(procs, "%d", &pid) == 1) {
+        char path[64];
+        char line[256];
+        snprintf(path, sizeof(path), "/proc/%d/status", pid);
+        FILE* status = fopen(path, "re");
+        while (status != NULL && fgets(line, sizeof(line), status) != NULL) {
+            // "NSpid:\t<host pid>\t...\t<pid in its own namespace>"
+            if (strncmp(line, "NSpid:", 6) == 0) {
+                char* last = strrchr(line, '\t');
+                if (last != NULL && last != line + 6 && atoi(last + 1) == 1) {
+                    init = pid;
+                }
+                break;
+            }
+        }
+        if (status != NULL) {
+            fclose(status);
+        }
+    }
+    fclose(procs);
+    if (init == -1) {
+        errno = ESRCH;
+    }
+    return init;
+}
+
+/**
+ * The container's overlay upper, if the host can still reach it
+ *
+ * Taken from the upperdir= option of its root mount in /proc/<pid>/mountinfo.
+ * A --upper-dir is a host path. The default upper was under
+ * OVERLAY_SCRATCH_DIR on a tmpfs that is no longer mounted anywhere.
+ *
+ * @param pid   Container init
+ * @param upper Receives the directory
+ * @param len   Size of upper
+ * @return 0 with upper filled in, -1 if there is no reachable upper
+ */
+static int container_upper_dir(pid_t pid, char* upper, size_t len) {
+    char path[64];
+    char line[4096];
+    int found = 0;
+
+    snprintf(path, sizeof(path), "/proc/%d/mountinfo", pid);
+    FILE* f = fopen(path, "re");
+    if (f == NULL) {
+        return -1;
+    }
+    // "<id> <parent> <maj:min> <root> <mount point> <options> [tags] - <fstype> <source> <super options>"
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char mount_point[PATH_MAX];
+        char* fs = strstr(line, " - ");
+        char* opt = fs != NULL ? strstr(fs, "upperdir=") : NULL;
+        if (sscanf(line, "%*d %*d %*s %*s %4095s", mount_point) != 1 || strcmp(mount_point, "/") != 0
+            || opt == NULL || strncmp(fs + 3, "overlay ", 8) != 0) {
+            continue;
+        }
+        opt += strlen("upperdir=");
+        size_t n = strcspn(opt, ",\n");
+        if (n < len) {
+            memcpy(upper, opt, n);  // The last root mount listed is the one on top
+            upper[n] = '\0';
+            found = 1;
+        }
+    }
+    fclose(f);
+
+    struct stat st;
+    if (!found || strncmp(upper, OVERLAY_SCRATCH_DIR "/", strlen(OVERLAY_SCRATCH_DIR) + 1) == 0
+        || stat(upper, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Record what the container's fds 0-2 are in DIR/stdio, one "<fd> <link target>" per line
+ *
+ * @return 1 if one of them is a terminal, 0 if none is, -1 on error
+ */
+static int checkpoint_save_stdio(pid_t pid, const char* dir) {
+    char path[PATH_MAX];
+    int terminal = 0;
+
+    snprintf(path, sizeof(path), "%s/stdio", dir);
+    FILE* out = fopen(path, "we");
+    if (out == NULL) {
+        return -1;
+    }
+    for (int fd = 0; fd <= 2; fd++) {
+        char link[64];
+        char target[PATH_MAX];
+        snprintf(link, sizeof(link), "/proc/%d/fd/%d", pid, fd);
+        ssize_t n = readlink(link, target, sizeof(target) - 1);
+        if (n <= 0) {
+            continue;  // Closed
+        }
+        target[n] = '\0';
+        fprintf(out, "%d %s\n", fd, target);
+        terminal |= is_terminal_path(target);
+    }
+    return fclose(out) == 0 ? terminal : -1;
+}
+
+/**
+ * Save a running container (started by any runtime on the host) into dir
+ *
+ * @param container_name Name of container
+ * @param dir            Checkpoint directory, created if needed
+ * @return 0 on success, -1 on failure (error printed; the container keeps running either way)
+ */
+int checkpoint_container(const char* container_name, const char* dir) {
+    CgroupHandle cg;
+    char images[PATH_MAX];
+    char layer[PATH_MAX];
+    char upper[PATH_MAX];
+    char ns_path[64];
+    char tree[16];
+    struct stat ours, theirs;
+
+    if (cgroup_open_existing(&cg, container_name) != 0) {
+        fprintf(stderr, "No cgroup for container %s (is it running?): %s\n", container_name, strerror(errno));
+        return -1;
+    }
+    pid_t pid = container_init_pid(&cg);
+    if (pid == -1) {
+        fprintf(stderr, "No container init in %s: %s\n", cg.path, strerror(errno));
+        cgroup_close(&cg);
+        return -1;
+    }
+
+    // Its eth0 is a veth pool slot, see the section comment
+    snprintf(ns_path, sizeof(ns_path), "/proc/%d/ns/net", pid);
+    if (stat("/proc/self/ns/net", &ours) != 0 || stat(ns_path, &theirs) != 0 || ours.st_ino != theirs.st_ino) {
+        fprintf(stderr, "Container %s has its own network namespace (--net) and can't be checkpointed\n",
+                container_name);
+        cgroup_close(&cg);
+        return -1;
+    }
+
+    snprintf(images, sizeof(images), "%s/images", dir);
+    snprintf(layer, sizeof(layer), "%s/upper", dir);
+    if ((mkdir(dir, 0755) != 0 && errno != EEXIST) || (mkdir(images, 0755) != 0 && errno != EEXIST)) {
+        fprintf(stderr, "Cannot create %s: %s\n", images, strerror(errno));
+        cgroup_close(&cg);
+        return -1;
+    }
+
+    // Nothing may run between copying the files and dumping the memory that refers to them
+    if (cgroup_freeze(&cg, 1) != 0) {
+        fprintf(stderr, "Cannot freeze %s: %s\n", cg.path, strerror(errno));
+        cgroup_freeze(&cg, 0);
+        cgroup_close(&cg);
+        return -1;
+    }
+
+    int ret = 0;
+    int shell_job = checkpoint_save_stdio(pid, dir);
+    if (shell_job < 0) {
+        fprintf(stderr, "Cannot record the container's stdio in %s: %s\n", dir, strerror(errno));
+        ret = -1;
+    } else if (container_upper_dir(pid, upper, sizeof(upper)) == 0) {
+        char* copy[] = { "cp", "-a", upper, layer, NULL };
+        if (run_tool(copy) != 0) {
+            fprintf(stderr, "Copying %s to %s failed\n", upper, layer);
+            ret = -1;
+        }
+    } else {
+        report(stderr, "⚠️  Files written by %s are not reachable (no --upper-dir), only its processes are saved\n",
+               container_name);
+    }
+
+    if (ret == 0) {
+        // --freeze-cgroup: CRIU seizes the tasks where cgroup.freeze stopped them
+        snprintf(tree, sizeof(tree), "%d", pid);
+        char* dump[] = {
+            CRIU_BIN, "dump", "--tree", tree, "--images-dir", images, "--log-file", "dump.log",
+            "--leave-running", "--freeze-cgroup", cg.path, "--manage-cgroups=ignore",
+            shell_job ? "--shell-job" : NULL, NULL
+        };
+        if (run_tool(dump) != 0) {
+            fprintf(stderr, "criu dump of %s failed, see %s/dump.log\n", container_name, images);
+            ret = -1;
+        }
+    }
+
+    if (cgroup_freeze(&cg, 0) != 0) {
+        fprintf(stderr, "⚠️  Cannot thaw %s: %s\n", cg.path, strerror(errno));
+    }
+    cgroup_close(&cg);
+    return ret;
+}
+
+/**
+ * Recreate a checkpointed container (what spawn_container() is for a normal run)
+ *
+ * The helper that execs criu joins config->cgroup (if set) first, so the
+ * restored tasks are born in it. config->log_fd (if set) becomes the helper's
+ * stdout/stderr, and so the restored tree's in place of the pipes it had.
+ *
+ * @param config     Container configuration (name, rootfs, upper dir, cgroup, log pipe)
+ * @param dir        Checkpoint directory written by checkpoint_container()
+ * @param lazy_pages 1 to serve memory from dir/images on first touch (criu lazy-pages)
+ * @return PID of the restored init in our namespace (reparented to us), or -1 on failure (errno set)
+ */
+pid_t restore_container(ContainerConfig* config, const char* dir, int lazy_pages) {
+    char images[PATH_MAX];
+    char layer[PATH_MAX];
+    char work[PATH_MAX];
+    char path[PATH_MAX + 16];
+    char inherit[3][PATH_MAX];
+    char* argv[32];
+    int argc = 0;
+    struct stat st;
+
+    snprintf(images, sizeof(images), "%s/images", dir);
+    snprintf(layer, sizeof(layer), "%s/upper", dir);
+    snprintf(work, sizeof(work), "%s/%s", RESTORE_WORK_DIR, config->name);
+    if (stat(images, &st) != 0) {
+        fprintf(stderr, "No checkpoint in %s\n", dir);
+        return -1;
+    }
+    int has_layer = stat(layer, &st) == 0 && S_ISDIR(st.st_mode);
+    mkdir(MINIRUN_RUN_DIR, 0755);
+    if ((mkdir(RESTORE_WORK_DIR, 0755) != 0 && errno != EEXIST) || (mkdir(work, 0755) != 0 && errno != EEXIST)) {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/pidfile", work);
+    unlink(path);  // Left by an earlier restore under this name
+
+    argv[argc++] = CRIU_BIN;
+    argv[argc++] = "restore";
+    argv[argc++] = "--images-dir";
+    argv[argc++] = images;
+    argv[argc++] = "--work-dir";
+    argv[argc++] = work;
+    argv[argc++] = "--log-file";
+    argv[argc++] = "restore.log";
+    argv[argc++] = "--pidfile";
+    argv[argc++] = "pidfile";  // In the work dir
+    argv[argc++] = "--restore-detached";
+    argv[argc++] = "--manage-cgroups=ignore";
+    if (lazy_pages) {
+        argv[argc++] = "--lazy-pages";
+    }
+
+    // Pipes and sockets at fds 0-2 become the helper's fds, a terminal is re-attached
+    char stdio_path[PATH_MAX];
+    snprintf(stdio_path, sizeof(stdio_path), "%s/stdio", dir);
+    FILE* stdio = fopen(stdio_path, "re");
+    int fd;
+    int shell_job = 0;
+    char target[PATH_MAX - 16];
+    while (stdio != NULL && fscanf(stdio, "%d %4000s", &fd, target) == 2) {
+        if (fd < 0 || fd > 2 || argc + 5 > (int)(sizeof(argv) / sizeof(argv[0]))) {
+            continue;
+        }
+        if (strncmp(target, "pipe:", 5) == 0 || strncmp(target, "socket:", 7) == 0) {
+            snprintf(inherit[fd], sizeof(inherit[fd]), "fd[%d]:%s", fd, target);
+            argv[argc++] = "--inherit-fd";
+            argv[argc++] = inherit[fd];
+        } else if (is_terminal_path(target) && !shell_job) {
+            argv[argc++] = "--shell-job";
+            shell_job = 1;
+        }
+    }
+    if (stdio != NULL) {
+        fclose(stdio);
+    }
+    argv[argc++] = "--root";
+    int root_arg = argc++;  // The overlay, mounted by the helper
+    argv[argc] = NULL;
+
+    // criu leaves the restored tree behind when it detaches, and orphans go to the nearest subreaper
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1) != 0) {
+        return -1;
+    }
+
+    if (lazy_pages) {
+        // --daemon: returns once the socket the restore connects to (in the work dir) is listening
+        char* server[] = {
+            CRIU_BIN, "lazy-pages", "--images-dir", images, "--work-dir", work,
+            "--log-file", "lazy-pages.log", "--daemon", NULL
+        };
+        if (run_tool(server) != 0) {
+            fprintf(stderr, "criu lazy-pages failed, see %s/lazy-pages.log\n", work);
+            errno = ECHILD;
+            return -1;
+        }
+    }
+
+    fflush(stdout);  // The helper shares our stdio buffers until it execs
+    pid_t helper = fork();
+    if (helper == 0) {
+        char merged[PATH_MAX];
+
+        // Same as enter_rootfs(): our mounts must stay out of the host's namespace
+        if (unshare(CLONE_NEWNS) != 0 || mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) {
+            perror("private mount namespace failed");
+            _exit(127);
+        }
+        if (config->rootfs_flags & ROOTFS_OVERLAY) {
+            if (mount_overlay_root(config->rootfs_path, has_layer ? layer : NULL, config->upper_dir,
+                                   merged, sizeof(merged)) != 0) {
+                perror("overlay mount failed");
+                _exit(127);
+            }
+        } else {
+            if (has_layer) {
+                report(stderr, "⚠️  No overlay, so the files saved in %s are not used\n", layer);
+            }
+            snprintf(merged, sizeof(merged), "%s", config->rootfs_path);
+        }
+        argv[root_arg] = merged;
+
+        if (config->cgroup != NULL && cgroup_add_process(config->cgroup, getpid()) != 0) {
+            report(stderr, "⚠️  Warning: Running without resource limits\n");
+        }
+        if (config->log_fd != -1) {
+            dup2(config->log_fd, STDOUT_FILENO);
+            dup2(config->log_fd, STDERR_FILENO);
+            close(config->log_fd);
+        }
+        execvp(CRIU_BIN, argv);
+        fprintf(stderr, "Cannot run %s: %s\n", CRIU_BIN, strerror(errno));
+        _exit(127);
+    }
+    if (helper == -1) {
+        return -1;
+    }
+
+    int status;
+    while (waitpid(helper, &status, 0) == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "criu restore of %s failed, see %s/restore.log\n", config->name, work);
+        errno = ECHILD;
+        return -1;
+    }
+
+    int pid = -1;
+    FILE* f = fopen(path, "re");
+    if (f == NULL || fscanf(f, "%d", &pid) != 1) {
+        pid = -1;
+        errno = ENOENT;
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+    return pid;
+}
+
+/*
+ * Zygote mode
+ *
+ * A long-lived daemon keeps a pool of children that have already been cloned into
+ * fresh PID/mount namespaces, chrooted and had /proc mounted. Each one blocks on a
+ * socketpair until a client request arrives. The protocol on the control socket
+ * (SOCK_SEQPACKET, one message per request) is:
+ *
+ *   client -> zygote : "<name>\0<command>\0" + SCM_RIGHTS [stdin, stdout, stderr]
+ *   zygote -> client : "pid <host_pid>\n"  or  "error <reason>\n"
+ *   zygote -> client : "exit <status>\n"   (once the container stops)
+ *
+ * A start is then a single IPC round trip instead of exec + cgroup setup + clone.
+ */
+
+// Arguments handed to a pre-cloned zygote child
+typedef struct {
+    const char* rootfs_path;
+    int rootfs_flags;   // ROOTFS_* bits for enter_rootfs()
+    int control_fd;     // Child's end of the socketpair
+    int peer_fd;        // Zygote's end, closed in the child so EOF is seen if the zygote exits
+} ZygoteChildArgs;
+
+/**
+ * Receive one message plus up to max_fds file descriptors (SCM_RIGHTS)
+ *
+ * @return Number of payload bytes received, 0 on EOF, -1 on error
+ */
+static ssize_t recv_with_fds(int sock, char* buf, size_t len, int* fds, int max_fds, int* nfds) {
+    char control[CMSG_SPACE(sizeof(int) * 3)];
+    struct iovec iov = { .iov_base = buf, .iov_len = len };
+    struct msghdr msg = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = control, .msg_controllen = sizeof(control)
+    };
+
+    *nfds = 0;
+    ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    if (n <= 0) {
+        return n;
+    }
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (int i = 0; i < count; i++) {
+                int fd;
+                memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                if (*nfds < max_fds) {
+                    fds[(*nfds)++] = fd;
+                } else {
+                    close(fd);
+                }
+            }
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Send one message plus file descriptors (SCM_RIGHTS)
+ *
+ * @return 0 on success, -1 on error
+ */
+static int send_with_fds(int sock, const char* buf, size_t len, const int* fds, int nfds) {
+    char control[CMSG_SPACE(sizeof(int) * 3)];
+    struct iovec iov = { .iov_base = (void*)buf, .iov_len = len };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    if (nfds > 0) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+    }
+
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) < 0 ? -1 : 0;
+}
+
+/**
+ * Pre-cloned zygote child: prepare the namespace, then wait for a command
+ *
+ * Everything up to the exec is done ahead of time. Cgroup membership is handled
+ * by the zygote (it knows our host PID) before the command is sent.
+ */
+int zygote_child_function(void* arg) {
+    ZygoteChildArgs* args = (ZygoteChildArgs*)arg;
+    char request[4096];
+    int fds[3];
+    int nfds;
+    sigset_t mask;
+
+    // Die with the zygote instead of lingering in the pool
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    close(args->peer_fd);
+
+    // The zygote blocks SIGCHLD/SIGTERM/SIGINT for its signalfd; don't leak that mask into the workload
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+
+    if (enter_rootfs(args->rootfs_path, args->rootfs_flags, NULL) != 0) {
+        return 1;
+    }
+
+    // Block until the zygote hands us "<name>\0<command>\0" plus the client's stdio
+    // ("<name>\0\0<arg0>\0<arg1>\0..." to exec an argv without bash)
+    ssize_t n = recv_with_fds(args->control_fd, request, sizeof(request) - 1, fds, 3, &nfds);
+    if (n <= 0) {
+        return 0;  // Zygote shut down before we were used
+    }
+    request[n] = '\0';
+    close(args->control_fd);
+
+    // Adopt the client's terminal/pipes as our stdio
+    for (int i = 0; i < nfds; i++) {
+        dup2(fds[i], i);
+        close(fds[i]);
+    }
+
+    size_t name_len = strnlen(request, n);
+    if (name_len + 1 >= (size_t)n) {
+        fprintf(stderr, "zygote: malformed request\n");
+        return 1;
+    }
+    const char* command = request + name_len + 1;
+
+    if (*command == '\0') {
+        char* args[ZYGOTE_MAX_ARGS + 1];
+        int argc = 0;
+        for (char* arg = request + name_len + 2; arg < request + n && argc < ZYGOTE_MAX_ARGS; arg += strlen(arg) + 1) {
+            args[argc++] = arg;
+        }
+        args[argc] = NULL;
+        if (argc == 0) {
+            fprintf(stderr, "zygote: malformed request\n");
+            return 1;
+        }
+        execvp(args[0], args);
+    } else {
+        execl("/bin/bash", "bash", "-c", command, NULL);
+    }
+
     // ERROR: execution failed
     perror("exec failed");
     return 1;
+}
+
+/**
+ * Clone one zygote child into a free slot
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int zygote_spawn(ZygoteSlot* slot, const char* rootfs_path, int rootfs_flags) {
+    int sv[2];
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) {
+        perror("socketpair failed");
+        return -1;
+    }
+
+    ZygoteChildArgs args = {
+        .rootfs_path = rootfs_path, .rootfs_flags = rootfs_flags, .control_fd = sv[1], .peer_fd = sv[0]
+    };
+
+    // Unflushed stdio would otherwise be written a second time by the child
+    fflush(stdout);
+
+    // Without CLONE_VM the child gets its own copy of the stack,
+    // so the same pooled stack is reused for every spawn
+    void* stack = stack_acquire(&stack_pool);
+    pid_t pid = stack == NULL ? -1 : clone(
+        zygote_child_function,
+        stack,
+        CLONE_NEWPID | CLONE_NEWNS | SIGCHLD,
+        &args
+    );
+    if (stack != NULL) {
+        int saved_errno = errno;
+        stack_release(&stack_pool, stack);
+        errno = saved_errno;
+    }
+    close(sv[1]);
+
+    if (pid == -1) {
+        perror("clone failed");
+        close(sv[0]);
+        return -1;
+    }
+
+    slot->pid = pid;
+    slot->control_fd = sv[0];
+    slot->client_fd = -1;
+    slot->name[0] = '\0';
+    return 0;
+}
+
+/**
+ * Hand a client request to a ready child
+ *
+ * Sets up the cgroup, moves the child into it, passes the command and stdio fds,
+ * then replies with the container's host PID.
+ */
+static void zygote_dispatch(ZygoteSlot* slots, int client_fd, const CgroupLimitSet* limits) {
+    char request[4096];
+    char reply[64];
+    int fds[3];
+    int nfds;
+
+    ssize_t n = recv_with_fds(client_fd, request, sizeof(request) - 1, fds, 3, &nfds);
+    if (n <= 0) {
+        close(client_fd);
+        return;
+    }
+    request[n] = '\0';
+
+    size_t name_len = strnlen(request, n);
+    if (name_len == 0 || name_len >= sizeof(slots[0].name) || name_len + 1 >= (size_t)n) {
+        dprintf(client_fd, "error malformed request\n");
+        goto out_close;
+    }
+    if (!valid_container_name(request)) {
+        dprintf(client_fd, "error invalid name\n");
+        goto out_close;
+    }
+
+    // Find a child that is still waiting in the pool
+    ZygoteSlot* slot = NULL;
+    for (int i = 0; i < ZYGOTE_MAX_SLOTS; i++) {
+        if (slots[i].pid > 0 && slots[i].client_fd == -1) {
+            slot = &slots[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        dprintf(client_fd, "error no ready containers\n");
+        goto out_close;
+    }
+
+    strcpy(slot->name, request);
+
+    // Limits come from the zygote's own command line (NULL = cgroups unavailable)
+    CgroupHandle cg;
+    if (limits != NULL && cgroup_open(&cg, slot->name) == 0) {
+        if (cgroup_apply_limits(&cg, limits) && cgroup_add_process(&cg, slot->pid) != 0) {
+            fprintf(stderr, "⚠️  zygote: could not move PID %d into cgroup: %s\n", slot->pid, strerror(errno));
+        }
+        cgroup_close(&cg);
+    }
+
+    if (send_with_fds(slot->control_fd, request, n, fds, nfds) != 0) {
+        dprintf(client_fd, "error child unavailable\n");
+        kill(slot->pid, SIGKILL);  // Reaped through SIGCHLD like any other exit
+        goto out_close;
+    }
+    close(slot->control_fd);
+    slot->control_fd = -1;
+    slot->client_fd = client_fd;
+
+    snprintf(reply, sizeof(reply), "pid %d\n", slot->pid);
+    if (write(client_fd, reply, strlen(reply)) < 0) {
+        // Client went away; the container keeps running and is reaped normally
+    }
+    printf("zygote: container [%s] started as PID %d\n", slot->name, slot->pid);
+
+    for (int i = 0; i < nfds; i++) {
+        close(fds[i]);
+    }
+    return;
+
+out_close:
+    for (int i = 0; i < nfds; i++) {
+        close(fds[i]);
+    }
+    close(client_fd);
+}
+
+/**
+ * Reap exited children, report exit status to their clients and free slots
+ */
+static void zygote_reap(ZygoteSlot* slots) {
+    int status;
+    pid_t pid;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int i = 0; i < ZYGOTE_MAX_SLOTS; i++) {
+            if (slots[i].pid != pid) {
+                continue;
+            }
+
+            int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+            if (slots[i].client_fd >= 0) {
+                dprintf(slots[i].client_fd, "exit %d\n", code);
+                close(slots[i].client_fd);
+                printf("zygote: container [%s] stopped (status %d)\n", slots[i].name, code);
+                cleanup_cgroups(slots[i].name);
+            }
+            if (slots[i].control_fd >= 0) {
+                close(slots[i].control_fd);
+            }
+            slots[i].pid = 0;
+            slots[i].control_fd = -1;
+            slots[i].client_fd = -1;
+            break;
+        }
+    }
+}
+
+/**
+ * Top the pool back up to pool_size ready children
+ */
+static void zygote_refill(ZygoteSlot* slots, int pool_size, const char* rootfs_path, int rootfs_flags) {
+    int ready = 0;
+
+    for (int i = 0; i < ZYGOTE_MAX_SLOTS; i++) {
+        if (slots[i].pid > 0 && slots[i].client_fd == -1) {
+            ready++;
+        }
+    }
+
+    for (int i = 0; i < ZYGOTE_MAX_SLOTS && ready < pool_size; i++) {
+        if (slots[i].pid == 0) {
+            if (zygote_spawn(&slots[i], rootfs_path, rootfs_flags) != 0) {
+                break;  // Try again on the next loop iteration
+            }
+            ready++;
+        }
+    }
+}
+
+/**
+ * Run the zygote daemon until SIGTERM/SIGINT
+ *
+ * @param rootfs_path Root filesystem every pooled child runs in
+ * @param socket_path Unix socket clients connect to
+ * @param pool_size   Number of ready children to keep
+ * @param rootfs_flags ROOTFS_* bits applied to every pooled child
+ * @param limits      Cgroup limits applied to every container it hands out
+ * @return Exit code for main()
+ */
+int run_zygote(const char* rootfs_path, const char* socket_path, int pool_size, int rootfs_flags,
+               const CgroupLimitSet* limits) {
+    static ZygoteSlot slots[ZYGOTE_MAX_SLOTS];
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    sigset_t mask;
+    int running = 1;
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socket_path);
+        return 1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    for (int i = 0; i < ZYGOTE_MAX_SLOTS; i++) {
+        slots[i].pid = 0;
+        slots[i].control_fd = -1;
+        slots[i].client_fd = -1;
+    }
+
+    // Handle SIGCHLD and shutdown signals synchronously through a signalfd
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    int sig_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+    if (sig_fd == -1) {
+        perror("signalfd failed");
+        return 1;
+    }
+
+    // Create the control socket (root only: clients get root-owned containers)
+    if (mkdir(MINIRUN_RUN_DIR, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "⚠️  Failed to create %s: %s\n", MINIRUN_RUN_DIR, strerror(errno));
+    }
+    int listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        perror("socket failed");
+        return 1;
+    }
+    unlink(socket_path);
+    mode_t old_umask = umask(0077);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        perror("bind failed");
+        umask(old_umask);
+        return 1;
+    }
+    umask(old_umask);
+    if (listen(listen_fd, 128) != 0) {
+        perror("listen failed");
+        return 1;
+    }
+
+    // Probe the hierarchy once for the daemon's lifetime
+    int cgroups_enabled = cgroups_v2_available();
+    if (cgroups_enabled) {
+        enable_cgroup_controllers();
+    } else {
+        fprintf(stderr, "⚠️  Cgroups v2 not available, containers will run without resource limits\n");
+    }
+
+    printf("=== MiniRun Zygote ===\n");
+    printf("Root filesystem: %s\n", rootfs_path);
+    printf("Socket: %s\n", socket_path);
+    printf("Pool size: %d\n\n", pool_size);
+
+    zygote_refill(slots, pool_size, rootfs_path, rootfs_flags);
+
+    while (running) {
+        struct pollfd pfds[2] = {
+            { .fd = listen_fd, .events = POLLIN },
+            { .fd = sig_fd, .events = POLLIN },
+        };
+
+        if (poll(pfds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll failed");
+            break;
+        }
+
+        if (pfds[1].revents & POLLIN) {
+            struct signalfd_siginfo si;
+            if (read(sig_fd, &si, sizeof(si)) == sizeof(si)) {
+                if (si.ssi_signo == SIGCHLD) {
+                    zygote_reap(slots);
+                } else {
+                    running = 0;
+                }
+            }
+        }
+
+        if (running && (pfds[0].revents & POLLIN)) {
+            int client_fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (client_fd >= 0) {
+                zygote_dispatch(slots, client_fd, cgroups_enabled ? limits : NULL);
+            }
+        }
+
+        // Replace used children after replying, off the client's critical path
+        if (running) {
+            zygote_refill(slots, pool_size, rootfs_path, rootfs_flags);
+        }
+    }
+
+    printf("\n=== Zygote shutting down ===\n");
+
+    close(listen_fd);
+    unlink(socket_path);
+    for (int i = 0; i < ZYGOTE_MAX_SLOTS; i++) {
+        if (slots[i].pid > 0) {
+            kill(slots[i].pid, SIGKILL);
+            waitpid(slots[i].pid, NULL, 0);
+            if (slots[i].client_fd >= 0) {
+                close(slots[i].client_fd);
+                cleanup_cgroups(slots[i].name);
+            }
+        }
+    }
+    stack_pool_drain(&stack_pool);
+
+    return 0;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <stdio.h>
+#include <unistd.h>
 
 int main() {
     printf("hello from process %d\n", getpid());
-    return;
+    return 0;
 }
\ No newline at end of file
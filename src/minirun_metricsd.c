@@ -0,0 +1,776 @@
+#define _GNU_SOURCE
+#include <stdio.h>      // Standard input/output (printf, snprintf)
+#include <stdlib.h>     // Standard library (malloc, strtoull)
+#include <unistd.h>     // UNIX standard (pread, close)
+#include <string.h>     // String operations (strncmp, strerror)
+#include <errno.h>      // Error numbers (errno)
+#include <stdint.h>     // Fixed-width integers (uint64_t)
+#include <inttypes.h>   // Format macros (PRIu64)
+#include <stddef.h>     // offsetof
+#include <limits.h>     // PATH_MAX
+#include <stdarg.h>     // Variadic arguments (buf_printf)
+#include <fcntl.h>      // File control (openat, O_DIRECTORY)
+#include <dirent.h>     // Directory scanning (opendir, readdir)
+#include <getopt.h>     // Long option parsing (getopt_long)
+#include <poll.h>       // I/O multiplexing (poll)
+#include <signal.h>     // Signal masks (sigprocmask)
+#include <time.h>       // Monotonic clock (clock_gettime)
+#include <sys/inotify.h>  // Cgroup directory create/remove events
+#include <sys/timerfd.h>  // Sample interval as a file descriptor
+#include <sys/signalfd.h> // Signals as file descriptors (signalfd)
+#include <sys/socket.h> // TCP sockets (socket, accept4)
+#include <sys/uio.h>    // Scatter/gather writes (writev)
+#include <netinet/in.h> // Internet addresses (sockaddr_in)
+#include <arpa/inet.h>  // Address parsing (inet_pton)
+
+/*
+ * minirun-metricsd: Prometheus exporter for MiniRun container cgroups
+ *
+ * Replaces polling scripts/monitor.sh from cron. Every /sys/fs/cgroup/minirun-<name>
+ * cgroup gets its stat files opened once; each sample is one pread() per file,
+ * parsed in place, and the exposition text is rendered into memory. A scrape is
+ * accept + read + writev + close. New and removed cgroups are picked up through
+ * inotify on the cgroup root, so nothing is rescanned while the set is stable.
+ * Warm pool slots (minirun-pool-<n>, see container_runtime --cgroup-pool) are
+ * labelled with the container named in the slot's run-state file, and not
+ * exported while the slot is free.
+ *
+ * Build: gcc -o bin/minirun-metricsd src/minirun_metricsd.c -Wall -Wextra -O2
+ * Usage: sudo ./bin/minirun-metricsd [--interval MS] [--port N] [--bind ADDR]
+ */
+
+#define CGROUP_ROOT         "/sys/fs/cgroup"
+#define CGROUP_PREFIX       "minirun-"      // Same naming as container_runtime
+#define CGROUP_POOL_DIR     "/run/minirun/cgroups"  // Run-state files of the warm cgroup pool
+#define DEFAULT_INTERVAL_MS 1000
+#define DEFAULT_PORT        9101
+#define DEFAULT_BIND        "127.0.0.1"
+#define STAT_BUF_SIZE       8192            // memory.stat is the largest file (~2KB)
+
+// Stat files kept open per container
+enum {
+    FILE_MEMORY_CURRENT,
+    FILE_MEMORY_MAX,
+    FILE_MEMORY_STAT,
+    FILE_CPU_STAT,
+    FILE_IO_STAT,
+    FILE_PIDS_CURRENT,
+    FILE_COUNT
+};
+
+static const char* stat_files[FILE_COUNT] = {
+    "memory.current", "memory.max", "memory.stat", "cpu.stat", "io.stat", "pids.current"
+};
+
+// One exported series per key of a "key value" file (memory.stat, cpu.stat)
+typedef struct {
+    const char* key;        // Key in the cgroup file
+    const char* metric;     // Prometheus metric name
+    const char* label;      // Value of the "type" label, or NULL for none
+    const char* help;
+    const char* type;       // "gauge" or "counter"
+} KeyedMetric;
+
+static const KeyedMetric memory_stat_metrics[] = {
+    { "anon",          "minirun_container_memory_stat_bytes", "anon",          "Memory by type (memory.stat)", "gauge" },
+    { "file",          "minirun_container_memory_stat_bytes", "file",          NULL, NULL },
+    { "kernel",        "minirun_container_memory_stat_bytes", "kernel",        NULL, NULL },
+    { "kernel_stack",  "minirun_container_memory_stat_bytes", "kernel_stack",  NULL, NULL },
+    { "sock",          "minirun_container_memory_stat_bytes", "sock",          NULL, NULL },
+    { "shmem",         "minirun_container_memory_stat_bytes", "shmem",         NULL, NULL },
+    { "file_mapped",   "minirun_container_memory_stat_bytes", "file_mapped",   NULL, NULL },
+    { "file_dirty",    "minirun_container_memory_stat_bytes", "file_dirty",    NULL, NULL },
+    { "pgfault",       "minirun_container_memory_page_faults_total", "all",    "Page faults (memory.stat)", "counter" },
+    { "pgmajfault",    "minirun_container_memory_page_faults_total", "major",  NULL, NULL },
+};
+#define MEMORY_STAT_COUNT (sizeof(memory_stat_metrics) / sizeof(memory_stat_metrics[0]))
+
+static const KeyedMetric cpu_stat_metrics[] = {
+    { "usage_usec",     "minirun_container_cpu_usage_usec_total", NULL,     "CPU time used (cpu.stat)", "counter" },
+    { "user_usec",      "minirun_container_cpu_mode_usec_total", "user",    "CPU time by mode (cpu.stat)", "counter" },
+    { "system_usec",    "minirun_container_cpu_mode_usec_total", "system",  NULL, NULL },
+    { "nr_periods",     "minirun_container_cpu_periods_total", NULL,        "Enforcement periods elapsed (cpu.stat)", "counter" },
+    { "nr_throttled",   "minirun_container_cpu_throttled_periods_total", NULL, "Periods the cgroup was throttled in (cpu.stat)", "counter" },
+    { "throttled_usec", "minirun_container_cpu_throttled_usec_total", NULL, "Time spent throttled (cpu.stat)", "counter" },
+};
+#define CPU_STAT_COUNT (sizeof(cpu_stat_metrics) / sizeof(cpu_stat_metrics[0]))
+
+// io.stat fields summed over all devices
+static const char* io_fields[] = { "rbytes", "wbytes", "rios", "wios" };
+#define IO_FIELD_COUNT 4
+
+// Latest sample of one container cgroup
+typedef struct {
+    char name[128];                 // Container name (cgroup dir without the prefix)
+    char label[128];                // Exported name (escaped): name, or the container holding a pool slot
+    int pool;                       // A warm pool slot (pool-<n>)
+    int claim_fd;                   // The slot's run-state file, -1 if not open (yet)
+    int idle;                       // Free pool slot, not exported
+    int fds[FILE_COUNT];            // -1 if the file doesn't exist (controller disabled)
+    uint64_t memory_current;
+    uint64_t memory_max;            // UINT64_MAX for "max"
+    uint64_t memory_stat[MEMORY_STAT_COUNT];
+    uint64_t cpu_stat[CPU_STAT_COUNT];
+    uint64_t io[IO_FIELD_COUNT];
+    uint64_t pids_current;
+    int gone;                       // Cgroup was removed; dropped after this sample
+} Container;
+
+// Growable output buffer for the exposition text
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+// Daemon state
+static Container* containers = NULL;
+static int container_count = 0;
+static int container_cap = 0;
+static const char* cgroup_root = CGROUP_ROOT;
+static const char* pool_dir = CGROUP_POOL_DIR;
+static Buffer page;                 // Last rendered /metrics body
+static double last_sample_seconds = 0;
+
+// Container tracking
+static void add_container(const char* dir_name);
+static void remove_container(const char* dir_name);
+static void scan_cgroups(void);
+
+// Sampling and rendering
+static void sample_all(void);
+static void render_metrics(void);
+
+// HTTP
+static int open_listener(const char* bind_addr, int port);
+static void serve_client(int listen_fd);
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--interval MS] [--port N] [--bind ADDR] [--cgroup-root DIR] [--pool-dir DIR]\n", prog);
+    fprintf(stderr, "\nOptions:\n");
+    fprintf(stderr, "  --interval MS     Sample interval in milliseconds (default: %d)\n", DEFAULT_INTERVAL_MS);
+    fprintf(stderr, "  --port N          Port to serve /metrics on (default: %d)\n", DEFAULT_PORT);
+    fprintf(stderr, "  --bind ADDR       Address to listen on (default: %s)\n", DEFAULT_BIND);
+    fprintf(stderr, "  --cgroup-root DIR Cgroup v2 mount (default: %s)\n", CGROUP_ROOT);
+    fprintf(stderr, "  --pool-dir DIR    Run-state files of the warm cgroup pool (default: %s)\n", CGROUP_POOL_DIR);
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"interval",    required_argument, 0, 'i'},
+        {"port",        required_argument, 0, 'p'},
+        {"bind",        required_argument, 0, 'b'},
+        {"cgroup-root", required_argument, 0, 'c'},
+        {"pool-dir",    required_argument, 0, 'P'},
+        {"help",        no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int interval_ms = DEFAULT_INTERVAL_MS;
+    int port = DEFAULT_PORT;
+    const char* bind_addr = DEFAULT_BIND;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'i':
+                interval_ms = atoi(optarg);
+                if (interval_ms < 10) {
+                    fprintf(stderr, "Interval must be at least 10ms\n");
+                    return 1;
+                }
+                break;
+            case 'p':
+                port = atoi(optarg);
+                if (port < 1 || port > 65535) {
+                    fprintf(stderr, "Port must be between 1 and 65535\n");
+                    return 1;
+                }
+                break;
+            case 'b':
+                bind_addr = optarg;
+                break;
+            case 'c':
+                cgroup_root = optarg;
+                break;
+            case 'P':
+                pool_dir = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    int listen_fd = open_listener(bind_addr, port);
+    if (listen_fd == -1) {
+        return 1;
+    }
+
+    // Cgroup mkdir/rmdir both show up as directory events on the root
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd == -1 || inotify_add_watch(inotify_fd, cgroup_root, IN_CREATE | IN_DELETE | IN_ONLYDIR) == -1) {
+        fprintf(stderr, "⚠️  inotify on %s failed (%s), rescanning every sample\n", cgroup_root, strerror(errno));
+        if (inotify_fd != -1) {
+            close(inotify_fd);
+            inotify_fd = -1;
+        }
+    }
+
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    struct itimerspec its = {
+        .it_interval = { interval_ms / 1000, (interval_ms % 1000) * 1000000L },
+        .it_value = { 0, 1 }  // First sample right away
+    };
+    if (timer_fd == -1 || timerfd_settime(timer_fd, 0, &its, NULL) != 0) {
+        perror("timerfd failed");
+        return 1;
+    }
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    int signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+
+    scan_cgroups();
+
+    printf("=== MiniRun Metrics Daemon ===\n");
+    printf("Cgroup root: %s\n", cgroup_root);
+    printf("Containers: %d\n", container_count);
+    printf("Sampling every %dms, serving http://%s:%d/metrics\n\n", interval_ms, bind_addr, port);
+    fflush(stdout);
+
+    struct pollfd pfds[4] = {
+        { .fd = listen_fd, .events = POLLIN },
+        { .fd = timer_fd, .events = POLLIN },
+        { .fd = signal_fd, .events = POLLIN },
+        { .fd = inotify_fd, .events = POLLIN },
+    };
+    int nfds = inotify_fd != -1 ? 4 : 3;
+
+    for (;;) {
+        if (poll(pfds, nfds, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll failed");
+            return 1;
+        }
+
+        if (pfds[2].revents & POLLIN) {
+            break;  // SIGTERM/SIGINT
+        }
+
+        if (nfds == 4 && (pfds[3].revents & POLLIN)) {
+            char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+            ssize_t n;
+            while ((n = read(inotify_fd, events, sizeof(events))) > 0) {
+                for (char* p = events; p < events + n; ) {
+                    struct inotify_event* ev = (struct inotify_event*)p;
+                    if (ev->mask & IN_Q_OVERFLOW) {
+                        scan_cgroups();
+                    } else if (ev->len > 0 && strncmp(ev->name, CGROUP_PREFIX, strlen(CGROUP_PREFIX)) == 0) {
+                        if (ev->mask & IN_CREATE) {
+                            add_container(ev->name);
+                        } else if (ev->mask & IN_DELETE) {
+                            remove_container(ev->name);
+                        }
+                    }
+                    p += sizeof(struct inotify_event) + ev->len;
+                }
+            }
+        }
+
+        if (pfds[1].revents & POLLIN) {
+            uint64_t expirations;
+            if (read(timer_fd, &expirations, sizeof(expirations)) < 0) {
+                // Spurious wakeup; sample anyway
+            }
+            if (nfds == 3) {
+                scan_cgroups();
+            }
+            sample_all();
+            render_metrics();
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            serve_client(listen_fd);
+        }
+    }
+
+    printf("\n=== Metrics daemon shutting down ===\n");
+    return 0;
+}
+
+/**
+ * Copy a name into a label value, escaped as the exposition format requires
+ * (backslash, double quote and newline); truncated to fit, never mid-escape
+ */
+static void set_label(char* label, size_t size, const char* name, size_t len) {
+    size_t out = 0;
+
+    for (size_t i = 0; i < len && name[i] != '\0'; i++) {
+        const char* esc = name[i] == '\\' ? "\\\\" : name[i] == '"' ? "\\\"" : name[i] == '\n' ? "\\n" : NULL;
+        size_t n = esc != NULL ? 2 : 1;
+        if (out + n >= size) {
+            break;
+        }
+        if (esc != NULL) {
+            memcpy(label + out, esc, 2);
+        } else {
+            label[out] = name[i];
+        }
+        out += n;
+    }
+    label[out] = '\0';
+}
+
+/**
+ * Start tracking a minirun-<name> cgroup and open its stat files
+ *
+ * @param dir_name Directory name under the cgroup root (with prefix)
+ */
+static void add_container(const char* dir_name) {
+    const char* name = dir_name + strlen(CGROUP_PREFIX);
+
+    for (int i = 0; i < container_count; i++) {
+        if (strcmp(containers[i].name, name) == 0) {
+            return;  // Already tracked (rescan after overflow)
+        }
+    }
+
+    int dir_fd = openat(AT_FDCWD, cgroup_root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1) {
+        return;
+    }
+    int cg_fd = openat(dir_fd, dir_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    close(dir_fd);
+    if (cg_fd == -1) {
+        return;  // Not a directory, or already gone
+    }
+
+    if (container_count == container_cap) {
+        int new_cap = container_cap ? container_cap * 2 : 64;
+        Container* grown = realloc(containers, new_cap * sizeof(Container));
+        if (grown == NULL) {
+            close(cg_fd);
+            return;
+        }
+        containers = grown;
+        container_cap = new_cap;
+    }
+
+    Container* c = &containers[container_count++];
+    memset(c, 0, sizeof(*c));
+    snprintf(c->name, sizeof(c->name), "%s", name);
+    set_label(c->label, sizeof(c->label), name, strlen(name));
+    int slot;
+    char rest;
+    c->pool = sscanf(name, "pool-%d%c", &slot, &rest) == 1;
+    c->claim_fd = -1;
+    for (int f = 0; f < FILE_COUNT; f++) {
+        c->fds[f] = openat(cg_fd, stat_files[f], O_RDONLY | O_CLOEXEC);
+    }
+    close(cg_fd);
+}
+
+static void drop_container(int index) {
+    for (int f = 0; f < FILE_COUNT; f++) {
+        if (containers[index].fds[f] >= 0) {
+            close(containers[index].fds[f]);
+        }
+    }
+    if (containers[index].claim_fd >= 0) {
+        close(containers[index].claim_fd);
+    }
+    containers[index] = containers[--container_count];  // Order doesn't matter
+}
+
+static void remove_container(const char* dir_name) {
+    const char* name = dir_name + strlen(CGROUP_PREFIX);
+
+    for (int i = 0; i < container_count; i++) {
+        if (strcmp(containers[i].name, name) == 0) {
+            drop_container(i);
+            return;
+        }
+    }
+}
+
+/**
+ * Pick up every minirun-* cgroup under the root (startup and inotify overflow)
+ */
+static void scan_cgroups(void) {
+    DIR* dir = opendir(cgroup_root);
+    if (dir == NULL) {
+        fprintf(stderr, "⚠️  Cannot read %s: %s\n", cgroup_root, strerror(errno));
+        return;
+    }
+
+    // Forget cgroups that disappeared while we weren't watching
+    for (int i = 0; i < container_count; i++) {
+        containers[i].gone = 1;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, CGROUP_PREFIX, strlen(CGROUP_PREFIX)) != 0) {
+            continue;
+        }
+        const char* name = entry->d_name + strlen(CGROUP_PREFIX);
+        int found = 0;
+        for (int i = 0; i < container_count; i++) {
+            if (strcmp(containers[i].name, name) == 0) {
+                containers[i].gone = 0;
+                found = 1;
+                break;
+            }
+        }
+        if (!found) {
+            add_container(entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    for (int i = container_count - 1; i >= 0; i--) {
+        if (containers[i].gone) {
+            drop_container(i);
+        }
+    }
+}
+
+/**
+ * Re-read one stat file from offset 0 into buf
+ *
+ * @return Bytes read (buf is NUL-terminated), 0 if the file isn't open, -1 on error
+ */
+static ssize_t read_stat(int fd, char* buf, size_t len) {
+    if (fd < 0) {
+        return 0;
+    }
+    ssize_t n = pread(fd, buf, len - 1, 0);
+    if (n < 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+/**
+ * Label a pool slot with the container that claimed it
+ *
+ * The runtime holding the slot keeps "<container> <pid>" in its run-state file
+ * and empties it on release. The file only exists once the slot was claimed.
+ */
+static void read_claim(Container* c) {
+    char buf[256];
+
+    if (c->claim_fd < 0) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", pool_dir, c->name);
+        c->claim_fd = open(path, O_RDONLY | O_CLOEXEC);
+    }
+    char* space = read_stat(c->claim_fd, buf, sizeof(buf)) > 0 ? strchr(buf, ' ') : NULL;
+    c->idle = space == NULL;
+    if (!c->idle) {
+        set_label(c->label, sizeof(c->label), buf, space - buf);
+    }
+}
+
+/**
+ * Parse a "key value" file (memory.stat, cpu.stat) into the values wanted by table
+ */
+static void parse_keyed(const char* buf, const KeyedMetric* table, size_t count, uint64_t* values) {
+    const char* line = buf;
+
+    while (*line) {
+        const char* space = strchr(line, ' ');
+        const char* end = strchr(line, '\n');
+        if (end == NULL) {
+            end = line + strlen(line);
+        }
+        if (space != NULL && space < end) {
+            size_t key_len = space - line;
+            for (size_t k = 0; k < count; k++) {
+                if (strlen(table[k].key) == key_len && strncmp(line, table[k].key, key_len) == 0) {
+                    values[k] = strtoull(space + 1, NULL, 10);
+                    break;
+                }
+            }
+        }
+        line = *end ? end + 1 : end;
+    }
+}
+
+/**
+ * Sum io.stat fields over all devices ("MAJ:MIN rbytes=N wbytes=N rios=N wios=N ...")
+ */
+static void parse_io_stat(const char* buf, uint64_t* totals) {
+    memset(totals, 0, sizeof(uint64_t) * IO_FIELD_COUNT);
+
+    for (const char* p = buf; (p = strchr(p, '=')) != NULL; p++) {
+        const char* key = p;
+        while (key > buf && key[-1] != ' ' && key[-1] != '\n') {
+            key--;
+        }
+        for (int f = 0; f < IO_FIELD_COUNT; f++) {
+            if ((size_t)(p - key) == strlen(io_fields[f]) && strncmp(key, io_fields[f], p - key) == 0) {
+                totals[f] += strtoull(p + 1, NULL, 10);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Take one sample of every tracked container: one pread() per open stat file
+ */
+static void sample_all(void) {
+    static char buf[STAT_BUF_SIZE];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int i = container_count - 1; i >= 0; i--) {
+        Container* c = &containers[i];
+
+        // Reads on a removed cgroup fail with ENODEV; inotify may not have told us yet
+        ssize_t n = read_stat(c->fds[FILE_MEMORY_CURRENT], buf, sizeof(buf));
+        if (n < 0 && errno == ENODEV) {
+            drop_container(i);
+            continue;
+        }
+        if (c->pool) {
+            read_claim(c);
+            if (c->idle) {
+                continue;
+            }
+        }
+        if (n > 0) {
+            c->memory_current = strtoull(buf, NULL, 10);
+        }
+
+        if (read_stat(c->fds[FILE_MEMORY_MAX], buf, sizeof(buf)) > 0) {
+            c->memory_max = strncmp(buf, "max", 3) == 0 ? UINT64_MAX : strtoull(buf, NULL, 10);
+        }
+        if (read_stat(c->fds[FILE_MEMORY_STAT], buf, sizeof(buf)) > 0) {
+            parse_keyed(buf, memory_stat_metrics, MEMORY_STAT_COUNT, c->memory_stat);
+        }
+        if (read_stat(c->fds[FILE_CPU_STAT], buf, sizeof(buf)) > 0) {
+            parse_keyed(buf, cpu_stat_metrics, CPU_STAT_COUNT, c->cpu_stat);
+        }
+        if (c->fds[FILE_IO_STAT] >= 0 && read_stat(c->fds[FILE_IO_STAT], buf, sizeof(buf)) >= 0) {
+            parse_io_stat(buf, c->io);
+        }
+        if (read_stat(c->fds[FILE_PIDS_CURRENT], buf, sizeof(buf)) > 0) {
+            c->pids_current = strtoull(buf, NULL, 10);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    last_sample_seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void buf_printf(Buffer* b, const char* fmt, ...) {
+    va_list ap;
+
+    for (;;) {
+        va_start(ap, fmt);
+        int n = vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            return;
+        }
+        if ((size_t)n < b->cap - b->len) {
+            b->len += n;
+            return;
+        }
+        size_t new_cap = b->cap ? b->cap * 2 : 16384;
+        while (new_cap - b->len <= (size_t)n) {
+            new_cap *= 2;
+        }
+        char* grown = realloc(b->data, new_cap);
+        if (grown == NULL) {
+            return;
+        }
+        b->data = grown;
+        b->cap = new_cap;
+    }
+}
+
+static void render_family(Buffer* b, const char* metric, const char* help, const char* type) {
+    buf_printf(b, "# HELP %s %s\n# TYPE %s %s\n", metric, help, metric, type);
+}
+
+/**
+ * Series of a keyed table, grouped by metric name as the exposition format requires
+ */
+static void render_keyed(Buffer* b, const KeyedMetric* table, size_t count, size_t value_offset) {
+    for (size_t k = 0; k < count; k++) {
+        if (table[k].help != NULL) {
+            render_family(b, table[k].metric, table[k].help, table[k].type);
+        }
+        for (int i = 0; i < container_count; i++) {
+            if (containers[i].idle) {
+                continue;
+            }
+            const uint64_t* values = (const uint64_t*)((const char*)&containers[i] + value_offset);
+            if (table[k].label != NULL) {
+                buf_printf(b, "%s{name=\"%s\",type=\"%s\"} %" PRIu64 "\n",
+                           table[k].metric, containers[i].label, table[k].label, values[k]);
+            } else {
+                buf_printf(b, "%s{name=\"%s\"} %" PRIu64 "\n", table[k].metric, containers[i].label, values[k]);
+            }
+        }
+    }
+}
+
+/**
+ * Render the whole /metrics page from the last sample
+ *
+ * Names shared with scripts/monitor.sh --prometheus (status, processes,
+ * memory_bytes) keep their meaning so existing dashboards keep working.
+ */
+static void render_metrics(void) {
+    Buffer* b = &page;
+    b->len = 0;
+
+    render_family(b, "minirun_container_status", "Container status (1=running, 0=stopped)", "gauge");
+    for (int i = 0; i < container_count; i++) {
+        if (containers[i].idle) {
+            continue;
+        }
+        buf_printf(b, "minirun_container_status{name=\"%s\"} %d\n",
+                   containers[i].label, containers[i].pids_current > 0);
+    }
+
+    render_family(b, "minirun_container_processes", "Number of processes in container", "gauge");
+    for (int i = 0; i < container_count; i++) {
+        if (containers[i].idle) {
+            continue;
+        }
+        buf_printf(b, "minirun_container_processes{name=\"%s\"} %" PRIu64 "\n",
+                   containers[i].label, containers[i].pids_current);
+    }
+
+    render_family(b, "minirun_container_memory_bytes", "Container memory usage", "gauge");
+    for (int i = 0; i < container_count; i++) {
+        Container* c = &containers[i];
+        if (c->idle) {
+            continue;
+        }
+        buf_printf(b, "minirun_container_memory_bytes{name=\"%s\",type=\"current\"} %" PRIu64 "\n", c->label, c->memory_current);
+        if (c->memory_max == UINT64_MAX) {
+            buf_printf(b, "minirun_container_memory_bytes{name=\"%s\",type=\"max\"} +Inf\n", c->label);
+        } else {
+            buf_printf(b, "minirun_container_memory_bytes{name=\"%s\",type=\"max\"} %" PRIu64 "\n", c->label, c->memory_max);
+        }
+    }
+
+    render_keyed(b, memory_stat_metrics, MEMORY_STAT_COUNT, offsetof(Container, memory_stat));
+    render_keyed(b, cpu_stat_metrics, CPU_STAT_COUNT, offsetof(Container, cpu_stat));
+
+    render_family(b, "minirun_container_io_bytes_total", "Bytes read/written on all devices (io.stat)", "counter");
+    for (int i = 0; i < container_count; i++) {
+        if (containers[i].idle) {
+            continue;
+        }
+        buf_printf(b, "minirun_container_io_bytes_total{name=\"%s\",op=\"read\"} %" PRIu64 "\n", containers[i].label, containers[i].io[0]);
+        buf_printf(b, "minirun_container_io_bytes_total{name=\"%s\",op=\"write\"} %" PRIu64 "\n", containers[i].label, containers[i].io[1]);
+    }
+    render_family(b, "minirun_container_io_ops_total", "Read/write operations on all devices (io.stat)", "counter");
+    for (int i = 0; i < container_count; i++) {
+        if (containers[i].idle) {
+            continue;
+        }
+        buf_printf(b, "minirun_container_io_ops_total{name=\"%s\",op=\"read\"} %" PRIu64 "\n", containers[i].label, containers[i].io[2]);
+        buf_printf(b, "minirun_container_io_ops_total{name=\"%s\",op=\"write\"} %" PRIu64 "\n", containers[i].label, containers[i].io[3]);
+    }
+
+    render_family(b, "minirun_metricsd_containers", "Container cgroups being tracked", "gauge");
+    buf_printf(b, "minirun_metricsd_containers %d\n", container_count);
+    render_family(b, "minirun_metricsd_sample_seconds", "Time taken by the last sample", "gauge");
+    buf_printf(b, "minirun_metricsd_sample_seconds %.6f\n", last_sample_seconds);
+}
+
+/**
+ * Listen for scrapes on bind_addr:port
+ *
+ * @return Listening socket, or -1 (error printed)
+ */
+static int open_listener(const char* bind_addr, int port) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    int one = 1;
+
+    if (inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1) {
+        fprintf(stderr, "Invalid bind address: %s\n", bind_addr);
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        perror("socket failed");
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        fprintf(stderr, "Cannot listen on %s:%d: %s\n", bind_addr, port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * Answer one HTTP request: GET /metrics gets the pre-rendered page, anything else 404
+ */
+static void serve_client(int listen_fd) {
+    static const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    struct timeval timeout = { .tv_sec = 1 };
+    char request[1024];
+    char header[256];
+
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd == -1) {
+        return;
+    }
+
+    // Don't let a slow client stall sampling for more than a second
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    ssize_t n = read(fd, request, sizeof(request) - 1);
+    if (n <= 0) {
+        close(fd);
+        return;
+    }
+    request[n] = '\0';
+
+    if (strncmp(request, "GET /metrics", 12) != 0 || (request[12] != ' ' && request[12] != '?')) {
+        if (write(fd, not_found, sizeof(not_found) - 1) < 0) {
+            // Client went away
+        }
+        close(fd);
+        return;
+    }
+
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: text/plain; version=0.0.4\r\n"
+                              "Content-Length: %zu\r\n"
+                              "Connection: close\r\n\r\n", page.len);
+    struct iovec iov[2] = {
+        { .iov_base = header, .iov_len = header_len },
+        { .iov_base = page.data, .iov_len = page.len },
+    };
+    if (writev(fd, iov, 2) < 0) {
+        // Client went away
+    }
+    close(fd);
+}
@@ -133,6 +133,10 @@ resource "aws_instance" "minirun" {
     db_user     = var.db_user
     db_password = var.db_password
     db_name     = var.db_name
+    
+    fleet_scheduler = var.node_count > 0 ? var.fleet_scheduler : ""  # Coordinator only with nodes
+    coordinator_url = ""
+    fleet_token     = var.fleet_token
   })
   
   root_block_device {
@@ -152,6 +156,46 @@ resource "aws_instance" "minirun" {
   }
 }
 
+resource "aws_instance" "minirun_node" {
+  count         = var.node_count  # Fleet nodes; the host above schedules starts onto them
+  ami           = var.ami_id
+  instance_type = var.node_instance_type != "" ? var.node_instance_type : var.instance_type
+  subnet_id     = aws_subnet.minirun_public.id
+  
+  vpc_security_group_ids = [aws_security_group.minirun.id]
+  iam_instance_profile   = aws_iam_instance_profile.minirun.name
+  
+  key_name = var.create_key_pair ? aws_key_pair.minirun[0].key_name : var.existing_key_name
+  
+  user_data = templatefile("${path.module}/user-data.sh", {  # Same setup, run as a node agent
+    db_host     = ""  # Each node keeps its own state store
+    db_port     = ""
+    db_user     = ""
+    db_password = ""
+    db_name     = ""
+    
+    fleet_scheduler = ""
+    coordinator_url = "http://${aws_instance.minirun.private_ip}:8080"  # Heartbeats over the VPC
+    fleet_token     = var.fleet_token
+  })
+  
+  root_block_device {
+    volume_size = 30
+    volume_type = "gp3"
+    encrypted   = true
+  }
+  
+  tags = {
+    Name        = "minirun-node-${count.index}"
+    Project     = "MiniRun"
+    Environment = var.environment
+  }
+  
+  lifecycle {
+    ignore_changes = [ami]
+  }
+}
+
 resource "aws_eip" "minirun" {
   count    = var.enable_elastic_ip ? 1 : 0  # Static IP (optional, default: enabled)
   instance = aws_instance.minirun.id
@@ -178,6 +222,11 @@ output "instance_private_ip" {
   value       = aws_instance.minirun.private_ip
 }
 
+output "node_private_ips" {
+  description = "Private IPs of the fleet nodes (GET /nodes on the API lists them once they heartbeat)"
+  value       = aws_instance.minirun_node[*].private_ip
+}
+
 output "api_url" {
   description = "Direct URL to access MiniRun API"
   value       = "http://${var.enable_elastic_ip ? aws_eip.minirun[0].public_ip : aws_instance.minirun.public_ip}:8080"
@@ -35,6 +35,7 @@ fi
 echo "Building container runtime..."
 mkdir -p bin
 gcc -o bin/container_runtime src/container_runtime.c -Wall -Wextra  # Compile C runtime
+gcc -o bin/minirun-metricsd src/minirun_metricsd.c -Wall -Wextra -O2  # Compile metrics exporter
 
 chmod +x scripts/*.sh minirun tests/run_tests.sh  # Make scripts executable
 
@@ -46,7 +47,7 @@ fi
 echo "Building Go orchestrator..."
 cd orchestrator
 go mod download  # Download dependencies
-go build -o minirun-api main.go  # Build API binary
+go build -o minirun-api .  # Build API binary (all package files)
 
 mkdir -p /etc/minirun  # Create config directory
 
@@ -57,8 +58,18 @@ DB_PORT=${db_port}
 DB_USER=${db_user}
 DB_PASSWORD=${db_password}
 DB_NAME=${db_name}
+FLEET_SCHEDULER=${fleet_scheduler}
+COORDINATOR_URL=${coordinator_url}
+FLEET_TOKEN=${fleet_token}
 EOF
 
+if [ -n "${coordinator_url}" ]; then
+    echo "Configuring fleet node agent..."
+    IMDS_TOKEN=$(curl -s -X PUT http://169.254.169.254/latest/api/token -H "X-aws-ec2-metadata-token-ttl-seconds: 300")
+    PRIVATE_IP=$(curl -s -H "X-aws-ec2-metadata-token: $IMDS_TOKEN" http://169.254.169.254/latest/meta-data/local-ipv4)
+    echo "NODE_ADDR=http://$PRIVATE_IP:8080" >> /etc/minirun/env.conf  # Where the coordinator forwards starts
+fi
+
 echo "Creating systemd service..."
 cat > /etc/systemd/system/minirun-api.service << 'EOF'
 [Unit]
@@ -109,14 +120,25 @@ EOF
 mkdir -p /var/log/minirun
 
 echo "Setting up monitoring..."
-cat > /usr/local/bin/minirun-monitor << 'EOF'
-#!/bin/bash
-cd /opt/minirun
-./scripts/monitor.sh --format json > /var/log/minirun/metrics.json
+cat > /etc/systemd/system/minirun-metricsd.service << 'EOF'
+[Unit]
+Description=MiniRun Container Metrics Exporter
+After=network.target
+
+[Service]
+Type=simple
+User=root
+ExecStart=/opt/minirun/bin/minirun-metricsd --interval 5000 --port 9101
+Restart=on-failure
+RestartSec=10
+
+[Install]
+WantedBy=multi-user.target
 EOF
-chmod +x /usr/local/bin/minirun-monitor
 
-echo "*/5 * * * * /usr/local/bin/minirun-monitor" | crontab -  # Run every 5 minutes
+systemctl daemon-reload
+systemctl enable minirun-metricsd  # Replaces the monitor.sh cron job
+systemctl start minirun-metricsd
 
 apt-get install -y fail2ban  # Install SSH brute-force protection
 systemctl enable fail2ban
@@ -144,6 +166,7 @@ Management Commands:
   - View Logs:       journalctl -u minirun-api -f
   - Restart Service: systemctl restart minirun-api
   - Monitor:         /opt/minirun/scripts/monitor.sh
+  - Metrics:         curl http://localhost:9101/metrics
 
 Project Directory: /opt/minirun
 
@@ -81,4 +81,34 @@ variable "db_name" {
   description = "PostgreSQL database name"
   type        = string
   default     = "minirun"
+}
+
+variable "node_count" {
+  description = "Fleet nodes started next to the API host (0 = single host)"
+  type        = number
+  default     = 0
+}
+
+variable "node_instance_type" {
+  description = "EC2 instance type of the fleet nodes (empty = instance_type)"
+  type        = string
+  default     = ""
+}
+
+variable "fleet_scheduler" {
+  description = "How the API host places starts on nodes: least-loaded or binpack"
+  type        = string
+  default     = "least-loaded"  # Spread load; binpack keeps whole nodes free for large containers
+  
+  validation {
+    condition     = contains(["least-loaded", "binpack"], var.fleet_scheduler)
+    error_message = "fleet_scheduler must be least-loaded or binpack."
+  }
+}
+
+variable "fleet_token" {
+  description = "Shared token that authenticates heartbeats and forwarded starts between the API host and nodes"
+  type        = string
+  sensitive   = true  # Hidden in Terraform output
+  default     = ""
 }
\ No newline at end of file
@@ -0,0 +1,208 @@
+/*
+ * Cgroup churn benchmark: mkdir/rmdir per container vs the warm cgroup pool
+ *
+ * Simulates a host running many short-lived containers: --parallel worker
+ * processes (each standing in for one runtime) start and stop containers until
+ * --containers have run in total. One start/stop is the cgroup work the runtime
+ * does around a container: cgroup_open() and the default limits, a child that
+ * joins cgroup.procs and exits, then cleanup_cgroups(). The baseline creates
+ * and removes minirun-<name> every time; with --cgroup-pool semantics each
+ * worker reuses a minirun-pool-<n> slot that the reaper drains and resets.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -DMINIRUN_NO_MAIN -o bin/bench_cgroup_churn tests/bench/bench_cgroup_churn.c
+ *
+ * Run:
+ *   sudo ./bin/bench_cgroup_churn [--containers N] [--parallel N] [--root DIR]
+ *
+ * Everything happens below a private minirun-bench-churn parent cgroup with its
+ * own run-state directory, so a production pool on the same host is never
+ * touched. --root picks another cgroup v2 mount (e.g. the controller-less
+ * /sys/fs/cgroup/unified of a hybrid host: no limits, same mkdir/rmdir cost).
+ */
+
+#include "../../src/container_runtime.c"
+
+#include <dirent.h>
+
+#define BENCH_PARENT "minirun-bench-churn"
+
+/**
+ * Start and stop `count` containers' worth of cgroups from one process
+ *
+ * @return Number of start/stop cycles whose cgroup could not be used
+ */
+static int churn_worker(int worker, int count, int pool_slots) {
+    CgroupLimitSet limits;
+    char name[64];
+    int failed = 0;
+
+    cgroup_limits_init(&limits, DEFAULT_MEMORY_LIMIT, DEFAULT_CPU_PERCENT, DEFAULT_CPU_PERIOD);
+    if (pool_slots > 0 && cgroup_pool_init(pool_slots) != 0) {
+        return count;
+    }
+
+    for (int i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "churn-%d-%d", worker, i);
+
+        CgroupHandle cg;
+        if (cgroup_open(&cg, name) != 0) {
+            failed++;
+            continue;
+        }
+        // Limits are written the way cgroup_apply_limits() does, minus its warnings
+        // on roots without controllers
+        for (int k = 0; k < limits.count; k++) {
+            cgroup_write(&cg, limits.knob[k], limits.value[k]);
+        }
+
+        // A container that does nothing: join the cgroup, exit
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(cgroup_add_process(&cg, getpid()) == 0 ? 0 : 1);
+        }
+        int status;
+        if (pid == -1 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed++;
+        }
+
+        cgroup_close(&cg);
+        cleanup_cgroups(name);
+    }
+    return failed;
+}
+
+/**
+ * Run `containers` start/stops from `parallel` processes at once
+ *
+ * @return Wall time in ms (failed cycles are added to *failed)
+ */
+static double run_churn(int containers, int parallel, int pool_slots, int* failed) {
+    struct timespec start, end;
+    pid_t workers[256];
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int w = 0; w < parallel; w++) {
+        int count = containers / parallel + (w < containers % parallel);
+        workers[w] = fork();
+        if (workers[w] == 0) {
+            int bad = churn_worker(w, count, pool_slots);
+            _exit(bad > 255 ? 255 : bad);
+        }
+    }
+    for (int w = 0; w < parallel; w++) {
+        int status;
+        if (workers[w] > 0 && waitpid(workers[w], &status, 0) == workers[w] && WIFEXITED(status)) {
+            *failed += WEXITSTATUS(status);
+        } else {
+            (*failed)++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+/**
+ * Remove whatever the runs left below the bench parent (pool slots, stragglers)
+ */
+static int remove_leftovers(void) {
+    DIR* dir = opendir(cgroup_root);
+    struct dirent* entry;
+    char path[PATH_MAX];
+    int left = 0;
+
+    if (dir == NULL) {
+        return 0;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "minirun-", 8) == 0) {
+            int is_pool = strncmp(entry->d_name, "minirun-pool-", 13) == 0;
+            snprintf(path, sizeof(path), "%s/%s", cgroup_root, entry->d_name);
+            if (rmdir(path) == 0 && !is_pool) {
+                left++;  // A per-container cgroup that cleanup_cgroups() couldn't remove
+            }
+        }
+    }
+    closedir(dir);
+    return left;
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"containers", required_argument, 0, 'n'},
+        {"parallel",   required_argument, 0, 'j'},
+        {"root",       required_argument, 0, 'R'},
+        {0, 0, 0, 0}
+    };
+    int containers = 1000;
+    int parallel = 50;
+    const char* root = CGROUP_ROOT;
+    char parent[PATH_MAX];
+    char state_dir[] = "/tmp/minirun-churn-XXXXXX";
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                containers = atoi(optarg);
+                break;
+            case 'j':
+                parallel = atoi(optarg);
+                break;
+            case 'R':
+                root = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [--containers N] [--parallel N] [--root DIR]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (containers < 1 || parallel < 1 || parallel > 256 || parallel > containers) {
+        fprintf(stderr, "Need 1 <= --parallel <= min(256, --containers)\n");
+        return 1;
+    }
+
+    // Private parent cgroup with the controllers delegated to it
+    cgroup_root = root;
+    if (!cgroups_v2_available()) {
+        fprintf(stderr, "❌ No cgroup v2 hierarchy at %s, use --root DIR\n", root);
+        return 1;
+    }
+    enable_cgroup_controllers();
+    snprintf(parent, sizeof(parent), "%s/" BENCH_PARENT, root);
+    if ((mkdir(parent, 0755) != 0 && errno != EEXIST) || mkdtemp(state_dir) == NULL) {
+        fprintf(stderr, "❌ Cannot create %s: %s\n", parent, strerror(errno));
+        return 1;
+    }
+    cgroup_root = parent;
+    cgroup_pool_dir = state_dir;
+    enable_cgroup_controllers();
+
+    int failed[2] = { 0, 0 };
+    double wall[2];
+    int left[2];
+    wall[0] = run_churn(containers, parallel, 0, &failed[0]);
+    left[0] = remove_leftovers();
+    wall[1] = run_churn(containers, parallel, parallel, &failed[1]);
+    left[1] = remove_leftovers();
+
+    // Run-state files of the pool, then the bench parent itself
+    for (int slot = 0; slot < parallel; slot++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/pool-%d", state_dir, slot);
+        unlink(path);
+    }
+    rmdir(state_dir);
+    rmdir(parent);
+
+    const char* modes[] = { "mkdir_rmdir", "pool" };
+    printf("{\"root\": \"%s\", \"containers\": %d, \"parallel\": %d, \"results\": [", root, containers, parallel);
+    for (int m = 0; m < 2; m++) {
+        printf("%s\n  {\"mode\": \"%s\", \"wall_ms\": %.1f, \"starts_per_sec\": %.0f, \"failed\": %d, \"leftover\": %d}",
+               m ? "," : "", modes[m], wall[m], containers / (wall[m] / 1000), failed[m], left[m]);
+    }
+    printf("\n], \"speedup\": %.2f}\n", wall[0] / wall[1]);
+
+    return 0;
+}
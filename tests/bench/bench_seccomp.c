@@ -0,0 +1,202 @@
+/*
+ * Seccomp benchmark: what a --seccomp profile costs per start and per syscall
+ *
+ * Per start, the runtime either compiles the profile (seccomp_compile(), first
+ * start after a change) or finds it in the cache (seccomp_load() with nothing
+ * loaded yet: profile read + hash + cache file read). Both are timed.
+ *
+ * Per syscall, the filter runs in the kernel on every call the container
+ * makes. getppid() is timed without a filter, under the runtime's binary
+ * search program and under a linear one (one compare per listed syscall, the
+ * layout of a naive filter), each in a forked child since a filter can't be
+ * removed. The profile allows every syscall the runtime knows by name except
+ * a handful, with everything else failing, like a typical allowlist.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -DMINIRUN_NO_MAIN -o bin/bench_seccomp tests/bench/bench_seccomp.c
+ *
+ * Run:
+ *   ./bin/bench_seccomp [--iterations N] [--calls N]
+ *
+ * The cache goes to a temporary directory, not SECCOMP_CACHE_DIR.
+ */
+
+#include "../../src/container_runtime.c"
+
+// Left out of the allowlist, so the ranges are split as in real profiles
+static const char* const denied[] = {
+    "ptrace", "mount", "umount2", "pivot_root", "reboot", "kexec_load", "init_module", "bpf",
+    "perf_event_open", "keyctl", "unshare", "setns", "userfaultfd", "open_by_handle_at",
+};
+
+static double elapsed_ns(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static int is_denied(const char* name) {
+    for (size_t i = 0; i < sizeof(denied) / sizeof(denied[0]); i++) {
+        if (strcmp(denied[i], name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Time getppid() in a child, under prog if given
+ *
+ * @return ns per call, or -1 if the filter could not be installed
+ */
+static double time_syscall(const struct sock_fprog* prog, long calls) {
+    int fds[2];
+    double ns = -1;
+
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        struct timespec start, end;
+        double result = -1;
+        close(fds[0]);
+        if (prog == NULL || seccomp_install(prog) == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (long i = 0; i < calls; i++) {
+                syscall(SYS_getppid);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            result = elapsed_ns(&start, &end) / calls;
+        }
+        _exit(write(fds[1], &result, sizeof(result)) == sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    if (pid > 0 && read(fds[0], &ns, sizeof(ns)) != sizeof(ns)) {
+        ns = -1;
+    }
+    close(fds[0]);
+    if (pid > 0) {
+        waitpid(pid, NULL, 0);
+    }
+    return ns;
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"iterations", required_argument, 0, 'n'},
+        {"calls",      required_argument, 0, 'c'},
+        {0, 0, 0, 0}
+    };
+    long iterations = 2000;
+    long calls = 2000000;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                iterations = atol(optarg);
+                break;
+            case 'c':
+                calls = atol(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [--iterations N] [--calls N]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (iterations < 1 || calls < 1) {
+        fprintf(stderr, "--iterations and --calls must be at least 1\n");
+        return 1;
+    }
+
+    // Allowlist profile, and the linear program a naive compiler would emit for it
+    size_t names = sizeof(syscall_names) / sizeof(syscall_names[0]);
+    char* text = malloc(names * 32 + 64);
+    struct sock_filter* linear = malloc((names * 2 + 8) * sizeof(struct sock_filter));
+    int listed = 0, len = 0;
+    if (text == NULL || linear == NULL) {
+        perror("malloc failed");
+        return 1;
+    }
+    strcpy(text, "default errno\nallow");
+    linear[len++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch));
+    linear[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_AUDIT_ARCH, 1, 0);
+    linear[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS);
+    linear[len++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr));
+    for (size_t nr = 0; nr < names; nr++) {
+        if (syscall_names[nr] == NULL || is_denied(syscall_names[nr])) {
+            continue;
+        }
+        strcat(strcat(text, " "), syscall_names[nr]);
+        linear[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, nr, 0, 1);
+        linear[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+        listed++;
+    }
+    strcat(text, "\n");
+    linear[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EPERM);
+    if (listed == 0) {
+        fprintf(stderr, "No syscall names on this architecture\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/minirun-bench-seccomp-XXXXXX";
+    char profile[PATH_MAX];
+    if (mkdtemp(dir) == NULL) {
+        perror("mkdtemp failed");
+        return 1;
+    }
+    seccomp_cache_dir = dir;
+    snprintf(profile, sizeof(profile), "%s/allowlist.profile", dir);
+    FILE* f = fopen(profile, "w");
+    if (f == NULL || fputs(text, f) == EOF || fclose(f) != 0) {
+        perror("Cannot write profile");
+        return 1;
+    }
+
+    struct timespec start, end;
+    struct sock_filter* filter = NULL;
+    int count = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        free(filter);
+        count = seccomp_compile(text, profile, &filter);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double compile_us = elapsed_ns(&start, &end) / iterations / 1000;
+
+    // First load compiles and writes the cache file; then every load is a cache hit
+    const struct sock_fprog* tree = seccomp_load(profile);
+    if (count < 0 || tree == NULL) {
+        return 1;
+    }
+    struct sock_fprog cached = *tree;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        free(seccomp_profiles[0].path);
+        free(seccomp_profiles[0].prog.filter);
+        seccomp_profiles[0].path = NULL;
+        if (seccomp_load(profile) == NULL) {
+            return 1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double load_us = elapsed_ns(&start, &end) / iterations / 1000;
+    cached = seccomp_profiles[0].prog;
+
+    struct sock_fprog naive = { .len = len, .filter = linear };
+    double none_ns = time_syscall(NULL, calls);
+    double tree_ns = time_syscall(&cached, calls);
+    double linear_ns = time_syscall(&naive, calls);
+
+    printf("{\"listed_syscalls\": %d, \"compile_us\": %.1f, \"cache_load_us\": %.1f, "
+           "\"tree_instructions\": %d, \"linear_instructions\": %d, "
+           "\"getppid_ns\": {\"none\": %.1f, \"tree\": %.1f, \"linear\": %.1f}}\n",
+           listed, compile_us, load_us, cached.len, len, none_ns, tree_ns, linear_ns);
+
+    char cache_file[PATH_MAX];
+    snprintf(cache_file, sizeof(cache_file), "%s/%016llx.bpf", dir,
+             (unsigned long long)seccomp_hash(text, strlen(text)));
+    unlink(cache_file);
+    unlink(profile);
+    rmdir(dir);
+    return tree_ns < 0 || linear_ns < 0 ? 1 : 0;
+}
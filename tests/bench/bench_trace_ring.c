@@ -0,0 +1,92 @@
+/*
+ * Trace ring benchmark: cost of one trace_event() and of one trace_flush()
+ *
+ * trace_event() is called at every start-up step, so it has to stay in the
+ * tens of nanoseconds: one CLOCK_MONOTONIC read (vDSO) and a few stores. The
+ * clock read alone is reported as clock_ns; under a hypervisor it is often
+ * most of event_ns.
+ *
+ * trace_flush() runs once per process (exit, signal, exec) and copies the
+ * recorded events into the shared ring.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -DMINIRUN_NO_MAIN -o bin/bench_trace_ring tests/bench/bench_trace_ring.c
+ *
+ * Run:
+ *   sudo ./bin/bench_trace_ring [--events N]
+ *
+ * Flushes go to the host-wide ring, so a run shows up in --trace-dump as
+ * "bench-trace" events.
+ */
+
+#include "../../src/container_runtime.c"
+
+static double elapsed_ns(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"events", required_argument, 0, 'n'},
+        {0, 0, 0, 0}
+    };
+    long events = 10000000;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                events = atol(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [--events N]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (events < TRACE_RING_EVENTS) {
+        fprintf(stderr, "Need --events >= %d\n", TRACE_RING_EVENTS);
+        return 1;
+    }
+
+    trace_ring.pid = getpid();
+    trace_ring.shm = trace_ring_map(1);
+    if (trace_ring.shm == NULL) {
+        fprintf(stderr, "❌ Cannot map %s: %s\n", TRACE_RING_PATH, strerror(errno));
+        return 1;
+    }
+
+    struct timespec start, end, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < events; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double clock_ns = elapsed_ns(&start, &end) / events;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < events; i++) {
+        trace_event(TRACE_CHILD + i % 5, 0, "bench-trace", NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double event_ns = elapsed_ns(&start, &end) / events;
+
+    // A full ring per flush, as many times as the events above allow
+    int flushes = 0;
+    double flush_ns = 0;
+    for (long done = 0; done + TRACE_RING_EVENTS <= events && flushes < 1000; done += TRACE_RING_EVENTS) {
+        for (int i = 0; i < TRACE_RING_EVENTS; i++) {
+            trace_event(TRACE_CHILD + i % 5, 0, "bench-trace", NULL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        trace_flush();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        flush_ns += elapsed_ns(&start, &end);
+        flushes++;
+    }
+
+    printf("{\"events\": %ld, \"clock_ns\": %.1f, \"event_ns\": %.1f, \"flushes\": %d, \"flush_events\": %d, "
+           "\"flush_us\": %.2f, \"flush_ns_per_event\": %.1f}\n",
+           events, clock_ns, event_ns, flushes, TRACE_RING_EVENTS, flush_ns / flushes / 1000,
+           flush_ns / flushes / TRACE_RING_EVENTS);
+    return 0;
+}
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""
+Bulk API benchmark: creates (and starts) per second, one request each vs POST /bulk
+
+Creates N containers on an orchestrator twice: first with one POST /containers
+per container from --concurrency clients (a new connection per request, like a
+control plane that sends bursts of single calls), then as one NDJSON stream to
+POST /bulk on a single connection. With --start every container is started
+too (POST /containers/{name}/start, or a start line after its create).
+
+Reports requests (operations) per second for both as JSON. Every container is
+deleted again afterwards.
+
+Usage: ./tests/bench/bulk_throughput.py [--api URL] [--count N] [--concurrency N] [--start]
+"""
+
+import sys
+import json
+import time
+import argparse
+import http.client
+import urllib.error
+import urllib.parse
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+
+DEFAULT_API = "http://localhost:8080"
+
+
+def request(method, url, body=None, timeout=30):
+    """JSON request on a new connection; returns (status, parsed body)"""
+    data = json.dumps(body).encode() if body is not None else None
+    req = urllib.request.Request(url, data=data, method=method, headers={"Content-Type": "application/json"})
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as resp:
+            return resp.status, json.loads(resp.read() or b"{}")
+    except urllib.error.HTTPError as err:
+        return err.code, json.loads(err.read() or b"{}")
+
+
+def single(api, names, command, concurrency, start):
+    """One request per operation; returns (seconds, failed operations)"""
+    def run(name):
+        failed = 0
+        status, _ = request("POST", f"{api}/containers", {"name": name, "command": command})
+        failed += status != 200
+        if start:
+            status, _ = request("POST", f"{api}/containers/{name}/start")
+            failed += status != 202
+        return failed
+
+    began = time.time()
+    with ThreadPoolExecutor(max_workers=concurrency) as pool:
+        failed = sum(pool.map(run, names))
+    return time.time() - began, failed
+
+
+def bulk(api, names, command, start):
+    """All operations as one streamed POST /bulk; returns (seconds, failed operations)"""
+    def chunks(per_chunk=256):
+        # Buffered like any client would, not one write per line
+        lines = []
+        for name in names:
+            lines.append(json.dumps({"op": "create", "name": name, "command": command}))
+            if start:
+                lines.append(json.dumps({"op": "start", "name": name}))
+            if len(lines) >= per_chunk:
+                yield ("\n".join(lines) + "\n").encode()
+                lines = []
+        if lines:
+            yield ("\n".join(lines) + "\n").encode()
+
+    url = urllib.parse.urlsplit(api)
+    conn_type = http.client.HTTPSConnection if url.scheme == "https" else http.client.HTTPConnection
+    conn = conn_type(url.netloc, timeout=120)
+    began = time.time()
+    # A generator body goes out chunked, as it is produced
+    conn.request("POST", "/bulk", body=chunks(), headers={"Content-Type": "application/x-ndjson"},
+                 encode_chunked=True)
+    resp = conn.getresponse()
+    failed = 0
+    expected = len(names) * (2 if start else 1)
+    results = 0
+    for line in resp:
+        result = json.loads(line)
+        results += 1
+        failed += result["status"] not in (200, 202)
+    elapsed = time.time() - began
+    conn.close()
+    return elapsed, failed + expected - results
+
+
+def cleanup(api, names, concurrency):
+    with ThreadPoolExecutor(max_workers=concurrency) as pool:
+        list(pool.map(lambda name: request("DELETE", f"{api}/containers/{name}"), names))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare single-request and bulk creates/starts per second")
+    parser.add_argument("--api", default=DEFAULT_API, help=f"Orchestrator URL (default: {DEFAULT_API})")
+    parser.add_argument("--count", type=int, default=2000, help="Containers per mode (default: 2000)")
+    parser.add_argument("--concurrency", type=int, default=16, help="Clients in single mode (default: 16)")
+    parser.add_argument("--command", default="/bin/echo", help="Command of each container")
+    parser.add_argument("--start", action="store_true", help="Start every container as well")
+    parser.add_argument("--bulk-only", action="store_true", help="Skip single mode (e.g. to compare servers)")
+    parser.add_argument("--single-only", action="store_true", help="Skip bulk mode (servers without /bulk)")
+    args = parser.parse_args()
+    api = args.api.rstrip("/")
+
+    status, _ = request("GET", f"{api}/health")
+    if status != 200:
+        print(f"Orchestrator not reachable at {api}", file=sys.stderr)
+        return 1
+
+    ops = args.count * (2 if args.start else 1)
+    report = {"api": api, "count": args.count, "operations": ops, "start": args.start}
+    for mode in ("single", "bulk"):
+        if (mode == "single" and args.bulk_only) or (mode == "bulk" and args.single_only):
+            continue
+        names = [f"bulk-bench-{mode}-{i}" for i in range(args.count)]
+        try:
+            if mode == "single":
+                elapsed, failed = single(api, names, args.command, args.concurrency, args.start)
+            else:
+                elapsed, failed = bulk(api, names, args.command, args.start)
+        finally:
+            cleanup(api, names, args.concurrency)
+        report[mode] = {"seconds": round(elapsed, 3), "failed": failed, "ops_per_sec": round(ops / elapsed, 1)}
+
+    if "single" in report and "bulk" in report:
+        report["speedup"] = round(report["bulk"]["ops_per_sec"] / report["single"]["ops_per_sec"], 1)
+    print(json.dumps(report, indent=2))
+    return 0 if all(report[m]["failed"] == 0 for m in ("single", "bulk") if m in report) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
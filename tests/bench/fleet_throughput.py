@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""
+Fleet throughput benchmark: container starts per second through the API
+
+Creates N containers on an orchestrator, starts them from a pool of concurrent
+clients and waits until every one has been launched (GET /containers/{name}/process
+shows it running or exited). Point it at a fleet coordinator to measure the whole
+fleet, and at a single host to get the baseline to compare against.
+
+Reports starts/s overall and per node (from GET /nodes on a coordinator,
+1 node otherwise) as JSON, along with how the starts were spread across nodes.
+Starts refused with 429/503 are retried after their Retry-After.
+
+Usage: ./tests/bench/fleet_throughput.py [--api URL] [--count N] [--concurrency N] [--command CMD]
+"""
+
+import sys
+import json
+import time
+import argparse
+import urllib.error
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+
+DEFAULT_API = "http://localhost:8080"
+
+
+def request(method, url, body=None, timeout=30):
+    """JSON request; returns (status, parsed body, headers)"""
+    data = json.dumps(body).encode() if body is not None else None
+    req = urllib.request.Request(url, data=data, method=method, headers={"Content-Type": "application/json"})
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as resp:
+            return resp.status, json.loads(resp.read() or b"{}"), resp.headers
+    except urllib.error.HTTPError as err:
+        return err.code, json.loads(err.read() or b"{}"), err.headers
+
+
+def start(api, name):
+    """Start one container, retrying while the fleet is saturated; returns the node that took it"""
+    while True:
+        status, body, headers = request("POST", f"{api}/containers/{name}/start")
+        if status == 202:
+            return headers.get("X-Minirun-Node", "local")
+        if status in (429, 503):
+            time.sleep(float(headers.get("Retry-After", "1")))
+            continue
+        raise RuntimeError(f"start {name}: {status} {body.get('message')}")
+
+
+def wait_launched(api, name, timeout):
+    """Poll until the container has left the launch queue"""
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        status, body, _ = request("GET", f"{api}/containers/{name}/process")
+        if status == 200 and body["data"]["status"] in ("running", "stopped", "failed"):
+            return True
+        time.sleep(0.05)
+    return False
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure container starts/s through an orchestrator or fleet")
+    parser.add_argument("--api", default=DEFAULT_API, help=f"Orchestrator URL (default: {DEFAULT_API})")
+    parser.add_argument("--count", type=int, default=200, help="Containers to start (default: 200)")
+    parser.add_argument("--concurrency", type=int, default=32, help="Concurrent clients (default: 32)")
+    parser.add_argument("--command", default="/bin/echo", help="Command run in each container")
+    parser.add_argument("--timeout", type=float, default=120.0, help="Seconds to wait for all launches")
+    args = parser.parse_args()
+    api = args.api.rstrip("/")
+
+    status, body, _ = request("GET", f"{api}/health")
+    if status != 200:
+        print(f"Orchestrator not reachable at {api}", file=sys.stderr)
+        return 1
+    status, body, _ = request("GET", f"{api}/nodes")
+    nodes = [n["name"] for n in body["data"]["nodes"] if n["alive"]] if status == 200 else []
+
+    names = [f"fleet-bench-{i}" for i in range(args.count)]
+    for name in names:
+        status, body, _ = request("POST", f"{api}/containers", {"name": name, "command": args.command})
+        if status not in (200, 409):
+            print(f"create {name}: {status} {body.get('message')}", file=sys.stderr)
+            return 1
+
+    placed = {}
+    launched = 0
+    try:
+        began = time.time()
+        with ThreadPoolExecutor(max_workers=args.concurrency) as pool:
+            for node in pool.map(lambda name: start(api, name), names):
+                placed[node] = placed.get(node, 0) + 1
+            launched = sum(pool.map(lambda name: wait_launched(api, name, args.timeout), names))
+        elapsed = time.time() - began
+    finally:
+        for name in names:
+            request("DELETE", f"{api}/containers/{name}")
+
+    node_count = max(1, len(nodes))
+    report = {
+        "api": api,
+        "count": args.count,
+        "launched": launched,
+        "seconds": round(elapsed, 3),
+        "starts_per_sec": round(launched / elapsed, 1),
+        "nodes": node_count,
+        "starts_per_sec_per_node": round(launched / elapsed / node_count, 1),
+        "placement": placed,
+    }
+    print(json.dumps(report, indent=2))
+    return 0 if launched == args.count else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,505 @@
+#!/usr/bin/env python3
+"""
+Load and soak benchmark: runtime, CLI and orchestrator together
+
+Runs src/hello.c and src/memory_hog.c as container payloads through every
+layer from --concurrency parallel clients, then keeps the whole stack busy
+for --duration seconds and watches what grows:
+
+    runtime  container_runtime --exec /bin/hello
+    memory   container_runtime --memory 32M --exec /bin/memory_hog, which its
+             own cgroup OOM-kills after a few seconds (needs cgroup v2)
+    cli      minirun start of a created hello container
+    api      POST /containers, POST /containers/{name}/start until the process
+             has exited, GET /containers/{name} and DELETE on the orchestrator
+    soak     the api cycle in a loop, sampling the orchestrator's RSS, open fds
+             and threads, minirun-* cgroups, host mounts and runtime processes
+             every --sample-interval seconds
+
+Every phase reports operations per second and a latency histogram (p50/p95/
+p99, max and counts per bucket). The api phase also reports the storage the
+orchestrator uses (file or postgresql), so runs against both show what the
+database costs. At the end the harness waits for the runtimes to exit and
+counts what they left behind: cgroups and mounts that weren't there before,
+and runtime processes still running.
+
+With --baseline (the --output of an earlier run) every operations-per-second
+figure that fell, and every p50/p95 latency or RSS growth that rose, by more
+than --tolerance is a regression and the exit code is 1 (p99 and max are
+reported but too noisy to gate on). Compare against a baseline from the same
+hardware: CI uses the soak.json of the last successful main-branch run. Leaks
+fail the run with or without a baseline.
+
+With --orchestrator BIN the harness runs its own orchestrator (on :8080),
+pointed at this checkout with MINIRUN_ROOT, and samples its RSS; with --api it
+uses a running one and leaves RSS out. The api and soak phases are skipped if
+neither is reachable. $MINIRUN_ROOT also sets the checkout the harness itself
+takes the runtime, minirun and rootfs from (default: the one it is in).
+
+Requires root (namespaces + cgroups).
+
+Usage: sudo ./tests/bench/soak.py [--iterations N] [--concurrency N] [--duration S]
+           [--phases LIST] [--orchestrator BIN | --api URL] [--output FILE] [--baseline FILE]
+"""
+
+import os
+import sys
+import json
+import time
+import shutil
+import argparse
+import tempfile
+import threading
+import subprocess
+import urllib.error
+import urllib.request
+from pathlib import Path
+from concurrent.futures import ThreadPoolExecutor
+
+from start_latency import percentile
+
+PROJECT_ROOT = Path(os.environ.get("MINIRUN_ROOT") or Path(__file__).resolve().parent.parent.parent).resolve()
+RUNTIME_BIN = PROJECT_ROOT / "bin" / "container_runtime"
+MINIRUN = PROJECT_ROOT / "minirun"
+PAYLOADS = {"hello": PROJECT_ROOT / "src" / "hello.c", "memory_hog": PROJECT_ROOT / "src" / "memory_hog.c"}
+DEFAULT_ROOTFS = PROJECT_ROOT / "myroot"
+DEFAULT_API = "http://localhost:8080"
+CGROUP_ROOT = "/sys/fs/cgroup"  # CGROUP_ROOT in container_runtime.c
+PHASES = ["runtime", "memory", "cli", "api", "soak"]
+
+# Latency histogram bucket bounds (ms); the last bucket is everything above
+BUCKETS_MS = [1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000]
+
+# Absolute slack under which a change is noise, whatever --tolerance says
+LATENCY_SLACK_MS = 1.0
+RSS_SLACK_KB = 4096
+
+
+def summarize(samples_ms, failed, wall_s=None):
+    """Throughput (over wall_s, if given) and latency histogram of one phase"""
+    report = {"ops": len(samples_ms), "failed": failed}
+    if wall_s:
+        report["per_sec"] = round(len(samples_ms) / wall_s, 1)
+    if not samples_ms:
+        return report
+    counts = [0] * (len(BUCKETS_MS) + 1)
+    for ms in samples_ms:
+        counts[next((i for i, bound in enumerate(BUCKETS_MS) if ms <= bound), len(BUCKETS_MS))] += 1
+    report.update({
+        "p50_ms": round(percentile(samples_ms, 50), 3),
+        "p95_ms": round(percentile(samples_ms, 95), 3),
+        "p99_ms": round(percentile(samples_ms, 99), 3),
+        "max_ms": round(max(samples_ms), 3),
+        "histogram_ms": {f"le_{bound}": count for bound, count in zip(BUCKETS_MS + ["inf"], counts)},
+    })
+    return report
+
+
+def spread(iterations, concurrency, client_fn):
+    """Run `iterations` operations over `concurrency` clients; client_fn(client, runs) returns
+    (latencies in ms, failures). Returns the phase summary."""
+    runs = [iterations // concurrency + (c < iterations % concurrency) for c in range(concurrency)]
+    start = time.monotonic()
+    with ThreadPoolExecutor(max_workers=concurrency) as pool:
+        # subprocess.run() and urllib release the GIL while they wait, so threads are enough
+        results = list(pool.map(lambda c: client_fn(c, runs[c]), range(concurrency)))
+    wall_s = time.monotonic() - start
+    samples = [ms for latencies, _ in results for ms in latencies]
+    return summarize(samples, sum(failed for _, failed in results), wall_s)
+
+
+def timed_run(cmd, timeout=60, cgroup=None):
+    """Run a command; returns (ms, exit code), exit code None on timeout. A runtime
+    that times out with its container's cgroup given has the cgroup killed
+    (cgroup.kill), so it still reaps the container and removes the cgroup."""
+    start = time.monotonic()
+    proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        code = proc.wait(timeout=timeout)
+    except subprocess.TimeoutExpired:
+        code = None
+        try:
+            with open(f"{CGROUP_ROOT}/{cgroup}/cgroup.kill", "w") as f:
+                f.write("1")
+        except (OSError, TypeError):
+            proc.kill()
+        proc.wait()
+    return (time.monotonic() - start) * 1000, code
+
+
+def build_rootfs(base, workdir):
+    """Copy the rootfs and add the payloads as /bin/hello and /bin/memory_hog"""
+    rootfs = Path(workdir) / "rootfs"
+    shutil.copytree(base, rootfs, symlinks=True)
+    for name, src in PAYLOADS.items():
+        compile_cmd = ["gcc", "-O2", "-o", str(rootfs / "bin" / name), str(src)]
+        # Static when libc.a is installed, so the payloads don't depend on the rootfs' libraries
+        if subprocess.run(compile_cmd + ["-static"], stderr=subprocess.DEVNULL).returncode != 0:
+            subprocess.run(compile_cmd, check=True)
+    return rootfs
+
+
+def bench_runtime(prefix, rootfs, iterations, concurrency):
+    def client(c, runs):
+        latencies, failed = [], 0
+        for _ in range(runs):
+            ms, code = timed_run([str(RUNTIME_BIN), "--quiet", "--exec", f"{prefix}-rt-{c}", str(rootfs), "/bin/hello"])
+            if code == 0:
+                latencies.append(ms)
+            else:
+                failed += 1
+        return latencies, failed
+    return spread(iterations, concurrency, client)
+
+
+def bench_memory(prefix, rootfs, runs, concurrency):
+    """memory_hog under a 32M limit: how long until its cgroup kills it, and how it ended"""
+    exits = {}
+    lock = threading.Lock()
+
+    def client(c, runs):
+        latencies = []
+        for _ in range(runs):
+            name = f"{prefix}-mem-{c}"
+            ms, code = timed_run([str(RUNTIME_BIN), "--quiet", "--memory", "32M", "--exec", name, str(rootfs),
+                                  "/bin/memory_hog"], timeout=30, cgroup=f"minirun-{name}")
+            latencies.append(ms)
+            with lock:
+                exits[str(code)] = exits.get(str(code), 0) + 1
+        return latencies, 0
+    report = spread(runs, min(runs, concurrency), client)
+    report["exit_codes"] = exits  # "None": killed after 30s (e.g. the host swapped instead)
+    return report
+
+
+def bench_cli(prefix, rootfs, iterations, concurrency):
+    names = [f"{prefix}-cli-{c}" for c in range(concurrency)]
+    for name in names:
+        subprocess.run([sys.executable, str(MINIRUN), "create", name, "--rootfs", str(rootfs), "--exec", "/bin/hello"],
+                       stdout=subprocess.DEVNULL, check=True)
+    try:
+        def client(c, runs):
+            latencies, failed = [], 0
+            for _ in range(runs):
+                ms, code = timed_run([sys.executable, str(MINIRUN), "start", names[c]])
+                if code == 0:
+                    latencies.append(ms)
+                else:
+                    failed += 1
+            return latencies, failed
+        return spread(iterations, concurrency, client)
+    finally:
+        for name in names:
+            subprocess.run([sys.executable, str(MINIRUN), "delete", name], stdout=subprocess.DEVNULL)
+
+
+def request(method, url, body=None, timeout=30):
+    """JSON request; returns (status, parsed body)"""
+    data = json.dumps(body).encode() if body is not None else None
+    req = urllib.request.Request(url, data=data, method=method, headers={"Content-Type": "application/json"})
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as resp:
+            return resp.status, json.loads(resp.read() or b"{}")
+    except urllib.error.HTTPError as err:
+        return err.code, json.loads(err.read() or b"{}")
+    except (urllib.error.URLError, OSError):
+        return 0, {}
+
+
+def api_cycle(api, name, rootfs, latencies):
+    """Create, start (until exited), get and delete one container; appends ms per
+    endpoint to latencies and returns whether every step succeeded"""
+    def timed(endpoint, method, url, body=None):
+        start = time.monotonic()
+        status, data = request(method, url, body)
+        latencies.setdefault(endpoint, []).append((time.monotonic() - start) * 1000)
+        return status, data
+
+    status, _ = timed("create", "POST", f"{api}/containers", {"name": name, "rootfs": str(rootfs), "argv": ["/bin/hello"]})
+    ok = status == 200
+    if ok:
+        began = time.monotonic()
+        status, _ = timed("start", "POST", f"{api}/containers/{name}/start")
+        while status == 429:  # Launch queue full: back off like a real client
+            time.sleep(0.05)
+            status, _ = timed("start", "POST", f"{api}/containers/{name}/start")
+        ok = status == 202
+        while ok:
+            status, data = request("GET", f"{api}/containers/{name}/process")
+            process = data.get("data") or {}
+            if status != 200 or process.get("status") in ("stopped", "failed"):
+                ok = status == 200 and process.get("status") == "stopped"
+                break
+            time.sleep(0.005)
+        latencies.setdefault("start_to_exit", []).append((time.monotonic() - began) * 1000)
+        status, _ = timed("get", "GET", f"{api}/containers/{name}")
+        ok = ok and status == 200
+    status, _ = timed("delete", "DELETE", f"{api}/containers/{name}")
+    return ok and status == 200
+
+
+def bench_api(api, prefix, rootfs, iterations, concurrency):
+    per_client = [{} for _ in range(concurrency)]
+
+    def client(c, runs):
+        cycles, failed = [], 0
+        for i in range(runs):
+            start = time.monotonic()
+            if api_cycle(api, f"{prefix}-api-{c}-{i}", rootfs, per_client[c]):
+                cycles.append((time.monotonic() - start) * 1000)
+            else:
+                failed += 1
+        return cycles, failed
+    report = spread(iterations, concurrency, client)  # ops are whole cycles
+    _, health = request("GET", f"{api}/health")
+    report["storage"] = (health.get("data") or {}).get("storage", "unknown")
+    report["endpoints"] = {}
+    for endpoint in ("create", "start", "start_to_exit", "get", "delete"):
+        samples = [ms for latencies in per_client for ms in latencies.get(endpoint, [])]
+        report["endpoints"][endpoint] = summarize(samples, 0)
+    return report
+
+
+def proc_status(pid):
+    """VmRSS (kB), open fds and threads of a process (None if it's gone)"""
+    try:
+        with open(f"/proc/{pid}/status") as f:
+            fields = dict(line.split(":", 1) for line in f if ":" in line)
+        return {"rss_kb": int(fields["VmRSS"].split()[0]), "threads": int(fields["Threads"]),
+                "fds": len(os.listdir(f"/proc/{pid}/fd"))}
+    except (OSError, KeyError, ValueError):
+        return None
+
+
+def host_state(prefix):
+    """What containers can leave behind: their cgroups, host mounts, runtime processes"""
+    try:
+        cgroups = sorted(d for d in os.listdir(CGROUP_ROOT) if d.startswith(f"minirun-{prefix}"))
+    except OSError:
+        cgroups = []
+    with open("/proc/self/mountinfo") as f:
+        mounts = sorted(line.split()[4] for line in f)
+    runtimes = []
+    for pid in filter(str.isdigit, os.listdir("/proc")):
+        try:
+            with open(f"/proc/{pid}/cmdline", "rb") as f:
+                argv = f.read().split(b"\0")
+        except OSError:
+            continue
+        if argv[0].endswith(b"container_runtime") and any(arg.startswith(prefix.encode()) for arg in argv):
+            runtimes.append(int(pid))
+    return {"cgroups": cgroups, "mounts": mounts, "runtimes": runtimes}
+
+
+def bench_soak(api, prefix, rootfs, duration, concurrency, interval, server_pid):
+    deadline = time.monotonic() + duration
+    samples = []
+    stop = threading.Event()
+
+    def sampler():
+        began = time.monotonic()
+        while True:
+            state = host_state(prefix)
+            sample = {"t_s": round(time.monotonic() - began, 1), "cgroups": len(state["cgroups"]),
+                      "mounts": len(state["mounts"]), "runtimes": len(state["runtimes"])}
+            if server_pid:
+                sample.update(proc_status(server_pid) or {})
+            samples.append(sample)
+            if stop.wait(interval):
+                return
+
+    def client(c):
+        latencies, cycles, failed = {}, [], 0
+        i = 0
+        while time.monotonic() < deadline:
+            start = time.monotonic()
+            if api_cycle(api, f"{prefix}-soak-{c}-{i}", rootfs, latencies):
+                cycles.append((time.monotonic() - start) * 1000)
+            else:
+                failed += 1
+            i += 1
+        return cycles, failed
+
+    watcher = threading.Thread(target=sampler)
+    watcher.start()
+    start = time.monotonic()
+    with ThreadPoolExecutor(max_workers=concurrency) as pool:
+        results = list(pool.map(client, range(concurrency)))
+    wall_s = time.monotonic() - start
+    stop.set()
+    watcher.join()
+
+    report = summarize([ms for cycles, _ in results for ms in cycles],
+                       sum(failed for _, failed in results), wall_s)
+    report["duration_s"] = round(wall_s, 1)
+    for field in ("rss_kb", "fds", "threads", "cgroups", "mounts", "runtimes"):
+        values = [s[field] for s in samples if field in s]
+        if values:
+            report[field] = {"first": values[0], "last": values[-1], "max": max(values)}
+    if "rss_kb" in report:
+        report["rss_growth_kb"] = report["rss_kb"]["last"] - report["rss_kb"]["first"]
+    report["samples"] = samples
+    return report
+
+
+def leaks(before, prefix, timeout=30):
+    """Wait for the runtimes to finish, then diff the host against `before`"""
+    deadline = time.monotonic() + timeout
+    after = host_state(prefix)
+    while after["runtimes"] and time.monotonic() < deadline:
+        time.sleep(0.2)
+        after = host_state(prefix)
+    new_mounts = list(after["mounts"])
+    for mount in before["mounts"]:
+        if mount in new_mounts:
+            new_mounts.remove(mount)
+    return {
+        "leaked_cgroups": len(set(after["cgroups"]) - set(before["cgroups"])),
+        "leaked_mounts": len(new_mounts),
+        "leftover_runtimes": len(after["runtimes"]),
+        "detail": {"cgroups": sorted(set(after["cgroups"]) - set(before["cgroups"]))[:20],
+                   "mounts": new_mounts[:20], "runtimes": after["runtimes"][:20]},
+    }
+
+
+def start_orchestrator(binary, workdir):
+    """Run our own orchestrator; returns the process once /health answers"""
+    log = open(Path(workdir) / "orchestrator.log", "w")
+    env = dict(os.environ, MINIRUN_ROOT=str(PROJECT_ROOT))  # Same runtime and store as the other phases
+    proc = subprocess.Popen([binary], stdout=log, stderr=subprocess.STDOUT, env=env)
+    deadline = time.monotonic() + 10
+    while time.monotonic() < deadline:
+        if proc.poll() is not None:
+            raise RuntimeError(f"orchestrator exited with {proc.returncode}, see the log in {workdir}")
+        if request("GET", f"{DEFAULT_API}/health", timeout=1)[0] == 200:
+            return proc
+        time.sleep(0.1)
+    proc.terminate()
+    raise RuntimeError("orchestrator did not come up on :8080")
+
+
+def flatten(report, path=""):
+    """{dotted path: number} of every figure the regression check compares"""
+    figures = {}
+    for key, value in report.items():
+        if key in ("samples", "histogram_ms", "detail"):
+            continue
+        if isinstance(value, dict):
+            figures.update(flatten(value, f"{path}{key}."))
+        elif isinstance(value, (int, float)) and not isinstance(value, bool):
+            figures[path + key] = value
+    return figures
+
+
+def leak_lines(report):
+    """One line per kind of leftover that was found"""
+    return [f"leaks.{key} = {value}" for key, value in report["leaks"].items() if key != "detail" and value]
+
+
+def regressions(report, baseline, tolerance):
+    """Figures that got worse than the baseline by more than tolerance"""
+    found = []
+    current, previous = flatten(report), flatten(baseline or {})
+    for path, base in previous.items():
+        if path not in current:
+            continue
+        value, key = current[path], path.rsplit(".", 1)[-1]
+        if key == "per_sec" and value < base * (1 - tolerance):
+            found.append(f"{path}: {value} < {base} (-{round(100 * (1 - value / base))}%)")
+        elif key in ("p50_ms", "p95_ms") and value > base * (1 + tolerance) + LATENCY_SLACK_MS:
+            found.append(f"{path}: {value}ms > {base}ms")
+        elif key == "rss_growth_kb" and value > max(base, 0) * (1 + tolerance) + RSS_SLACK_KB:
+            found.append(f"{path}: {value}kB > {base}kB")
+    return found
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Load and soak benchmark of runtime, CLI and orchestrator")
+    parser.add_argument("--iterations", type=int, default=500, help="Operations per phase (default: 500)")
+    parser.add_argument("--concurrency", type=int, default=8, help="Parallel clients (default: 8)")
+    parser.add_argument("--memory-runs", type=int, default=8, help="memory_hog containers (default: 8)")
+    parser.add_argument("--duration", type=float, default=300, help="Soak seconds (default: 300)")
+    parser.add_argument("--sample-interval", type=float, default=5, help="Soak sampling period in seconds (default: 5)")
+    parser.add_argument("--phases", default=",".join(PHASES), help=f"Comma-separated subset of {','.join(PHASES)}")
+    parser.add_argument("--rootfs", default=str(DEFAULT_ROOTFS), help="Root filesystem the payloads are added to")
+    parser.add_argument("--orchestrator", help="Orchestrator binary to run for the api and soak phases")
+    parser.add_argument("--api", default=DEFAULT_API, help=f"Running orchestrator otherwise (default: {DEFAULT_API})")
+    parser.add_argument("--output", help="Also write the JSON report to FILE (a later run's --baseline)")
+    parser.add_argument("--baseline", help="Earlier report to compare against; regressions exit 1")
+    parser.add_argument("--tolerance", type=float, default=0.25, help="Allowed relative change (default: 0.25)")
+    args = parser.parse_args()
+
+    phases = [p for p in args.phases.split(",") if p]
+    if any(p not in PHASES for p in phases):
+        print(f"--phases takes {','.join(PHASES)}", file=sys.stderr)
+        return 1
+    if os.geteuid() != 0:
+        print("This benchmark requires root: sudo ./tests/bench/soak.py", file=sys.stderr)
+        return 1
+    if not RUNTIME_BIN.exists():
+        print(f"Runtime not built: {RUNTIME_BIN}", file=sys.stderr)
+        return 1
+    if args.iterations < 1 or args.concurrency < 1 or args.memory_runs < 1:
+        print("--iterations, --concurrency and --memory-runs must be at least 1", file=sys.stderr)
+        return 1
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    prefix = f"soak-{os.getpid()}"
+    workdir = tempfile.mkdtemp(prefix="minirun-soak-")
+    before = host_state(prefix)
+    server = None
+    report = {"iterations": args.iterations, "concurrency": args.concurrency, "phases": {}}
+    try:
+        rootfs = build_rootfs(args.rootfs, workdir)
+        api = args.api.rstrip("/")
+        if args.orchestrator and ("api" in phases or "soak" in phases):
+            server = start_orchestrator(args.orchestrator, workdir)
+            api = DEFAULT_API
+            report["orchestrator_rss_kb"] = (proc_status(server.pid) or {}).get("rss_kb")
+        api_up = request("GET", f"{api}/health", timeout=2)[0] == 200
+
+        for phase in phases:
+            print(f"Phase {phase}...", file=sys.stderr)
+            if phase in ("api", "soak") and not api_up:
+                report["phases"][phase] = {"skipped": f"no orchestrator at {api}"}
+            elif phase == "runtime":
+                report["phases"][phase] = bench_runtime(prefix, rootfs, args.iterations, args.concurrency)
+            elif phase == "memory":
+                if not os.path.exists(f"{CGROUP_ROOT}/cgroup.controllers"):
+                    report["phases"][phase] = {"skipped": "no cgroup v2, memory_hog would never be stopped"}
+                else:
+                    report["phases"][phase] = bench_memory(prefix, rootfs, args.memory_runs, args.concurrency)
+            elif phase == "cli":
+                report["phases"][phase] = bench_cli(prefix, rootfs, args.iterations, args.concurrency)
+            elif phase == "api":
+                report["phases"][phase] = bench_api(api, prefix, rootfs, args.iterations, args.concurrency)
+            elif phase == "soak":
+                report["phases"][phase] = bench_soak(api, prefix, rootfs, args.duration, args.concurrency,
+                                                     args.sample_interval, server.pid if server else None)
+    finally:
+        if server:
+            server.terminate()
+            server.wait()
+        report["leaks"] = leaks(before, prefix)
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    leaked = leak_lines(report)
+    found = regressions(report, baseline, args.tolerance)
+    report["regressions"] = leaked + found
+    text = json.dumps(report, indent=2)
+    print(text)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    for line in leaked:
+        print(f"Leak: {line}", file=sys.stderr)
+    for line in found:
+        print(f"Regression: {line}", file=sys.stderr)
+    return 1 if leaked or found else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
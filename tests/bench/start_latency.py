@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""
+Start latency benchmark: one-shot runtime vs zygote
+
+Measures how long it takes to bring up a container and run a no-op command
+through both start paths:
+1. Cold path: exec bin/container_runtime <name> <rootfs> <command>
+2. Zygote path: one request on the zygote socket (pid reply and exit reply)
+
+Also times a bulk launch (container_runtime --replicas N) and reports the
+supervisor's peak RSS, at the default and at a minimal --stack-size.
+
+Reports p50/p99 per path as JSON. Requires root (namespaces + cgroups).
+
+Usage: sudo ./tests/bench/start_latency.py [--iterations N] [--command CMD] [--replicas N]
+"""
+
+import os
+import sys
+import json
+import time
+import socket
+import argparse
+import subprocess
+from pathlib import Path
+
+PROJECT_ROOT = Path(__file__).resolve().parent.parent.parent
+RUNTIME_BIN = PROJECT_ROOT / "bin" / "container_runtime"
+DEFAULT_ROOTFS = PROJECT_ROOT / "myroot"
+BENCH_SOCKET = "/run/minirun/zygote-bench.sock"
+
+
+def percentile(samples, pct):
+    """Nearest-rank percentile of a list of samples"""
+    ordered = sorted(samples)
+    rank = max(0, min(len(ordered) - 1, int(round(pct / 100.0 * len(ordered))) - 1))
+    return ordered[rank]
+
+
+def summarize(samples_ms):
+    """Reduce raw samples (milliseconds) to the figures we report"""
+    return {
+        "samples": len(samples_ms),
+        "p50_ms": round(percentile(samples_ms, 50), 3),
+        "p99_ms": round(percentile(samples_ms, 99), 3),
+        "mean_ms": round(sum(samples_ms) / len(samples_ms), 3),
+    }
+
+
+def bench_cold(iterations, rootfs, command):
+    """Time full process bring-up through the one-shot runtime"""
+    samples = []
+    for i in range(iterations):
+        start = time.monotonic()
+        subprocess.run(
+            [str(RUNTIME_BIN), f"bench-cold-{os.getpid()}-{i}", str(rootfs), command],
+            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL
+        )
+        samples.append((time.monotonic() - start) * 1000)
+    return samples
+
+
+def bench_zygote(iterations, command):
+    """Time a start request to the zygote until the pid reply and until exit"""
+    to_pid = []
+    to_exit = []
+    devnull = os.open(os.devnull, os.O_RDWR)
+    try:
+        for i in range(iterations):
+            start = time.monotonic()
+            with socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET) as sock:
+                sock.connect(BENCH_SOCKET)
+                request = f"bench-zygote-{os.getpid()}-{i}\0{command}\0".encode()
+                socket.send_fds(sock, [request], [devnull, devnull, devnull])
+                reply = sock.recv(256).decode()
+                to_pid.append((time.monotonic() - start) * 1000)
+                if not reply.startswith("pid "):
+                    raise RuntimeError(f"zygote refused request: {reply.strip()}")
+                sock.recv(256)
+                to_exit.append((time.monotonic() - start) * 1000)
+    finally:
+        os.close(devnull)
+    return to_pid, to_exit
+
+
+def bench_batch(replicas, rootfs, command, stack_size=None):
+    """Time one runtime starting and reaping N replicas, and its peak RSS"""
+    cmd = [str(RUNTIME_BIN)]
+    if stack_size:
+        cmd += ["--stack-size", stack_size]
+    cmd += ["--replicas", str(replicas), f"bench-batch-{os.getpid()}", str(rootfs), command]
+
+    start = time.monotonic()
+    proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    _, _, usage = os.wait4(proc.pid, 0)
+    elapsed_ms = (time.monotonic() - start) * 1000
+    return {
+        "stack_size": stack_size or "default",
+        "wall_ms": round(elapsed_ms, 3),
+        "per_container_ms": round(elapsed_ms / replicas, 3),
+        "max_rss_kb": usage.ru_maxrss,  # Largest of the runtime and its reaped children
+    }
+
+
+def wait_for_socket(path, timeout=5.0):
+    """Wait until the zygote has bound its socket"""
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        if os.path.exists(path):
+            return True
+        time.sleep(0.05)
+    return False
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare cold and zygote start latency")
+    parser.add_argument("--iterations", type=int, default=200, help="Starts per path (default: 200)")
+    parser.add_argument("--rootfs", default=str(DEFAULT_ROOTFS), help="Root filesystem")
+    parser.add_argument("--command", default="true", help="Command run in each container")
+    parser.add_argument("--pool-size", type=int, default=8, help="Zygote pool size")
+    parser.add_argument("--replicas", type=int, default=100, help="Containers in the bulk launch (0 = skip)")
+    args = parser.parse_args()
+
+    if os.geteuid() != 0:
+        print("This benchmark requires root: sudo ./tests/bench/start_latency.py", file=sys.stderr)
+        return 1
+    if not RUNTIME_BIN.exists():
+        print(f"Runtime not built: {RUNTIME_BIN}", file=sys.stderr)
+        return 1
+
+    cold = bench_cold(args.iterations, args.rootfs, args.command)
+    batch = []
+    if args.replicas > 0:
+        batch = [bench_batch(args.replicas, args.rootfs, args.command, size) for size in (None, "64K")]
+
+    # Private zygote so the benchmark never competes with a production one
+    zygote = subprocess.Popen(
+        [str(RUNTIME_BIN), "--zygote", "--socket", BENCH_SOCKET,
+         "--pool-size", str(args.pool_size), args.rootfs],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL
+    )
+    try:
+        if not wait_for_socket(BENCH_SOCKET):
+            print("Zygote did not come up", file=sys.stderr)
+            return 1
+        to_pid, to_exit = bench_zygote(args.iterations, args.command)
+    finally:
+        zygote.terminate()
+        zygote.wait()
+
+    report = {
+        "command": args.command,
+        "iterations": args.iterations,
+        "cold": {"start_to_exit": summarize(cold)},
+        "zygote": {"start_to_pid": summarize(to_pid), "start_to_exit": summarize(to_exit)},
+    }
+    if batch:
+        report["batch"] = {"replicas": args.replicas, "runs": batch}
+    print(json.dumps(report, indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
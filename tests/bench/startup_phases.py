@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+"""
+Start-up phase benchmark: where the time goes between `minirun start` and exit
+
+Starts src/hello.c (built static when possible) as the container command
+thousands of times, first one after another and then from --concurrency
+parallel clients, with MINIRUN_TRACE set. minirun and container_runtime then
+append a CLOCK_MONOTONIC timestamp at the end of every start-up phase to a
+per-run trace file (the runtime's trace ring, see "Trace ring" in
+src/container_runtime.c); each phase is the time since the previous point:
+
+    cli           python3 minirun start, up to the sudo exec
+    sudo          sudo, up to the runtime's main()
+    cgroup_probe  v2 check and cgroup.subtree_control
+    cgroup_mkdir  cgroup_open() (mkdir, or a warm pool slot)
+    cgroup_write  limit knobs
+    clone         runtime to the first instruction of the container
+    cgroup_join   cgroup.procs write (nothing after clone3 CLONE_INTO_CGROUP)
+    net           eth0 moved in and configured (only with --net)
+    chroot        overlay mount and pivot_root()/chroot()
+    proc_mount    /proc mount
+    seccomp       filter installed (only with --seccomp)
+    exec          remaining setup before execl()
+    payload       bash -c hello (hello itself with --exec), until the runtime has reaped it
+
+Phases with no tracepoint on this host (e.g. the cgroup ones without cgroup v2)
+are left out. With --direct the runtime is exec'd without minirun and sudo,
+and the first phase is "runtime_exec". With --exec the payload is exec'd
+directly (container_runtime --exec, minirun create --exec) instead of through
+bash -c, so the two runs show what the shell costs.
+
+Reports p50/p95/p99 per phase as JSON. Requires root (namespaces + cgroups).
+
+Usage: sudo ./tests/bench/startup_phases.py [--iterations N] [--concurrency N] [--direct] [--exec]
+"""
+
+import os
+import sys
+import json
+import time
+import shutil
+import argparse
+import tempfile
+import subprocess
+from pathlib import Path
+from concurrent.futures import ThreadPoolExecutor
+
+from start_latency import percentile
+
+PROJECT_ROOT = Path(__file__).resolve().parent.parent.parent
+RUNTIME_BIN = PROJECT_ROOT / "bin" / "container_runtime"
+MINIRUN = PROJECT_ROOT / "minirun"
+PAYLOAD_SRC = PROJECT_ROOT / "src" / "hello.c"
+DEFAULT_ROOTFS = PROJECT_ROOT / "myroot"
+
+# Tracepoints in start-up order and the phase each one ends
+PHASES = [
+    ("cli", "cli"),
+    ("main", "sudo"),
+    ("cgroup_probe", "cgroup_probe"),
+    ("cgroup_mkdir", "cgroup_mkdir"),
+    ("cgroup_write", "cgroup_write"),
+    ("child", "clone"),
+    ("cgroup_join", "cgroup_join"),
+    ("net", "net"),
+    ("rootfs", "chroot"),
+    ("proc_mount", "proc_mount"),
+    ("seccomp", "seccomp"),
+    ("exec", "exec"),
+    ("exit", "payload"),
+]
+
+
+def build_rootfs(base, workdir):
+    """Copy the rootfs and add the payload as /bin/hello"""
+    rootfs = Path(workdir) / "rootfs"
+    shutil.copytree(base, rootfs, symlinks=True)
+    payload = rootfs / "bin" / "hello"
+    compile_cmd = ["gcc", "-O2", "-o", str(payload), str(PAYLOAD_SRC)]
+    # Static when libc.a is installed, so the payload doesn't depend on the rootfs' libraries
+    if subprocess.run(compile_cmd + ["-static"], stderr=subprocess.DEVNULL).returncode != 0:
+        subprocess.run(compile_cmd, check=True)
+    return rootfs
+
+
+def phase_durations(trace, started_ns):
+    """Turn one run's tracepoints into {phase: microseconds}"""
+    points = {}
+    for line in trace.splitlines():
+        fields = line.split()  # "<phase> <ns> [errno]"
+        if len(fields) >= 2:
+            points.setdefault(fields[0], int(fields[1]))  # First one wins if a point fires twice
+    if "exit" not in points:
+        return None
+
+    durations = {}
+    previous = started_ns
+    for point, phase in PHASES:
+        if point not in points:
+            continue
+        if point == "main" and "cli" not in points:
+            phase = "runtime_exec"
+        durations[phase] = (points[point] - previous) / 1000
+        previous = points[point]
+    durations["total"] = (points["exit"] - started_ns) / 1000
+    return durations
+
+
+def run_once(name, rootfs, trace_path, direct, no_shell):
+    """Start one container with tracing on and return its phase durations (None on failure)"""
+    if direct:
+        cmd = [str(RUNTIME_BIN), "--trace", trace_path] + (["--exec"] if no_shell else []) + [name, str(rootfs), "/bin/hello"]
+        env = None
+    else:
+        cmd = [sys.executable, str(MINIRUN), "start", name]
+        env = dict(os.environ, MINIRUN_TRACE=trace_path)
+
+    started_ns = time.monotonic_ns()
+    result = subprocess.run(cmd, env=env, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        with open(trace_path) as f:
+            trace = f.read()
+        os.unlink(trace_path)
+    except FileNotFoundError:
+        return None
+    if result.returncode != 0:
+        return None
+    return phase_durations(trace, started_ns)
+
+
+def run_client(client, runs, rootfs, workdir, direct, no_shell):
+    """One client starting its container `runs` times in a row"""
+    name = f"bench-phases-{os.getpid()}-{client}"
+    results = []
+    for i in range(runs):
+        trace_path = os.path.join(workdir, f"trace-{client}-{i}")
+        results.append(run_once(name, rootfs, trace_path, direct, no_shell))
+    return results
+
+
+def bench(iterations, concurrency, rootfs, workdir, direct, no_shell):
+    """Run `iterations` starts spread over `concurrency` clients"""
+    runs = [iterations // concurrency + (c < iterations % concurrency) for c in range(concurrency)]
+    start = time.monotonic()
+    with ThreadPoolExecutor(max_workers=concurrency) as pool:
+        # subprocess.run() releases the GIL while it waits, so threads are enough
+        per_client = list(pool.map(lambda c: run_client(c, runs[c], rootfs, workdir, direct, no_shell),
+                                   range(concurrency)))
+    wall_s = time.monotonic() - start
+
+    samples = {}
+    failed = 0
+    for results in per_client:
+        for durations in results:
+            if durations is None:
+                failed += 1
+                continue
+            for phase, us in durations.items():
+                samples.setdefault(phase, []).append(us)
+
+    order = ["runtime_exec"] + [phase for _, phase in PHASES] + ["total"]
+    phases = {}
+    for phase in sorted(samples, key=order.index):
+        values = samples[phase]
+        phases[phase] = {
+            "samples": len(values),
+            "p50_us": round(percentile(values, 50), 1),
+            "p95_us": round(percentile(values, 95), 1),
+            "p99_us": round(percentile(values, 99), 1),
+            "mean_us": round(sum(values) / len(values), 1),
+        }
+    return {
+        "concurrency": concurrency,
+        "runs": iterations,
+        "failed": failed,
+        "starts_per_sec": round(iterations / wall_s, 1),
+        "phases": phases,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Per-phase start-up latency of container_runtime")
+    parser.add_argument("--iterations", type=int, default=2000, help="Starts per mode (default: 2000)")
+    parser.add_argument("--concurrency", type=int, default=8, help="Parallel clients in the concurrent mode (default: 8)")
+    parser.add_argument("--rootfs", default=str(DEFAULT_ROOTFS), help="Root filesystem the payload is added to")
+    parser.add_argument("--direct", action="store_true", help="Exec the runtime directly (no minirun, no sudo)")
+    parser.add_argument("--exec", dest="no_shell", action="store_true", help="Exec the payload without bash -c")
+    args = parser.parse_args()
+
+    if os.geteuid() != 0:
+        print("This benchmark requires root: sudo ./tests/bench/startup_phases.py", file=sys.stderr)
+        return 1
+    if not RUNTIME_BIN.exists():
+        print(f"Runtime not built: {RUNTIME_BIN}", file=sys.stderr)
+        return 1
+    if args.iterations < 1 or args.concurrency < 1:
+        print("--iterations and --concurrency must be at least 1", file=sys.stderr)
+        return 1
+
+    workdir = tempfile.mkdtemp(prefix="minirun-phases-")
+    names = [f"bench-phases-{os.getpid()}-{c}" for c in range(args.concurrency)]
+    try:
+        rootfs = build_rootfs(args.rootfs, workdir)
+        if not args.direct:
+            for name in names:
+                command = ["--exec", "/bin/hello"] if args.no_shell else ["--command", "/bin/hello"]
+                subprocess.run([sys.executable, str(MINIRUN), "create", name, "--rootfs", str(rootfs)] + command,
+                               stdout=subprocess.DEVNULL, check=True)
+
+        report = {
+            "payload": "hello.c" if args.no_shell else "bash -c hello.c",
+            "path": "runtime" if args.direct else "minirun",
+            "sequential": bench(args.iterations, 1, rootfs, workdir, args.direct, args.no_shell),
+            "concurrent": bench(args.iterations, args.concurrency, rootfs, workdir, args.direct, args.no_shell),
+        }
+    finally:
+        if not args.direct:
+            for name in names:
+                subprocess.run([sys.executable, str(MINIRUN), "delete", name], stdout=subprocess.DEVNULL)
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    print(json.dumps(report, indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -7,6 +7,9 @@ Tests the Python CLI interface to ensure:
 2. Container listing works
 3. Container deletion works
 4. Error handling is correct
+5. Image store deduplicates rootfs content
+6. Resource limits are stored with the container
+7. The state store takes concurrent writers
 """
 
 import sys
@@ -104,6 +107,16 @@ def test_cli_help():
     
     return True
 
+def stored_config(name):
+    """A container's config as the state store has it (minirun info --json), or None"""
+    returncode, stdout, stderr = run_command(f"{PROJECT_ROOT}/minirun info {name} --json", check=False)
+    if returncode != 0:
+        return None
+    try:
+        return json.loads(stdout)
+    except json.JSONDecodeError:
+        return None
+
 def test_container_create():
     """Test 3: Test container creation"""
     print("\n[Test 3: Container Creation]")
@@ -122,33 +135,24 @@ def test_container_create():
         print_error(f"Container creation failed: {stderr}")
         return False
     
-    # Verify container config file exists
-    config_file = PROJECT_ROOT / "containers" / f"{test_name}.json"
-    if config_file.exists():
-        print_success("Container config file created")
+    # Verify the state store has the container
+    config = stored_config(test_name)
+    if config is not None:
+        print_success("Container config stored")
     else:
-        print_error("Container config file not found")
+        print_error("Container config not found in the state store")
         return False
     
-    # Verify config file is valid JSON
-    try:
-        with open(config_file, 'r') as f:
-            config = json.load(f)
-        print_success("Container config is valid JSON")
-        
-        # Check required fields
-        if config.get('name') == test_name:
-            print_success("Container config has correct name")
-        else:
-            print_error("Container config has incorrect name")
+    # Check required fields
+    if config.get('name') == test_name:
+        print_success("Container config has correct name")
+    else:
+        print_error("Container config has incorrect name")
         
-        if 'rootfs' in config and 'command' in config:
-            print_success("Container config has required fields")
-        else:
-            print_error("Container config missing required fields")
-    except json.JSONDecodeError:
-        print_error("Container config is not valid JSON")
-        return False
+    if 'rootfs' in config and 'command' in config and config.get('status') == 'created':
+        print_success("Container config has required fields")
+    else:
+        print_error("Container config missing required fields")
     
     # Cleanup
     run_command(f"{PROJECT_ROOT}/minirun delete {test_name}", check=False)
@@ -231,8 +235,7 @@ def test_container_delete():
     run_command(f"{PROJECT_ROOT}/minirun create {test_name}", check=False)
     
     # Verify it exists
-    config_file = PROJECT_ROOT / "containers" / f"{test_name}.json"
-    if not config_file.exists():
+    if stored_config(test_name) is None:
         print_error("Container was not created properly")
         return False
     
@@ -249,10 +252,10 @@ def test_container_delete():
         return False
     
     # Verify it's gone
-    if not config_file.exists():
-        print_success("Container config file removed")
+    if stored_config(test_name) is None:
+        print_success("Container config removed")
     else:
-        print_error("Container config file still exists")
+        print_error("Container config still exists")
         return False
     
     return True
@@ -297,11 +300,328 @@ def test_error_handling():
     else:
         print_error("Duplicate container creation should fail")
     
+    # Names that are not a single path component must be rejected
+    for bad_name in ("../x", "a/b"):
+        returncode, stdout, stderr = run_command(
+            f"{PROJECT_ROOT}/minirun create {bad_name}",
+            check=False
+        )
+        
+        if returncode != 0 and "Invalid container name" in stdout:
+            print_success(f"Container name '{bad_name}' properly rejected")
+        else:
+            print_error(f"Container name '{bad_name}' should be rejected")
+    
     # Cleanup
     run_command(f"{PROJECT_ROOT}/minirun delete {test_name}", check=False)
     
     return True
 
+def test_image_store():
+    """Test 8: Test image import, dedup and create --image"""
+    print("\n[Test 8: Image Store]")
+    
+    work_dir = Path(tempfile.mkdtemp())
+    env = f"MINIRUN_IMAGE_STORE={work_dir / 'store'}"
+    test_name = f"test-image-{os.getpid()}"
+    
+    try:
+        # Two rootfs trees that share one file
+        for tree, extra in (("a", "one"), ("b", "two")):
+            (work_dir / tree / "bin").mkdir(parents=True)
+            (work_dir / tree / "bin" / "tool").write_text("shared content\n")
+            (work_dir / tree / "extra").write_text(extra)
+        
+        returncode, stdout, stderr = run_command(
+            f"{env} {PROJECT_ROOT}/minirun image import {work_dir / 'a'} --tag img-a", check=False)
+        run_command(f"{env} {PROJECT_ROOT}/minirun image import {work_dir / 'b'} --tag img-b", check=False)
+        
+        if returncode == 0 and "sha256:" in stdout:
+            print_success("Image import returns a digest")
+        else:
+            print_error(f"Image import failed: {stderr}")
+            return False
+        
+        blobs = list((work_dir / "store" / "blobs" / "sha256").iterdir())
+        if len(blobs) == 3:
+            print_success("Identical files are stored once")
+        else:
+            print_error(f"Expected 3 blobs, found {len(blobs)}")
+        
+        trees = list((work_dir / "store" / "rootfs").iterdir())
+        tool_inodes = {os.stat(t / "bin" / "tool").st_ino for t in trees}
+        if len(trees) == 2 and len(tool_inodes) == 1:
+            print_success("Image trees hardlink shared content")
+        else:
+            print_error("Image trees don't share the common file")
+        
+        returncode, stdout, stderr = run_command(
+            f"{env} {PROJECT_ROOT}/minirun create {test_name} --image img-a", check=False)
+        config = stored_config(test_name)
+        if returncode == 0 and config and config["rootfs"].startswith("sha256:"):
+            print_success("Container created from image stores its digest")
+        else:
+            print_error(f"Create --image failed: {stderr}")
+        
+        returncode, stdout, stderr = run_command(
+            f"{env} {PROJECT_ROOT}/minirun create {test_name}-missing --image no-such-image", check=False)
+        if returncode != 0:
+            print_success("Unknown image is rejected")
+        else:
+            print_error("Create with an unknown image should fail")
+    finally:
+        run_command(f"{PROJECT_ROOT}/minirun delete {test_name}", check=False)
+        shutil.rmtree(work_dir, ignore_errors=True)
+    
+    return True
+
+def test_resource_limits():
+    """Test 9: Test create with resource limits"""
+    print("\n[Test 9: Resource Limits]")
+    
+    test_name = f"test-limits-{os.getpid()}"
+    
+    try:
+        returncode, stdout, stderr = run_command(
+            f"{PROJECT_ROOT}/minirun create {test_name} --memory 1G --cpu 250 --cpu-period 10000 "
+            f"--cpuset-cpus 0-1 --io-max '8:0 rbps=1048576' --pids-max 64",
+            check=False
+        )
+        if returncode != 0:
+            print_error(f"Create with limits failed: {stderr}")
+            return False
+    
+        limits = (stored_config(test_name) or {}).get("limits", {})
+        expected = {"memory": 1 << 30, "cpu": 250, "cpu_period": 10000, "cpuset_cpus": "0-1",
+                    "io_max": ["8:0 rbps=1048576"], "pids_max": 64}
+        if limits == expected:
+            print_success("Limits are stored in the container config")
+        else:
+            print_error(f"Unexpected limits: {limits}")
+    
+        returncode, stdout, stderr = run_command(f"{PROJECT_ROOT}/minirun info {test_name}", check=False)
+        if "cpu: 250% of one core" in stdout and "memory: 1024MB" in stdout:
+            print_success("Info shows configured limits")
+        else:
+            print_error("Info does not show limits")
+    
+        returncode, stdout, stderr = run_command(
+            f"{PROJECT_ROOT}/minirun create {test_name}-bad --memory lots", check=False)
+        if returncode != 0:
+            print_success("Invalid memory size is rejected")
+        else:
+            print_error("Create with an invalid size should fail")
+            run_command(f"{PROJECT_ROOT}/minirun delete {test_name}-bad", check=False)
+    finally:
+        run_command(f"{PROJECT_ROOT}/minirun delete {test_name}", check=False)
+    
+    return True
+
+def test_state_store():
+    """Test 10: Test concurrent writers of the state store"""
+    print("\n[Test 10: State Store]")
+
+    test_name = f"test-store-{os.getpid()}"
+    names = [f"{test_name}-{i}" for i in range(8)]
+
+    try:
+        # Eight CLIs creating the same name at once: exactly one wins
+        racers = [subprocess.Popen([str(PROJECT_ROOT / "minirun"), "create", test_name],
+                                   stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL) for _ in range(8)]
+        wins = sum(p.wait() == 0 for p in racers)
+        if wins == 1:
+            print_success("Concurrent creates of one name: exactly one succeeds")
+        else:
+            print_error(f"Concurrent creates of one name: {wins} succeeded")
+
+        # Eight different names at once: none lost
+        writers = [subprocess.Popen([str(PROJECT_ROOT / "minirun"), "create", name],
+                                    stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL) for name in names]
+        for p in writers:
+            p.wait()
+        returncode, stdout, stderr = run_command(f"{PROJECT_ROOT}/minirun list --names", check=False)
+        listed = set(stdout.split())
+        if returncode == 0 and set(names) <= listed:
+            print_success("Concurrent creates are all listed")
+        else:
+            print_error(f"Missing after concurrent creates: {sorted(set(names) - listed)}")
+
+        if not any((PROJECT_ROOT / "containers" / f"{name}.json").exists() for name in names):
+            print_success("No per-container JSON files written")
+        else:
+            print_error("Per-container JSON files were written")
+    finally:
+        for name in [test_name] + names:
+            run_command(f"{PROJECT_ROOT}/minirun delete {name}", check=False)
+
+    if stored_config(names[0]) is None and test_name not in run_command(
+            f"{PROJECT_ROOT}/minirun list --names", check=False)[1].split():
+        print_success("Deleted containers are gone from lookups and listings")
+    else:
+        print_error("Deleted containers are still in the store")
+
+    return True
+
+def test_checkpoint_restore():
+    """Test 11: Test checkpoint/restore argument and state handling (no CRIU needed)"""
+    print("\n[Test 11: Checkpoint and Restore]")
+
+    test_name = f"test-ckpt-{os.getpid()}"
+    run_command(f"{PROJECT_ROOT}/minirun create {test_name}", check=False)
+
+    try:
+        # Only a running container has processes to save
+        returncode, stdout, stderr = run_command(f"{PROJECT_ROOT}/minirun checkpoint {test_name}", check=False)
+        if returncode != 0 and "not running" in stdout:
+            print_success("Checkpoint of a stopped container properly fails")
+        else:
+            print_error("Checkpoint of a stopped container should fail")
+
+        returncode, stdout, stderr = run_command(
+            f"{PROJECT_ROOT}/minirun restore {test_name} --as {test_name}-copy", check=False)
+        if returncode != 0 and "No checkpoint" in stdout:
+            print_success("Restore without a checkpoint properly fails")
+        else:
+            print_error("Restore without a checkpoint should fail")
+
+        if stored_config(f"{test_name}-copy") is None:
+            print_success("Failed restore creates no container")
+        else:
+            print_error("Failed restore left a container behind")
+
+        returncode, stdout, stderr = run_command(f"{PROJECT_ROOT}/minirun restore {test_name}", check=False)
+        if returncode != 0:
+            print_success("Restore requires --as")
+        else:
+            print_error("Restore without --as should fail")
+    finally:
+        run_command(f"{PROJECT_ROOT}/minirun delete {test_name}", check=False)
+        run_command(f"{PROJECT_ROOT}/minirun delete {test_name}-copy", check=False)
+
+    return True
+
+def test_live_update():
+    """Test 12: Test update of stored limits and pause/resume state checks"""
+    print("\n[Test 12: Live Updates]")
+
+    test_name = f"test-update-{os.getpid()}"
+    run_command(f"{PROJECT_ROOT}/minirun create {test_name} --memory 256M --cpu 150", check=False)
+
+    try:
+        # Not running: only the stored limits change, and unchanged ones are kept
+        returncode, stdout, stderr = run_command(
+            f"{PROJECT_ROOT}/minirun update {test_name} --cpu 300 --pids-max 64", check=False)
+        limits = (stored_config(test_name) or {}).get("limits", {})
+        if returncode == 0 and limits == {"memory": 256 * 1024 * 1024, "cpu": 300, "pids_max": 64}:
+            print_success("Update merges new limits into the stored ones")
+        else:
+            print_error(f"Unexpected limits after update: {limits}")
+
+        returncode, stdout, stderr = run_command(f"{PROJECT_ROOT}/minirun update {test_name}", check=False)
+        if returncode != 0 and "Nothing to update" in stdout:
+            print_success("Update without limits properly fails")
+        else:
+            print_error("Update without limits should fail")
+
+        returncode, stdout, stderr = run_command(f"{PROJECT_ROOT}/minirun update {test_name} --memory 1X", check=False)
+        if returncode != 0:
+            print_success("Update with an invalid size properly fails")
+        else:
+            print_error("Update with an invalid size should fail")
+
+        for action in ("pause", "resume"):
+            returncode, stdout, stderr = run_command(f"{PROJECT_ROOT}/minirun {action} {test_name}", check=False)
+            if returncode != 0 and "not running" in stdout:
+                print_success(f"{action.capitalize()} of a stopped container properly fails")
+            else:
+                print_error(f"{action.capitalize()} of a stopped container should fail")
+    finally:
+        run_command(f"{PROJECT_ROOT}/minirun delete {test_name}", check=False)
+
+    return True
+
+def test_seccomp_profile():
+    """Test 13: Test that --seccomp profiles are checked and stored with the container"""
+    print("\n[Test 13: Seccomp Profiles]")
+
+    test_name = f"test-seccomp-{os.getpid()}"
+    workdir = tempfile.mkdtemp(prefix="minirun-seccomp-")
+    profile = Path(workdir) / "deny.profile"
+    profile.write_text("default allow\nerrno mount umount2 ptrace\n")
+
+    try:
+        returncode, stdout, stderr = run_command(
+            f"{PROJECT_ROOT}/minirun create {test_name} --seccomp {workdir}/missing.profile", check=False)
+        if returncode != 0 and "not found" in stdout and stored_config(test_name) is None:
+            print_success("Create with a missing profile properly fails")
+        else:
+            print_error("Create with a missing profile should fail")
+
+        # Relative paths are stored absolute, so start works from any directory
+        returncode, stdout, stderr = run_command(
+            f"cd {workdir} && {PROJECT_ROOT}/minirun create {test_name} --seccomp deny.profile", check=False)
+        config = stored_config(test_name) or {}
+        if returncode == 0 and config.get("seccomp") == str(profile.resolve()):
+            print_success("Profile path is stored with the container")
+        else:
+            print_error(f"Unexpected stored profile: {config.get('seccomp')}")
+
+        returncode, stdout, stderr = run_command(f"{PROJECT_ROOT}/minirun info {test_name}", check=False)
+        if returncode == 0 and "Seccomp profile" in stdout:
+            print_success("Info shows the profile")
+        else:
+            print_error("Info should show the profile")
+
+        returncode, stdout, stderr = run_command(f"{PROJECT_ROOT}/minirun start {test_name} --zygote", check=False)
+        if returncode != 0 and "without --zygote" in stdout:
+            print_success("Zygote start of a filtered container properly fails")
+        else:
+            print_error("Zygote start of a filtered container should fail")
+    finally:
+        run_command(f"{PROJECT_ROOT}/minirun delete {test_name}", check=False)
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    return True
+
+def test_direct_exec():
+    """Test 14: Test that --exec stores an argv and --init is stored with the container"""
+    print("\n[Test 14: Direct Exec]")
+
+    test_name = f"test-exec-{os.getpid()}"
+
+    try:
+        returncode, stdout, stderr = run_command(
+            f"{PROJECT_ROOT}/minirun create {test_name} --init --exec /bin/echo --name 'a b'", check=False)
+        config = stored_config(test_name) or {}
+        if returncode == 0 and config.get("argv") == ["/bin/echo", "--name", "a b"] and config.get("init"):
+            print_success("Argv (options included) and init are stored with the container")
+        else:
+            print_error(f"Unexpected stored argv/init: {config.get('argv')} {config.get('init')}")
+
+        if config.get("command") == "/bin/echo --name 'a b'":
+            print_success("Command holds the quoted argv for display")
+        else:
+            print_error(f"Unexpected command: {config.get('command')}")
+
+        returncode, stdout, stderr = run_command(f"{PROJECT_ROOT}/minirun start {test_name} --zygote", check=False)
+        if returncode != 0 and "without --zygote" in stdout:
+            print_success("Zygote start of an --init container properly fails")
+        else:
+            print_error("Zygote start of an --init container should fail")
+
+        for args in ("--exec", "--command /bin/sh --exec /bin/echo"):
+            returncode, stdout, stderr = run_command(
+                f"{PROJECT_ROOT}/minirun create {test_name}-bad {args}", check=False)
+            if returncode != 0 and stored_config(f"{test_name}-bad") is None:
+                print_success(f"Create with {args} properly fails")
+            else:
+                print_error(f"Create with {args} should fail")
+    finally:
+        run_command(f"{PROJECT_ROOT}/minirun delete {test_name}", check=False)
+        run_command(f"{PROJECT_ROOT}/minirun delete {test_name}-bad", check=False)
+
+    return True
+
 def main():
     """Run all integration tests"""
     print("╔════════════════════════════════════════════════╗")
@@ -316,6 +636,13 @@ def main():
     test_container_info()
     test_container_delete()
     test_error_handling()
+    test_image_store()
+    test_resource_limits()
+    test_state_store()
+    test_checkpoint_restore()
+    test_live_update()
+    test_seccomp_profile()
+    test_direct_exec()
     
     # Summary
     print("\n════════════════════════════════════════════════")
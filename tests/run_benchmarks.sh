@@ -0,0 +1,67 @@
+#!/bin/bash
+
+
+# MiniRun Container Runtime - Benchmark Runner
+#
+# Times every start-up phase of the runtime (CLI, sudo, cgroup probe/mkdir/
+# writes, clone, cgroup join, chroot, /proc mount, exec) with hello.c as the
+# payload and prints p50/p95/p99 per phase as JSON
+#
+# Usage: sudo ./tests/run_benchmarks.sh [options]
+# Options:
+#   --iterations N   Starts per mode (default: 2000)
+#   --concurrency N  Parallel clients in the concurrent mode (default: 8)
+#   --direct         Exec the runtime directly (skips the CLI and sudo phases)
+#   --exec           Exec hello.c without bash -c (container_runtime --exec)
+#   --output FILE    Also write the JSON report to FILE
+
+
+set -e  # Exit on error
+
+# Directories
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+BENCH_DIR="$SCRIPT_DIR/bench"
+
+OUTPUT=""
+BENCH_ARGS=()
+
+while [[ $# -gt 0 ]]; do
+    case $1 in
+        --iterations|--concurrency)
+            BENCH_ARGS+=("$1" "$2")
+            shift 2
+            ;;
+        --direct|--exec)
+            BENCH_ARGS+=("$1")
+            shift
+            ;;
+        --output)
+            OUTPUT="$2"
+            shift 2
+            ;;
+        -h|--help)
+            sed -n '4,16p' "$0" | sed 's/^# \{0,1\}//'
+            exit 0
+            ;;
+        *)
+            echo "Unknown option: $1"
+            exit 1
+            ;;
+    esac
+done
+
+cd "$PROJECT_ROOT"
+
+# The trace ring is part of the normal build, so benchmark what users run
+if [ ! -x bin/container_runtime ] || [ src/container_runtime.c -nt bin/container_runtime ]; then
+    echo "Building bin/container_runtime..." >&2
+    mkdir -p bin
+    gcc -o bin/container_runtime src/container_runtime.c -Wall -Wextra
+fi
+
+if [ -n "$OUTPUT" ]; then
+    python3 "$BENCH_DIR/startup_phases.py" "${BENCH_ARGS[@]}" | tee "$OUTPUT"
+else
+    python3 "$BENCH_DIR/startup_phases.py" "${BENCH_ARGS[@]}"
+fi
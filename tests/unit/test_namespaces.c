@@ -5,6 +5,7 @@
  * Tests:
  * 1. PID namespace isolation (getpid() returns 1 in child)
  * 2. Mount namespace isolation (changes don't affect parent)
+ * 3. Network namespace isolation (only lo, none of the host's interfaces)
  */
 
 #define _GNU_SOURCE
@@ -16,6 +17,7 @@
 #include <sys/mount.h>
 #include <string.h>
 #include <errno.h>
+#include <net/if.h>
 
 // Test results
 int tests_passed = 0;
@@ -213,6 +215,61 @@ void test_combined_namespace_creation() {
     free(stack);
 }
 
+/*
+ * Test 6: Verify Network namespace isolation (container_runtime --net)
+ * A new network namespace starts with nothing but a loopback device
+ */
+int test_network_namespace(void* arg) {
+    (void)arg;
+
+    struct if_nameindex* links = if_nameindex();
+    if (links == NULL) {
+        return 2;
+    }
+    int count = 0;
+    int has_lo = 0;
+    for (struct if_nameindex* link = links; link->if_index != 0; link++) {
+        count++;
+        has_lo |= strcmp(link->if_name, "lo") == 0;
+    }
+    if_freenameindex(links);
+
+    return count == 1 && has_lo ? 0 : 1;
+}
+
+void test_network_namespace_creation() {
+    printf("\n[Test 4: Network Namespace Isolation]\n");
+
+    void* stack = malloc(1024 * 1024);
+    if (stack == NULL) {
+        printf("  ✗ FAIL: Could not allocate stack\n");
+        tests_failed++;
+        return;
+    }
+
+    pid_t child_pid = clone(
+        test_network_namespace,
+        stack + (1024 * 1024),
+        CLONE_NEWPID | CLONE_NEWNS | CLONE_NEWNET | SIGCHLD,
+        NULL
+    );
+
+    if (child_pid == -1) {
+        printf("  ✗ FAIL: Could not create child with a network namespace: %s\n", strerror(errno));
+        tests_failed++;
+        free(stack);
+        return;
+    }
+
+    int status;
+    waitpid(child_pid, &status, 0);
+
+    // The child's ASSERTs would only count in its copy of the counters, so it reports through its exit code
+    ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0, "Only lo is visible in the new network namespace");
+
+    free(stack);
+}
+
 /*
  * Main test runner
  */
@@ -232,6 +289,7 @@ int main() {
     test_namespace_creation();
     test_mount_namespace_creation();
     test_combined_namespace_creation();
+    test_network_namespace_creation();
     
     // Summary
     printf("\n════════════════════════════════════════════════\n");